@@ -51,6 +51,7 @@ static void AdiDebugInit()
         /* Error handling */
     	AdiLogError(AppThread_c, __LINE__, status);
         AdiAppErrorHandler(status);
+        return;
     }
 
     /* Set UART configuration */
@@ -69,6 +70,7 @@ static void AdiDebugInit()
     {
     	AdiLogError(AppThread_c, __LINE__, status);
     	AdiAppErrorHandler(status);
+    	return;
     }
 
     /* Set the UART transfer to a really large value. */
@@ -77,6 +79,7 @@ static void AdiDebugInit()
     {
     	AdiLogError(AppThread_c, __LINE__, status);
     	AdiAppErrorHandler(status);
+    	return;
     }
 
     /* Initialize the debug module. */
@@ -85,6 +88,7 @@ static void AdiDebugInit()
     {
     	AdiLogError(AppThread_c, __LINE__, status);
     	AdiAppErrorHandler(status);
+    	return;
     }
 
     /* Turn off the preamble to the debug messages. */
@@ -138,12 +142,22 @@ static void AdiAppInit ()
 		serial_number[i*16+14] = hex_digit[(die_id[1-i] >>  0) & 0xF];
 	}
 
+	/* Create the event groups used by all threads */
+	AdiEventInit();
+
+	/* Initialize the peripherals which do not depend on the USB connection speed (before any flash writes) */
+	AdiBoardInit();
+
+	/* Load the fatal error recovery mode and the last recovery reset reason */
+	AdiRecoveryInit();
+
 	/* Start the USB functionality. */
     status = CyU3PUsbStart();
     if (status != CY_U3P_SUCCESS)
     {
     	AdiLogError(AppThread_c, __LINE__, status);
         AdiAppErrorHandler(status);
+        return;
     }
     else
     {
@@ -169,6 +183,7 @@ static void AdiAppInit ()
     {
     	AdiLogError(AppThread_c, __LINE__, status);
         AdiAppErrorHandler(status);
+        return;
     }
 
     /* Full speed configuration descriptor */
@@ -177,6 +192,7 @@ static void AdiAppInit ()
     {
     	AdiLogError(AppThread_c, __LINE__, status);
         AdiAppErrorHandler(status);
+        return;
     }
 
     /* Super speed configuration descriptor */
@@ -185,6 +201,7 @@ static void AdiAppInit ()
     {
     	AdiLogError(AppThread_c, __LINE__, status);
         AdiAppErrorHandler(status);
+        return;
     }
 
     /* BOS descriptor */
@@ -193,6 +210,7 @@ static void AdiAppInit ()
     {
     	AdiLogError(AppThread_c, __LINE__, status);
         AdiAppErrorHandler(status);
+        return;
     }
 
     /* High speed device descriptor. */
@@ -201,6 +219,7 @@ static void AdiAppInit ()
     {
     	AdiLogError(AppThread_c, __LINE__, status);
         AdiAppErrorHandler(status);
+        return;
     }
 
     /* Device qualifier descriptor */
@@ -209,6 +228,7 @@ static void AdiAppInit ()
     {
     	AdiLogError(AppThread_c, __LINE__, status);
         AdiAppErrorHandler(status);
+        return;
     }
 
     /* High speed configuration descriptor */
@@ -217,6 +237,7 @@ static void AdiAppInit ()
     {
     	AdiLogError(AppThread_c, __LINE__, status);
         AdiAppErrorHandler(status);
+        return;
     }
 
     /* String descriptor 0 */
@@ -225,6 +246,7 @@ static void AdiAppInit ()
     {
     	AdiLogError(AppThread_c, __LINE__, status);
         AdiAppErrorHandler(status);
+        return;
     }
 
     /* String descriptor 1 */
@@ -233,6 +255,7 @@ static void AdiAppInit ()
     {
     	AdiLogError(AppThread_c, __LINE__, status);
         AdiAppErrorHandler(status);
+        return;
     }
 
     /* String descriptor 2 */
@@ -241,6 +264,7 @@ static void AdiAppInit ()
     {
     	AdiLogError(AppThread_c, __LINE__, status);
         AdiAppErrorHandler(status);
+        return;
     }
 
     /* Serial number descriptor */
@@ -249,6 +273,7 @@ static void AdiAppInit ()
     {
     	AdiLogError(AppThread_c, __LINE__, status);
     	AdiAppErrorHandler(status);
+    	return;
     }
 
     /* Connect the USB Pins with high speed operation enabled (USB 2.0 for better compatibility) */
@@ -258,6 +283,7 @@ static void AdiAppInit ()
     	AdiLogError(AppThread_c, __LINE__, status);
         AdiAppErrorHandler(status);
     }
+    AdiBootCheckpoint(BootCheckpointConnect);
 }
 
 /**
@@ -289,7 +315,14 @@ void AdiAppThreadEntry (uint32_t input)
     		ADI_TRANSFER_STREAM_STOP |
     		ADI_I2C_STREAM_DONE |
     		ADI_I2C_STREAM_START |
-    		ADI_I2C_STREAM_STOP;
+    		ADI_I2C_STREAM_STOP |
+    		ADI_ERROR_LOG_DUMP |
+    		ADI_FLASH_BULK_READ |
+    		ADI_RUN_BOOT_SCRIPT |
+    		ADI_IMAGE_UPDATE |
+    		ADI_APP_RECOVER |
+    		ADI_STREAM_RESUME |
+    		ADI_ERROR_LOG_FLUSH;
 
     /* Event flags */
     uint32_t eventFlag;
@@ -420,6 +453,57 @@ void AdiAppThreadEntry (uint32_t input)
 #endif
 			}
 
+			/* Handle error log flush requested by a vendor command */
+			if (eventFlag & ADI_ERROR_LOG_FLUSH)
+			{
+				AdiFlushErrorLog();
+#ifdef VERBOSE_MODE
+				CyU3PDebugPrint (4, "Error log flush finished.\r\n");
+#endif
+			}
+
+			/* Handle error log dump */
+			if (eventFlag & ADI_ERROR_LOG_DUMP)
+			{
+				AdiErrorLogDumpWork();
+#ifdef VERBOSE_MODE
+				CyU3PDebugPrint (4, "Error log dump finished.\r\n");
+#endif
+			}
+
+			/* Handle bulk flash read */
+			if (eventFlag & ADI_FLASH_BULK_READ)
+			{
+				AdiFlashBulkReadWork();
+#ifdef VERBOSE_MODE
+				CyU3PDebugPrint (4, "Bulk flash read finished.\r\n");
+#endif
+			}
+
+			/* Handle boot script execution */
+			if (eventFlag & ADI_RUN_BOOT_SCRIPT)
+			{
+				AdiRunBootScript();
+			}
+
+			/* Handle stored image update */
+			if (eventFlag & ADI_IMAGE_UPDATE)
+			{
+				AdiImageUpdateWork();
+			}
+
+			/* Handle application soft restart after a fatal error */
+			if (eventFlag & ADI_APP_RECOVER)
+			{
+				AdiAppRecover();
+			}
+
+			/* Handle stream resume after a USB reset */
+			if (eventFlag & ADI_STREAM_RESUME)
+			{
+				AdiStreamResume();
+			}
+
     	}
         /* Allow other ready threads to run. */
         CyU3PThreadRelinquish();
@@ -98,4 +98,25 @@ void AdiAppThreadEntry(uint32_t input);
 /** I2C read stream enable */
 #define ADI_I2C_STREAM_ENABLE					(1 << 20)
 
+/** Stream the flash error log to the PC over the bulk endpoint */
+#define ADI_ERROR_LOG_DUMP						(1 << 21)
+
+/** Stream a block of flash memory to the PC over the bulk endpoint */
+#define ADI_FLASH_BULK_READ						(1 << 22)
+
+/** Run the flash stored boot script */
+#define ADI_RUN_BOOT_SCRIPT						(1 << 23)
+
+/** Program a stored image from the bulk endpoint */
+#define ADI_IMAGE_UPDATE						(1 << 24)
+
+/** Soft restart the application after a fatal error */
+#define ADI_APP_RECOVER							(1 << 25)
+
+/** Resume a stream suspended by a USB reset */
+#define ADI_STREAM_RESUME						(1 << 26)
+
+/** Write any rate limited error log data to flash */
+#define ADI_ERROR_LOG_FLUSH						(1 << 27)
+
 #endif
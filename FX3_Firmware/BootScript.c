@@ -0,0 +1,474 @@
+/**
+  * Copyright (c) Analog Devices Inc, 2018 - 2020
+  * All Rights Reserved.
+  *
+  * THIS SOFTWARE UTILIZES LIBRARIES DEVELOPED
+  * AND MAINTAINED BY CYPRESS INC. THE LICENSE INCLUDED IN
+  * THIS REPOSITORY DOES NOT EXTEND TO CYPRESS PROPERTY.
+  *
+  * Use of this file is governed by the license agreement
+  * included in this repository.
+  *
+  * @file		BootScript.c
+  * @date		10/17/2020
+  * @author		A. Nolan (alex.nolan@analog.com)
+  * @brief		Implementation file for the flash stored DUT boot script engine
+ **/
+
+#include "BootScript.h"
+
+/* Private function prototypes */
+static CyBool_t ReadScriptHeader(ScriptHeader* Header);
+static CyU3PReturnStatus_t ExecuteScript(uint8_t* Script, uint16_t Length);
+static CyU3PReturnStatus_t ValidateScript(uint8_t* Script, uint16_t Length);
+static CyU3PReturnStatus_t CheckCommand(uint8_t* Script, uint16_t Offset, uint16_t Length, uint16_t* ArgLength);
+static uint32_t ParseU32(uint8_t* Buf);
+static void ScriptStall();
+
+/* Tell the compiler where to find the needed globals */
+extern BoardState FX3State;
+extern uint8_t USBBuffer[4096];
+extern CyU3PEvent EventHandler;
+
+/** Current boot script state */
+static ScriptState State = ScriptNotPresent;
+
+/** Number of script commands executed in the last run */
+static uint16_t CommandsRun = 0;
+
+/** Script body offset of the command which failed (last run) */
+static uint16_t FailOffset = 0;
+
+/** Status code of the last script run */
+static uint32_t LastStatus = CY_U3P_SUCCESS;
+
+/** Stored script body length */
+static uint16_t ScriptLength = 0;
+
+/** Run time of the last script run, in ms */
+static uint32_t RunTimeMs = 0;
+
+/** Track if the boot time script check has been performed */
+static CyBool_t BootCheckDone = CyFalse;
+
+/**
+  * @brief Checks for a stored boot script at application start
+  *
+  * @return void
+  *
+  * This function should be called at the end of AdiAppStart. On the first application
+  * start after boot, if a valid script with SCRIPT_FLAG_RUN_AT_BOOT is stored in flash,
+  * the AppThread is signaled to run it. Subsequent application starts (re-enumeration)
+  * do not re-run the script.
+ **/
+void AdiBootScriptAppStart()
+{
+	ScriptHeader header;
+	CyU3PReturnStatus_t status;
+
+	if(BootCheckDone)
+		return;
+	BootCheckDone = CyTrue;
+
+	if(!ReadScriptHeader(&header))
+	{
+		State = ScriptNotPresent;
+		return;
+	}
+	State = ScriptIdle;
+	ScriptLength = header.Length;
+
+	if(header.Flags & SCRIPT_FLAG_RUN_AT_BOOT)
+	{
+		status = CyU3PEventSet(&EventHandler, ADI_RUN_BOOT_SCRIPT, CYU3P_EVENT_OR);
+		if(status != CY_U3P_SUCCESS)
+		{
+			AdiLogError(BootScript_c, __LINE__, status);
+		}
+	}
+}
+
+/**
+  * @brief Loads the stored boot script from flash and executes it
+  *
+  * @return A status code indicating the success of the script execution
+  *
+  * This function should be called from the AppThread. The script body is read into a
+  * temporary heap buffer and CRC checked before any command is executed. Execution
+  * stops on the first command which fails. The result can be read back using the
+  * ADI_BOOT_SCRIPT_STATUS command.
+ **/
+CyU3PReturnStatus_t AdiRunBootScript()
+{
+	CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
+	ScriptHeader header;
+	uint8_t* script;
+	uint32_t startTime;
+
+	CommandsRun = 0;
+	FailOffset = 0;
+	RunTimeMs = 0;
+
+	if(!ReadScriptHeader(&header))
+	{
+		State = ScriptNotPresent;
+		LastStatus = CY_U3P_ERROR_NOT_CONFIGURED;
+		return LastStatus;
+	}
+	ScriptLength = header.Length;
+
+	script = CyU3PMemAlloc(header.Length);
+	if(script == NULL)
+	{
+		AdiLogError(BootScript_c, __LINE__, CY_U3P_ERROR_MEMORY_ERROR);
+		State = ScriptFailed;
+		LastStatus = CY_U3P_ERROR_MEMORY_ERROR;
+		return LastStatus;
+	}
+
+	AdiFlashRead(SCRIPT_BASE_ADDR + sizeof(ScriptHeader), header.Length, script);
+	if(AdiCrc32(0, script, header.Length) != header.Crc)
+	{
+		AdiLogError(BootScript_c, __LINE__, header.Crc);
+		status = CY_U3P_ERROR_FAILURE;
+	}
+	else
+	{
+#ifdef VERBOSE_MODE
+		CyU3PDebugPrint (4, "Running boot script, %d bytes\r\n", header.Length);
+#endif
+		State = ScriptRunning;
+		startTime = CyU3PGetTime();
+		status = ExecuteScript(script, header.Length);
+		RunTimeMs = CyU3PGetTime() - startTime;
+	}
+
+	CyU3PMemFree(script);
+
+	LastStatus = status;
+	if(status == CY_U3P_SUCCESS)
+		State = ScriptDone;
+	else
+		State = ScriptFailed;
+
+#ifdef VERBOSE_MODE
+	CyU3PDebugPrint (4, "Boot script finished. Status: 0x%x, Commands: %d, Time: %dms\r\n", status, CommandsRun, RunTimeMs);
+#endif
+
+	return status;
+}
+
+/**
+  * @brief Writes a boot script to flash, from control endpoint data
+  *
+  * @param RequestLength The number of bytes sent over the control endpoint
+  *
+  * @return A status code indicating the success of the script write
+  *
+  * The control endpoint data must contain a complete script image (ScriptHeader followed
+  * by the script body) of at most SCRIPT_MAX_SIZE bytes. The image and each script command
+  * are validated before it is written. A zero length request clears the stored script.
+ **/
+CyU3PReturnStatus_t AdiWriteBootScript(uint16_t RequestLength)
+{
+	CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
+	ScriptHeader* header = (ScriptHeader *) USBBuffer;
+	uint16_t bytesRead = 0;
+
+	/* Get data from control endpoint */
+	status = CyU3PUsbGetEP0Data(RequestLength, USBBuffer, &bytesRead);
+	if(status != CY_U3P_SUCCESS)
+		return status;
+
+	/* Clear stored script */
+	if(RequestLength == 0)
+	{
+		USBBuffer[0] = 0xFF;
+		USBBuffer[1] = 0xFF;
+		USBBuffer[2] = 0xFF;
+		USBBuffer[3] = 0xFF;
+		AdiFlashWrite(SCRIPT_BASE_ADDR, 4, USBBuffer);
+		State = ScriptNotPresent;
+		ScriptLength = 0;
+		return CY_U3P_SUCCESS;
+	}
+
+	/* Validate script image */
+	if((RequestLength < sizeof(ScriptHeader)) ||
+		(RequestLength > SCRIPT_MAX_SIZE) ||
+		(header->Magic != SCRIPT_MAGIC) ||
+		(header->Version != SCRIPT_VERSION) ||
+		(header->Length != (RequestLength - sizeof(ScriptHeader))) ||
+		(header->Crc != AdiCrc32(0, USBBuffer + sizeof(ScriptHeader), header->Length)))
+	{
+		AdiLogError(BootScript_c, __LINE__, RequestLength);
+		return CY_U3P_ERROR_BAD_ARGUMENT;
+	}
+
+	/* Validate every command, so a bad script is never stored to run at boot */
+	status = ValidateScript(USBBuffer + sizeof(ScriptHeader), header->Length);
+	if(status != CY_U3P_SUCCESS)
+		return status;
+
+	AdiFlashWrite(SCRIPT_BASE_ADDR, RequestLength, USBBuffer);
+	State = ScriptIdle;
+	ScriptLength = header->Length;
+
+	return status;
+}
+
+/**
+  * @brief Returns the boot script status over the control endpoint, and optionally runs the script
+  *
+  * @param RunScript If non-zero, the stored script is run (in the AppThread)
+  *
+  * @param RequestLength The number of bytes requested over the control endpoint. Should be 20.
+  *
+  * @return A status code indicating the success of the status request
+  *
+  * The status data is: status (0 - 3), script state (4), reserved (5), commands executed (6 - 7),
+  * failing command offset (8 - 9), script status code (10 - 13), script length (14 - 15), and
+  * script run time in ms (16 - 19).
+ **/
+CyU3PReturnStatus_t AdiBootScriptStatus(uint16_t RunScript, uint16_t RequestLength)
+{
+	CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
+
+	if(RunScript && (State != ScriptRunning))
+		status = CyU3PEventSet(&EventHandler, ADI_RUN_BOOT_SCRIPT, CYU3P_EVENT_OR);
+
+	USBBuffer[4] = State;
+	USBBuffer[5] = 0;
+	USBBuffer[6] = CommandsRun & 0xFF;
+	USBBuffer[7] = (CommandsRun & 0xFF00) >> 8;
+	USBBuffer[8] = FailOffset & 0xFF;
+	USBBuffer[9] = (FailOffset & 0xFF00) >> 8;
+	USBBuffer[10] = LastStatus & 0xFF;
+	USBBuffer[11] = (LastStatus & 0xFF00) >> 8;
+	USBBuffer[12] = (LastStatus & 0xFF0000) >> 16;
+	USBBuffer[13] = (LastStatus & 0xFF000000) >> 24;
+	USBBuffer[14] = ScriptLength & 0xFF;
+	USBBuffer[15] = (ScriptLength & 0xFF00) >> 8;
+	USBBuffer[16] = RunTimeMs & 0xFF;
+	USBBuffer[17] = (RunTimeMs & 0xFF00) >> 8;
+	USBBuffer[18] = (RunTimeMs & 0xFF0000) >> 16;
+	USBBuffer[19] = (RunTimeMs & 0xFF000000) >> 24;
+	AdiSendStatus(status, RequestLength, CyTrue);
+
+	return status;
+}
+
+/**
+  * @brief Executes a boot script body
+  *
+  * @param Script The script body
+  *
+  * @param Length The script body length, in bytes
+  *
+  * @return A status code indicating the success of the script
+ **/
+static CyU3PReturnStatus_t ExecuteScript(uint8_t* Script, uint16_t Length)
+{
+	CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
+	CyU3PGpioIntrMode_t edge;
+	uint32_t timeoutMs;
+	uint16_t offset = 0;
+	uint16_t argLength;
+	uint8_t opcode;
+
+	/* SPI read data is discarded. USBBuffer belongs to the USB setup callback */
+	uint8_t readBuffer[4];
+
+	while(offset < Length)
+	{
+		opcode = Script[offset];
+		FailOffset = offset;
+
+		if(opcode == SCRIPT_OP_END)
+			return CY_U3P_SUCCESS;
+
+		status = CheckCommand(Script, offset, Length, &argLength);
+		if(status != CY_U3P_SUCCESS)
+			return status;
+		offset++;
+
+		/* Execute */
+		switch(opcode)
+		{
+		case SCRIPT_OP_SET_SUPPLY:
+			status = AdiSetDutSupply((DutVoltage) Script[offset]);
+			break;
+		case SCRIPT_OP_DELAY_MS:
+			CyU3PThreadSleep(ParseU32(Script + offset));
+			break;
+		case SCRIPT_OP_DELAY_US:
+			if(ParseU32(Script + offset) >= 2)
+				status = AdiSleepForMicroSeconds(ParseU32(Script + offset));
+			break;
+		case SCRIPT_OP_SET_PIN:
+			status = AdiSetPin(Script[offset], (CyBool_t) Script[offset + 1]);
+			break;
+		case SCRIPT_OP_SPI_TRANSFER:
+			status = AdiTransferBytesToBuffer(ParseU32(Script + offset), readBuffer);
+			ScriptStall();
+			break;
+		case SCRIPT_OP_REG_WRITE:
+			/* Standard iSensor 16-bit write command, same framing as AdiWriteRegByte */
+			status = AdiTransferBytesToBuffer(((0x80 | Script[offset]) << 8) | Script[offset + 1], readBuffer);
+			ScriptStall();
+			break;
+		case SCRIPT_OP_WAIT_PIN:
+			if(Script[offset + 1])
+				edge = CY_U3P_GPIO_INTR_POS_EDGE;
+			else
+				edge = CY_U3P_GPIO_INTR_NEG_EDGE;
+			timeoutMs = ParseU32(Script + offset + 2);
+			if(timeoutMs > SCRIPT_MAX_WAIT_MS)
+				timeoutMs = SCRIPT_MAX_WAIT_MS;
+			status = AdiWaitForPin(Script[offset], edge, timeoutMs);
+			break;
+		}
+
+		if(status != CY_U3P_SUCCESS)
+		{
+			AdiLogError(BootScript_c, __LINE__, status);
+			return status;
+		}
+
+		offset += argLength;
+		CommandsRun++;
+	}
+
+	return status;
+}
+
+/**
+  * @brief Checks every command in a boot script body, without executing it
+  *
+  * @param Script The script body
+  *
+  * @param Length The script body length, in bytes
+  *
+  * @return A status code indicating if the script is valid
+ **/
+static CyU3PReturnStatus_t ValidateScript(uint8_t* Script, uint16_t Length)
+{
+	CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
+	uint16_t offset = 0;
+	uint16_t argLength;
+
+	while((offset < Length) && (Script[offset] != SCRIPT_OP_END))
+	{
+		status = CheckCommand(Script, offset, Length, &argLength);
+		if(status != CY_U3P_SUCCESS)
+			return status;
+		offset += 1 + argLength;
+	}
+	return status;
+}
+
+/**
+  * @brief Checks a single boot script command
+  *
+  * @param Script The script body
+  *
+  * @param Offset The offset of the command opcode within the script body
+  *
+  * @param Length The script body length, in bytes
+  *
+  * @param ArgLength Return by reference for the command argument length, in bytes
+  *
+  * @return A status code indicating if the command is valid
+  *
+  * A command is rejected if the opcode is unknown, the arguments are truncated, or
+  * a delay or pin wait argument is outside of the range which the script engine allows.
+ **/
+static CyU3PReturnStatus_t CheckCommand(uint8_t* Script, uint16_t Offset, uint16_t Length, uint16_t* ArgLength)
+{
+	uint8_t* args = Script + Offset + 1;
+	uint8_t opcode = Script[Offset];
+
+	/* Get argument length */
+	switch(opcode)
+	{
+	case SCRIPT_OP_SET_SUPPLY:
+		*ArgLength = 1;
+		break;
+	case SCRIPT_OP_SET_PIN:
+	case SCRIPT_OP_REG_WRITE:
+		*ArgLength = 2;
+		break;
+	case SCRIPT_OP_DELAY_MS:
+	case SCRIPT_OP_DELAY_US:
+	case SCRIPT_OP_SPI_TRANSFER:
+		*ArgLength = 4;
+		break;
+	case SCRIPT_OP_WAIT_PIN:
+		*ArgLength = 6;
+		break;
+	default:
+		AdiLogError(BootScript_c, __LINE__, opcode);
+		return CY_U3P_ERROR_BAD_ARGUMENT;
+	}
+
+	/* Check for truncated command */
+	if((Offset + 1 + *ArgLength) > Length)
+	{
+		AdiLogError(BootScript_c, __LINE__, Offset);
+		return CY_U3P_ERROR_BAD_ARGUMENT;
+	}
+
+	/* Check argument range. Delays block the AppThread, and AdiWaitForPin treats a 0 timeout as wait forever */
+	if(((opcode == SCRIPT_OP_DELAY_MS) && (ParseU32(args) > SCRIPT_MAX_DELAY_MS)) ||
+		((opcode == SCRIPT_OP_DELAY_US) && (ParseU32(args) > SCRIPT_MAX_DELAY_US)) ||
+		((opcode == SCRIPT_OP_WAIT_PIN) && (ParseU32(args + 2) == 0)))
+	{
+		AdiLogError(BootScript_c, __LINE__, Offset);
+		return CY_U3P_ERROR_BAD_ARGUMENT;
+	}
+
+	return CY_U3P_SUCCESS;
+}
+
+/**
+  * @brief Stalls for the configured stall time between SPI transfers
+  *
+  * @return void
+ **/
+static void ScriptStall()
+{
+	if(FX3State.StallTime >= 2)
+		AdiSleepForMicroSeconds(FX3State.StallTime);
+}
+
+/**
+  * @brief Parses a little endian 32-bit value from a byte buffer
+  *
+  * @param Buf The buffer to parse
+  *
+  * @return The parsed value
+ **/
+static uint32_t ParseU32(uint8_t* Buf)
+{
+	return Buf[0] | (Buf[1] << 8) | (Buf[2] << 16) | (Buf[3] << 24);
+}
+
+/**
+  * @brief Reads and validates the stored boot script header
+  *
+  * @param Header Pointer to the header to read into
+  *
+  * @return CyTrue if a valid script header is stored
+ **/
+static CyBool_t ReadScriptHeader(ScriptHeader* Header)
+{
+	AdiFlashRead(SCRIPT_BASE_ADDR, sizeof(ScriptHeader), (uint8_t *)Header);
+
+	if((Header->Magic != SCRIPT_MAGIC) || (Header->Version != SCRIPT_VERSION))
+		return CyFalse;
+
+	if((Header->Length == 0) || (Header->Length > (SCRIPT_MAX_SIZE - sizeof(ScriptHeader))))
+		return CyFalse;
+
+	return CyTrue;
+}
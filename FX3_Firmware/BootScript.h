@@ -0,0 +1,125 @@
+/**
+  * Copyright (c) Analog Devices Inc, 2018 - 2020
+  * All Rights Reserved.
+  *
+  * THIS SOFTWARE UTILIZES LIBRARIES DEVELOPED
+  * AND MAINTAINED BY CYPRESS INC. THE LICENSE INCLUDED IN
+  * THIS REPOSITORY DOES NOT EXTEND TO CYPRESS PROPERTY.
+  *
+  * Use of this file is governed by the license agreement
+  * included in this repository.
+  *
+  * @file		BootScript.h
+  * @date		10/17/2020
+  * @author		A. Nolan (alex.nolan@analog.com)
+  * @brief		Header file for the flash stored DUT boot script engine
+ **/
+
+#ifndef BOOTSCRIPT_H_
+#define BOOTSCRIPT_H_
+
+/* Include the main header file */
+#include "main.h"
+
+/* Defines */
+
+/** Flash address of the boot script (below the error log) */
+#define SCRIPT_BASE_ADDR						(0x33000)
+
+/** Max size of a stored boot script (header + body), in bytes */
+#define SCRIPT_MAX_SIZE							(0x1000)
+
+/** Magic number identifying a stored boot script ("ADIS") */
+#define SCRIPT_MAGIC							(0x53494441)
+
+/** Current boot script format version */
+#define SCRIPT_VERSION							1
+
+/** Script header flag: run the script automatically after the first AdiAppStart after boot */
+#define SCRIPT_FLAG_RUN_AT_BOOT					(1 << 0)
+
+/** Boot script opcode: end of script */
+#define SCRIPT_OP_END							(0x00)
+
+/** Boot script opcode: set DUT supply. Args: mode (1 byte, DutVoltage) */
+#define SCRIPT_OP_SET_SUPPLY					(0x01)
+
+/** Boot script opcode: delay in ms. Args: delay (4 bytes, 0 - SCRIPT_MAX_DELAY_MS) */
+#define SCRIPT_OP_DELAY_MS						(0x02)
+
+/** Boot script opcode: delay in us. Args: delay (4 bytes, 0 - SCRIPT_MAX_DELAY_US) */
+#define SCRIPT_OP_DELAY_US						(0x03)
+
+/** Boot script opcode: drive a pin. Args: GPIO number (1 byte), value (1 byte) */
+#define SCRIPT_OP_SET_PIN						(0x04)
+
+/** Boot script opcode: protocol agnostic SPI transfer, followed by stall. Args: data (4 bytes) */
+#define SCRIPT_OP_SPI_TRANSFER					(0x05)
+
+/** Boot script opcode: iSensor SPI register write, followed by stall. Args: address (1 byte), data (1 byte) */
+#define SCRIPT_OP_REG_WRITE						(0x06)
+
+/** Boot script opcode: wait for a pin edge. Args: GPIO number (1 byte), polarity (1 byte), timeout ms (4 bytes, 1 - SCRIPT_MAX_WAIT_MS) */
+#define SCRIPT_OP_WAIT_PIN						(0x07)
+
+/** Max pin wait timeout for a boot script, in ms. Longer timeouts are clamped, a timeout of 0 (wait forever) is rejected */
+#define SCRIPT_MAX_WAIT_MS						(10000)
+
+/** Max ms delay for a boot script. Scripts with longer delays are rejected */
+#define SCRIPT_MAX_DELAY_MS						(10000)
+
+/** Max us delay for a boot script. This is a busy wait, so longer delays should use SCRIPT_OP_DELAY_MS */
+#define SCRIPT_MAX_DELAY_US						(100000)
+
+/** @brief Boot script execution state */
+typedef enum ScriptState
+{
+	/** No valid script is stored in flash */
+	ScriptNotPresent = 0,
+
+	/** A valid script is stored, but has not been run */
+	ScriptIdle = 1,
+
+	/** The script is currently running */
+	ScriptRunning = 2,
+
+	/** The script ran to completion */
+	ScriptDone = 3,
+
+	/** The script stopped on an error */
+	ScriptFailed = 4
+
+}ScriptState;
+
+/**
+  * @brief Boot script header, stored at SCRIPT_BASE_ADDR
+  *
+  * The script body (a sequence of opcodes and little endian arguments) immediately
+  * follows the header. The CRC32 covers the script body only.
+ **/
+typedef struct ScriptHeader
+{
+	/** Magic number, must be SCRIPT_MAGIC (bytes 0 - 3) */
+	uint32_t Magic;
+
+	/** Script format version, must be SCRIPT_VERSION (bytes 4 - 5) */
+	uint16_t Version;
+
+	/** Script body length, in bytes (bytes 6 - 7) */
+	uint16_t Length;
+
+	/** Script flags (bytes 8 - 11) */
+	uint32_t Flags;
+
+	/** CRC32 of the script body (bytes 12 - 15) */
+	uint32_t Crc;
+
+}ScriptHeader;
+
+/* Public function prototypes */
+void AdiBootScriptAppStart();
+CyU3PReturnStatus_t AdiRunBootScript();
+CyU3PReturnStatus_t AdiWriteBootScript(uint16_t RequestLength);
+CyU3PReturnStatus_t AdiBootScriptStatus(uint16_t RunScript, uint16_t RequestLength);
+
+#endif /* BOOTSCRIPT_H_ */
@@ -0,0 +1,372 @@
+/**
+  * Copyright (c) Analog Devices Inc, 2018 - 2020
+  * All Rights Reserved.
+  *
+  * THIS SOFTWARE UTILIZES LIBRARIES DEVELOPED
+  * AND MAINTAINED BY CYPRESS INC. THE LICENSE INCLUDED IN
+  * THIS REPOSITORY DOES NOT EXTEND TO CYPRESS PROPERTY.
+  *
+  * Use of this file is governed by the license agreement
+  * included in this repository.
+  *
+  * @file		BootSlot.c
+  * @date		10/17/2020
+  * @author		A. Nolan (alex.nolan@analog.com)
+  * @brief		Implementation file for the A/B firmware image slot support
+ **/
+
+#include <stddef.h>
+#include "BootSlot.h"
+
+/* Private function prototypes */
+static void WriteSlotHeader(uint32_t Slot, uint32_t Length, uint32_t ImageCrc);
+
+/* Tell the compiler where to find the needed globals */
+extern uint8_t USBBuffer[4096];
+extern CyU3PEvent EventHandler;
+
+/** The slot this firmware was booted from (BOOT_SLOT_NONE if loaded over USB) */
+static uint8_t BootedSlot = BOOT_SLOT_NONE;
+
+/** Track if the slot confirmation has been performed */
+static CyBool_t ConfirmDone = CyFalse;
+
+/** Current stored image update state */
+static volatile ImageUpdateState UpdateState = UpdateIdle;
+
+/** Image update target slot */
+static uint8_t UpdateTarget = 0;
+
+/** Image update length, in bytes */
+static uint32_t UpdateLength = 0;
+
+/** Expected CRC32 of the image being updated */
+static uint32_t UpdateCrc = 0;
+
+/** CRC32 of the image read back from flash */
+static uint32_t UpdateReadCrc = 0;
+
+/** Status code of the last image update */
+static uint32_t UpdateStatus = CY_U3P_SUCCESS;
+
+/**
+  * @brief Reads the bootloader handoff record, to find which slot the firmware was booted from
+  *
+  * @return void
+  *
+  * This function must be called at the start of main, before the DMA buffer area (which holds
+  * the handoff record) is used. The record is cleared once read, so it is not seen again if the
+  * firmware is later re-loaded over USB.
+ **/
+void AdiBootSlotInit()
+{
+	volatile uint32_t* handoff = (volatile uint32_t *) BOOT_HANDOFF_ADDRESS;
+
+	if((handoff[0] == BOOT_HANDOFF_MAGIC) && (handoff[1] < BOOT_SLOT_COUNT) && (handoff[2] == ~(BOOT_HANDOFF_MAGIC ^ handoff[1])))
+		BootedSlot = handoff[1];
+	else
+		BootedSlot = BOOT_SLOT_NONE;
+
+	handoff[0] = 0;
+}
+
+/**
+  * @brief Confirms the image slot the firmware was booted from
+  *
+  * @return void
+  *
+  * This function should be called at the end of AdiAppStart. Reaching the first application
+  * start (USB enumerated, and the endpoints configured) confirms the image, so the bootloader
+  * keeps booting it instead of falling back to the other slot. Only the first application start
+  * after boot performs the check.
+ **/
+void AdiBootSlotAppStart()
+{
+	BootSlotHeader_t header;
+	uint32_t confirmed = BOOT_SLOT_CONFIRMED;
+
+	if(ConfirmDone)
+		return;
+	ConfirmDone = CyTrue;
+
+	if(BootedSlot == BOOT_SLOT_NONE)
+		return;
+
+	if(!AdiReadBootSlotHeader(BootedSlot, &header))
+	{
+		AdiLogError(BootSlot_c, __LINE__, BootedSlot);
+		return;
+	}
+
+	if(header.confirmed != BOOT_SLOT_CONFIRMED)
+	{
+		AdiFlashWrite(BOOT_SLOT_HEADER_ADDR + (BootedSlot * FLASH_PAGE_SIZE) + offsetof(BootSlotHeader_t, confirmed), 4, (uint8_t *)&confirmed);
+#ifdef VERBOSE_MODE
+		CyU3PDebugPrint (4, "Confirmed image slot %d after %d boot attempts\r\n", BootedSlot, header.bootCount);
+#endif
+	}
+}
+
+/**
+  * @brief Reads and validates an image slot header
+  *
+  * @param Slot The slot to read (0 or 1)
+  *
+  * @param Header Returns the slot header by reference
+  *
+  * @return CyTrue if the slot holds a valid image header
+ **/
+CyBool_t AdiReadBootSlotHeader(uint32_t Slot, BootSlotHeader_t* Header)
+{
+	if(Slot >= BOOT_SLOT_COUNT)
+		return CyFalse;
+
+	AdiFlashRead(BOOT_SLOT_HEADER_ADDR + (Slot * FLASH_PAGE_SIZE), sizeof(BootSlotHeader_t), (uint8_t *)Header);
+
+	if(Header->magic != BOOT_SLOT_MAGIC)
+		return CyFalse;
+	if(Header->headerCrc != AdiCrc32(0, (uint8_t *)Header, offsetof(BootSlotHeader_t, headerCrc)))
+		return CyFalse;
+	if(Header->length > BOOT_SLOT_SIZE)
+		return CyFalse;
+	return CyTrue;
+}
+
+/**
+  * @brief Sends the image slot status to the host
+  *
+  * @param RequestLength The number of bytes requested over the control endpoint. Should be 40.
+  *
+  * @return A status code indicating the success of the status request
+  *
+  * The status data is: status (0 - 3), booted slot (4, 0xFF if loaded over USB), reserved (5 - 7),
+  * then 16 bytes for each slot: sequence (0 - 3), image length (4 - 7), boot count (8 - 11),
+  * and flags (12 - 15, bit 0 valid, bit 1 confirmed).
+ **/
+CyU3PReturnStatus_t AdiBootSlotStatus(uint16_t RequestLength)
+{
+	BootSlotHeader_t header;
+	uint32_t flags;
+	uint8_t* buf;
+
+	USBBuffer[4] = BootedSlot;
+	USBBuffer[5] = 0;
+	USBBuffer[6] = 0;
+	USBBuffer[7] = 0;
+
+	for(uint32_t slot = 0; slot < BOOT_SLOT_COUNT; slot++)
+	{
+		buf = USBBuffer + 8 + (slot * 16);
+		flags = 0;
+		if(AdiReadBootSlotHeader(slot, &header))
+		{
+			flags |= 1;
+			if(header.confirmed == BOOT_SLOT_CONFIRMED)
+				flags |= 2;
+		}
+		else
+		{
+			CyU3PMemSet((uint8_t *)&header, 0, sizeof(header));
+		}
+		CyU3PMemCopy(buf, (uint8_t *)&header.sequence, 8);
+		CyU3PMemCopy(buf + 8, (uint8_t *)&header.bootCount, 4);
+		CyU3PMemCopy(buf + 12, (uint8_t *)&flags, 4);
+	}
+
+	AdiSendStatus(CY_U3P_SUCCESS, RequestLength, CyTrue);
+	return CY_U3P_SUCCESS;
+}
+
+/**
+  * @brief Asks the bootloader to boot the stored image after the next software reset
+  *
+  * @return void
+  *
+  * The bootloader normally only boots a stored image after a power on or watchdog reset,
+  * and starts the USB bootloader after a software reset. This writes a request record to
+  * the handoff area, so the reset which follows an image update boots the new image. If
+  * the record does not survive the reset, the board starts in the USB bootloader as before.
+ **/
+void AdiBootSlotRequestBoot()
+{
+	volatile uint32_t* handoff = (volatile uint32_t *) BOOT_HANDOFF_ADDRESS;
+
+	handoff[0] = BOOT_REQUEST_MAGIC;
+	handoff[1] = BOOT_SLOT_NONE;
+	handoff[2] = ~(BOOT_REQUEST_MAGIC ^ BOOT_SLOT_NONE);
+}
+
+/**
+  * @brief Starts programming a stored image slot over the bulk endpoint
+  *
+  * @param Target The image slot to program (0 or 1)
+  *
+  * @param RequestLength The number of bytes sent over the control endpoint. Should be 8.
+  *
+  * @return A status code indicating the success of the image update start
+  *
+  * The control endpoint data holds the image length (0 - 3) and the CRC32 of the image (4 - 7).
+  * The host then sends the image to the ChannelFromPC bulk endpoint as a single transfer, and
+  * the AppThread programs and verifies it (AdiImageUpdateWork). The slot the running firmware
+  * was booted from cannot be programmed, so there is always an image to fall back to. The slot
+  * header is invalidated before the slot image is programmed, and only re-written once the
+  * programmed image has been verified.
+ **/
+CyU3PReturnStatus_t AdiImageUpdateStart(uint16_t Target, uint16_t RequestLength)
+{
+	CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
+	uint16_t bytesRead = 0;
+	uint32_t length, crc, invalid = 0;
+
+	/* Get data from control endpoint */
+	status = CyU3PUsbGetEP0Data(RequestLength, USBBuffer, &bytesRead);
+	if(status != CY_U3P_SUCCESS)
+		return status;
+
+	length = USBBuffer[0];
+	length |= (USBBuffer[1] << 8);
+	length |= (USBBuffer[2] << 16);
+	length |= (USBBuffer[3] << 24);
+	crc = USBBuffer[4];
+	crc |= (USBBuffer[5] << 8);
+	crc |= (USBBuffer[6] << 16);
+	crc |= (USBBuffer[7] << 24);
+
+	/* The bootloader image is not a target. It has no fallback copy, so an interrupted update would brick the board */
+	if((RequestLength < 8) ||
+		(UpdateState == UpdateReceiving) ||
+		(UpdateState == UpdateVerifying) ||
+		(Target >= BOOT_SLOT_COUNT) ||
+		(Target == BootedSlot) ||
+		(length == 0) ||
+		(length > BOOT_SLOT_SIZE))
+	{
+		AdiLogError(BootSlot_c, __LINE__, Target);
+		return CY_U3P_ERROR_BAD_ARGUMENT;
+	}
+
+	/* A partly programmed slot must never be booted */
+	AdiFlashWrite(BOOT_SLOT_HEADER_ADDR + (Target * FLASH_PAGE_SIZE), 4, (uint8_t *)&invalid);
+
+	UpdateTarget = Target;
+	UpdateLength = length;
+	UpdateCrc = crc;
+	UpdateReadCrc = 0;
+	UpdateStatus = CY_U3P_SUCCESS;
+	UpdateState = UpdateReceiving;
+
+#ifdef VERBOSE_MODE
+	CyU3PDebugPrint (4, "Starting image update: Target: 0x%x, Bytes: 0x%x\r\n", Target, length);
+#endif
+
+	status = CyU3PEventSet(&EventHandler, ADI_IMAGE_UPDATE, CYU3P_EVENT_OR);
+	if(status != CY_U3P_SUCCESS)
+		UpdateState = UpdateFailed;
+	return status;
+}
+
+/**
+  * @brief Programs and verifies the image requested by AdiImageUpdateStart
+  *
+  * @return A status code indicating the success of the image update
+  *
+  * This function should be called from the AppThread. The image is received and programmed
+  * using AdiFlashBulkWrite, then read back from the flash device and checked against the
+  * expected CRC. The slot header is written last, with a sequence number
+  * newer than the other slot, so the bootloader tries the new image on the next boot.
+ **/
+CyU3PReturnStatus_t AdiImageUpdateWork()
+{
+	CyU3PReturnStatus_t status;
+	uint32_t address, crc;
+
+	address = BOOT_SLOT_IMAGE_ADDR + (UpdateTarget * BOOT_SLOT_SIZE);
+
+	status = AdiFlashBulkWrite(address, UpdateLength, &crc);
+	if((status == CY_U3P_SUCCESS) && (crc != UpdateCrc))
+	{
+		/* Received data does not match the image the host meant to send */
+		AdiLogError(BootSlot_c, __LINE__, crc);
+		status = CY_U3P_ERROR_FAILURE;
+	}
+
+	if(status == CY_U3P_SUCCESS)
+	{
+		UpdateState = UpdateVerifying;
+		status = AdiFlashReadCrc(address, UpdateLength, &UpdateReadCrc);
+		if((status == CY_U3P_SUCCESS) && (UpdateReadCrc != UpdateCrc))
+		{
+			AdiLogError(BootSlot_c, __LINE__, UpdateReadCrc);
+			status = CY_U3P_ERROR_FAILURE;
+		}
+	}
+
+	if(status == CY_U3P_SUCCESS)
+		WriteSlotHeader(UpdateTarget, UpdateLength, UpdateCrc);
+
+	UpdateStatus = status;
+	if(status == CY_U3P_SUCCESS)
+		UpdateState = UpdateDone;
+	else
+		UpdateState = UpdateFailed;
+
+#ifdef VERBOSE_MODE
+	CyU3PDebugPrint (4, "Image update finished. Status: 0x%x, CRC: 0x%x\r\n", status, UpdateReadCrc);
+#endif
+
+	return status;
+}
+
+/**
+  * @brief Sends the stored image update status to the host
+  *
+  * @param RequestLength The number of bytes requested over the control endpoint. Should be 20.
+  *
+  * @return A status code indicating the success of the status request
+  *
+  * The status data is: status (0 - 3), update state (4), update target (5), reserved (6 - 7),
+  * image length (8 - 11), CRC32 read back from flash (12 - 15), and the update status code (16 - 19).
+ **/
+CyU3PReturnStatus_t AdiImageUpdateStatus(uint16_t RequestLength)
+{
+	USBBuffer[4] = UpdateState;
+	USBBuffer[5] = UpdateTarget;
+	USBBuffer[6] = 0;
+	USBBuffer[7] = 0;
+	CyU3PMemCopy(USBBuffer + 8, (uint8_t *)&UpdateLength, 4);
+	CyU3PMemCopy(USBBuffer + 12, (uint8_t *)&UpdateReadCrc, 4);
+	CyU3PMemCopy(USBBuffer + 16, (uint8_t *)&UpdateStatus, 4);
+	AdiSendStatus(CY_U3P_SUCCESS, RequestLength, CyTrue);
+	return CY_U3P_SUCCESS;
+}
+
+/**
+  * @brief Writes a new, unconfirmed image slot header
+  *
+  * @param Slot The slot to write
+  *
+  * @param Length The image length, in bytes
+  *
+  * @param ImageCrc The image CRC32
+  *
+  * @return void
+  *
+  * The sequence number is one past the other slot, so the new image is tried first.
+ **/
+static void WriteSlotHeader(uint32_t Slot, uint32_t Length, uint32_t ImageCrc)
+{
+	BootSlotHeader_t header;
+	uint32_t sequence = 1;
+
+	if(AdiReadBootSlotHeader(Slot ^ 1, &header))
+		sequence = header.sequence + 1;
+
+	header.magic = BOOT_SLOT_MAGIC;
+	header.sequence = sequence;
+	header.length = Length;
+	header.imageCrc = ImageCrc;
+	header.headerCrc = AdiCrc32(0, (uint8_t *)&header, offsetof(BootSlotHeader_t, headerCrc));
+	header.bootCount = 0;
+	header.confirmed = 0xFFFFFFFF;
+	AdiFlashWrite(BOOT_SLOT_HEADER_ADDR + (Slot * FLASH_PAGE_SIZE), sizeof(header), (uint8_t *)&header);
+}
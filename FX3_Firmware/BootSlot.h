@@ -0,0 +1,62 @@
+/**
+  * Copyright (c) Analog Devices Inc, 2018 - 2020
+  * All Rights Reserved.
+  *
+  * THIS SOFTWARE UTILIZES LIBRARIES DEVELOPED
+  * AND MAINTAINED BY CYPRESS INC. THE LICENSE INCLUDED IN
+  * THIS REPOSITORY DOES NOT EXTEND TO CYPRESS PROPERTY.
+  *
+  * Use of this file is governed by the license agreement
+  * included in this repository.
+  *
+  * @file		BootSlot.h
+  * @date		10/17/2020
+  * @author		A. Nolan (alex.nolan@analog.com)
+  * @brief		Header file for the A/B firmware image slot support
+ **/
+
+#ifndef BOOTSLOT_H_
+#define BOOTSLOT_H_
+
+/* Include the main header file */
+#include "main.h"
+
+/* Slot layout, header format and handoff record shared with the bootloader */
+#include "../boot_fw/boot_slot.h"
+
+/* Defines */
+
+/** Slot value used when the firmware was not booted from a slot (loaded over USB) */
+#define BOOT_SLOT_NONE							(0xFF)
+
+/** @brief Stored image update state */
+typedef enum ImageUpdateState
+{
+	/** No image update has been started */
+	UpdateIdle = 0,
+
+	/** Image data is being received and programmed */
+	UpdateReceiving = 1,
+
+	/** The programmed image is being read back and checked */
+	UpdateVerifying = 2,
+
+	/** The image was programmed and verified */
+	UpdateDone = 3,
+
+	/** The image update failed */
+	UpdateFailed = 4
+
+}ImageUpdateState;
+
+/* Public function prototypes */
+void AdiBootSlotInit();
+void AdiBootSlotAppStart();
+CyBool_t AdiReadBootSlotHeader(uint32_t Slot, BootSlotHeader_t* Header);
+CyU3PReturnStatus_t AdiBootSlotStatus(uint16_t RequestLength);
+void AdiBootSlotRequestBoot();
+CyU3PReturnStatus_t AdiImageUpdateStart(uint16_t Target, uint16_t RequestLength);
+CyU3PReturnStatus_t AdiImageUpdateWork();
+CyU3PReturnStatus_t AdiImageUpdateStatus(uint16_t RequestLength);
+
+#endif /* BOOTSLOT_H_ */
@@ -0,0 +1,280 @@
+/**
+  * Copyright (c) Analog Devices Inc, 2018 - 2020
+  * All Rights Reserved.
+  *
+  * THIS SOFTWARE UTILIZES LIBRARIES DEVELOPED
+  * AND MAINTAINED BY CYPRESS INC. THE LICENSE INCLUDED IN
+  * THIS REPOSITORY DOES NOT EXTEND TO CYPRESS PROPERTY.
+  *
+  * Use of this file is governed by the license agreement
+  * included in this repository.
+  *
+  * @file		ConfigStore.c
+  * @date		10/17/2020
+  * @author		A. Nolan (alex.nolan@analog.com)
+  * @brief		Implementation file for the FX3 persistent configuration store
+ **/
+
+#include "ConfigStore.h"
+
+/* Private function prototypes */
+static CyBool_t ReadConfigBlock(ConfigBlock* Block);
+
+/* Tell the compiler where to find the needed globals */
+extern BoardState FX3State;
+
+/** RAM copy of the stored configuration block, read from flash on the first load */
+static ConfigBlock CachedBlock;
+
+/** Track if the stored configuration has been read into CachedBlock */
+static CyBool_t CacheLoaded = CyFalse;
+
+/** Track if CachedBlock holds a valid configuration */
+static CyBool_t CacheValid = CyFalse;
+
+/**
+  * @brief Loads the stored configuration from flash into the FX3 board state
+  *
+  * @return CyTrue if a valid configuration block was found and loaded, CyFalse otherwise
+  *
+  * This function only updates FX3State. The caller is responsible for applying the loaded
+  * settings to the SPI, I2C, and watchdog hardware. If no valid configuration block is
+  * present, the board state is left unchanged (firmware defaults are used). The block is
+  * only read from flash on the first call, since AdiAppStart loads it on every enumeration.
+  * AdiSaveConfig and AdiRestoreConfig keep the RAM copy up to date.
+ **/
+CyBool_t AdiLoadConfig()
+{
+	ConfigBlock block;
+
+	if(!CacheLoaded)
+	{
+		CacheValid = ReadConfigBlock(&CachedBlock);
+		CacheLoaded = CyTrue;
+	}
+	block = CachedBlock;
+
+	if(!CacheValid)
+	{
+#ifdef VERBOSE_MODE
+		CyU3PDebugPrint (4, "No valid stored configuration found, using defaults\r\n");
+#endif
+		return CyFalse;
+	}
+
+	/* SPI settings */
+	FX3State.SpiConfig.clock = block.SpiClock;
+	FX3State.SpiConfig.wordLen = block.SpiWordLen;
+	FX3State.SpiConfig.cpol = (CyBool_t) block.SpiCpol;
+	FX3State.SpiConfig.cpha = (CyBool_t) block.SpiCpha;
+	FX3State.SpiConfig.ssnPol = (CyBool_t) block.SpiSsnPol;
+	FX3State.SpiConfig.ssnCtrl = (CyU3PSpiSsnCtrl_t) block.SpiSsnCtrl;
+	FX3State.SpiConfig.leadTime = (CyU3PSpiSsnLagLead_t) block.SpiLeadTime;
+	FX3State.SpiConfig.lagTime = (CyU3PSpiSsnLagLead_t) block.SpiLagTime;
+	FX3State.SpiConfig.isLsbFirst = (CyBool_t) block.SpiIsLsbFirst;
+
+	/* DUT settings */
+	FX3State.StallTime = block.StallTime;
+	AdiSetDutType(block.DutType);
+	FX3State.DrPin = block.DrPin;
+	FX3State.DrActive = (CyBool_t) block.DrActive;
+	FX3State.DrPolarity = (CyBool_t) block.DrPolarity;
+
+	/* Watchdog settings */
+	FX3State.WatchDogEnabled = (CyBool_t) block.WatchDogEnabled;
+	FX3State.WatchDogPeriodMs = block.WatchDogPeriodMs;
+
+	/* I2C settings */
+	FX3State.I2CBitRate = block.I2CBitRate;
+	FX3State.I2CRetryCount = block.I2CRetryCount;
+
+#ifdef VERBOSE_MODE
+	CyU3PDebugPrint (4, "Loaded stored configuration (version %d)\r\n", block.Version);
+#endif
+
+	return CyTrue;
+}
+
+/**
+  * @brief Saves the current FX3 board configuration to flash
+  *
+  * @return A status code indicating the success of the save operation
+  *
+  * The saved configuration is loaded by AdiAppStart on the next boot, so the board
+  * comes up ready to stream without any configuration traffic from the host.
+ **/
+CyU3PReturnStatus_t AdiSaveConfig()
+{
+	ConfigBlock block;
+
+	CyU3PMemSet((uint8_t *)&block, 0, sizeof(block));
+	block.Magic = CONFIG_BLOCK_MAGIC;
+	block.Version = CONFIG_BLOCK_VERSION;
+	block.Length = sizeof(block);
+
+	/* SPI settings */
+	block.SpiClock = FX3State.SpiConfig.clock;
+	block.SpiWordLen = FX3State.SpiConfig.wordLen;
+	block.SpiCpol = FX3State.SpiConfig.cpol;
+	block.SpiCpha = FX3State.SpiConfig.cpha;
+	block.SpiSsnPol = FX3State.SpiConfig.ssnPol;
+	block.SpiSsnCtrl = FX3State.SpiConfig.ssnCtrl;
+	block.SpiLeadTime = FX3State.SpiConfig.leadTime;
+	block.SpiLagTime = FX3State.SpiConfig.lagTime;
+	block.SpiIsLsbFirst = FX3State.SpiConfig.isLsbFirst;
+
+	/* DUT settings */
+	block.StallTime = FX3State.StallTime;
+	block.DutType = FX3State.DutType;
+	block.DrPin = FX3State.DrPin;
+	block.DrActive = FX3State.DrActive;
+	block.DrPolarity = FX3State.DrPolarity;
+
+	/* Watchdog settings */
+	block.WatchDogEnabled = FX3State.WatchDogEnabled;
+	block.WatchDogPeriodMs = FX3State.WatchDogPeriodMs;
+
+	/* I2C settings */
+	block.I2CBitRate = FX3State.I2CBitRate;
+	block.I2CRetryCount = FX3State.I2CRetryCount;
+
+	/* CRC covers everything up to the CRC field */
+	block.Crc = AdiCrc32(0, (uint8_t *)&block, sizeof(block) - sizeof(block.Crc));
+
+	AdiFlashWrite(CONFIG_BLOCK_ADDR, sizeof(block), (uint8_t *)&block);
+
+	/* Read back to verify, and update the RAM copy */
+	CacheValid = ReadConfigBlock(&CachedBlock);
+	CacheLoaded = CyTrue;
+	if(!CacheValid)
+	{
+		AdiLogError(ConfigStore_c, __LINE__, CY_U3P_ERROR_FAILURE);
+		return CY_U3P_ERROR_FAILURE;
+	}
+
+#ifdef VERBOSE_MODE
+	CyU3PDebugPrint (4, "Saved configuration to flash\r\n");
+#endif
+
+	return CY_U3P_SUCCESS;
+}
+
+/**
+  * @brief Restores the board configuration
+  *
+  * @param Mode The restore mode. CONFIG_RESTORE_STORED or CONFIG_RESTORE_DEFAULTS
+  *
+  * @return A status code indicating the success of the restore operation
+  *
+  * CONFIG_RESTORE_STORED re-loads the stored configuration from flash and applies it to
+  * the SPI, I2C and watchdog hardware. CONFIG_RESTORE_DEFAULTS invalidates the stored
+  * configuration, so the firmware defaults are used on the next boot.
+ **/
+CyU3PReturnStatus_t AdiRestoreConfig(uint16_t Mode)
+{
+	CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
+	uint8_t clearBuf[4] = {0xFF, 0xFF, 0xFF, 0xFF};
+
+	switch(Mode)
+	{
+	case CONFIG_RESTORE_STORED:
+		/* Re-read the block from flash */
+		CacheLoaded = CyFalse;
+		if(!AdiLoadConfig())
+			return CY_U3P_ERROR_NOT_CONFIGURED;
+
+		/* Apply loaded settings to hardware */
+		status = CyU3PSpiSetConfig(&FX3State.SpiConfig, NULL);
+		if(status != CY_U3P_SUCCESS)
+		{
+			AdiLogError(ConfigStore_c, __LINE__, status);
+			return status;
+		}
+		status = AdiI2CInit(FX3State.I2CBitRate, CyFalse);
+		if(status != CY_U3P_SUCCESS)
+		{
+			AdiLogError(ConfigStore_c, __LINE__, status);
+			return status;
+		}
+		AdiConfigureWatchdog();
+		break;
+
+	case CONFIG_RESTORE_DEFAULTS:
+		/* Overwrite the magic number */
+		AdiFlashWrite(CONFIG_BLOCK_ADDR, sizeof(clearBuf), clearBuf);
+		CacheLoaded = CyTrue;
+		CacheValid = CyFalse;
+#ifdef VERBOSE_MODE
+		CyU3PDebugPrint (4, "Stored configuration cleared\r\n");
+#endif
+		break;
+
+	default:
+		AdiLogError(ConfigStore_c, __LINE__, Mode);
+		status = CY_U3P_ERROR_BAD_ARGUMENT;
+		break;
+	}
+
+	return status;
+}
+
+/**
+  * @brief Calculates a CRC32 (IEEE 802.3, reflected) over a block of memory
+  *
+  * @param Crc The starting CRC value. Use 0 for a new calculation, or a previous result to continue it
+  *
+  * @param Buf The data buffer to calculate the CRC over
+  *
+  * @param NumBytes The number of bytes in Buf
+  *
+  * @return The updated CRC32 value
+ **/
+uint32_t AdiCrc32(uint32_t Crc, uint8_t* Buf, uint32_t NumBytes)
+{
+	uint32_t bit;
+
+	Crc = ~Crc;
+	while(NumBytes--)
+	{
+		Crc ^= *Buf++;
+		for(bit = 0; bit < 8; bit++)
+		{
+			if(Crc & 0x1)
+				Crc = (Crc >> 1) ^ 0xEDB88320;
+			else
+				Crc = Crc >> 1;
+		}
+	}
+	return ~Crc;
+}
+
+/**
+  * @brief Reads the configuration block from flash and validates it
+  *
+  * @param Block Pointer to the config block to read into
+  *
+  * @return CyTrue if the block is valid, CyFalse otherwise
+ **/
+static CyBool_t ReadConfigBlock(ConfigBlock* Block)
+{
+	AdiFlashRead(CONFIG_BLOCK_ADDR, sizeof(ConfigBlock), (uint8_t *)Block);
+
+	if(Block->Magic != CONFIG_BLOCK_MAGIC)
+		return CyFalse;
+
+	if((Block->Version != CONFIG_BLOCK_VERSION) || (Block->Length != sizeof(ConfigBlock)))
+	{
+#ifdef VERBOSE_MODE
+		CyU3PDebugPrint (4, "Stored configuration version %d not supported\r\n", Block->Version);
+#endif
+		return CyFalse;
+	}
+
+	if(Block->Crc != AdiCrc32(0, (uint8_t *)Block, sizeof(ConfigBlock) - sizeof(Block->Crc)))
+	{
+		AdiLogError(ConfigStore_c, __LINE__, Block->Crc);
+		return CyFalse;
+	}
+
+	return CyTrue;
+}
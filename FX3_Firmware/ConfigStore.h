@@ -0,0 +1,130 @@
+/**
+  * Copyright (c) Analog Devices Inc, 2018 - 2020
+  * All Rights Reserved.
+  *
+  * THIS SOFTWARE UTILIZES LIBRARIES DEVELOPED
+  * AND MAINTAINED BY CYPRESS INC. THE LICENSE INCLUDED IN
+  * THIS REPOSITORY DOES NOT EXTEND TO CYPRESS PROPERTY.
+  *
+  * Use of this file is governed by the license agreement
+  * included in this repository.
+  *
+  * @file		ConfigStore.h
+  * @date		10/17/2020
+  * @author		A. Nolan (alex.nolan@analog.com)
+  * @brief		Header file for the FX3 persistent configuration store
+ **/
+
+#ifndef CONFIGSTORE_H_
+#define CONFIGSTORE_H_
+
+/* Include the main header file */
+#include "main.h"
+
+/* Defines */
+
+/** The flash address of the stored configuration block (one flash page, after the error log) */
+#define CONFIG_BLOCK_ADDR						(0x3FC00)
+
+/** Magic number identifying a configuration block ("ADIC") */
+#define CONFIG_BLOCK_MAGIC						(0x43494441)
+
+/** Current configuration block layout version. Increment when the layout changes */
+#define CONFIG_BLOCK_VERSION					1
+
+/** Restore config command: re-load and apply the stored configuration */
+#define CONFIG_RESTORE_STORED					0
+
+/** Restore config command: invalidate the stored configuration (defaults on next boot) */
+#define CONFIG_RESTORE_DEFAULTS					1
+
+/**
+  * @brief Structure which holds the persistent board configuration
+  *
+  * This struct is stored to flash at CONFIG_BLOCK_ADDR. It must fit within a single
+  * flash page (64 bytes). The CRC32 covers all bytes of the structure before the Crc field.
+  * A block with an unknown magic number, version, length, or CRC is ignored.
+ **/
+typedef struct ConfigBlock
+{
+	/** Magic number, must be CONFIG_BLOCK_MAGIC (bytes 0 - 3) */
+	uint32_t Magic;
+
+	/** Layout version, must be CONFIG_BLOCK_VERSION (bytes 4 - 5) */
+	uint16_t Version;
+
+	/** Size of this structure, in bytes (bytes 6 - 7) */
+	uint16_t Length;
+
+	/** SPI clock frequency, in Hz (bytes 8 - 11) */
+	uint32_t SpiClock;
+
+	/** SPI word length, in bits (byte 12) */
+	uint8_t SpiWordLen;
+
+	/** SPI clock polarity (byte 13) */
+	uint8_t SpiCpol;
+
+	/** SPI clock phase (byte 14) */
+	uint8_t SpiCpha;
+
+	/** SPI chip select polarity (byte 15) */
+	uint8_t SpiSsnPol;
+
+	/** SPI chip select control mode (byte 16) */
+	uint8_t SpiSsnCtrl;
+
+	/** SPI chip select lead time (byte 17) */
+	uint8_t SpiLeadTime;
+
+	/** SPI chip select lag time (byte 18) */
+	uint8_t SpiLagTime;
+
+	/** SPI LSB first setting (byte 19) */
+	uint8_t SpiIsLsbFirst;
+
+	/** Stall time, in microseconds (bytes 20 - 23) */
+	uint32_t StallTime;
+
+	/** DUT type (bytes 24 - 25) */
+	uint16_t DutType;
+
+	/** Data ready pin number (bytes 26 - 27) */
+	uint16_t DrPin;
+
+	/** Data ready triggering active (byte 28) */
+	uint8_t DrActive;
+
+	/** Data ready polarity (byte 29) */
+	uint8_t DrPolarity;
+
+	/** Watchdog enabled (byte 30) */
+	uint8_t WatchDogEnabled;
+
+	/** Reserved (byte 31) */
+	uint8_t Reserved;
+
+	/** Watchdog period, in ms (bytes 32 - 35) */
+	uint32_t WatchDogPeriodMs;
+
+	/** I2C bit rate (bytes 36 - 39) */
+	uint32_t I2CBitRate;
+
+	/** I2C retry count (bytes 40 - 41) */
+	uint16_t I2CRetryCount;
+
+	/** Padding (bytes 42 - 43) */
+	uint16_t Padding;
+
+	/** CRC32 of bytes 0 - 43 (bytes 44 - 47) */
+	uint32_t Crc;
+
+}ConfigBlock;
+
+/* Public function prototypes */
+CyBool_t AdiLoadConfig();
+CyU3PReturnStatus_t AdiSaveConfig();
+CyU3PReturnStatus_t AdiRestoreConfig(uint16_t Mode);
+uint32_t AdiCrc32(uint32_t Crc, uint8_t* Buf, uint32_t NumBytes);
+
+#endif /* CONFIGSTORE_H_ */
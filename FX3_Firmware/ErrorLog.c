@@ -20,16 +20,63 @@
 /* Tell the compiler where to find the needed globals */
 extern BoardState FX3State;
 extern uint8_t FirmwareID[32];
+extern uint8_t USBBuffer[4096];
+extern uint8_t BulkBuffer[12288];
+extern CyU3PDmaChannel ChannelToPC;
+extern CyU3PDmaBuffer_t ManualDMABuffer;
+extern CyU3PEvent EventHandler;
 
 /** Error log buffer. Each error log entry is copied here before being written to flash */
 uint8_t LogBuffer[FLASH_PAGE_SIZE];
 
+/** Table of recently logged errors, used for de-duplication */
+static LogDedupEntry DedupTable[LOG_DEDUP_DEPTH];
+
+/** Index of the next de-duplication table entry to replace (round robin) */
+static uint32_t DedupReplaceIndex = 0;
+
+/** Rate limit window length, in ms */
+static uint32_t RateWindowMs = LOG_DEFAULT_RATE_WINDOW_MS;
+
+/** Max number of flash writes allowed per rate limit window */
+static uint32_t RateWritesPerWindow = LOG_DEFAULT_WRITES_PER_WINDOW;
+
+/** Start time (RTOS ms) of the current rate limit window */
+static uint32_t RateWindowStart = 0;
+
+/** Number of flash writes performed in the current rate limit window */
+static uint32_t RateWindowWrites = 0;
+
+/** Number of entries in the pending error log dump */
+static uint32_t DumpNumEntries = 0;
+
+/** Serializes the de-duplication table, rate limit state and log flash writes. AdiLogError is called
+  * from the AppThread, the StreamThread and the USB setup callback. */
+static CyU3PMutex LogMutex;
+
 /* Private helper function protypes */
 static void FindFirmwareVersion(uint8_t* buf);
-static void WriteLogToFlash(ErrorMsg* msg);
+static uint32_t WriteLogToFlash(ErrorMsg* msg);
+static void WriteRepeatCountToFlash(LogDedupEntry* entry);
 static void WriteLogToDebug(ErrorMsg* msg);
 static uint32_t GetNewLogAddress(uint32_t* TotalLogCount);
 static uint32_t GetLogCount();
+static LogDedupEntry* FindDedupEntry(FileIdentifier File, uint32_t Line, uint32_t ErrorCode);
+static CyBool_t IsFlashWriteAllowed(uint32_t Time);
+static void FlushDedupEntry(LogDedupEntry* entry);
+static uint32_t GetPendingLogCount();
+
+/**
+  * @brief Creates the error log mutex
+  *
+  * @return A status code indicating the success of the mutex create
+  *
+  * Must be called from CyFxApplicationDefine, before any thread which can log an error is started.
+ **/
+CyU3PReturnStatus_t AdiErrorLogInit()
+{
+	return CyU3PMutexCreate(&LogMutex, CYU3P_INHERIT);
+}
 
 /**
   * @brief Logs a firmware error to flash memory for later examination
@@ -47,34 +94,271 @@ static uint32_t GetLogCount();
   * unit boot time stamp (FX3 boot time), system uptime based on the FX3 RTOS tick clock,
   * and the FX3 firmware version before logging the error to both the debugger output (serial port)
   * and flash memory.
+  *
+  * Errors which repeat (same file, line, and error code as a recently logged error) do not
+  * generate a new flash log entry. Instead, the repeat count of the existing entry is incremented.
+  * All flash writes are rate limited, so an error storm from within a hot loop costs at most a
+  * few flash writes per rate limit window. Any repeat counts which could not be written due to the
+  * rate limit are held in RAM until the next allowed write, or until AdiFlushErrorLog is called.
  **/
 void AdiLogError(FileIdentifier File, uint32_t Line, uint32_t ErrorCode)
 {
-	ErrorMsg error = {};
+	LogDedupEntry* entry;
+	uint32_t time = CyU3PGetTime();
+
+	CyU3PMutexGet(&LogMutex, CYU3P_WAIT_FOREVER);
+
+	/* Check if this error has been logged recently */
+	entry = FindDedupEntry(File, Line, ErrorCode);
+	if(entry != NULL)
+	{
+		/* Increment the repeat count (saturating) */
+		if(entry->Msg.RepeatCount < 0xFFFF)
+			entry->Msg.RepeatCount++;
+
+		/* Update flash at most once per window for each entry, and only if the global rate limit allows it */
+		if(((time - entry->FlashWriteTime) >= RateWindowMs) && IsFlashWriteAllowed(time))
+			FlushDedupEntry(entry);
+		CyU3PMutexPut(&LogMutex);
+		return;
+	}
+
+	/* New error. Claim the next table entry, flushing its old contents first if allowed */
+	entry = &DedupTable[DedupReplaceIndex];
+	DedupReplaceIndex = (DedupReplaceIndex + 1) % LOG_DEDUP_DEPTH;
+	if(entry->Valid && ((entry->FlashAddr == 0) || (entry->Msg.RepeatCount != entry->FlashRepeatCount)))
+	{
+		if(IsFlashWriteAllowed(time))
+			FlushDedupEntry(entry);
+		else
+			CyU3PDebugPrint (4, "Error log rate limited, dropped pending log for line %d of file %d\r\n", entry->Msg.Line, entry->Msg.File);
+	}
+	CyU3PMemSet((uint8_t *)entry, 0, sizeof(LogDedupEntry));
+	entry->Valid = CyTrue;
 
 	/* Set the uptime */
-	error.Uptime = CyU3PGetTime();
+	entry->Msg.Uptime = time;
 
 	/* Set the file code */
-	error.File = File;
+	entry->Msg.File = File;
 
 	/* Set the line */
-	error.Line = Line;
+	entry->Msg.Line = Line;
 
 	/* Set the error code */
-	error.ErrorCode = ErrorCode;
+	entry->Msg.ErrorCode = ErrorCode;
 
 	/* Set the boot time */
-	error.BootTimeCode = FX3State.BootTime;
+	entry->Msg.BootTimeCode = FX3State.BootTime;
 
 	/* Set the firmware version */
-	FindFirmwareVersion(error.FirmwareVersion);
+	FindFirmwareVersion(entry->Msg.FirmwareVersion);
 
 	/* Print to debug */
-	WriteLogToDebug(&error);
+	WriteLogToDebug(&entry->Msg);
+
+	/* Store to flash (if allowed by rate limit, otherwise leave pending in RAM) */
+	if(IsFlashWriteAllowed(time))
+		FlushDedupEntry(entry);
+
+	CyU3PMutexPut(&LogMutex);
+}
+
+/**
+  * @brief Writes any error log data which is pending due to rate limiting to flash
+  *
+  * @return void
+  *
+  * This function ignores the rate limit. It should be called before any planned
+  * reset or application shut down, so no repeat counts are lost.
+  *
+  * The flush can take several I2C flash writes, so it must not be called from the USB
+  * setup callback. Vendor requests set the ADI_ERROR_LOG_FLUSH event instead, and the
+  * flush runs in the AppThread.
+ **/
+void AdiFlushErrorLog()
+{
+	CyU3PMutexGet(&LogMutex, CYU3P_WAIT_FOREVER);
+
+	for(int i = 0; i < LOG_DEDUP_DEPTH; i++)
+	{
+		if(DedupTable[i].Valid)
+			FlushDedupEntry(&DedupTable[i]);
+	}
 
-	/* Store to flash */
-	WriteLogToFlash(&error);
+	CyU3PMutexPut(&LogMutex);
+}
+
+/**
+  * @brief Clears the flash error log
+  *
+  * @return void
+  *
+  * Resets the log count stored in flash, and clears the RAM de-duplication table
+  * (which holds flash addresses of entries which are no longer valid).
+ **/
+void AdiClearErrorLog()
+{
+	CyU3PMutexGet(&LogMutex, CYU3P_WAIT_FOREVER);
+	CyU3PMemSet((uint8_t *)DedupTable, 0, sizeof(DedupTable));
+	DedupReplaceIndex = 0;
+	WriteErrorLogCount(0);
+	CyU3PMutexPut(&LogMutex);
+}
+
+/**
+  * @brief Sets the error log flash write rate limit
+  *
+  * @param WindowMs The rate limit window length, in ms. 0 disables rate limiting.
+  *
+  * @param WritesPerWindow The max number of flash writes allowed per window. Clamped to at least 1.
+  *
+  * @return void
+ **/
+void AdiSetErrorLogRateLimit(uint32_t WindowMs, uint32_t WritesPerWindow)
+{
+	if(WritesPerWindow == 0)
+		WritesPerWindow = 1;
+	CyU3PMutexGet(&LogMutex, CYU3P_WAIT_FOREVER);
+	RateWindowMs = WindowMs;
+	RateWritesPerWindow = WritesPerWindow;
+	RateWindowStart = CyU3PGetTime();
+	RateWindowWrites = 0;
+	CyU3PMutexPut(&LogMutex);
+#ifdef VERBOSE_MODE
+	CyU3PDebugPrint (4, "Error log rate limit set to %d writes per %dms\r\n", RateWritesPerWindow, RateWindowMs);
+#endif
+}
+
+/**
+  * @brief Starts a bulk dump of the flash error log
+  *
+  * @param RequestLength The number of bytes requested over the control endpoint. Should be 16.
+  *
+  * @return A status code indicating the success of the dump start
+  *
+  * This function returns a header over the control endpoint: status (0 - 3), lifetime log
+  * count (4 - 7), number of entries in the dump (8 - 11), and the total dump size in bytes
+  * (12 - 15). The log entries are then streamed by the AppThread (AdiErrorLogDumpWork) over
+  * the ChannelToPC bulk endpoint, oldest entry first, so the host can read the whole valid
+  * portion of the log with a single bulk transfer of the returned size.
+  *
+  * No flash is written from the USB setup callback. The returned count includes any rate
+  * limited entries which are still pending in RAM, and AdiErrorLogDumpWork flushes them
+  * before reading the log.
+ **/
+CyU3PReturnStatus_t AdiErrorLogDumpStart(uint16_t RequestLength)
+{
+	CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
+	uint32_t count, numBytes;
+
+	/* Log count once the pending entries are flushed */
+	CyU3PMutexGet(&LogMutex, CYU3P_WAIT_FOREVER);
+	count = GetLogCount() + GetPendingLogCount();
+	CyU3PMutexPut(&LogMutex);
+
+	/* Size of the valid region of the ring buffer */
+	if(count > LOG_CAPACITY)
+		DumpNumEntries = LOG_CAPACITY;
+	else
+		DumpNumEntries = count;
+	numBytes = DumpNumEntries * LOG_ENTRY_SIZE;
+
+#ifdef VERBOSE_MODE
+	CyU3PDebugPrint (4, "Dumping %d error log entries\r\n", DumpNumEntries);
+#endif
+
+	/* Start streaming in the AppThread */
+	if(DumpNumEntries > 0)
+		status = CyU3PEventSet(&EventHandler, ADI_ERROR_LOG_DUMP, CYU3P_EVENT_OR);
+
+	/* Load header and return over control endpoint */
+	USBBuffer[4] = count & 0xFF;
+	USBBuffer[5] = (count & 0xFF00) >> 8;
+	USBBuffer[6] = (count & 0xFF0000) >> 16;
+	USBBuffer[7] = (count & 0xFF000000) >> 24;
+	USBBuffer[8] = DumpNumEntries & 0xFF;
+	USBBuffer[9] = (DumpNumEntries & 0xFF00) >> 8;
+	USBBuffer[10] = (DumpNumEntries & 0xFF0000) >> 16;
+	USBBuffer[11] = (DumpNumEntries & 0xFF000000) >> 24;
+	USBBuffer[12] = numBytes & 0xFF;
+	USBBuffer[13] = (numBytes & 0xFF00) >> 8;
+	USBBuffer[14] = (numBytes & 0xFF0000) >> 16;
+	USBBuffer[15] = (numBytes & 0xFF000000) >> 24;
+	AdiSendStatus(status, RequestLength, CyTrue);
+
+	return status;
+}
+
+/**
+  * @brief Streams the error log entries announced by AdiErrorLogDumpStart to the PC
+  *
+  * @return A status code indicating the success of the dump
+  *
+  * Any rate limited log data is flushed first. The newest DumpNumEntries entries are then
+  * sent, so the dump size always matches the header returned by AdiErrorLogDumpStart, even
+  * if an error was logged in between. The log entries are read from flash into BulkBuffer,
+  * starting at the oldest entry and wrapping around the end of the ring buffer as needed.
+  * Each BulkBuffer sized chunk is completely filled before being sent (it is a multiple of
+  * all USB packet sizes), so only the final chunk of the dump can be a short packet. This
+  * keeps the whole dump in a single host side bulk transfer.
+ **/
+CyU3PReturnStatus_t AdiErrorLogDumpWork()
+{
+	CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
+	uint32_t entriesLeft = DumpNumEntries;
+	uint32_t index, count, bufEntries, segEntries;
+	const uint32_t maxBufEntries = sizeof(BulkBuffer) / LOG_ENTRY_SIZE;
+
+	/* Make sure any rate limited log data is included in the dump */
+	AdiFlushErrorLog();
+
+	/* Oldest of the newest DumpNumEntries entries in the ring buffer */
+	CyU3PMutexGet(&LogMutex, CYU3P_WAIT_FOREVER);
+	count = GetLogCount();
+	CyU3PMutexPut(&LogMutex);
+	if(count >= DumpNumEntries)
+		index = (count - DumpNumEntries) % LOG_CAPACITY;
+	else
+		index = 0;
+
+	while(entriesLeft > 0)
+	{
+		/* Fill the bulk buffer, wrapping around the end of the ring */
+		bufEntries = 0;
+		while((bufEntries < maxBufEntries) && (entriesLeft > 0))
+		{
+			segEntries = maxBufEntries - bufEntries;
+			if(segEntries > entriesLeft)
+				segEntries = entriesLeft;
+			if(segEntries > (LOG_CAPACITY - index))
+				segEntries = LOG_CAPACITY - index;
+
+			AdiFlashRead(LOG_BASE_ADDR + (index * LOG_ENTRY_SIZE), segEntries * LOG_ENTRY_SIZE, BulkBuffer + (bufEntries * LOG_ENTRY_SIZE));
+
+			bufEntries += segEntries;
+			entriesLeft -= segEntries;
+			index = (index + segEntries) % LOG_CAPACITY;
+		}
+
+		/* Send chunk to the PC */
+		ManualDMABuffer.buffer = BulkBuffer;
+		ManualDMABuffer.size = sizeof(BulkBuffer);
+		ManualDMABuffer.count = bufEntries * LOG_ENTRY_SIZE;
+		status = CyU3PDmaChannelSetupSendBuffer(&ChannelToPC, &ManualDMABuffer);
+		if(status == CY_U3P_SUCCESS)
+			status = CyU3PDmaChannelWaitForCompletion(&ChannelToPC, LOG_DUMP_TIMEOUT_MS);
+		if(status != CY_U3P_SUCCESS)
+		{
+			/* Don't log this error to flash - the log is what we are trying to read */
+			CyU3PDebugPrint (4, "Error log dump failed! 0x%x\r\n", status);
+			CyU3PDmaChannelReset(&ChannelToPC);
+			break;
+		}
+	}
+
+	DumpNumEntries = 0;
+	return status;
 }
 
 /**
@@ -83,9 +367,13 @@ void AdiLogError(FileIdentifier File, uint32_t Line, uint32_t ErrorCode)
   * @param count The new error log count value to write to flash
   *
   * @return void
+  *
+  * The count is written to both the wear leveled journal and the legacy
+  * LOG_COUNT_ADDR location.
  **/
 void WriteErrorLogCount(uint32_t count)
 {
+	AdiJournalWrite(JOURNAL_KEY_LOG_COUNT, count);
 	LogBuffer[0] = count & 0xFF;
 	LogBuffer[1] = (count & 0xFF00) >> 8;
 	LogBuffer[2] = (count & 0xFF0000) >> 16;
@@ -102,15 +390,18 @@ void WriteErrorLogCount(uint32_t count)
   *
   * This function uses a fixed offset to get the version number from the FirmwareID
   * string. This fixed offset works for current and past versions of the FirmwareID,
-  * but will break if the ID format is changed.
+  * but will break if the ID format is changed. The version is truncated to
+  * LOG_FW_VERSION_SIZE - 1 characters and null terminated, since the trailing
+  * bytes of the log entry hold the repeat count.
  **/
 static void FindFirmwareVersion(uint8_t* outBuf)
 {
 	uint32_t offset = 12;
-	for(int i = 0; i < 12; i++)
+	for(int i = 0; i < (LOG_FW_VERSION_SIZE - 1); i++)
 	{
 		outBuf[i] = FirmwareID[offset + i];
 	}
+	outBuf[LOG_FW_VERSION_SIZE - 1] = 0;
 }
 
 /**
@@ -124,10 +415,13 @@ static void FindFirmwareVersion(uint8_t* outBuf)
   * from the flash error log ring buffer. It then clears the 32 bytes
   * which have been allocated in flash for the current error log. The
   * passed log is then copied byte-wise into the LogBuffer, array,
-  * then written to flash. Finally, the LOG_COUNT variable in flash
-  * is incremented.
+  * then written to flash. Finally, the log count is incremented in both the
+  * wear leveled journal and the legacy LOG_COUNT_ADDR location, which hosts
+  * read directly (ADI_READ_FLASH) to find the head of the log.
+  *
+  * @return The flash address the log entry was written to
  **/
-static void WriteLogToFlash(ErrorMsg* msg)
+static uint32_t WriteLogToFlash(ErrorMsg* msg)
 {
 	uint32_t logAddr, logCount;
 	uint8_t* memPtr;
@@ -154,9 +448,107 @@ static void WriteLogToFlash(ErrorMsg* msg)
 	/* Transfer log to flash */
 	AdiFlashWrite(logAddr, 32, LogBuffer);
 
-	/* Increment log count and store back to flash */
+	/* Increment log count and store to flash */
 	logCount++;
 	WriteErrorLogCount(logCount);
+
+	return logAddr;
+}
+
+/**
+  * @brief Updates the repeat count of a log entry which has already been written to flash
+  *
+  * @param entry The de-duplication table entry to update
+  *
+  * @return void
+  *
+  * Only the two repeat count bytes of the stored entry are re-written.
+ **/
+static void WriteRepeatCountToFlash(LogDedupEntry* entry)
+{
+	LogBuffer[0] = entry->Msg.RepeatCount & 0xFF;
+	LogBuffer[1] = (entry->Msg.RepeatCount & 0xFF00) >> 8;
+	AdiFlashWrite(entry->FlashAddr + LOG_REPEAT_COUNT_OFFSET, 2, LogBuffer);
+}
+
+/**
+  * @brief Writes any pending data for a de-duplication table entry to flash
+  *
+  * @param entry The entry to flush
+  *
+  * @return void
+  *
+  * If the entry has never been written, a new flash log entry is created.
+  * Otherwise, only the repeat count is updated (if it has changed).
+ **/
+static void FlushDedupEntry(LogDedupEntry* entry)
+{
+	if(entry->FlashAddr == 0)
+	{
+		entry->FlashAddr = WriteLogToFlash(&entry->Msg);
+	}
+	else if(entry->Msg.RepeatCount != entry->FlashRepeatCount)
+	{
+#ifdef VERBOSE_MODE
+		CyU3PDebugPrint (4, "Error on line %d of file %d repeated %d times\r\n", entry->Msg.Line, entry->Msg.File, entry->Msg.RepeatCount);
+#endif
+		WriteRepeatCountToFlash(entry);
+	}
+	entry->FlashRepeatCount = entry->Msg.RepeatCount;
+	entry->FlashWriteTime = CyU3PGetTime();
+}
+
+/**
+  * @brief Finds a matching error in the de-duplication table
+  *
+  * @param File The file which produced the error
+  *
+  * @param Line The line which produced the error
+  *
+  * @param ErrorCode The error code
+  *
+  * @return Pointer to the matching table entry, or NULL if the error is not in the table
+ **/
+static LogDedupEntry* FindDedupEntry(FileIdentifier File, uint32_t Line, uint32_t ErrorCode)
+{
+	for(int i = 0; i < LOG_DEDUP_DEPTH; i++)
+	{
+		if(DedupTable[i].Valid &&
+				(DedupTable[i].Msg.Line == Line) &&
+				(DedupTable[i].Msg.File == File) &&
+				(DedupTable[i].Msg.ErrorCode == ErrorCode))
+		{
+			return &DedupTable[i];
+		}
+	}
+	return NULL;
+}
+
+/**
+  * @brief Checks the error log rate limit, and consumes one write if allowed
+  *
+  * @param Time The current RTOS time, in ms
+  *
+  * @return True if a flash write is allowed, false otherwise
+ **/
+static CyBool_t IsFlashWriteAllowed(uint32_t Time)
+{
+	/* Rate limit disabled */
+	if(RateWindowMs == 0)
+		return CyTrue;
+
+	/* Start a new window once the current one has elapsed */
+	if((Time - RateWindowStart) >= RateWindowMs)
+	{
+		RateWindowStart = Time;
+		RateWindowWrites = 0;
+	}
+
+	if(RateWindowWrites >= RateWritesPerWindow)
+		return CyFalse;
+
+	RateWindowWrites++;
+	return CyTrue;
 }
 
 /**
@@ -212,14 +604,40 @@ static uint32_t GetNewLogAddress(uint32_t* TotalLogCount)
 }
 
 /**
-  * @brief Gets the log count from flash
+  * @brief Gets the number of de-duplication table entries which have not been written to flash yet
+  *
+  * @return The number of pending entries
+  *
+  * Each pending entry adds one to the log count when it is flushed. Must be called with LogMutex held.
+ **/
+static uint32_t GetPendingLogCount()
+{
+	uint32_t pending = 0;
+
+	for(int i = 0; i < LOG_DEDUP_DEPTH; i++)
+	{
+		if(DedupTable[i].Valid && (DedupTable[i].FlashAddr == 0))
+			pending++;
+	}
+	return pending;
+}
+
+/**
+  * @brief Gets the log count
+  *
+  * @return The current logged error count
   *
-  * @return The current logged error count (from LOG_COUNT)
+  * The count is read from the journal RAM index. If the journal does not
+  * have a log count yet, it is seeded from the legacy LOG_COUNT_ADDR location.
  **/
 static uint32_t GetLogCount()
 {
 	uint32_t count;
 
+	/* Fast path, count is stored in the journal */
+	if(AdiJournalRead(JOURNAL_KEY_LOG_COUNT, &count))
+		return count;
+
 	/* Perform DMA flash read (4 bytes) */
 	AdiFlashRead(LOG_COUNT_ADDR, 4, LogBuffer);
 
@@ -244,5 +662,8 @@ static uint32_t GetLogCount()
 	{
 		count = 0;
 	}
+
+	/* Seed the journal */
+	AdiJournalWrite(JOURNAL_KEY_LOG_COUNT, count);
 	return count;
 }
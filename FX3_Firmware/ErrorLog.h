@@ -32,6 +32,27 @@
 /** The flash address of the current log count. This is used to track the head of the error log  */
 #define LOG_COUNT_ADDR							(0x34000)
 
+/** The number of recent, distinct errors tracked in RAM for de-duplication */
+#define LOG_DEDUP_DEPTH							8
+
+/** Default error log rate limit window, in milliseconds */
+#define LOG_DEFAULT_RATE_WINDOW_MS				1000
+
+/** Default max number of error log flash writes allowed per rate limit window */
+#define LOG_DEFAULT_WRITES_PER_WINDOW			4
+
+/** Byte offset of the repeat count within a stored error log entry. Uses the firmware version padding bytes */
+#define LOG_REPEAT_COUNT_OFFSET					30
+
+/** Number of firmware version string bytes stored in an error log entry (including null terminator) */
+#define LOG_FW_VERSION_SIZE						10
+
+/** Size of a single error log entry, in bytes */
+#define LOG_ENTRY_SIZE							32
+
+/** Timeout for each bulk endpoint transfer during an error log dump, in ms */
+#define LOG_DUMP_TIMEOUT_MS						5000
+
 /** Enum to identify the source file which threw an error. More RAM efficient than the __FILE__ directive (gives full path as string) */
 typedef enum FileIdentifier
 {
@@ -66,7 +87,19 @@ typedef enum FileIdentifier
 	I2cFunctions_c = 9,
 
 	/** Error originating from HelperFunctions.c */
-	HelperFunctions_c = 10
+	HelperFunctions_c = 10,
+
+	/** Error originating from ConfigStore.c */
+	ConfigStore_c = 11,
+
+	/** Error originating from Journal.c */
+	Journal_c = 12,
+
+	/** Error originating from BootScript.c */
+	BootScript_c = 13,
+
+	/** Error originating from BootSlot.c */
+	BootSlot_c = 14
 
 }FileIdentifier;
 
@@ -94,12 +127,47 @@ typedef struct __attribute__((__packed__)) ErrorMsg
 	/** The file which originated the error. Is file identifier casted into uint (16 - 19) */
 	uint32_t File;
 
-	/** The firmware version number string (20 - 31) */
-	uint8_t FirmwareVersion[12];
+	/** The firmware version number string, null terminated (20 - 29) */
+	uint8_t FirmwareVersion[LOG_FW_VERSION_SIZE];
+
+	/** The number of times the error re-occurred after being logged. Saturates at 0xFFFF. Occupies
+	  * the trailing padding of the legacy 12 byte firmware version field, which older hosts ignore (30 - 31) */
+	uint16_t RepeatCount;
 }ErrorMsg;
 
+/**
+  * @brief Structure which tracks a recently logged error, for de-duplication and rate limiting
+  *
+  * A small table of these entries is kept in RAM. Repeated errors with the same file, line,
+  * and error code are folded into a single flash log entry by incrementing the repeat count,
+  * instead of generating a new flash entry per occurrence.
+ **/
+typedef struct LogDedupEntry
+{
+	/** The full error log entry, as it is (or will be) stored in flash */
+	ErrorMsg Msg;
+
+	/** The flash address of the stored log entry. 0 if the entry has not been written to flash yet */
+	uint32_t FlashAddr;
+
+	/** The repeat count value most recently written to flash */
+	uint16_t FlashRepeatCount;
+
+	/** RTOS time (ms) of the most recent flash write for this entry */
+	uint32_t FlashWriteTime;
+
+	/** Track if the table entry is in use */
+	CyBool_t Valid;
+}LogDedupEntry;
+
 /* External functions */
+CyU3PReturnStatus_t AdiErrorLogInit();
 void AdiLogError(FileIdentifier File, uint32_t Line, uint32_t ErrorCode);
+void AdiFlushErrorLog();
+void AdiClearErrorLog();
+void AdiSetErrorLogRateLimit(uint32_t WindowMs, uint32_t WritesPerWindow);
+CyU3PReturnStatus_t AdiErrorLogDumpStart(uint16_t RequestLength);
+CyU3PReturnStatus_t AdiErrorLogDumpWork();
 void WriteErrorLogCount(uint32_t count);
 
 #endif /* ERRORLOG_H_ */
@@ -20,10 +20,29 @@
 /* Private function prototypes */
 static uint16_t GetFlashDeviceAddress(uint32_t ByteAddress);
 static CyU3PReturnStatus_t FlashTransfer(uint32_t Address, uint16_t NumBytes, uint8_t* Buf, CyBool_t isRead);
+static CyU3PReturnStatus_t FlashPageTransfer(uint32_t Address, uint16_t NumBytes, uint8_t* Buf, CyBool_t isRead);
+static CyU3PReturnStatus_t FlashPageRead(uint32_t Address, uint16_t NumBytes, uint8_t* Buf);
+static CyU3PReturnStatus_t FlashPageWrite(uint32_t Address, uint16_t NumBytes, uint8_t* Buf);
+static uint16_t GetPageChunkSize(uint32_t Address, uint16_t NumBytes);
+static CyBool_t FlashCacheRead(uint32_t Address, uint16_t NumBytes, uint8_t* ReadBuf);
+static FlashCacheLine* FlashCacheLookup(uint32_t PageAddr);
+static CyU3PReturnStatus_t FlashBulkRecvSetup(uint8_t* Buf, uint16_t NumBytes);
 
 /** Global USB Buffer, from main */
 extern uint8_t USBBuffer[4096];
 
+/** Global bulk buffer, from main */
+extern uint8_t BulkBuffer[12288];
+
+/** Bulk in DMA channel, from main */
+extern CyU3PDmaChannel ChannelToPC;
+
+/** Bulk out DMA channel, from main */
+extern CyU3PDmaChannel ChannelFromPC;
+
+/** Application event handler, from main */
+extern CyU3PEvent EventHandler;
+
 /** FX3 state (from main) */
 extern BoardState FX3State;
 
@@ -33,6 +52,18 @@ static CyU3PDmaChannel flashTxHandle;
 /** I2C Rx DMA channel handle */
 static CyU3PDmaChannel flashRxHandle;
 
+/** Start address of the pending bulk flash read */
+static uint32_t BulkReadAddress = 0;
+
+/** Number of bytes remaining in the pending bulk flash read */
+static uint32_t BulkReadLength = 0;
+
+/** Flash read cache (LRU, write-through invalidate) */
+static FlashCacheLine FlashCache[FLASH_CACHE_LINES];
+
+/** Flash read cache access counter, used to track LRU line */
+static uint32_t FlashCacheClock = 0;
+
 /**
   * @brief Initializes flash memory interface module
   *
@@ -153,6 +184,8 @@ void AdiFlashDeInit()
  **/
 void AdiFlashWrite(uint32_t Address, uint16_t NumBytes, uint8_t* WriteBuf)
 {
+	/* Drop any cached copies of the region being written */
+	AdiFlashCacheInvalidate(Address, NumBytes);
 	/* Enable flash for write */
 	CyU3PGpioSimpleSetValue(ADI_FLASH_WRITE_ENABLE_PIN, CyFalse);
 	/* Perform write */
@@ -173,13 +206,39 @@ void AdiFlashWrite(uint32_t Address, uint16_t NumBytes, uint8_t* WriteBuf)
   * @return void
   *
   * This function leaves the I2C EEPROM write functionality disabled. This prevents
-  * inadvertent writes from being processed.
+  * inadvertent writes from being processed. Small reads are served from the flash
+  * read cache when possible.
  **/
 void AdiFlashRead(uint32_t Address, uint16_t NumBytes, uint8_t* ReadBuf)
 {
+	if(FlashCacheRead(Address, NumBytes, ReadBuf))
+		return;
 	FlashTransfer(Address, NumBytes, ReadBuf, CyTrue);
 }
 
+/**
+  * @brief Invalidates any flash read cache lines which overlap a region of flash
+  *
+  * @param Address The start address of the flash region
+  *
+  * @param NumBytes The size of the flash region, in bytes
+  *
+  * @return void
+  *
+  * This is called automatically by AdiFlashWrite. It must also be called if the flash
+  * is modified through any path other than AdiFlashWrite.
+ **/
+void AdiFlashCacheInvalidate(uint32_t Address, uint32_t NumBytes)
+{
+	uint32_t endAddr = Address + NumBytes;
+
+	for(int i = 0; i < FLASH_CACHE_LINES; i++)
+	{
+		if(FlashCache[i].Valid && (FlashCache[i].PageAddr < endAddr) && ((FlashCache[i].PageAddr + FLASH_PAGE_SIZE) > Address))
+			FlashCache[i].Valid = CyFalse;
+	}
+}
+
 /**
   * @brief Handles flash read requests from control endpoint
   *
@@ -206,6 +265,288 @@ void AdiFlashReadHandler(uint32_t Address, uint16_t NumBytes)
 	CyU3PUsbSendEP0Data(NumBytes, USBBuffer);
 }
 
+/**
+  * @brief Handles bulk flash read requests from control endpoint
+  *
+  * @param RequestLength The number of bytes sent over the control endpoint. Should be 8.
+  *
+  * @return A status code indicating the success of the bulk read start
+  *
+  * The control endpoint data contains the flash start address (0 - 3) and the number
+  * of bytes to read (4 - 7). Requests which extend past the end of flash are clamped
+  * to the flash size. The flash data is then streamed over the ChannelToPC bulk endpoint
+  * by the AppThread (AdiFlashBulkReadWork), so the host should issue a single bulk read
+  * of the requested size.
+ **/
+CyU3PReturnStatus_t AdiFlashBulkReadStart(uint16_t RequestLength)
+{
+	CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
+	uint16_t bytesRead = 0;
+
+	/* Get data from control endpoint */
+	status = CyU3PUsbGetEP0Data(RequestLength, USBBuffer, &bytesRead);
+	if(status != CY_U3P_SUCCESS)
+		return status;
+
+	/* Parse USB Buffer */
+	BulkReadAddress = USBBuffer[0];
+	BulkReadAddress |= (USBBuffer[1] << 8);
+	BulkReadAddress |= (USBBuffer[2] << 16);
+	BulkReadAddress |= (USBBuffer[3] << 24);
+	BulkReadLength = USBBuffer[4];
+	BulkReadLength |= (USBBuffer[5] << 8);
+	BulkReadLength |= (USBBuffer[6] << 16);
+	BulkReadLength |= (USBBuffer[7] << 24);
+
+	/* Clamp to flash size */
+	if(BulkReadAddress >= FLASH_SIZE)
+	{
+		AdiLogError(Flash_c, __LINE__, BulkReadAddress);
+		BulkReadLength = 0;
+		return CY_U3P_ERROR_BAD_ARGUMENT;
+	}
+	if(BulkReadLength > (FLASH_SIZE - BulkReadAddress))
+		BulkReadLength = FLASH_SIZE - BulkReadAddress;
+
+#ifdef VERBOSE_MODE
+	CyU3PDebugPrint (4, "Starting bulk flash read: Addr: 0x%x, Bytes: 0x%x\r\n", BulkReadAddress, BulkReadLength);
+#endif
+
+	/* Start the read in the AppThread */
+	if(BulkReadLength > 0)
+		status = CyU3PEventSet(&EventHandler, ADI_FLASH_BULK_READ, CYU3P_EVENT_OR);
+
+	return status;
+}
+
+/**
+  * @brief Streams the flash region requested by AdiFlashBulkReadStart to the PC
+  *
+  * @return A status code indicating the success of the bulk read
+  *
+  * BulkBuffer is split into two FLASH_BULK_CHUNK_SIZE halves. While one half is being
+  * sent over the ChannelToPC endpoint, the next chunk is read from flash into the other
+  * half, so the I2C reads overlap the USB transfers. The flash interface is only initialized
+  * once for the entire read. The chunk size is a multiple of all USB packet sizes, so only the
+  * final chunk can be a short packet.
+ **/
+CyU3PReturnStatus_t AdiFlashBulkReadWork()
+{
+	CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
+	CyU3PDmaBuffer_t dmaBuf;
+	CyBool_t sendPending = CyFalse;
+	uint32_t bufIndex = 0;
+	uint16_t chunkSize;
+
+	/* Make sure the error log in flash is current (not done from the USB setup callback) */
+	AdiFlushErrorLog();
+
+	/* Init flash once for the full read */
+	AdiFlashInit();
+
+	while(BulkReadLength > 0)
+	{
+		chunkSize = FLASH_BULK_CHUNK_SIZE;
+		if(BulkReadLength < chunkSize)
+			chunkSize = BulkReadLength;
+
+		/* Read next chunk while the previous chunk is in flight */
+		status = FlashPageTransfer(BulkReadAddress, chunkSize, BulkBuffer + (bufIndex * FLASH_BULK_CHUNK_SIZE), CyTrue);
+		if(status != CY_U3P_SUCCESS)
+			break;
+
+		/* Wait for the previous chunk to finish sending */
+		if(sendPending)
+		{
+			status = CyU3PDmaChannelWaitForCompletion(&ChannelToPC, FLASH_TIMEOUT_MS);
+			if(status != CY_U3P_SUCCESS)
+				break;
+		}
+
+		/* Send chunk */
+		dmaBuf.buffer = BulkBuffer + (bufIndex * FLASH_BULK_CHUNK_SIZE);
+		dmaBuf.size = FLASH_BULK_CHUNK_SIZE;
+		dmaBuf.count = chunkSize;
+		dmaBuf.status = 0;
+		status = CyU3PDmaChannelSetupSendBuffer(&ChannelToPC, &dmaBuf);
+		if(status != CY_U3P_SUCCESS)
+			break;
+		sendPending = CyTrue;
+
+		/* Swap buffers */
+		bufIndex ^= 1;
+		BulkReadAddress += chunkSize;
+		BulkReadLength -= chunkSize;
+	}
+
+	/* Wait for final chunk */
+	if(sendPending && (status == CY_U3P_SUCCESS))
+		status = CyU3PDmaChannelWaitForCompletion(&ChannelToPC, FLASH_TIMEOUT_MS);
+
+	AdiFlashDeInit();
+
+	if(status != CY_U3P_SUCCESS)
+	{
+		AdiLogError(Flash_c, __LINE__, status);
+		CyU3PDmaChannelReset(&ChannelToPC);
+	}
+
+	BulkReadLength = 0;
+	return status;
+}
+
+/**
+  * @brief Programs a block of flash with data received from the PC over the bulk endpoint
+  *
+  * @param Address The flash byte address to start writing at
+  *
+  * @param NumBytes The number of bytes to receive and program
+  *
+  * @param Crc Returns the CRC32 of the received data by reference
+  *
+  * @return A status code indicating the success of the bulk write
+  *
+  * The data is received over the ChannelFromPC bulk endpoint, as a single transfer from the
+  * host. BulkBuffer is split into two FLASH_BULK_CHUNK_SIZE halves. While one half is being
+  * written to flash, the next chunk is received from the PC into the other half. The flash
+  * write enable is asserted, and the flash interface initialized, once for the entire write.
+ **/
+CyU3PReturnStatus_t AdiFlashBulkWrite(uint32_t Address, uint32_t NumBytes, uint32_t* Crc)
+{
+	CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
+	CyU3PDmaBuffer_t dmaBuf;
+	uint32_t bufIndex = 0;
+	uint16_t chunkSize, nextSize;
+
+	*Crc = 0;
+	if(NumBytes == 0)
+		return CY_U3P_SUCCESS;
+
+	AdiFlashCacheInvalidate(Address, NumBytes);
+
+	/* Start receiving the first chunk */
+	chunkSize = (NumBytes < FLASH_BULK_CHUNK_SIZE) ? NumBytes : FLASH_BULK_CHUNK_SIZE;
+	status = FlashBulkRecvSetup(BulkBuffer, chunkSize);
+	if(status != CY_U3P_SUCCESS)
+	{
+		AdiLogError(Flash_c, __LINE__, status);
+		return status;
+	}
+
+	/* Enable flash for write, and init flash once for the full write */
+	CyU3PGpioSimpleSetValue(ADI_FLASH_WRITE_ENABLE_PIN, CyFalse);
+	AdiFlashInit();
+
+	while(NumBytes > 0)
+	{
+		chunkSize = (NumBytes < FLASH_BULK_CHUNK_SIZE) ? NumBytes : FLASH_BULK_CHUNK_SIZE;
+
+		/* Wait for the current chunk from the PC */
+		status = CyU3PDmaChannelWaitForRecvBuffer(&ChannelFromPC, &dmaBuf, FLASH_TIMEOUT_MS);
+		if(status != CY_U3P_SUCCESS)
+			break;
+		if(dmaBuf.count != chunkSize)
+		{
+			status = CY_U3P_ERROR_BAD_ARGUMENT;
+			break;
+		}
+
+		/* Receive the next chunk while this chunk is programmed */
+		if(NumBytes > chunkSize)
+		{
+			nextSize = ((NumBytes - chunkSize) < FLASH_BULK_CHUNK_SIZE) ? (NumBytes - chunkSize) : FLASH_BULK_CHUNK_SIZE;
+			status = FlashBulkRecvSetup(BulkBuffer + ((bufIndex ^ 1) * FLASH_BULK_CHUNK_SIZE), nextSize);
+			if(status != CY_U3P_SUCCESS)
+				break;
+		}
+
+		status = FlashPageTransfer(Address, chunkSize, BulkBuffer + (bufIndex * FLASH_BULK_CHUNK_SIZE), CyFalse);
+		if(status != CY_U3P_SUCCESS)
+			break;
+		*Crc = AdiCrc32(*Crc, BulkBuffer + (bufIndex * FLASH_BULK_CHUNK_SIZE), chunkSize);
+
+		bufIndex ^= 1;
+		Address += chunkSize;
+		NumBytes -= chunkSize;
+	}
+
+	AdiFlashDeInit();
+	CyU3PGpioSimpleSetValue(ADI_FLASH_WRITE_ENABLE_PIN, CyTrue);
+
+	if(status != CY_U3P_SUCCESS)
+	{
+		AdiLogError(Flash_c, __LINE__, status);
+		CyU3PDmaChannelReset(&ChannelFromPC);
+	}
+
+	return status;
+}
+
+/**
+  * @brief Calculates the CRC32 of a block of flash, read back from the device
+  *
+  * @param Address The flash byte address to start reading at
+  *
+  * @param NumBytes The number of bytes to read
+  *
+  * @param Crc Returns the CRC32 of the flash contents by reference
+  *
+  * @return A status code indicating the success of the flash read
+  *
+  * The flash is always read from the device (never the read cache), so this can be used to
+  * verify data which was just programmed.
+ **/
+CyU3PReturnStatus_t AdiFlashReadCrc(uint32_t Address, uint32_t NumBytes, uint32_t* Crc)
+{
+	CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
+	uint16_t chunkSize;
+
+	*Crc = 0;
+	AdiFlashInit();
+
+	while(NumBytes > 0)
+	{
+		chunkSize = (NumBytes < FLASH_BULK_CHUNK_SIZE) ? NumBytes : FLASH_BULK_CHUNK_SIZE;
+		status = FlashPageRead(Address, chunkSize, BulkBuffer);
+		if(status != CY_U3P_SUCCESS)
+			break;
+		*Crc = AdiCrc32(*Crc, BulkBuffer, chunkSize);
+		Address += chunkSize;
+		NumBytes -= chunkSize;
+	}
+
+	AdiFlashDeInit();
+
+	if(status != CY_U3P_SUCCESS)
+		AdiLogError(Flash_c, __LINE__, status);
+
+	return status;
+}
+
+/**
+  * @brief Sets up the ChannelFromPC bulk endpoint to receive a chunk of data
+  *
+  * @param Buf The RAM buffer to receive into
+  *
+  * @param NumBytes The number of bytes expected
+  *
+  * @return A status code indicating the success of the receive setup
+  *
+  * The receive buffer size is rounded up to a whole number of USB packets. The receive completes
+  * once the expected number of bytes (a whole number of packets), or a short packet, arrives.
+ **/
+static CyU3PReturnStatus_t FlashBulkRecvSetup(uint8_t* Buf, uint16_t NumBytes)
+{
+	CyU3PDmaBuffer_t dmaBuf;
+	uint16_t packetSize = FX3State.UsbBufferSize;
+
+	dmaBuf.buffer = Buf;
+	dmaBuf.size = ((NumBytes + packetSize - 1) / packetSize) * packetSize;
+	dmaBuf.count = 0;
+	dmaBuf.status = 0;
+	return CyU3PDmaChannelSetupRecvBuffer(&ChannelFromPC, &dmaBuf);
+}
+
 /**
   * @brief Performs a transfer from the I2C flash memory
   *
@@ -221,137 +562,381 @@ void AdiFlashReadHandler(uint32_t Address, uint16_t NumBytes)
   *
   * This function performs all interfacing with the ST m24m02-dr I2C EEPROM which is
   * included on the iSensor FX3 board (and FX3 explorer kit). Before each transaction,
-  * AdiFlashInit is called to ensure the flash and DMA are configured properly. Then, for
-  * each transaction, the read/write is split into 64 byte (or less) chunks, which are
-  * each performed using a single I2C<->Mem DMA transfer. Once all required transfers have
+  * AdiFlashInit is called to ensure the flash and DMA are configured properly. The transfer
+  * itself is performed by FlashPageTransfer. Once all required transfers have
   * been performed, the flash is de-initialized.
  **/
 static CyU3PReturnStatus_t FlashTransfer(uint32_t Address, uint16_t NumBytes, uint8_t* Buf, CyBool_t isRead)
 {
-    CyU3PDmaBuffer_t buf_p;
-    CyU3PI2cPreamble_t preamble;
-    CyU3PReturnStatus_t status;
+	CyU3PReturnStatus_t status;
 
-    uint16_t dmaCount;
-    uint16_t lastCount;
+	/* Return for zero transfer */
+	if(NumBytes == 0)
+		return CY_U3P_SUCCESS;
 
-    /* device address (upper two address bits encoded into device address) */
-    uint16_t device_address;
+	/* Init flash */
+	AdiFlashInit();
 
-    /* Calculate page count */
-    uint16_t pageCount = (NumBytes / FLASH_PAGE_SIZE);
+	/* Perform transfer */
+	status = FlashPageTransfer(Address, NumBytes, Buf, isRead);
 
-    /* Return for zero transfer */
-    if(NumBytes == 0)
-        return CY_U3P_SUCCESS;
+	/* De-Init flash */
+	AdiFlashDeInit();
+
+	/* Return the status code */
+	return status;
+}
+
+/**
+  * @brief Performs a transfer from the I2C flash memory, without initializing the flash interface
+  *
+  * @param Address The flash byte address to start the read/write operation from. Valid range 0x0 - 0x40000
+  *
+  * @param NumBytes The number of data bytes to transfer to/from the flash
+  *
+  * @param Buf RAM data buffer. Write data must be placed here. Read data is returned here.
+  *
+  * @param isRead Bool indicating if operation is read or write
+  *
+  * @return Status code indicating the success of the flash read/write operation
+  *
+  * The transfer is split on flash page boundaries (leading partial page, full pages, trailing
+  * partial page), with each chunk performed using a single I2C<->Mem DMA transfer. This allows
+  * writes to start at any address without wrapping within a flash page. AdiFlashInit must be
+  * called before this function.
+ **/
+static CyU3PReturnStatus_t FlashPageTransfer(uint32_t Address, uint16_t NumBytes, uint8_t* Buf, CyBool_t isRead)
+{
+	if(isRead)
+		return FlashPageRead(Address, NumBytes, Buf);
+	else
+		return FlashPageWrite(Address, NumBytes, Buf);
+}
 
-    /* Check if extra bytes which fall onto another page */
-    lastCount = (NumBytes % FLASH_PAGE_SIZE);
-    if(lastCount != 0)
-        pageCount ++;
-    else
-    	lastCount = FLASH_PAGE_SIZE;
+/**
+  * @brief Reads a block of flash memory, split into page aligned DMA transfers
+  *
+  * @param Address The flash byte address to start reading from
+  *
+  * @param NumBytes The number of bytes to read
+  *
+  * @param Buf RAM buffer to read the flash data into
+  *
+  * @return Status code indicating the success of the flash read operation
+  *
+  * The read stops at the first failed step of any page, and returns its status.
+ **/
+static CyU3PReturnStatus_t FlashPageRead(uint32_t Address, uint16_t NumBytes, uint8_t* Buf)
+{
+    CyU3PDmaBuffer_t buf_p;
+    CyU3PI2cPreamble_t preamble;
+    CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
+    uint16_t dmaCount;
 
-    /* Init flash */
-    AdiFlashInit();
+    /* device address (upper two address bits encoded into device address) */
+    uint16_t device_address;
 
     /* Update the buffer status. */
     buf_p.status = 0;
 	/* Update buffer address */
 	buf_p.buffer = Buf;
 
-    while (pageCount != 0)
+    while (NumBytes != 0)
     {
     	/* Get device addr */
     	device_address = GetFlashDeviceAddress(Address);
-    	/* Get transfer count */
-    	if(pageCount > 1)
-    		dmaCount = FLASH_PAGE_SIZE;
-    	else
-    		dmaCount = lastCount;
+    	/* Get transfer count (up to the end of the current page) */
+    	dmaCount = GetPageChunkSize(Address, NumBytes);
 
 #ifdef VERBOSE_MODE
-    	CyU3PDebugPrint (4, "I2C access: Dev addr: 0x%x Byte Addr: 0x%x, size: 0x%x, pages: 0x%x read: %d\r\n", device_address, Address, dmaCount, pageCount, isRead);
+    	CyU3PDebugPrint (4, "I2C read: Dev addr: 0x%x Byte Addr: 0x%x, size: 0x%x\r\n", device_address, Address, dmaCount);
 #endif
 
-    	if(isRead)
-    	{
-            /* Update the preamble information. */
-            preamble.length    = 4;
-            preamble.buffer[0] = device_address;
-            preamble.buffer[1] = (uint8_t)((Address & 0xFF00) >> 8);
-            preamble.buffer[2] = (uint8_t)(Address & 0xFF);
-            preamble.buffer[3] = (device_address | 0x01);
-            preamble.ctrlMask  = 0x0004;
-
-            buf_p.size = FLASH_PAGE_SIZE;
-            buf_p.count = dmaCount;
+        /* Update the preamble information. */
+        preamble.length    = 4;
+        preamble.buffer[0] = device_address;
+        preamble.buffer[1] = (uint8_t)((Address & 0xFF00) >> 8);
+        preamble.buffer[2] = (uint8_t)(Address & 0xFF);
+        preamble.buffer[3] = (device_address | 0x01);
+        preamble.ctrlMask  = 0x0004;
 
-            /* Send read command */
-            status = CyU3PI2cSendCommand(&preamble, dmaCount, CyTrue);
+        buf_p.size = FLASH_PAGE_SIZE;
+        buf_p.count = dmaCount;
+
+        /* Set up DMA to receive read data, before the read command starts the I2C transfer */
+        status = CyU3PDmaChannelSetupRecvBuffer (&flashRxHandle, &buf_p);
+        if(status != CY_U3P_SUCCESS)
+        {
 #ifdef VERBOSE_MODE
-            if(status != CY_U3P_SUCCESS)
-            	CyU3PDebugPrint (4, "I2C send read command failed: 0x%x\r\n", status);
+        	CyU3PDebugPrint (4, "I2C DMA Rx channel setup failed: 0x%x\r\n", status);
 #endif
-            /* Set up DMA to receive read data */
-            status = CyU3PDmaChannelSetupRecvBuffer (&flashRxHandle, &buf_p);
+        	return status;
+        }
+
+        /* Send read command */
+        status = CyU3PI2cSendCommand(&preamble, dmaCount, CyTrue);
+        if(status != CY_U3P_SUCCESS)
+        {
 #ifdef VERBOSE_MODE
-            if(status != CY_U3P_SUCCESS)
-            	CyU3PDebugPrint (4, "I2C DMA Rx channel setup failed: 0x%x\r\n", status);
+        	CyU3PDebugPrint (4, "I2C send read command failed: 0x%x\r\n", status);
 #endif
-    	}
-    	else
-    	{
-            /* Update the preamble information. */
-            preamble.length    = 3;
-            preamble.buffer[0] = device_address;
-            preamble.buffer[1] = (uint8_t)((Address & 0xFF00) >> 8);
-            preamble.buffer[2] = (uint8_t)(Address & 0xFF);
-            preamble.ctrlMask  = 0x0000;
-
-            buf_p.size = FLASH_PAGE_SIZE;
-            buf_p.count = dmaCount;
+        	CyU3PDmaChannelReset(&flashRxHandle);
+        	return status;
+        }
 
-            /* Setup DMA transmit buffer */
-            status = CyU3PDmaChannelSetupSendBuffer (&flashTxHandle, &buf_p);
+        /* Wait for finish */
+        status = CyU3PI2cWaitForBlockXfer(CyTrue);
+        if(status != CY_U3P_SUCCESS)
+        {
 #ifdef VERBOSE_MODE
-            if(status != CY_U3P_SUCCESS)
-            	CyU3PDebugPrint (4, "I2C DMA Tx channel setup failed: 0x%x\r\n", status);
+        	CyU3PDebugPrint (4, "I2C DMA wait for completion failed: 0x%x\r\n", status);
+#endif
+        	/* Drop the partly received page, so the next read starts clean */
+        	CyU3PDmaChannelReset(&flashRxHandle);
+        	return status;
+        }
+
+        NumBytes -= dmaCount;
+        Address += dmaCount;
+        buf_p.buffer += dmaCount;
+    }
+
+    /* Return the status code */
+    return status;
+}
+
+/**
+  * @brief Writes a block of flash memory, split on flash page boundaries
+  *
+  * @param Address The flash byte address to start writing to
+  *
+  * @param NumBytes The number of bytes to write
+  *
+  * @param Buf RAM buffer holding the data to write
+  *
+  * @return Status code indicating the success of the flash write operation
+  *
+  * Each page write is followed by the EEPROM internal write cycle. Instead of stalling for
+  * the worst case write cycle time, the DMA for the next page is set up while the write cycle
+  * is in progress, and the EEPROM is then polled for an ACK (it NAKs its device address until
+  * the write cycle is complete). If ACK polling fails, the worst case write cycle time is used.
+ **/
+static CyU3PReturnStatus_t FlashPageWrite(uint32_t Address, uint16_t NumBytes, uint8_t* Buf)
+{
+    CyU3PDmaBuffer_t buf_p;
+    CyU3PI2cPreamble_t preamble;
+    CyU3PI2cPreamble_t ackPreamble;
+    CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
+    uint16_t dmaCount;
+
+    /* device address (upper two address bits encoded into device address) */
+    uint16_t device_address;
+
+    if(NumBytes == 0)
+    	return CY_U3P_SUCCESS;
+
+    /* Set up DMA for the first (possibly partial) page */
+    buf_p.status = 0;
+    buf_p.buffer = Buf;
+    buf_p.size = FLASH_PAGE_SIZE;
+    dmaCount = GetPageChunkSize(Address, NumBytes);
+    buf_p.count = dmaCount;
+    status = CyU3PDmaChannelSetupSendBuffer (&flashTxHandle, &buf_p);
+    if(status != CY_U3P_SUCCESS)
+    {
+#ifdef VERBOSE_MODE
+    	CyU3PDebugPrint (4, "I2C DMA Tx channel setup failed: 0x%x\r\n", status);
 #endif
-            /* Send write command */
-            status = CyU3PI2cSendCommand (&preamble, dmaCount, CyFalse);
+    	return status;
+    }
+
+    while (NumBytes != 0)
+    {
+    	/* Get device addr */
+    	device_address = GetFlashDeviceAddress(Address);
+
 #ifdef VERBOSE_MODE
-            if(status != CY_U3P_SUCCESS)
-            	CyU3PDebugPrint (4, "I2C send write command failed: 0x%x\r\n", status);
+    	CyU3PDebugPrint (4, "I2C write: Dev addr: 0x%x Byte Addr: 0x%x, size: 0x%x\r\n", device_address, Address, dmaCount);
 #endif
-    	}
-        /* Stall for 20ms */
-        CyU3PThreadSleep(20);
-        /* Wait for finish */
-        status = CyU3PI2cWaitForBlockXfer(isRead);
+
+        /* Update the preamble information. */
+        preamble.length    = 3;
+        preamble.buffer[0] = device_address;
+        preamble.buffer[1] = (uint8_t)((Address & 0xFF00) >> 8);
+        preamble.buffer[2] = (uint8_t)(Address & 0xFF);
+        preamble.ctrlMask  = 0x0000;
+
+        /* Send write command (DMA was set up in the previous iteration) */
+        status = CyU3PI2cSendCommand (&preamble, dmaCount, CyFalse);
+        if(status != CY_U3P_SUCCESS)
+        {
 #ifdef VERBOSE_MODE
+        	CyU3PDebugPrint (4, "I2C send write command failed: 0x%x\r\n", status);
+#endif
+        	CyU3PDmaChannelReset(&flashTxHandle);
+        	return status;
+        }
+
+        /* Wait for the data to be transferred to the EEPROM page buffer */
+        status = CyU3PI2cWaitForBlockXfer(CyFalse);
         if(status != CY_U3P_SUCCESS)
+        {
+#ifdef VERBOSE_MODE
         	CyU3PDebugPrint (4, "I2C DMA wait for completion failed: 0x%x\r\n", status);
 #endif
+        	CyU3PDmaChannelReset(&flashTxHandle);
+        	return status;
+        }
 
-        /* decrement page count */
-        pageCount --;
-        /* Increment address */
+        NumBytes -= dmaCount;
         Address += dmaCount;
         buf_p.buffer += dmaCount;
-    }
 
+        /* Set up DMA for the next page while the write cycle is in progress */
+        if(NumBytes != 0)
+        {
+        	dmaCount = GetPageChunkSize(Address, NumBytes);
+            buf_p.count = dmaCount;
+            status = CyU3PDmaChannelSetupSendBuffer (&flashTxHandle, &buf_p);
+            if(status != CY_U3P_SUCCESS)
+            {
 #ifdef VERBOSE_MODE
-    CyU3PDebugPrint (4, "Flash transfer complete!\r\n", status);
+            	CyU3PDebugPrint (4, "I2C DMA Tx channel setup failed: 0x%x\r\n", status);
 #endif
+            	return status;
+            }
+        }
+
+        /* Wait for the write cycle to complete */
+        ackPreamble.length    = 1;
+        ackPreamble.buffer[0] = device_address;
+        ackPreamble.ctrlMask  = 0x0000;
+        if(CyU3PI2cWaitForAck(&ackPreamble, FLASH_ACK_POLL_RETRIES) != CY_U3P_SUCCESS)
+        	CyU3PThreadSleep(FLASH_WRITE_CYCLE_MS);
+    }
 
-    /* De-Init flash */
-    AdiFlashDeInit();
+#ifdef VERBOSE_MODE
+    CyU3PDebugPrint (4, "Flash write complete!\r\n", status);
+#endif
 
     /* Return the status code */
     return status;
 }
 
+/**
+  * @brief Gets the size of the next flash transfer chunk, which must not cross a page boundary
+  *
+  * @param Address The flash byte address of the chunk
+  *
+  * @param NumBytes The number of bytes remaining in the transfer
+  *
+  * @return The chunk size, in bytes
+ **/
+static uint16_t GetPageChunkSize(uint32_t Address, uint16_t NumBytes)
+{
+	uint16_t chunk = FLASH_PAGE_SIZE - (Address & (FLASH_PAGE_SIZE - 1));
+	if(chunk > NumBytes)
+		chunk = NumBytes;
+	return chunk;
+}
+
+/**
+  * @brief Performs a flash read through the flash read cache
+  *
+  * @param Address The flash byte address to start reading from
+  *
+  * @param NumBytes The number of bytes to read
+  *
+  * @param ReadBuf RAM buffer to read the flash data into
+  *
+  * @return CyTrue if the read was handled by the cache, CyFalse if it must be performed directly
+  *
+  * Each flash page touched by the read is looked up in the cache. Missing pages are read
+  * from flash in full and replace the least recently used line. The flash interface is only
+  * initialized if at least one page misses, so repeated reads of a cached region complete
+  * without any I2C traffic. Large reads bypass the cache to avoid evicting the working set.
+  * If a page read fails, the line is left invalid and CyFalse is returned, so the whole read
+  * is repeated directly instead of returning stale line data.
+ **/
+static CyBool_t FlashCacheRead(uint32_t Address, uint16_t NumBytes, uint8_t* ReadBuf)
+{
+	FlashCacheLine* line;
+	CyBool_t flashActive = CyFalse;
+	uint32_t pageAddr, firstPage, lastPage;
+	uint16_t offset, count;
+
+	if(NumBytes == 0)
+		return CyTrue;
+
+	/* Check read size (in pages) */
+	firstPage = Address & ~(FLASH_PAGE_SIZE - 1);
+	lastPage = (Address + NumBytes - 1) & ~(FLASH_PAGE_SIZE - 1);
+	if(((lastPage - firstPage) / FLASH_PAGE_SIZE) >= FLASH_CACHE_MAX_READ_PAGES)
+		return CyFalse;
+
+	for(pageAddr = firstPage; pageAddr <= lastPage; pageAddr += FLASH_PAGE_SIZE)
+	{
+		line = FlashCacheLookup(pageAddr);
+		if(!line->Valid || (line->PageAddr != pageAddr))
+		{
+			/* Cache miss, fill line from flash */
+			if(!flashActive)
+			{
+				AdiFlashInit();
+				flashActive = CyTrue;
+			}
+			line->Valid = CyFalse;
+			if(FlashPageRead(pageAddr, FLASH_PAGE_SIZE, line->Data) != CY_U3P_SUCCESS)
+			{
+				/* Line holds no valid data. Let the caller read directly from flash */
+				AdiFlashDeInit();
+				return CyFalse;
+			}
+			line->PageAddr = pageAddr;
+			line->Valid = CyTrue;
+		}
+		line->LastUse = ++FlashCacheClock;
+
+		/* Copy the requested part of the page */
+		offset = Address - pageAddr;
+		count = FLASH_PAGE_SIZE - offset;
+		if(count > NumBytes)
+			count = NumBytes;
+		CyU3PMemCopy(ReadBuf, line->Data + offset, count);
+		ReadBuf += count;
+		Address += count;
+		NumBytes -= count;
+	}
+
+	if(flashActive)
+		AdiFlashDeInit();
+
+	return CyTrue;
+}
+
+/**
+  * @brief Finds the cache line for a flash page
+  *
+  * @param PageAddr The page aligned flash address
+  *
+  * @return The line holding the page if cached, otherwise the line to replace (invalid or LRU)
+ **/
+static FlashCacheLine* FlashCacheLookup(uint32_t PageAddr)
+{
+	FlashCacheLine* victim = &FlashCache[0];
+
+	for(int i = 0; i < FLASH_CACHE_LINES; i++)
+	{
+		if(FlashCache[i].Valid && (FlashCache[i].PageAddr == PageAddr))
+			return &FlashCache[i];
+
+		/* Prefer invalid lines, then least recently used */
+		if(victim->Valid && (!FlashCache[i].Valid || (FlashCache[i].LastUse < victim->LastUse)))
+			victim = &FlashCache[i];
+	}
+	return victim;
+}
+
 /**
   * @brief Gets the flash devices address, based on the requested byte address
   *
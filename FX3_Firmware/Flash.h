@@ -24,17 +24,57 @@
 #include "cyu3i2c.h"
 #include "main.h"
 
+/** Page size for attached i2c flash memory (64 bytes)  */
+#define FLASH_PAGE_SIZE		0x40
+
+/** Number of pages held in the flash read cache */
+#define FLASH_CACHE_LINES	8
+
+/** Reads spanning more pages than this bypass the flash read cache */
+#define FLASH_CACHE_MAX_READ_PAGES	4
+
+/** @brief Flash read cache line. Holds one flash page */
+typedef struct FlashCacheLine
+{
+	/** Cached page data. Aligned for DMA with D-cache enabled */
+	uint8_t Data[FLASH_PAGE_SIZE] __attribute__((aligned(32)));
+
+	/** Flash address of the cached page */
+	uint32_t PageAddr;
+
+	/** Access counter value at last use, for LRU replacement */
+	uint32_t LastUse;
+
+	/** Track if the line holds valid data */
+	CyBool_t Valid;
+
+}FlashCacheLine;
+
 /* Public function prototypes */
 CyU3PReturnStatus_t AdiFlashInit();
 void AdiFlashDeInit();
 void AdiFlashWrite(uint32_t Address, uint16_t NumBytes, uint8_t* WriteBuf);
 void AdiFlashRead(uint32_t Address, uint16_t NumBytes, uint8_t* ReadBuf);
 void AdiFlashReadHandler(uint32_t Address, uint16_t NumBytes);
+void AdiFlashCacheInvalidate(uint32_t Address, uint32_t NumBytes);
+CyU3PReturnStatus_t AdiFlashBulkReadStart(uint16_t RequestLength);
+CyU3PReturnStatus_t AdiFlashBulkReadWork();
+CyU3PReturnStatus_t AdiFlashBulkWrite(uint32_t Address, uint32_t NumBytes, uint32_t* Crc);
+CyU3PReturnStatus_t AdiFlashReadCrc(uint32_t Address, uint32_t NumBytes, uint32_t* Crc);
 
-/** Page size for attached i2c flash memory (64 bytes)  */
-#define FLASH_PAGE_SIZE		0x40
+/** Worst case flash write cycle time (ms). Used if ACK polling fails */
+#define FLASH_WRITE_CYCLE_MS	20
+
+/** Max number of ACK polls while waiting for a flash write cycle to complete */
+#define FLASH_ACK_POLL_RETRIES	1000
 
 /** Flash operation timeout  */
 #define FLASH_TIMEOUT_MS	5000
 
+/** Total size of attached i2c flash memory (256KB) */
+#define FLASH_SIZE			0x40000
+
+/** Chunk size for bulk flash reads. Half of BulkBuffer, for double buffering */
+#define FLASH_BULK_CHUNK_SIZE	6144
+
 #endif /* FLASH_H_ */
@@ -0,0 +1,317 @@
+/**
+  * Copyright (c) Analog Devices Inc, 2018 - 2020
+  * All Rights Reserved.
+  *
+  * THIS SOFTWARE UTILIZES LIBRARIES DEVELOPED
+  * AND MAINTAINED BY CYPRESS INC. THE LICENSE INCLUDED IN
+  * THIS REPOSITORY DOES NOT EXTEND TO CYPRESS PROPERTY.
+  *
+  * Use of this file is governed by the license agreement
+  * included in this repository.
+  *
+  * @file		Journal.c
+  * @date		10/17/2020
+  * @author		A. Nolan (alex.nolan@analog.com)
+  * @brief		Implementation file for the wear leveled flash key/value journal
+ **/
+
+#include "Journal.h"
+
+/* Private function prototypes */
+static uint32_t GetSlotAddress(uint32_t Bank, uint32_t Slot);
+static void WriteRecord(uint32_t Bank, uint32_t Slot, uint16_t Key, uint16_t Generation, uint32_t Value);
+static CyBool_t IsRecordValid(JournalRecord* Record);
+static CyBool_t ReadBankHeader(uint32_t Bank, uint16_t* Generation);
+static void ScanBank(uint32_t Bank);
+static void CompactJournal();
+
+/** RAM index of the current value for each key */
+static uint32_t IndexValue[JOURNAL_MAX_KEYS];
+
+/** Tracks which keys in the RAM index have a stored value */
+static CyBool_t IndexValid[JOURNAL_MAX_KEYS];
+
+/** The bank currently being appended to */
+static uint32_t ActiveBank = 0;
+
+/** The generation of the active bank */
+static uint16_t ActiveGeneration = 0;
+
+/** The next free record slot in the active bank */
+static uint32_t NextSlot = 1;
+
+/** Tracks if the journal has been scanned from flash */
+static CyBool_t JournalInitialized = CyFalse;
+
+/**
+  * @brief Initializes the journal by scanning the flash journal region
+  *
+  * @return void
+  *
+  * The bank with the newest valid header is used as the active bank. Each valid
+  * record in that bank is applied to the RAM index in order (later records override
+  * earlier ones), and the first invalid slot becomes the append point. If neither
+  * bank has a valid header, bank 0 is formatted. This function is called automatically
+  * on the first journal access.
+ **/
+void AdiJournalInit()
+{
+	uint16_t gen0, gen1;
+	CyBool_t valid0, valid1;
+
+	CyU3PMemSet((uint8_t *)IndexValue, 0, sizeof(IndexValue));
+	CyU3PMemSet((uint8_t *)IndexValid, 0, sizeof(IndexValid));
+
+	valid0 = ReadBankHeader(0, &gen0);
+	valid1 = ReadBankHeader(1, &gen1);
+
+	if(valid0 && valid1)
+	{
+		/* Pick the newer bank (handles generation wrap) */
+		if((int16_t)(gen1 - gen0) > 0)
+		{
+			ActiveBank = 1;
+			ActiveGeneration = gen1;
+		}
+		else
+		{
+			ActiveBank = 0;
+			ActiveGeneration = gen0;
+		}
+	}
+	else if(valid0)
+	{
+		ActiveBank = 0;
+		ActiveGeneration = gen0;
+	}
+	else if(valid1)
+	{
+		ActiveBank = 1;
+		ActiveGeneration = gen1;
+	}
+	else
+	{
+#ifdef VERBOSE_MODE
+		CyU3PDebugPrint (4, "No valid journal found, formatting\r\n");
+#endif
+		ActiveBank = 0;
+		ActiveGeneration = 1;
+		WriteRecord(0, 0, JOURNAL_HEADER_KEY, ActiveGeneration, JOURNAL_MAGIC);
+	}
+
+	/* Build the RAM index */
+	ScanBank(ActiveBank);
+	JournalInitialized = CyTrue;
+
+#ifdef VERBOSE_MODE
+	CyU3PDebugPrint (4, "Journal bank %d, generation %d, next slot %d\r\n", ActiveBank, ActiveGeneration, NextSlot);
+#endif
+}
+
+/**
+  * @brief Reads a value from the journal
+  *
+  * @param Key The key to read. Valid range 1 to JOURNAL_MAX_KEYS - 1
+  *
+  * @param Value Pointer to return the stored value by reference
+  *
+  * @return CyTrue if a value is stored for the key, CyFalse otherwise
+  *
+  * Reads are served from the RAM index, and do not access flash.
+ **/
+CyBool_t AdiJournalRead(uint16_t Key, uint32_t* Value)
+{
+	if(!JournalInitialized)
+		AdiJournalInit();
+
+	if((Key == 0) || (Key >= JOURNAL_MAX_KEYS) || !IndexValid[Key])
+		return CyFalse;
+
+	*Value = IndexValue[Key];
+	return CyTrue;
+}
+
+/**
+  * @brief Writes a value to the journal
+  *
+  * @param Key The key to write. Valid range 1 to JOURNAL_MAX_KEYS - 1
+  *
+  * @param Value The value to store
+  *
+  * @return A status code indicating the success of the write operation
+  *
+  * Each write appends a single record to the active bank, so repeated updates of a
+  * key are spread across the whole journal region instead of re-writing one flash
+  * location. When the active bank is full, the live values are compacted into the
+  * other bank. Writes which do not change the stored value are skipped.
+ **/
+CyU3PReturnStatus_t AdiJournalWrite(uint16_t Key, uint32_t Value)
+{
+	if(!JournalInitialized)
+		AdiJournalInit();
+
+	if((Key == 0) || (Key >= JOURNAL_MAX_KEYS))
+	{
+		AdiLogError(Journal_c, __LINE__, Key);
+		return CY_U3P_ERROR_BAD_ARGUMENT;
+	}
+
+	/* Skip redundant writes */
+	if(IndexValid[Key] && (IndexValue[Key] == Value))
+		return CY_U3P_SUCCESS;
+
+	/* Update RAM index */
+	IndexValue[Key] = Value;
+	IndexValid[Key] = CyTrue;
+
+	/* Compaction writes all live values (including this one) */
+	if(NextSlot >= JOURNAL_SLOTS_PER_BANK)
+	{
+		CompactJournal();
+		return CY_U3P_SUCCESS;
+	}
+
+	WriteRecord(ActiveBank, NextSlot, Key, ActiveGeneration, Value);
+	NextSlot++;
+	return CY_U3P_SUCCESS;
+}
+
+/**
+  * @brief Copies all live values into the inactive bank, and makes it the active bank
+  *
+  * @return void
+  *
+  * The new bank header is written last, so a power loss during compaction leaves the
+  * old bank as the newest valid bank.
+ **/
+static void CompactJournal()
+{
+	uint32_t newBank = ActiveBank ^ 1;
+	uint16_t newGen = ActiveGeneration + 1;
+	uint32_t slot = 1;
+
+	for(uint16_t key = 1; key < JOURNAL_MAX_KEYS; key++)
+	{
+		if(IndexValid[key])
+		{
+			WriteRecord(newBank, slot, key, newGen, IndexValue[key]);
+			slot++;
+		}
+	}
+	WriteRecord(newBank, 0, JOURNAL_HEADER_KEY, newGen, JOURNAL_MAGIC);
+
+	ActiveBank = newBank;
+	ActiveGeneration = newGen;
+	NextSlot = slot;
+
+#ifdef VERBOSE_MODE
+	CyU3PDebugPrint (4, "Journal compacted to bank %d, generation %d\r\n", ActiveBank, ActiveGeneration);
+#endif
+}
+
+/**
+  * @brief Applies each valid record in a bank to the RAM index, and finds the append point
+  *
+  * @param Bank The bank to scan
+  *
+  * @return void
+ **/
+static void ScanBank(uint32_t Bank)
+{
+	uint8_t pageBuf[FLASH_PAGE_SIZE];
+	JournalRecord* record;
+	uint32_t slot;
+
+	for(slot = 1; slot < JOURNAL_SLOTS_PER_BANK; slot++)
+	{
+		/* Read a full flash page at a time */
+		if((slot == 1) || ((GetSlotAddress(Bank, slot) % FLASH_PAGE_SIZE) == 0))
+			AdiFlashRead(GetSlotAddress(Bank, slot) & ~(FLASH_PAGE_SIZE - 1), FLASH_PAGE_SIZE, pageBuf);
+
+		record = (JournalRecord *) (pageBuf + (GetSlotAddress(Bank, slot) % FLASH_PAGE_SIZE));
+		if(!IsRecordValid(record) || (record->Generation != ActiveGeneration))
+			break;
+
+		if((record->Key > 0) && (record->Key < JOURNAL_MAX_KEYS))
+		{
+			IndexValue[record->Key] = record->Value;
+			IndexValid[record->Key] = CyTrue;
+		}
+	}
+	NextSlot = slot;
+}
+
+/**
+  * @brief Reads and validates a bank header
+  *
+  * @param Bank The bank to read the header from
+  *
+  * @param Generation Returns the bank generation by reference
+  *
+  * @return CyTrue if the bank header is valid
+ **/
+static CyBool_t ReadBankHeader(uint32_t Bank, uint16_t* Generation)
+{
+	JournalRecord header;
+
+	AdiFlashRead(GetSlotAddress(Bank, 0), sizeof(header), (uint8_t *)&header);
+	if(!IsRecordValid(&header) || (header.Key != JOURNAL_HEADER_KEY) || (header.Value != JOURNAL_MAGIC))
+		return CyFalse;
+
+	*Generation = header.Generation;
+	return CyTrue;
+}
+
+/**
+  * @brief Writes a single record to flash
+  *
+  * @param Bank The bank to write to
+  *
+  * @param Slot The record slot within the bank
+  *
+  * @param Key The record key
+  *
+  * @param Generation The record generation
+  *
+  * @param Value The record value
+  *
+  * @return void
+ **/
+static void WriteRecord(uint32_t Bank, uint32_t Slot, uint16_t Key, uint16_t Generation, uint32_t Value)
+{
+	JournalRecord record;
+
+	record.Key = Key;
+	record.Generation = Generation;
+	record.Value = Value;
+	record.Reserved = 0xFFFFFFFF;
+	record.Crc = AdiCrc32(0, (uint8_t *)&record, sizeof(record) - sizeof(record.Crc));
+
+	AdiFlashWrite(GetSlotAddress(Bank, Slot), sizeof(record), (uint8_t *)&record);
+}
+
+/**
+  * @brief Checks the CRC of a journal record
+  *
+  * @param Record The record to check
+  *
+  * @return CyTrue if the record CRC is valid
+ **/
+static CyBool_t IsRecordValid(JournalRecord* Record)
+{
+	return (Record->Crc == AdiCrc32(0, (uint8_t *)Record, sizeof(JournalRecord) - sizeof(Record->Crc)));
+}
+
+/**
+  * @brief Gets the flash address of a record slot
+  *
+  * @param Bank The journal bank (0 or 1)
+  *
+  * @param Slot The record slot within the bank
+  *
+  * @return The flash byte address of the slot
+ **/
+static uint32_t GetSlotAddress(uint32_t Bank, uint32_t Slot)
+{
+	return JOURNAL_BASE_ADDR + (Bank * JOURNAL_BANK_SIZE) + (Slot * JOURNAL_RECORD_SIZE);
+}
@@ -0,0 +1,87 @@
+/**
+  * Copyright (c) Analog Devices Inc, 2018 - 2020
+  * All Rights Reserved.
+  *
+  * THIS SOFTWARE UTILIZES LIBRARIES DEVELOPED
+  * AND MAINTAINED BY CYPRESS INC. THE LICENSE INCLUDED IN
+  * THIS REPOSITORY DOES NOT EXTEND TO CYPRESS PROPERTY.
+  *
+  * Use of this file is governed by the license agreement
+  * included in this repository.
+  *
+  * @file		Journal.h
+  * @date		10/17/2020
+  * @author		A. Nolan (alex.nolan@analog.com)
+  * @brief		Header file for the wear leveled flash key/value journal
+ **/
+
+#ifndef JOURNAL_H_
+#define JOURNAL_H_
+
+/* Include the main header file */
+#include "main.h"
+
+/* Defines */
+
+/** Flash address of the journal region (after the stored configuration block) */
+#define JOURNAL_BASE_ADDR						(0x3FC40)
+
+/** Size of each journal bank, in bytes. The journal uses two banks (7 flash pages each) */
+#define JOURNAL_BANK_SIZE						(0x1C0)
+
+/** Size of a single journal record, in bytes. Records never cross a flash page boundary */
+#define JOURNAL_RECORD_SIZE						16
+
+/** Number of record slots in each bank (slot 0 holds the bank header) */
+#define JOURNAL_SLOTS_PER_BANK					(JOURNAL_BANK_SIZE / JOURNAL_RECORD_SIZE)
+
+/** Number of keys supported by the journal RAM index. Valid keys are 1 to JOURNAL_MAX_KEYS - 1 */
+#define JOURNAL_MAX_KEYS						16
+
+/** Key used for the bank header record */
+#define JOURNAL_HEADER_KEY						(0xFFFE)
+
+/** Bank header magic number ("ADIJ") */
+#define JOURNAL_MAGIC							(0x4A494441)
+
+/** Journal key for the lifetime error log count */
+#define JOURNAL_KEY_LOG_COUNT					1
+
+/** Journal key for the fatal error recovery mode */
+#define JOURNAL_KEY_RECOVERY_MODE				2
+
+/** Journal key for the error code which caused the last recovery reset (0 = none) */
+#define JOURNAL_KEY_RESET_REASON				3
+
+/**
+  * @brief Structure for a single journal record
+  *
+  * Records are appended to the active bank. The CRC32 covers bytes 0 - 11. A record is
+  * only valid if its CRC matches and its generation matches the bank header generation,
+  * so stale records left over from a previous use of the bank are ignored.
+ **/
+typedef struct JournalRecord
+{
+	/** The record key (bytes 0 - 1) */
+	uint16_t Key;
+
+	/** The bank generation this record was written in (bytes 2 - 3) */
+	uint16_t Generation;
+
+	/** The record value (bytes 4 - 7) */
+	uint32_t Value;
+
+	/** Reserved, written as 0xFFFFFFFF (bytes 8 - 11) */
+	uint32_t Reserved;
+
+	/** CRC32 of bytes 0 - 11 (bytes 12 - 15) */
+	uint32_t Crc;
+
+}JournalRecord;
+
+/* Public function prototypes */
+void AdiJournalInit();
+CyBool_t AdiJournalRead(uint16_t Key, uint32_t* Value);
+CyU3PReturnStatus_t AdiJournalWrite(uint16_t Key, uint32_t Value);
+
+#endif /* JOURNAL_H_ */
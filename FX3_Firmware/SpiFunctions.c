@@ -62,9 +62,9 @@ static uint32_t SCLKLowTime;
   *
   * This function is used to allow for a reduced SPI stall time. Is fairly "unsafe" in that
   * all hardware has to be configured for correct operation, and free, before this function
-  * can be called.
+  * can be called. Placed in I-TCM, since it is called per word from the stream inner loops.
  **/
-void AdiSpiTransferWord(uint8_t *txBuf, uint8_t *rxBuf, uint32_t numBytes)
+ADI_ITCM_CODE void AdiSpiTransferWord(uint8_t *txBuf, uint8_t *rxBuf, uint32_t numBytes)
 {
     uint32_t temp, intrMask;
     uint8_t  wordLen;
@@ -504,6 +504,43 @@ static void AdiBitBangSpiTransfer(uint8_t * MOSI, uint8_t* MISO, uint32_t BitCou
 	*MOSIPin = PinHighMask;
 }
 
+/**
+  * @brief Sets the DUT type, and the real time stream frame size for that DUT type
+  *
+  * @param DutType The DUT type to apply
+  *
+  * @return void
+ **/
+void AdiSetDutType(uint16_t DutType)
+{
+	FX3State.DutType = DutType;
+	switch(FX3State.DutType)
+	{
+	case ADcmXL3021:
+		/* (32 word x 3 axis) + 4 word status/counter/etc */
+		StreamThreadState.BytesPerFrame = 200;
+		break;
+	case ADcmXL2021:
+		/* (32 word x 2 axis) + 8 word padding + 4 word status/counter/etc */
+		StreamThreadState.BytesPerFrame = 152;
+		break;
+	case ADcmXL1021:
+		/* 32 word + 8 word padding + 4 word status/counter/etc */
+		StreamThreadState.BytesPerFrame = 88;
+		break;
+	case IMU:
+	case LegacyIMU:
+		/* Falls into default case */
+	default:
+		/* Default to  3021 - shouldn't reach here during normal operation */
+		StreamThreadState.BytesPerFrame = 200;
+		break;
+	}
+#ifdef VERBOSE_MODE
+	CyU3PDebugPrint (4, "bytesPerFrame = %d\r\n", StreamThreadState.BytesPerFrame);
+#endif
+}
+
 /**
   * @brief This function parses the SPI control registers into an easier to work with config struct.
   *
@@ -570,10 +607,38 @@ void AdiPrintSpiConfig(CyU3PSpiConfig_t config)
   * in USBBuffer[4 - 7] following the transfer.
  **/
 CyU3PReturnStatus_t AdiTransferBytes(uint32_t writeData)
+{
+	CyU3PReturnStatus_t status;
+	uint8_t readBuffer[4];
+
+	status = AdiTransferBytesToBuffer(writeData, readBuffer);
+
+	/* Load read data to be sent back via control endpoint */
+	USBBuffer[4] = readBuffer[0];
+	USBBuffer[5] = readBuffer[1];
+	USBBuffer[6] = readBuffer[2];
+	USBBuffer[7] = readBuffer[3];
+
+	/* Return status code  */
+	return status;
+}
+
+/**
+  * @brief This function performs a protocol agnostic SPI bi-directional SPI transfer of (1, 2, 4) bytes
+  *
+  * @param writeData The data to transmit on the MOSI line.
+  *
+  * @param readData Buffer (4 bytes) to place the data received on the MISO line into.
+  *
+  * @return A status code indicating the success of the function.
+  *
+  * Same as AdiTransferBytes, but does not touch USBBuffer, so it can be used outside of the
+  * vendor request handler (e.g. by the boot script engine in the AppThread).
+ **/
+CyU3PReturnStatus_t AdiTransferBytesToBuffer(uint32_t writeData, uint8_t* readData)
 {
 	CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
 	uint8_t writeBuffer[4];
-	uint8_t readBuffer[4];
 	uint32_t transferSize;
 
 	/* populate the writebuffer */
@@ -586,18 +651,12 @@ CyU3PReturnStatus_t AdiTransferBytes(uint32_t writeData)
 	transferSize = FX3State.SpiConfig.wordLen / 8;
 
 	/* perform SPI transfer */
-	status = CyU3PSpiTransferWords(writeBuffer, transferSize, readBuffer, transferSize);
+	status = CyU3PSpiTransferWords(writeBuffer, transferSize, readData, transferSize);
 	if(status != CY_U3P_SUCCESS)
 	{
 		AdiLogError(SpiFunctions_c, __LINE__, status);
 	}
 
-	/* Load read data to be sent back via control endpoint */
-	USBBuffer[4] = readBuffer[0];
-	USBBuffer[5] = readBuffer[1];
-	USBBuffer[6] = readBuffer[2];
-	USBBuffer[7] = readBuffer[3];
-
 	/* Return status code  */
 	return status;
 }
@@ -946,32 +1005,7 @@ CyBool_t AdiSpiUpdate(uint16_t index, uint16_t value, uint16_t length)
 
 	case 10:
 		/* DUT type */
-		FX3State.DutType = value;
-		switch(FX3State.DutType)
-		{
-		case ADcmXL3021:
-			/* (32 word x 3 axis) + 4 word status/counter/etc */
-			StreamThreadState.BytesPerFrame = 200;
-			break;
-		case ADcmXL2021:
-			/* (32 word x 2 axis) + 8 word padding + 4 word status/counter/etc */
-			StreamThreadState.BytesPerFrame = 152;
-			break;
-		case ADcmXL1021:
-			/* 32 word + 8 word padding + 4 word status/counter/etc */
-			StreamThreadState.BytesPerFrame = 88;
-			break;
-		case IMU:
-		case LegacyIMU:
-			/* Falls into default case */
-		default:
-			/* Default to  3021 - shouldn't reach here during normal operation */
-			StreamThreadState.BytesPerFrame = 200;
-			break;
-		}
-#ifdef VERBOSE_MODE
-		CyU3PDebugPrint (4, "bytesPerFrame = %d\r\n", StreamThreadState.BytesPerFrame);
-#endif
+		AdiSetDutType(value);
 		break;
 
 	case 11:
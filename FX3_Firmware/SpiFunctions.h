@@ -55,10 +55,12 @@ CyU3PSpiConfig_t AdiGetSpiConfig();
 void AdiSetSpiWordLength(uint8_t wordLength);
 void AdiPrintSpiConfig(CyU3PSpiConfig_t config);
 CyU3PReturnStatus_t AdiRestartSpi();
+void AdiSetDutType(uint16_t DutType);
 
 /* SPI data transfer functions */
-void AdiSpiTransferWord(uint8_t *txBuf, uint8_t *rxBuf, uint32_t numBytes);
+ADI_ITCM_CODE void AdiSpiTransferWord(uint8_t *txBuf, uint8_t *rxBuf, uint32_t numBytes);
 CyU3PReturnStatus_t AdiTransferBytes(uint32_t writeData);
+CyU3PReturnStatus_t AdiTransferBytesToBuffer(uint32_t writeData, uint8_t* readData);
 CyU3PReturnStatus_t AdiWriteRegByte(uint16_t addr, uint8_t data);
 CyU3PReturnStatus_t AdiReadRegBytes(uint16_t addr);
 
@@ -25,13 +25,52 @@ extern CyU3PDmaChannel MemoryToSPI;
 extern CyU3PDmaBuffer_t SpiDmaBuffer;
 extern BoardState FX3State;
 extern volatile CyBool_t KillStreamEarly;
+extern volatile CyBool_t StreamSuspendRequest;
 extern StreamState StreamThreadState;
 
 /** Global USB Buffer (Control Endpoint) */
 extern uint8_t USBBuffer[4096];
 
-/** Global USB Buffer (Bulk Endpoints) */
-extern uint8_t BulkBuffer[12288];
+/* Private stream configuration functions */
+static CyU3PReturnStatus_t BurstStreamConfigure();
+static CyU3PReturnStatus_t GenericStreamConfigure();
+static void StreamSegmentStart(uint32_t Stream, CyBool_t Resume);
+static void StreamArenaStart();
+static CyU3PReturnStatus_t StreamChannelAcquire(CyU3PDmaChannel *Channel, StreamChannelCache *Cache, CyU3PDmaType_t Type, CyU3PDmaChannelConfig_t *Config);
+static CyU3PReturnStatus_t StreamChannelRelease(CyU3PDmaChannel *Channel, StreamChannelCache *Cache);
+static uint16_t StreamDmaDepth(uint16_t BufferSize);
+
+/** State used to resume a burst or generic stream after a USB reset */
+static StreamResumeState ResumeState;
+
+/** Memory arena for the running stream */
+static StreamArena Arena;
+
+/** Configuration of the StreamingChannel DMA channel, kept between streams */
+static StreamChannelCache StreamingCache;
+
+/** Configuration of the MemoryToSPI DMA channel, kept between burst streams */
+static StreamChannelCache MemoryToSpiCache;
+
+#ifdef STREAM_JITTER_STATS
+/** Generic stream stall time overshoot histogram, filled by the StreamThread */
+StreamJitterStats GenericJitter;
+
+/** Burst stream period jitter histogram, filled by the StreamThread */
+StreamJitterStats BurstJitter;
+
+/* Private jitter helper */
+static uint32_t PackJitterStats(StreamJitterStats* Stats, uint8_t* Buf);
+#endif
+
+/** Max stream DMA buffer count, set by the host */
+static uint16_t DmaMaxDepth = ADI_STREAM_DMA_MAX_DEPTH;
+
+/** DMA buffer count chosen for the last stream */
+static uint16_t DmaLastDepth;
+
+/** DMA buffer size used for the last stream */
+static uint16_t DmaLastSize;
 
 /**
   * @brief Configures 10MHz timer to control stall time for generic or transfer streams.
@@ -60,6 +99,11 @@ void AdiConfigStreamStallTimer()
 		/* Set the timer pin period (useful for error case, timer register is manually reset) */
 		GPIO->lpp_gpio_pin[ADI_TIMER_PIN_INDEX].period = (FX3State.StallTime * 10) - ADI_GENERIC_STALL_OFFSET + 1;
 	}
+
+#ifdef STREAM_JITTER_STATS
+	/* Let the timer run past the threshold, so the stall overshoot can be sampled */
+	GPIO->lpp_gpio_pin[ADI_TIMER_PIN_INDEX].period = 0xFFFFFFFF;
+#endif
 }
 
 /**
@@ -92,6 +136,9 @@ CyU3PReturnStatus_t AdiStopAnyDataStream()
 	/* Set kill stream early flag */
 	KillStreamEarly = CyTrue;
 
+	/* Drop a stream suspended by a USB reset, instead of resuming it */
+	ResumeState.SuspendedStream = 0;
+
 	/* Return status over USB */
 	AdiSendStatus(status, 4, CyTrue);
 
@@ -167,7 +214,7 @@ CyU3PReturnStatus_t AdiI2CStreamStart()
 	/* Configure StreamChannel for I2C to USB automatic DMA */
     CyU3PMemSet ((uint8_t *)&i2cDmaConfig, 0, sizeof(i2cDmaConfig));
     i2cDmaConfig.size           = StreamThreadState.NumCaptures;
-    i2cDmaConfig.count          = 16;
+    i2cDmaConfig.count          = StreamDmaDepth(i2cDmaConfig.size);
     i2cDmaConfig.prodAvailCount = 0;
     i2cDmaConfig.dmaMode        = CY_U3P_DMA_MODE_BYTE;
     i2cDmaConfig.prodHeader     = 0;
@@ -177,11 +224,12 @@ CyU3PReturnStatus_t AdiI2CStreamStart()
     i2cDmaConfig.cb             = NULL;
     i2cDmaConfig.prodSckId = CY_U3P_LPP_SOCKET_I2C_PROD;
     i2cDmaConfig.consSckId = CY_U3P_UIB_SOCKET_CONS_1;
-    status = CyU3PDmaChannelCreate(&StreamingChannel, CY_U3P_DMA_TYPE_AUTO, &i2cDmaConfig);
+    status = StreamChannelAcquire(&StreamingChannel, &StreamingCache, CY_U3P_DMA_TYPE_AUTO, &i2cDmaConfig);
 	if(status != CY_U3P_SUCCESS)
 	{
 		AdiLogError(StreamFunctions_c, __LINE__, status);
 		AdiAppErrorHandler(status);
+		return status;
 	}
 
 	/* Log stream state in vebose mode */
@@ -196,6 +244,7 @@ CyU3PReturnStatus_t AdiI2CStreamStart()
 	{
 		AdiLogError(StreamFunctions_c, __LINE__, status);
 		AdiAppErrorHandler(status);
+		return status;
 	}
 
 	/* Set the burst stream flag to notify the streaming thread it should take over */
@@ -217,8 +266,8 @@ CyU3PReturnStatus_t AdiI2CStreamFinished()
 {
 	CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
 
-    /* Destroy the stream DMA channel */
-    status = CyU3PDmaChannelDestroy(&StreamingChannel);
+    /* Release the stream DMA channel, for re-use by the next stream */
+    status = StreamChannelRelease(&StreamingChannel, &StreamingCache);
 
 	/* Flush the streaming end point */
 	status |= CyU3PUsbFlushEp(ADI_STREAMING_ENDPOINT);
@@ -260,6 +309,7 @@ CyU3PReturnStatus_t AdiTransferStreamStart()
 	{
 		AdiLogError(StreamFunctions_c, __LINE__, status);
 		AdiAppErrorHandler(status);
+		return status;
 	}
 
 	/* Parse control endpoint data. The data is formatted as follows
@@ -287,6 +337,16 @@ CyU3PReturnStatus_t AdiTransferStreamStart()
 	StreamThreadState.BytesPerBuffer = USBBuffer[12];
 	StreamThreadState.BytesPerBuffer |= (USBBuffer[13] << 8);
 
+	/* Copy the MOSI data to the stream arena, so the control endpoint buffer can be re-used while streaming */
+	StreamArenaStart();
+	StreamThreadState.RegList = AdiStreamArenaAlloc(StreamThreadState.BytesPerBuffer);
+	if(StreamThreadState.RegList == NULL)
+	{
+		AdiLogError(StreamFunctions_c, __LINE__, StreamThreadState.BytesPerBuffer);
+		return CY_U3P_ERROR_MEMORY_ERROR;
+	}
+	CyU3PMemCopy(StreamThreadState.RegList, USBBuffer + 14, StreamThreadState.BytesPerBuffer);
+
 	AdiPrintStreamState();
 
 	/* Disable VBUS ISR */
@@ -308,13 +368,14 @@ CyU3PReturnStatus_t AdiTransferStreamStart()
 	{
 		AdiLogError(StreamFunctions_c, __LINE__, status);
 		AdiAppErrorHandler(status);
+		return status;
 	}
 
 	/* Configure the StreamingChannel DMA (SPI to PC) */
 	CyU3PDmaChannelConfig_t dmaConfig;
 	CyU3PMemSet ((uint8_t *)&dmaConfig, 0, sizeof(dmaConfig));
 	dmaConfig.size 				= FX3State.UsbBufferSize;
-	dmaConfig.count 			= 8;
+	dmaConfig.count 			= StreamDmaDepth(dmaConfig.size);
 	dmaConfig.prodSckId 		= CY_U3P_CPU_SOCKET_PROD;
 	dmaConfig.consSckId 		= CY_U3P_UIB_SOCKET_CONS_1;
 	dmaConfig.dmaMode 			= CY_U3P_DMA_MODE_BYTE;
@@ -325,12 +386,12 @@ CyU3PReturnStatus_t AdiTransferStreamStart()
 	dmaConfig.cb            	= NULL;
 	dmaConfig.prodAvailCount	= 0;
 
-	CyU3PDmaChannelDestroy(&StreamingChannel);
-	status = CyU3PDmaChannelCreate(&StreamingChannel, CY_U3P_DMA_TYPE_MANUAL_OUT, &dmaConfig);
+	status = StreamChannelAcquire(&StreamingChannel, &StreamingCache, CY_U3P_DMA_TYPE_MANUAL_OUT, &dmaConfig);
 	if(status != CY_U3P_SUCCESS)
 	{
 		AdiLogError(StreamFunctions_c, __LINE__, status);
 		AdiAppErrorHandler(status);
+		return status;
 	}
 
 	/* Set DMA transfer mode */
@@ -339,6 +400,7 @@ CyU3PReturnStatus_t AdiTransferStreamStart()
 	{
 		AdiLogError(StreamFunctions_c, __LINE__, status);
 		AdiAppErrorHandler(status);
+		return status;
 	}
 
 	/* Enable timer hardware for stall */
@@ -359,7 +421,8 @@ CyU3PReturnStatus_t AdiTransferStreamStart()
   * Resets the streaming endpoint, destroys the DMA channel, and restores the interrupt
   * source states to their standard operating condition. Must be explicitly invoked via a
   * vendor command when all "buffers" or captured, or indirectly via a TransferStream cancel.
-  * This function currently just calls the GenericStreamFinished implementation.
+  * This function calls the GenericStreamFinished implementation, then releases the
+  * MOSI data copied to the stream arena by AdiTransferStreamStart.
  **/
 CyU3PReturnStatus_t AdiTransferStreamFinished()
 {
@@ -368,6 +431,9 @@ CyU3PReturnStatus_t AdiTransferStreamFinished()
 	/* Call generic stream finished, since the same resources are used */
 	status = AdiGenericStreamFinished();
 
+	/* Release the stream memory (MOSI data) */
+	AdiStreamArenaReset();
+
 	/* Return status code */
 	return status;
 }
@@ -423,7 +489,7 @@ CyU3PReturnStatus_t AdiRealTimeStreamStart()
 	CyU3PDmaChannelConfig_t dmaConfig;
 	CyU3PMemSet ((uint8_t *)&dmaConfig, 0, sizeof(dmaConfig));
 	dmaConfig.size 				= FX3State.UsbBufferSize;
-	dmaConfig.count 			= 64;
+	dmaConfig.count 			= StreamDmaDepth(dmaConfig.size);
 	dmaConfig.prodSckId 		= CY_U3P_LPP_SOCKET_SPI_PROD;
 	dmaConfig.consSckId 		= CY_U3P_UIB_SOCKET_CONS_1;
 	dmaConfig.dmaMode 			= CY_U3P_DMA_MODE_BYTE;
@@ -434,12 +500,13 @@ CyU3PReturnStatus_t AdiRealTimeStreamStart()
 	dmaConfig.cb            	= NULL;
 	dmaConfig.prodAvailCount	= 0;
 
-    /* Configure DMA for RealTimeStreamingChannel */
-    status = CyU3PDmaChannelCreate(&StreamingChannel, CY_U3P_DMA_TYPE_AUTO, &dmaConfig);
+    /* Configure DMA for RealTimeStreamingChannel (re-uses the previous stream channel if the configuration matches) */
+    status = StreamChannelAcquire(&StreamingChannel, &StreamingCache, CY_U3P_DMA_TYPE_AUTO, &dmaConfig);
 	if(status != CY_U3P_SUCCESS)
 	{
 		AdiLogError(StreamFunctions_c, __LINE__, status);
 		AdiAppErrorHandler(status);
+		return status;
 	}
 
 	/* Clear the DMA buffers */
@@ -461,6 +528,7 @@ CyU3PReturnStatus_t AdiRealTimeStreamStart()
 			{
 				AdiLogError(StreamFunctions_c, __LINE__, status);
 				AdiAppErrorHandler(status);
+				return status;
 			}
 			AdiSleepForMicroSeconds(FX3State.StallTime);
 			status = CyU3PSpiReceiveWords(tempReadBuffer, 2);
@@ -501,6 +569,7 @@ CyU3PReturnStatus_t AdiRealTimeStreamStart()
 			{
 				AdiLogError(StreamFunctions_c, __LINE__, status);
 				AdiAppErrorHandler(status);
+				return status;
 			}
 		}
 	}
@@ -551,6 +620,7 @@ CyU3PReturnStatus_t AdiRealTimeStreamStart()
 		{
 			AdiLogError(StreamFunctions_c, __LINE__, status);
 			AdiAppErrorHandler(status);
+			return status;
 		}
 	}
 	else
@@ -629,8 +699,8 @@ CyU3PReturnStatus_t AdiRealTimeStreamFinished()
 	SPI->lpp_spi_config &= ~(CY_U3P_LPP_SPI_RX_ENABLE | CY_U3P_LPP_SPI_TX_ENABLE | CY_U3P_LPP_SPI_DMA_MODE | CY_U3P_LPP_SPI_ENABLE);
 	while ((SPI->lpp_spi_config & CY_U3P_LPP_SPI_ENABLE) != 0);
 
-    /* Tear down the RT streaming channel */
-    status = CyU3PDmaChannelDestroy(&StreamingChannel);
+    /* Release the RT streaming channel, for re-use by the next stream */
+    status = StreamChannelRelease(&StreamingChannel, &StreamingCache);
 	if(status != CY_U3P_SUCCESS)
 	{
 		AdiLogError(StreamFunctions_c, __LINE__, status);
@@ -661,19 +731,16 @@ CyU3PReturnStatus_t AdiRealTimeStreamFinished()
 }
 
 /**
-  * @brief Starts a burst stream for IMU products.
+  * @brief Configures the hardware for a burst stream, and hands the stream over to the StreamThread.
   *
-  * @return The status of starting a real-time stream.
+  * @return The status of the stream configuration.
   *
-  * This function kicks off a burst stream by configuring a pin interrupt on a user-specified pin, configuring
-  * the SPI and USB DMAs to handle the incoming data, and enabling the streaming function.It can be configured
-  * for "Blackfin" or "ADuC" burst using vendor requests.
+  * The stream parameters (StreamThreadState) must be set before calling this function. This is
+  * shared by AdiBurstStreamStart and AdiStreamResume.
  **/
-CyU3PReturnStatus_t AdiBurstStreamStart()
+static CyU3PReturnStatus_t BurstStreamConfigure()
 {
 	CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
-	uint16_t bytesRead;
-	uint16_t triggerLength;
 
 	/* Disable VBUS ISR */
 	CyU3PVicDisableInt(CY_U3P_VIC_GCTL_PWR_VECTOR);
@@ -685,67 +752,11 @@ CyU3PReturnStatus_t AdiBurstStreamStart()
 	if(FX3State.DrActive)
 		AdiConfigureDrPin();
 
-	/* Get the number of buffers, trigger word, and transfer length from the control endpoint */
-	CyU3PUsbGetEP0Data(StreamThreadState.TransferWordLength, USBBuffer, &bytesRead);
-	if(status != CY_U3P_SUCCESS)
-	{
-		AdiLogError(StreamFunctions_c, __LINE__, status);
-		AdiAppErrorHandler(status);
-	}
-
-	/* Parse number of buffers */
-	StreamThreadState.NumBuffers = USBBuffer[0];
-	StreamThreadState.NumBuffers |= (USBBuffer[1] << 8);
-	StreamThreadState.NumBuffers |= (USBBuffer[2] << 16);
-	StreamThreadState.NumBuffers |= (USBBuffer[3] << 24);
-
-	/* Parse transfer byte length */
-	StreamThreadState.TransferByteLength = USBBuffer[4];
-	StreamThreadState.TransferByteLength |= (USBBuffer[5] << 8);
-	StreamThreadState.TransferByteLength |= (USBBuffer[6] << 16);
-	StreamThreadState.TransferByteLength |= (USBBuffer[7] << 24);
-
-	/* Set regList memory to correct length plus trigger word */
-	StreamThreadState.RegList = CyU3PDmaBufferAlloc(sizeof(uint8_t) * StreamThreadState.TransferByteLength);
-
-	/* Clear (zero) contents of regList memory. Burst transfers are DNC, so we're sending zeros */
-	CyU3PMemSet(StreamThreadState.RegList, 0, sizeof(uint8_t) * StreamThreadState.TransferByteLength);
-
-	/* Calculate trigger length (USB transfer length - header size) */
-	triggerLength = bytesRead - 8;
-
-	/* Append burst trigger word to the first two bytes of regList */
-	for(int i = 0; i< triggerLength; i++)
-	{
-		StreamThreadState.RegList[i] = USBBuffer[i + 8];
-	}
-
-	/* Calculate the required memory block (in bytes) to be a multiple of 16 */
-	uint16_t remainder = StreamThreadState.TransferByteLength % 16;
-	if (remainder == 0)
-	{
-		StreamThreadState.RoundedByteTransferLength = StreamThreadState.TransferByteLength;
-	}
-	else
-	{
-		StreamThreadState.RoundedByteTransferLength = StreamThreadState.TransferByteLength + 16 - remainder;
-	}
-
-#ifdef VERBOSE_MODE
-	 CyU3PDebugPrint (4, "Starting burst stream!\r\n");
-	 CyU3PDebugPrint (4, "burstTriggerUpper:  %d\r\n", StreamThreadState.RegList[0]);
-	 CyU3PDebugPrint (4, "burstTriggerLower:  %d\r\n", StreamThreadState.RegList[1]);
-	 CyU3PDebugPrint (4, "roundedTransferLength:  %d\r\n", StreamThreadState.RoundedByteTransferLength);
-	 CyU3PDebugPrint (4, "transferByteLength:  %d\r\n", StreamThreadState.TransferByteLength);
-	 CyU3PDebugPrint (4, "numBuffers:  %d\r\n", StreamThreadState.NumBuffers);
-	 CyU3PDebugPrint (4, "USB Buffer Size:  %d\r\n", FX3State.UsbBufferSize);
-#endif
-
 	/* Configure the Burst DMA Streaming Channel (SPI to PC) for Auto DMA */
 	CyU3PDmaChannelConfig_t dmaConfig;
 	CyU3PMemSet ((uint8_t *)&dmaConfig, 0, sizeof(dmaConfig));
 	dmaConfig.size 				= FX3State.UsbBufferSize;
-	dmaConfig.count 			= 8;
+	dmaConfig.count 			= StreamDmaDepth(dmaConfig.size);
 	dmaConfig.prodSckId 		= CY_U3P_LPP_SOCKET_SPI_PROD;
 	dmaConfig.consSckId 		= CY_U3P_UIB_SOCKET_CONS_1;
 	dmaConfig.dmaMode 			= CY_U3P_DMA_MODE_BYTE;
@@ -756,13 +767,13 @@ CyU3PReturnStatus_t AdiBurstStreamStart()
 	dmaConfig.cb            	= NULL;
 	dmaConfig.prodAvailCount	= 0;
 
-	/* Destroy and re-create streaming DMA channel */
-	CyU3PDmaChannelDestroy(&StreamingChannel);
-	status = CyU3PDmaChannelCreate(&StreamingChannel, CY_U3P_DMA_TYPE_AUTO, &dmaConfig);
+	/* Get the streaming DMA channel (re-uses the previous stream channel if the configuration matches) */
+	status = StreamChannelAcquire(&StreamingChannel, &StreamingCache, CY_U3P_DMA_TYPE_AUTO, &dmaConfig);
 	if(status != CY_U3P_SUCCESS)
 	{
 		AdiLogError(StreamFunctions_c, __LINE__, status);
 		AdiAppErrorHandler(status);
+		return status;
 	}
 
 	/* Configure SPI TX DMA (CPU memory to SPI for burst mode)
@@ -781,13 +792,13 @@ CyU3PReturnStatus_t AdiBurstStreamStart()
     dmaConfig.cb             	= NULL;
     dmaConfig.prodAvailCount 	= 0;
 
-    /* Destroy and re-create memory to SPI (Tx) channel */
-    CyU3PDmaChannelDestroy(&MemoryToSPI);
-    status = CyU3PDmaChannelCreate(&MemoryToSPI, CY_U3P_DMA_TYPE_MANUAL_OUT, &dmaConfig);
+    /* Get the memory to SPI (Tx) channel */
+    status = StreamChannelAcquire(&MemoryToSPI, &MemoryToSpiCache, CY_U3P_DMA_TYPE_MANUAL_OUT, &dmaConfig);
 	if(status != CY_U3P_SUCCESS)
 	{
 		AdiLogError(StreamFunctions_c, __LINE__, status);
 		AdiAppErrorHandler(status);
+		return status;
 	}
 
 	/* Flush the streaming endpoint */
@@ -796,6 +807,7 @@ CyU3PReturnStatus_t AdiBurstStreamStart()
 	{
 		AdiLogError(StreamFunctions_c, __LINE__, status);
 		AdiAppErrorHandler(status);
+		return status;
 	}
 
 	/* Manually reset the SPI Rx/Tx FIFO */
@@ -817,6 +829,7 @@ CyU3PReturnStatus_t AdiBurstStreamStart()
 	{
 		AdiLogError(StreamFunctions_c, __LINE__, status);
 		AdiAppErrorHandler(status);
+		return status;
 	}
 
 	/* Set the burst stream flag to notify the streaming thread it should take over */
@@ -830,6 +843,91 @@ CyU3PReturnStatus_t AdiBurstStreamStart()
 	return status;
 }
 
+/**
+  * @brief Starts a burst stream for IMU products.
+  *
+  * @return The status of starting a real-time stream.
+  *
+  * This function kicks off a burst stream by configuring a pin interrupt on a user-specified pin, configuring
+  * the SPI and USB DMAs to handle the incoming data, and enabling the streaming function.It can be configured
+  * for "Blackfin" or "ADuC" burst using vendor requests.
+ **/
+CyU3PReturnStatus_t AdiBurstStreamStart()
+{
+	CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
+	uint16_t bytesRead;
+	uint16_t triggerLength;
+
+	/* Get the number of buffers, trigger word, and transfer length from the control endpoint */
+	CyU3PUsbGetEP0Data(StreamThreadState.TransferWordLength, USBBuffer, &bytesRead);
+	if(status != CY_U3P_SUCCESS)
+	{
+		AdiLogError(StreamFunctions_c, __LINE__, status);
+		AdiAppErrorHandler(status);
+		return status;
+	}
+
+	/* Parse number of buffers */
+	StreamThreadState.NumBuffers = USBBuffer[0];
+	StreamThreadState.NumBuffers |= (USBBuffer[1] << 8);
+	StreamThreadState.NumBuffers |= (USBBuffer[2] << 16);
+	StreamThreadState.NumBuffers |= (USBBuffer[3] << 24);
+
+	/* Parse transfer byte length */
+	StreamThreadState.TransferByteLength = USBBuffer[4];
+	StreamThreadState.TransferByteLength |= (USBBuffer[5] << 8);
+	StreamThreadState.TransferByteLength |= (USBBuffer[6] << 16);
+	StreamThreadState.TransferByteLength |= (USBBuffer[7] << 24);
+
+	/* Calculate the required memory block (in bytes) to be a multiple of 16 */
+	uint16_t remainder = StreamThreadState.TransferByteLength % 16;
+	if (remainder == 0)
+	{
+		StreamThreadState.RoundedByteTransferLength = StreamThreadState.TransferByteLength;
+	}
+	else
+	{
+		StreamThreadState.RoundedByteTransferLength = StreamThreadState.TransferByteLength + 16 - remainder;
+	}
+
+	/* Allocate the regList (DMA source) from the stream arena, sized for the full DMA buffer */
+	StreamArenaStart();
+	StreamThreadState.RegList = AdiStreamArenaAlloc(StreamThreadState.RoundedByteTransferLength);
+	if(StreamThreadState.RegList == NULL)
+	{
+		AdiLogError(StreamFunctions_c, __LINE__, StreamThreadState.TransferByteLength);
+		return CY_U3P_ERROR_MEMORY_ERROR;
+	}
+
+	/* Clear (zero) contents of regList memory. Burst transfers are DNC, so we're sending zeros */
+	CyU3PMemSet(StreamThreadState.RegList, 0, StreamThreadState.RoundedByteTransferLength);
+
+	/* Calculate trigger length (USB transfer length - header size) */
+	triggerLength = bytesRead - 8;
+
+	/* Append burst trigger word to the first two bytes of regList */
+	for(int i = 0; (i < triggerLength) && (i < StreamThreadState.TransferByteLength); i++)
+	{
+		StreamThreadState.RegList[i] = USBBuffer[i + 8];
+	}
+
+#ifdef VERBOSE_MODE
+	 CyU3PDebugPrint (4, "Starting burst stream!\r\n");
+	 CyU3PDebugPrint (4, "burstTriggerUpper:  %d\r\n", StreamThreadState.RegList[0]);
+	 CyU3PDebugPrint (4, "burstTriggerLower:  %d\r\n", StreamThreadState.RegList[1]);
+	 CyU3PDebugPrint (4, "roundedTransferLength:  %d\r\n", StreamThreadState.RoundedByteTransferLength);
+	 CyU3PDebugPrint (4, "transferByteLength:  %d\r\n", StreamThreadState.TransferByteLength);
+	 CyU3PDebugPrint (4, "numBuffers:  %d\r\n", StreamThreadState.NumBuffers);
+	 CyU3PDebugPrint (4, "USB Buffer Size:  %d\r\n", FX3State.UsbBufferSize);
+#endif
+
+	/* Track the stream for resume, then configure the hardware and start the stream */
+	StreamSegmentStart(ADI_BURST_STREAM_ENABLE, CyFalse);
+	status = BurstStreamConfigure();
+
+	return status;
+}
+
 /**
   * @brief Cleans up resources allocated for a IMU burst stream.
   *
@@ -855,15 +953,15 @@ CyU3PReturnStatus_t AdiBurstStreamFinished()
 	gpioConfig.intrMode = CY_U3P_GPIO_NO_INTR;
 	CyU3PGpioSetSimpleConfig(FX3State.DrPin, &gpioConfig);
 
-	/* Destroy MemoryToSpi DMA channel */
-    status = CyU3PDmaChannelDestroy(&MemoryToSPI);
+	/* Release the MemoryToSpi DMA channel */
+    status = StreamChannelRelease(&MemoryToSPI, &MemoryToSpiCache);
 	if(status != CY_U3P_SUCCESS)
 	{
 		AdiLogError(StreamFunctions_c, __LINE__, status);
 	}
 
-    /* Destroy the burst DMA channel (and recover a LOT of memory) */
-    status = CyU3PDmaChannelDestroy(&StreamingChannel);
+    /* Release the burst DMA channel, for re-use by the next stream */
+    status = StreamChannelRelease(&StreamingChannel, &StreamingCache);
 	if(status != CY_U3P_SUCCESS)
 	{
 		AdiLogError(StreamFunctions_c, __LINE__, status);
@@ -882,6 +980,9 @@ CyU3PReturnStatus_t AdiBurstStreamFinished()
 	/* Restore the SPI state */
 	AdiSetSpiWordLength(FX3State.SpiConfig.wordLen);
 
+	/* Release the stream memory */
+	AdiStreamArenaReset();
+
 	/* Reset KillStreamEarly flag in case the user wants to capture data again */
 	KillStreamEarly = CyFalse;
 
@@ -889,15 +990,14 @@ CyU3PReturnStatus_t AdiBurstStreamFinished()
 }
 
 /**
-  * @brief Starts a register read/write stream, with options to trigger on a data ready.
+  * @brief Configures the hardware for a generic stream, and hands the stream over to the StreamThread.
   *
-  * @return The status of starting a generic stream.
+  * @return The status of the stream configuration.
   *
-  * This function kicks off a generic data stream by configuring interrupts, SPI, and end points.
-  * At the end of the function, the ADI_GENERIC_STREAM_ENABLE flag is set such that the
-  * generic streaming thread knows to start producing data.
+  * The stream parameters (StreamThreadState) and register list must be set before calling this
+  * function. This is shared by AdiGenericStreamStart and AdiStreamResume.
  **/
-CyU3PReturnStatus_t AdiGenericStreamStart()
+static CyU3PReturnStatus_t GenericStreamConfigure()
 {
 	CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
 
@@ -916,32 +1016,6 @@ CyU3PReturnStatus_t AdiGenericStreamStart()
 		AdiLogError(StreamFunctions_c, __LINE__, status);
 	}
 
-	/* Get the number of buffers (number of times to read each set of registers) */
-	StreamThreadState.NumBuffers = USBBuffer[0];
-	StreamThreadState.NumBuffers += (USBBuffer[1] << 8);
-	StreamThreadState.NumBuffers += (USBBuffer[2] << 16);
-	StreamThreadState.NumBuffers += (USBBuffer[3] << 24);
-
-	/* Get the number of captures of the address list (number of times to capture the list of registers per buffer) */
-	StreamThreadState.NumCaptures = USBBuffer[4];
-	StreamThreadState.NumCaptures += (USBBuffer[5] << 8);
-	StreamThreadState.NumCaptures += (USBBuffer[6] << 16);
-	StreamThreadState.NumCaptures += (USBBuffer[7] << 24);
-
-	/* Calculate the number of bytes per buffer */
-	/* Number of times to read each set of registers * (number of registers - control registers) */
-	StreamThreadState.BytesPerBuffer = StreamThreadState.NumCaptures * (StreamThreadState.TransferByteLength - 8);
-
-	/* Set the reglist (just use the Bulk buffer - gives defined behavior)*/
-	StreamThreadState.RegList = BulkBuffer;
-
-	/* Copy the register list */
-	CyU3PMemCopy(StreamThreadState.RegList, USBBuffer + 8, StreamThreadState.TransferByteLength - 8);
-
-	/* Zero the last values */
-	StreamThreadState.RegList[StreamThreadState.TransferByteLength - 7] = 0;
-	StreamThreadState.RegList[StreamThreadState.TransferByteLength - 8] = 0;
-
 	/* Find number of register "buffers" which fit in a USB buffer */
 	if(StreamThreadState.BytesPerBuffer > FX3State.UsbBufferSize)
 	{
@@ -958,13 +1032,14 @@ CyU3PReturnStatus_t AdiGenericStreamStart()
 	{
 		AdiLogError(StreamFunctions_c, __LINE__, status);
 		AdiAppErrorHandler(status);
+		return status;
 	}
 
 	/* Configure the StreamingChannel DMA (SPI to PC) */
 	CyU3PDmaChannelConfig_t dmaConfig;
 	CyU3PMemSet ((uint8_t *)&dmaConfig, 0, sizeof(dmaConfig));
 	dmaConfig.size 				= FX3State.UsbBufferSize;
-	dmaConfig.count 			= 16;
+	dmaConfig.count 			= StreamDmaDepth(dmaConfig.size);
 	dmaConfig.prodSckId 		= CY_U3P_CPU_SOCKET_PROD;
 	dmaConfig.consSckId 		= CY_U3P_UIB_SOCKET_CONS_1;
 	dmaConfig.dmaMode 			= CY_U3P_DMA_MODE_BYTE;
@@ -975,11 +1050,12 @@ CyU3PReturnStatus_t AdiGenericStreamStart()
 	dmaConfig.cb            	= NULL;
 	dmaConfig.prodAvailCount	= 0;
 
-	status = CyU3PDmaChannelCreate(&StreamingChannel, CY_U3P_DMA_TYPE_MANUAL_OUT, &dmaConfig);
+	status = StreamChannelAcquire(&StreamingChannel, &StreamingCache, CY_U3P_DMA_TYPE_MANUAL_OUT, &dmaConfig);
 	if(status != CY_U3P_SUCCESS)
 	{
 		AdiLogError(StreamFunctions_c, __LINE__, status);
 		AdiAppErrorHandler(status);
+		return status;
 	}
 
 	/* Set DMA transfer mode */
@@ -988,6 +1064,7 @@ CyU3PReturnStatus_t AdiGenericStreamStart()
 	{
 		AdiLogError(StreamFunctions_c, __LINE__, status);
 		AdiAppErrorHandler(status);
+		return status;
 	}
 
 #ifdef VERBOSE_MODE
@@ -1004,6 +1081,58 @@ CyU3PReturnStatus_t AdiGenericStreamStart()
 	return status;
 }
 
+/**
+  * @brief Starts a register read/write stream, with options to trigger on a data ready.
+  *
+  * @return The status of starting a generic stream.
+  *
+  * This function kicks off a generic data stream by configuring interrupts, SPI, and end points.
+  * At the end of the function, the ADI_GENERIC_STREAM_ENABLE flag is set such that the
+  * generic streaming thread knows to start producing data.
+ **/
+CyU3PReturnStatus_t AdiGenericStreamStart()
+{
+	CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
+
+	/* Get the number of buffers (number of times to read each set of registers) */
+	StreamThreadState.NumBuffers = USBBuffer[0];
+	StreamThreadState.NumBuffers += (USBBuffer[1] << 8);
+	StreamThreadState.NumBuffers += (USBBuffer[2] << 16);
+	StreamThreadState.NumBuffers += (USBBuffer[3] << 24);
+
+	/* Get the number of captures of the address list (number of times to capture the list of registers per buffer) */
+	StreamThreadState.NumCaptures = USBBuffer[4];
+	StreamThreadState.NumCaptures += (USBBuffer[5] << 8);
+	StreamThreadState.NumCaptures += (USBBuffer[6] << 16);
+	StreamThreadState.NumCaptures += (USBBuffer[7] << 24);
+
+	/* Calculate the number of bytes per buffer */
+	/* Number of times to read each set of registers * (number of registers - control registers) */
+	StreamThreadState.BytesPerBuffer = StreamThreadState.NumCaptures * (StreamThreadState.TransferByteLength - 8);
+
+	/* Allocate the reglist (including the two zeroed bytes) from the stream arena */
+	StreamArenaStart();
+	StreamThreadState.RegList = AdiStreamArenaAlloc(StreamThreadState.TransferByteLength - 6);
+	if(StreamThreadState.RegList == NULL)
+	{
+		AdiLogError(StreamFunctions_c, __LINE__, StreamThreadState.TransferByteLength);
+		return CY_U3P_ERROR_MEMORY_ERROR;
+	}
+
+	/* Copy the register list */
+	CyU3PMemCopy(StreamThreadState.RegList, USBBuffer + 8, StreamThreadState.TransferByteLength - 8);
+
+	/* Zero the last values */
+	StreamThreadState.RegList[StreamThreadState.TransferByteLength - 7] = 0;
+	StreamThreadState.RegList[StreamThreadState.TransferByteLength - 8] = 0;
+
+	/* Track the stream for resume, then configure the hardware and start the stream */
+	StreamSegmentStart(ADI_GENERIC_STREAM_ENABLE, CyFalse);
+	status = GenericStreamConfigure();
+
+	return status;
+}
+
 /**
   * @brief This function cleans up after a generic stream and notifies the host that the cancel operation was successful if requested.
   *
@@ -1025,8 +1154,8 @@ CyU3PReturnStatus_t AdiGenericStreamFinished()
 	gpioConfig.intrMode = CY_U3P_GPIO_NO_INTR;
 	CyU3PGpioSetSimpleConfig(FX3State.DrPin, &gpioConfig);
 
-    /* Destroy the StreamingChannel channel (and recover a LOT of memory) */
-    status = CyU3PDmaChannelDestroy(&StreamingChannel);
+    /* Release the StreamingChannel channel, for re-use by the next stream */
+    status = StreamChannelRelease(&StreamingChannel, &StreamingCache);
 	if(status != CY_U3P_SUCCESS)
 	{
 		AdiLogError(StreamFunctions_c, __LINE__, status);
@@ -1046,6 +1175,9 @@ CyU3PReturnStatus_t AdiGenericStreamFinished()
 	CyU3PVicEnableInt(CY_U3P_VIC_GPIO_CORE_VECTOR);
 	CyU3PVicEnableInt(CY_U3P_VIC_GCTL_PWR_VECTOR);
 
+	/* Release the stream memory */
+	AdiStreamArenaReset();
+
 	/* Reset KillStreamEarly flag in case the user wants to capture data again */
 	KillStreamEarly = CyFalse;
 
@@ -1066,3 +1198,604 @@ CyU3PReturnStatus_t AdiConfigureDrPin()
 {
 	return AdiConfigurePinInterrupt(FX3State.DrPin, FX3State.DrPolarity);
 }
+
+/**
+  * @brief Marks the start of a resumable stream segment.
+  *
+  * @param Stream The stream enable event bit for the stream (ADI_BURST_STREAM_ENABLE or ADI_GENERIC_STREAM_ENABLE)
+  *
+  * @param Resume True when the stream is being resumed, false for a new stream
+  *
+  * @return void
+  *
+  * Must be called before the stream enable event is set, so the StreamThread can not finish
+  * the segment before it is tracked.
+ **/
+static void StreamSegmentStart(uint32_t Stream, CyBool_t Resume)
+{
+	if(!Resume)
+	{
+		ResumeState.RequestedBuffers = StreamThreadState.NumBuffers;
+		ResumeState.BuffersRead = 0;
+		ResumeState.ResumeCount = 0;
+		ResumeState.GapIndex = 0;
+		ResumeState.GapSamples = 0;
+		ResumeState.TotalGapSamples = 0;
+	}
+	ResumeState.SuspendedStream = 0;
+	ResumeState.SegmentBuffers = 0;
+	ResumeState.SegmentStartTime = CyU3PGetTime();
+	ResumeState.Stream = Stream;
+}
+
+/**
+  * @brief Suspends a running burst or generic stream ahead of a USB reset or disconnect.
+  *
+  * @return void
+  *
+  * Called from the USB event handler before the application is stopped. If stream resume is
+  * enabled and a resumable stream is running, this asks the StreamThread to stop the stream at
+  * the end of the current buffer, and waits (up to ADI_STREAM_SUSPEND_TIMEOUT_MS) for it to do
+  * so. The StreamThread saves the stream position in AdiStreamSegmentDone.
+ **/
+void AdiStreamSuspend()
+{
+	uint32_t waitMs = 0;
+
+	if(!ResumeState.Enabled || (ResumeState.Stream == 0))
+		return;
+
+	StreamSuspendRequest = CyTrue;
+	while((ResumeState.Stream != 0) && (waitMs < ADI_STREAM_SUSPEND_TIMEOUT_MS))
+	{
+		CyU3PThreadSleep(1);
+		waitMs++;
+	}
+
+	if(ResumeState.Stream != 0)
+	{
+		/* The StreamThread is stuck, the stream can not be resumed */
+		AdiLogError(StreamFunctions_c, __LINE__, ResumeState.Stream);
+	}
+	StreamSuspendRequest = CyFalse;
+}
+
+/**
+  * @brief Called by the StreamThread when a burst or generic stream stops capturing data.
+  *
+  * @param BuffersRead The number of buffers captured since the stream was started or resumed
+  *
+  * @param Complete True if all requested buffers were captured
+  *
+  * @return void
+  *
+  * If the stream was stopped by AdiStreamSuspend, the stream position and the board settings
+  * it depends on are saved, and the stream resources are released so the application can be
+  * stopped cleanly. The stream is then restarted by AdiStreamResume on the next SET_CONFIGURATION.
+ **/
+void AdiStreamSegmentDone(uint32_t BuffersRead, CyBool_t Complete)
+{
+	uint32_t stream = ResumeState.Stream;
+
+	ResumeState.SegmentBuffers = BuffersRead;
+	ResumeState.BuffersRead += BuffersRead;
+
+	if(StreamSuspendRequest && (stream != 0) && !Complete && !KillStreamEarly)
+	{
+		ResumeState.SuspendTime = CyU3PGetTime();
+		ResumeState.SpiConfig = FX3State.SpiConfig;
+		ResumeState.StallTime = FX3State.StallTime;
+		ResumeState.DrPin = FX3State.DrPin;
+		ResumeState.DrActive = FX3State.DrActive;
+		ResumeState.DrPolarity = FX3State.DrPolarity;
+		ResumeState.SuspendedStream = stream;
+
+		/* Release the stream resources, the same as the host stream done command */
+		if(stream == ADI_BURST_STREAM_ENABLE)
+			AdiBurstStreamFinished();
+		else
+			AdiGenericStreamFinished();
+
+		CyU3PDebugPrint (4, "Stream suspended after %d buffers\r\n", ResumeState.BuffersRead);
+	}
+
+	/* Signal that the stream is no longer running */
+	ResumeState.Stream = 0;
+}
+
+/**
+  * @brief Schedules AdiStreamResume if a stream was suspended by a USB reset. Called after AdiAppStart.
+  *
+  * @return void
+ **/
+void AdiStreamResumeCheck()
+{
+	CyU3PReturnStatus_t status;
+
+	if(ResumeState.SuspendedStream == 0)
+		return;
+
+	status = CyU3PEventSet(&EventHandler, ADI_STREAM_RESUME, CYU3P_EVENT_OR);
+	if(status != CY_U3P_SUCCESS)
+	{
+		AdiLogError(StreamFunctions_c, __LINE__, status);
+	}
+}
+
+/**
+  * @brief Resumes a burst or generic stream after a USB reset. Called from the AppThread.
+  *
+  * @return The status of the stream configuration.
+  *
+  * The board settings saved when the stream was suspended are re-applied, and the stream is
+  * restarted for the remaining number of buffers. The number of DUT samples missed during the
+  * gap is estimated from the sample rate of the last stream segment, and saved as the gap marker
+  * (the buffer count at the gap, and the number of samples missed). The host reads the gap marker
+  * using ADI_STREAM_RESUME_CONFIG.
+ **/
+CyU3PReturnStatus_t AdiStreamResume()
+{
+	CyU3PReturnStatus_t status;
+	uint32_t stream = ResumeState.SuspendedStream;
+	uint32_t segmentMs, gapMs;
+
+	if(stream == 0)
+		return CY_U3P_ERROR_NOT_STARTED;
+
+	/* Work out the remaining buffers (0 = infinite stream) */
+	if(ResumeState.RequestedBuffers != 0)
+	{
+		if(ResumeState.BuffersRead >= ResumeState.RequestedBuffers)
+		{
+			ResumeState.SuspendedStream = 0;
+			return CY_U3P_SUCCESS;
+		}
+		StreamThreadState.NumBuffers = ResumeState.RequestedBuffers - ResumeState.BuffersRead;
+	}
+
+	/* Record the gap marker */
+	gapMs = CyU3PGetTime() - ResumeState.SuspendTime;
+	segmentMs = ResumeState.SuspendTime - ResumeState.SegmentStartTime;
+	ResumeState.GapIndex = ResumeState.BuffersRead;
+	ResumeState.GapSamples = 0;
+	if(segmentMs != 0)
+		ResumeState.GapSamples = (uint32_t)(((uint64_t)gapMs * ResumeState.SegmentBuffers) / segmentMs);
+	ResumeState.TotalGapSamples += ResumeState.GapSamples;
+	ResumeState.ResumeCount++;
+
+	/* Re-apply the board settings the stream was started with */
+	FX3State.SpiConfig = ResumeState.SpiConfig;
+	FX3State.StallTime = ResumeState.StallTime;
+	FX3State.DrPin = ResumeState.DrPin;
+	FX3State.DrActive = ResumeState.DrActive;
+	FX3State.DrPolarity = ResumeState.DrPolarity;
+	status = CyU3PSpiSetConfig(&FX3State.SpiConfig, NULL);
+	if(status != CY_U3P_SUCCESS)
+	{
+		AdiLogError(StreamFunctions_c, __LINE__, status);
+	}
+
+	CyU3PDebugPrint (4, "Resuming stream after %d buffers, ~%d samples missed\r\n", ResumeState.BuffersRead, ResumeState.GapSamples);
+
+	StreamSegmentStart(stream, CyTrue);
+	if(stream == ADI_BURST_STREAM_ENABLE)
+		status = BurstStreamConfigure();
+	else
+		status = GenericStreamConfigure();
+
+	return status;
+}
+
+/**
+  * @brief Gets the stream resume status, optionally enabling or disabling stream resume
+  *
+  * @param SetEnable Non-zero to set the stream resume enable
+  *
+  * @param Enable Non-zero to resume burst and generic streams after a USB reset or disconnect
+  *
+  * @param RequestLength The number of bytes requested by the host
+  *
+  * @return A status code indicating the success of the function
+  *
+  * Stream resume is disabled at boot. The response is structured as follows:
+  *
+  * Status (0 - 3), Enabled (4), Stream suspended (5), Reserved (6 - 7), Resume count (8 - 11),
+  * Buffers captured (12 - 15), Last gap buffer index (16 - 19), Last gap missed samples (20 - 23),
+  * Total missed samples (24 - 27)
+ **/
+CyU3PReturnStatus_t AdiStreamResumeConfig(uint16_t SetEnable, uint16_t Enable, uint16_t RequestLength)
+{
+	if(SetEnable)
+		ResumeState.Enabled = (Enable != 0);
+
+	USBBuffer[4] = ResumeState.Enabled;
+	USBBuffer[5] = (ResumeState.SuspendedStream != 0);
+	USBBuffer[6] = 0;
+	USBBuffer[7] = 0;
+	CyU3PMemCopy(USBBuffer + 8, (uint8_t *)&ResumeState.ResumeCount, 4);
+	CyU3PMemCopy(USBBuffer + 12, (uint8_t *)&ResumeState.BuffersRead, 4);
+	CyU3PMemCopy(USBBuffer + 16, (uint8_t *)&ResumeState.GapIndex, 4);
+	CyU3PMemCopy(USBBuffer + 20, (uint8_t *)&ResumeState.GapSamples, 4);
+	CyU3PMemCopy(USBBuffer + 24, (uint8_t *)&ResumeState.TotalGapSamples, 4);
+
+	AdiSendStatus(CY_U3P_SUCCESS, RequestLength, CyTrue);
+	return CY_U3P_SUCCESS;
+}
+
+/**
+  * @brief Allocates memory for the running stream from the stream arena
+  *
+  * @param Size The number of bytes to allocate
+  *
+  * @return Pointer to the allocated memory, or NULL if it does not fit in the arena
+  *
+  * Allocations are rounded up to a cache line (32 bytes), so they can be used as DMA buffers.
+  * Memory is only released by AdiStreamArenaReset, all at once. The arena block is allocated from
+  * the DMA buffer heap the first time this is called, and is kept for the life of the firmware.
+ **/
+uint8_t* AdiStreamArenaAlloc(uint32_t Size)
+{
+	uint8_t *ptr;
+
+	if(Arena.Base == NULL)
+	{
+		Arena.Base = CyU3PDmaBufferAlloc(ADI_STREAM_ARENA_SIZE);
+		if(Arena.Base == NULL)
+		{
+			AdiLogError(StreamFunctions_c, __LINE__, ADI_STREAM_ARENA_SIZE);
+			Arena.FailCount++;
+			return NULL;
+		}
+	}
+
+	Size = (Size + 31) & ~31;
+	if((Size == 0) || (Size > (ADI_STREAM_ARENA_SIZE - Arena.Used)))
+	{
+		Arena.FailCount++;
+		return NULL;
+	}
+
+	ptr = Arena.Base + Arena.Used;
+	Arena.Used += Size;
+	if(Arena.Used > Arena.HighWater)
+		Arena.HighWater = Arena.Used;
+
+	return ptr;
+}
+
+/**
+  * @brief Releases all stream arena allocations
+  *
+  * @return void
+  *
+  * Called when a stream is finished. The arena is kept when the stream has been suspended
+  * by a USB reset, since the resumed stream re-uses its register list.
+ **/
+void AdiStreamArenaReset()
+{
+	if(ResumeState.SuspendedStream != 0)
+		return;
+
+	Arena.Used = 0;
+}
+
+/**
+  * @brief Releases all stream arena allocations before a new stream is started
+  *
+  * @return void
+  *
+  * A new stream replaces a stream suspended by a USB reset, so the arena is always reset.
+ **/
+static void StreamArenaStart()
+{
+	Arena.Used = 0;
+}
+
+/**
+  * @brief Gets the stream memory arena usage
+  *
+  * @param ClearHighWater Non-zero to reset the high water mark to the current usage
+  *
+  * @param RequestLength The number of bytes requested by the host
+  *
+  * @return A status code indicating the success of the function
+  *
+  * The response is structured as follows:
+  *
+  * Status (0 - 3), Arena size (4 - 7), Bytes in use (8 - 11), High water mark (12 - 15),
+  * Failed allocations (16 - 19)
+ **/
+CyU3PReturnStatus_t AdiStreamArenaStatus(uint16_t ClearHighWater, uint16_t RequestLength)
+{
+	uint32_t size = ADI_STREAM_ARENA_SIZE;
+
+	CyU3PMemCopy(USBBuffer + 4, (uint8_t *)&size, 4);
+	CyU3PMemCopy(USBBuffer + 8, (uint8_t *)&Arena.Used, 4);
+	CyU3PMemCopy(USBBuffer + 12, (uint8_t *)&Arena.HighWater, 4);
+	CyU3PMemCopy(USBBuffer + 16, (uint8_t *)&Arena.FailCount, 4);
+
+	if(ClearHighWater)
+		Arena.HighWater = Arena.Used;
+
+	AdiSendStatus(CY_U3P_SUCCESS, RequestLength, CyTrue);
+	return CY_U3P_SUCCESS;
+}
+
+/**
+  * @brief Returns the stream timing jitter histograms over the control endpoint
+  *
+  * @param Clear If non-zero, the histograms are cleared after they are read
+  *
+  * @param RequestLength The number of bytes requested over the control endpoint. Should be 164.
+  *
+  * @return A status code indicating the success of the request
+  *
+  * The data is the status (0 - 3), then the generic stream histogram (4 - 83) and the burst stream
+  * histogram (84 - 163). Each histogram is the sample count, min, max and mean, followed by the
+  * ADI_JITTER_BINS bin counts, all 32 bit, in 10MHz timer ticks. Firmware built without
+  * STREAM_JITTER_STATS returns CY_U3P_ERROR_NOT_SUPPORTED and all zero histograms.
+ **/
+CyU3PReturnStatus_t AdiStreamJitterStatus(uint16_t Clear, uint16_t RequestLength)
+{
+	CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
+	uint32_t offset = 4;
+
+#ifdef STREAM_JITTER_STATS
+	offset += PackJitterStats(&GenericJitter, USBBuffer + offset);
+	offset += PackJitterStats(&BurstJitter, USBBuffer + offset);
+
+	if(Clear)
+	{
+		CyU3PMemSet((uint8_t *)&GenericJitter, 0, sizeof(GenericJitter));
+		CyU3PMemSet((uint8_t *)&BurstJitter, 0, sizeof(BurstJitter));
+	}
+#else
+	status = CY_U3P_ERROR_NOT_SUPPORTED;
+	CyU3PMemSet(USBBuffer + offset, 0, 2 * (16 + (4 * ADI_JITTER_BINS)));
+#endif
+
+	AdiSendStatus(status, RequestLength, CyTrue);
+	return status;
+}
+
+/**
+  * @brief Gets a stream DMA channel, re-using the channel from the previous stream if possible
+  *
+  * @param Channel The DMA channel to set up
+  *
+  * @param Cache The configuration the channel was last created with
+  *
+  * @param Type The DMA channel type
+  *
+  * @param Config The DMA channel configuration
+  *
+  * @return The status of the channel reset or create operation
+  *
+  * Creating a DMA channel allocates its descriptors and buffers from the buffer heap, which takes
+  * much longer than the rest of a stream start. Stream channels are therefore kept between streams
+  * (see StreamChannelRelease). If the channel type, buffer size, buffer count and sockets match the
+  * last stream, the existing channel is just reset. Otherwise the channel is re-created.
+ **/
+static CyU3PReturnStatus_t StreamChannelAcquire(CyU3PDmaChannel *Channel, StreamChannelCache *Cache, CyU3PDmaType_t Type, CyU3PDmaChannelConfig_t *Config)
+{
+	CyU3PReturnStatus_t status;
+
+	if(Cache->Valid &&
+		(Cache->Type == Type) &&
+		(Cache->Size == Config->size) &&
+		(Cache->Count == Config->count) &&
+		(Cache->ProdSckId == Config->prodSckId) &&
+		(Cache->ConsSckId == Config->consSckId))
+	{
+		status = CyU3PDmaChannelReset(Channel);
+		if(status == CY_U3P_SUCCESS)
+		{
+			Cache->ReuseCount++;
+			return status;
+		}
+		AdiLogError(StreamFunctions_c, __LINE__, status);
+	}
+
+	/* Configuration changed (or the reset failed), re-create the channel */
+	if(Cache->Valid)
+		CyU3PDmaChannelDestroy(Channel);
+	Cache->Valid = CyFalse;
+
+	status = CyU3PDmaChannelCreate(Channel, Type, Config);
+	if(status == CY_U3P_SUCCESS)
+	{
+		Cache->Valid = CyTrue;
+		Cache->Type = Type;
+		Cache->Size = Config->size;
+		Cache->Count = Config->count;
+		Cache->ProdSckId = Config->prodSckId;
+		Cache->ConsSckId = Config->consSckId;
+		Cache->CreateCount++;
+	}
+	return status;
+}
+
+/**
+  * @brief Stops a stream DMA channel at the end of a stream, keeping it for the next stream
+  *
+  * @param Channel The DMA channel to release
+  *
+  * @param Cache The configuration the channel was created with
+  *
+  * @return The status of the channel reset
+  *
+  * The channel is reset (any active transfer is aborted and the buffers are discarded), but not
+  * destroyed. If the reset fails the channel is destroyed, so the next stream re-creates it.
+ **/
+static CyU3PReturnStatus_t StreamChannelRelease(CyU3PDmaChannel *Channel, StreamChannelCache *Cache)
+{
+	CyU3PReturnStatus_t status;
+
+	if(!Cache->Valid)
+		return CyU3PDmaChannelDestroy(Channel);
+
+	status = CyU3PDmaChannelReset(Channel);
+	if(status != CY_U3P_SUCCESS)
+	{
+		CyU3PDmaChannelDestroy(Channel);
+		Cache->Valid = CyFalse;
+	}
+	return status;
+}
+
+/**
+  * @brief Destroys the stream DMA channels kept between streams
+  *
+  * @return void
+  *
+  * Called when the application is stopped (USB reset or disconnect), since the endpoints the
+  * channels are attached to are re-configured when the application is started again.
+ **/
+void AdiStreamChannelsDestroy()
+{
+	if(StreamingCache.Valid)
+		CyU3PDmaChannelDestroy(&StreamingChannel);
+	StreamingCache.Valid = CyFalse;
+
+	if(MemoryToSpiCache.Valid)
+		CyU3PDmaChannelDestroy(&MemoryToSPI);
+	MemoryToSpiCache.Valid = CyFalse;
+}
+
+/**
+  * @brief Gets the memory used in the buffer heap by a single DMA buffer
+  *
+  * @param BufferSize The DMA buffer size
+  *
+  * @return The number of bytes of buffer heap used
+  *
+  * The buffer allocator works in cache lines (32 bytes), and keeps one unused cache line after each block.
+ **/
+static uint32_t StreamDmaBufferCost(uint16_t BufferSize)
+{
+	return ((((uint32_t)BufferSize + 31) / 32) + 1) * 32;
+}
+
+/**
+  * @brief Sizes the DMA buffer count for a stream DMA channel from the free buffer heap
+  *
+  * @param BufferSize The DMA buffer size for the stream
+  *
+  * @return The DMA buffer count to use
+  *
+  * The stream uses as many buffers as fit in the free buffer heap, less ADI_STREAM_DMA_HEAP_RESERVE,
+  * limited to the max depth set by the host (ADI_STREAM_DMA_CONFIG). The host can lower the max depth
+  * to reduce the data latency, or to leave more memory free. The buffers held by the channel kept from
+  * the last stream are counted as free, since they are released if the channel is re-created. The count
+  * is never less than ADI_STREAM_DMA_MIN_DEPTH, so a stream start on a full heap fails in the channel
+  * create, as before.
+ **/
+static uint16_t StreamDmaDepth(uint16_t BufferSize)
+{
+	uint32_t freeBytes, depth;
+
+	if(CyU3PDmaBufferGetFreeSpace(&freeBytes, NULL) != CY_U3P_SUCCESS)
+	{
+		freeBytes = 0;
+	}
+
+	if(StreamingCache.Valid)
+	{
+		freeBytes += StreamingCache.Count * StreamDmaBufferCost(StreamingCache.Size);
+	}
+
+	depth = 0;
+	if(freeBytes > ADI_STREAM_DMA_HEAP_RESERVE)
+	{
+		depth = (freeBytes - ADI_STREAM_DMA_HEAP_RESERVE) / StreamDmaBufferCost(BufferSize);
+	}
+
+	if(depth > DmaMaxDepth)
+		depth = DmaMaxDepth;
+	if(depth < ADI_STREAM_DMA_MIN_DEPTH)
+		depth = ADI_STREAM_DMA_MIN_DEPTH;
+
+	DmaLastDepth = depth;
+	DmaLastSize = BufferSize;
+
+#ifdef VERBOSE_MODE
+	CyU3PDebugPrint (4, "Stream DMA depth %d (buffer size %d, %d bytes free)\r\n", depth, BufferSize, freeBytes);
+#endif
+
+	return (uint16_t) depth;
+}
+
+/**
+  * @brief Gets the stream DMA buffer depth status, optionally setting the max DMA buffer depth
+  *
+  * @param SetMaxDepth Non-zero to set the max DMA buffer depth
+  *
+  * @param MaxDepth The max number of DMA buffers per stream. 0 restores the default (ADI_STREAM_DMA_MAX_DEPTH)
+  *
+  * @param RequestLength The number of bytes requested by the host
+  *
+  * @return A status code indicating the success of the function
+  *
+  * The max depth is limited to ADI_STREAM_DMA_MIN_DEPTH - ADI_STREAM_DMA_MAX_DEPTH, and applies from the
+  * next stream start. The response is structured as follows:
+  *
+  * Status (0 - 3), Max depth (4 - 5), Last stream depth (6 - 7), Last stream buffer size (8 - 9),
+  * Reserved (10 - 11), Buffer heap free bytes (12 - 15), Largest free block (16 - 19)
+ **/
+CyU3PReturnStatus_t AdiStreamDmaConfig(uint16_t SetMaxDepth, uint16_t MaxDepth, uint16_t RequestLength)
+{
+	uint32_t freeBytes = 0, largest = 0;
+
+	if(SetMaxDepth)
+	{
+		if(MaxDepth == 0)
+			MaxDepth = ADI_STREAM_DMA_MAX_DEPTH;
+		if(MaxDepth > ADI_STREAM_DMA_MAX_DEPTH)
+			MaxDepth = ADI_STREAM_DMA_MAX_DEPTH;
+		if(MaxDepth < ADI_STREAM_DMA_MIN_DEPTH)
+			MaxDepth = ADI_STREAM_DMA_MIN_DEPTH;
+		DmaMaxDepth = MaxDepth;
+	}
+
+	CyU3PDmaBufferGetFreeSpace(&freeBytes, &largest);
+
+	USBBuffer[4] = DmaMaxDepth & 0xFF;
+	USBBuffer[5] = (DmaMaxDepth >> 8) & 0xFF;
+	USBBuffer[6] = DmaLastDepth & 0xFF;
+	USBBuffer[7] = (DmaLastDepth >> 8) & 0xFF;
+	USBBuffer[8] = DmaLastSize & 0xFF;
+	USBBuffer[9] = (DmaLastSize >> 8) & 0xFF;
+	USBBuffer[10] = 0;
+	USBBuffer[11] = 0;
+	CyU3PMemCopy(USBBuffer + 12, (uint8_t *)&freeBytes, 4);
+	CyU3PMemCopy(USBBuffer + 16, (uint8_t *)&largest, 4);
+
+	AdiSendStatus(CY_U3P_SUCCESS, RequestLength, CyTrue);
+	return CY_U3P_SUCCESS;
+}
+
+#ifdef STREAM_JITTER_STATS
+/**
+  * @brief Copies a jitter histogram to a control endpoint buffer
+  *
+  * @param Stats The histogram to copy
+  *
+  * @param Buf The buffer to copy into
+  *
+  * @return The number of bytes written to Buf
+ **/
+static uint32_t PackJitterStats(StreamJitterStats* Stats, uint8_t* Buf)
+{
+	uint32_t mean = 0;
+
+	if(Stats->Count > 0)
+		mean = (uint32_t) (Stats->Sum / Stats->Count);
+
+	CyU3PMemCopy(Buf, (uint8_t *)&Stats->Count, 4);
+	CyU3PMemCopy(Buf + 4, (uint8_t *)&Stats->Min, 4);
+	CyU3PMemCopy(Buf + 8, (uint8_t *)&Stats->Max, 4);
+	CyU3PMemCopy(Buf + 12, (uint8_t *)&mean, 4);
+	CyU3PMemCopy(Buf + 16, (uint8_t *)Stats->Bins, 4 * ADI_JITTER_BINS);
+	return 16 + (4 * ADI_JITTER_BINS);
+}
+#endif
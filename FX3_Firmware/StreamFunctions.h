@@ -50,6 +50,154 @@ CyU3PReturnStatus_t AdiConfigureDrPin();
 /* Config functions */
 void AdiConfigStreamStallTimer();
 
+/* Stream resume (USB reset survival) functions */
+void AdiStreamSuspend();
+void AdiStreamSegmentDone(uint32_t BuffersRead, CyBool_t Complete);
+void AdiStreamResumeCheck();
+CyU3PReturnStatus_t AdiStreamResume();
+CyU3PReturnStatus_t AdiStreamResumeConfig(uint16_t SetEnable, uint16_t Enable, uint16_t RequestLength);
+
+/* Stream memory arena functions */
+uint8_t* AdiStreamArenaAlloc(uint32_t Size);
+void AdiStreamArenaReset();
+CyU3PReturnStatus_t AdiStreamArenaStatus(uint16_t ClearHighWater, uint16_t RequestLength);
+
+/* Stream DMA channel functions */
+void AdiStreamChannelsDestroy();
+CyU3PReturnStatus_t AdiStreamDmaConfig(uint16_t SetMaxDepth, uint16_t MaxDepth, uint16_t RequestLength);
+
+/* Stream timing jitter functions */
+CyU3PReturnStatus_t AdiStreamJitterStatus(uint16_t Clear, uint16_t RequestLength);
+
+/** Size of the stream memory arena (bytes). Holds the register / MOSI lists for the running stream */
+#define ADI_STREAM_ARENA_SIZE					(8192)
+
+/** Min DMA buffer count for a stream DMA channel */
+#define ADI_STREAM_DMA_MIN_DEPTH				(4)
+
+/** Max DMA buffer count for a stream DMA channel (and the default max depth setting) */
+#define ADI_STREAM_DMA_MAX_DEPTH				(64)
+
+/** Buffer heap memory (bytes) left free when sizing stream DMA channels, for the stream arena and other channels */
+#define ADI_STREAM_DMA_HEAP_RESERVE				(16384)
+
+/** Max time (ms) the USB event handler waits for the StreamThread to suspend a stream */
+#define ADI_STREAM_SUSPEND_TIMEOUT_MS			100
+
+/**
+  * @brief State used to resume a burst or generic stream after a USB reset or disconnect
+  *
+  * The stream configuration, and the board settings the stream depends on, are saved when
+  * the stream is suspended. AdiAppStart restores the default board settings, so these are
+  * re-applied before the stream is restarted.
+ **/
+typedef struct StreamResumeState
+{
+	/** Resume streams after a USB reset (opt-in) */
+	CyBool_t Enabled;
+
+	/** Stream enable event bit of the running resumable stream (0 if none is running) */
+	volatile uint32_t Stream;
+
+	/** Stream enable event bit of the suspended stream (0 if none is suspended) */
+	uint32_t SuspendedStream;
+
+	/** Number of buffers requested for the stream by the host (0 = infinite) */
+	uint32_t RequestedBuffers;
+
+	/** Number of buffers (DUT samples) captured since the stream was started */
+	uint32_t BuffersRead;
+
+	/** Number of buffers captured in the last stream segment (since the last start or resume) */
+	uint32_t SegmentBuffers;
+
+	/** Time (ms) the current stream segment started */
+	uint32_t SegmentStartTime;
+
+	/** Time (ms) the stream was suspended */
+	uint32_t SuspendTime;
+
+	/** Number of times the stream has been resumed */
+	uint32_t ResumeCount;
+
+	/** Gap marker. Number of buffers captured before the last gap */
+	uint32_t GapIndex;
+
+	/** Gap marker. Estimated number of DUT samples missed during the last gap */
+	uint32_t GapSamples;
+
+	/** Estimated number of DUT samples missed during all gaps */
+	uint32_t TotalGapSamples;
+
+	/** Saved SPI configuration */
+	CyU3PSpiConfig_t SpiConfig;
+
+	/** Saved stall time */
+	uint32_t StallTime;
+
+	/** Saved data ready pin */
+	uint16_t DrPin;
+
+	/** Saved data ready enable */
+	CyBool_t DrActive;
+
+	/** Saved data ready polarity */
+	CyBool_t DrPolarity;
+
+}StreamResumeState;
+
+/**
+  * @brief Memory arena for the running stream
+  *
+  * The arena is a single block allocated from the DMA buffer heap the first time it is used.
+  * Stream start functions allocate from it, and it is reset in one step when the stream is
+  * finished, so stream start / stop cycles never leak or fragment the buffer heap.
+ **/
+typedef struct StreamArena
+{
+	/** Arena memory (DMA buffer heap, cache line aligned) */
+	uint8_t *Base;
+
+	/** Bytes currently allocated */
+	uint32_t Used;
+
+	/** Max bytes allocated since boot (or since the high water mark was cleared) */
+	uint32_t HighWater;
+
+	/** Number of allocations which did not fit in the arena */
+	uint32_t FailCount;
+
+}StreamArena;
+
+/** @brief Configuration a stream DMA channel was created with, used to re-use the channel for the next stream */
+typedef struct StreamChannelCache
+{
+	/** True if the channel exists (created, and not destroyed) */
+	CyBool_t Valid;
+
+	/** DMA channel type */
+	CyU3PDmaType_t Type;
+
+	/** DMA buffer size */
+	uint16_t Size;
+
+	/** DMA buffer count */
+	uint16_t Count;
+
+	/** Producer socket */
+	CyU3PDmaSocketId_t ProdSckId;
+
+	/** Consumer socket */
+	CyU3PDmaSocketId_t ConsSckId;
+
+	/** Number of times the channel has been created */
+	uint32_t CreateCount;
+
+	/** Number of stream starts which re-used the existing channel */
+	uint32_t ReuseCount;
+
+}StreamChannelCache;
+
 /*
  * Stream action commands
  */
@@ -63,4 +211,32 @@ void AdiConfigStreamStallTimer();
 /** Control endpoint index value to asynchronously stop a stream. */
 #define ADI_STREAM_STOP_CMD						2
 
+/** Number of bins in a stream jitter histogram. Bin 0 counts 0 ticks, bin n counts 2^(n-1) to 2^n - 1 ticks, the last bin counts everything above */
+#define ADI_JITTER_BINS							(16)
+
+/**
+  * @brief Timing jitter histogram for one stream type, in 10MHz timer ticks (STREAM_JITTER_STATS builds)
+  *
+  * Generic stream: time past the stall time when each SPI word starts (the stall wait loop latency).
+  * Burst stream: change in the time between consecutive bursts (the data ready response jitter).
+ **/
+typedef struct StreamJitterStats
+{
+	/** Number of samples */
+	uint32_t Count;
+
+	/** Smallest sample */
+	uint32_t Min;
+
+	/** Largest sample */
+	uint32_t Max;
+
+	/** Sum of all samples */
+	uint64_t Sum;
+
+	/** Log2 histogram of the samples */
+	uint32_t Bins[ADI_JITTER_BINS];
+
+}StreamJitterStats;
+
 #endif
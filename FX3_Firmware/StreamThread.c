@@ -18,13 +18,19 @@
 
 #include "StreamThread.h"
 
-/* Private worker functions for each of the stream modes */
-static CyU3PReturnStatus_t AdiGenericStreamWork();
-static CyU3PReturnStatus_t AdiRealTimeStreamWork();
-static CyU3PReturnStatus_t AdiBurstStreamWork();
+/* Private worker functions for each of the stream modes. The timing critical workers run from I-TCM */
+ADI_ITCM_CODE static CyU3PReturnStatus_t AdiGenericStreamWork();
+ADI_ITCM_CODE static CyU3PReturnStatus_t AdiRealTimeStreamWork();
+ADI_ITCM_CODE static CyU3PReturnStatus_t AdiBurstStreamWork();
 static CyU3PReturnStatus_t AdiTransferStreamWork();
 static CyU3PReturnStatus_t AdiI2CStreamWork();
 
+#ifdef STREAM_JITTER_STATS
+/* Stream timing jitter helpers, called from the I-TCM workers */
+ADI_ITCM_CODE static inline uint32_t JitterSampleTimer();
+ADI_ITCM_CODE static inline void JitterRecord(StreamJitterStats* Stats, uint32_t Ticks);
+#endif
+
 /* Tell the compiler where to find the needed globals */
 extern CyU3PEvent EventHandler;
 extern CyU3PDmaChannel StreamingChannel;
@@ -32,8 +38,13 @@ extern CyU3PDmaChannel MemoryToSPI;
 extern CyU3PDmaBuffer_t SpiDmaBuffer;
 extern BoardState FX3State;
 extern volatile CyBool_t KillStreamEarly;
+extern volatile CyBool_t StreamSuspendRequest;
 extern StreamState StreamThreadState;
 extern uint8_t USBBuffer[4096];
+#ifdef STREAM_JITTER_STATS
+extern StreamJitterStats GenericJitter;
+extern StreamJitterStats BurstJitter;
+#endif
 
 /**
   * @brief The entry point function for the StreamThread. Handles all streaming data captures.
@@ -176,9 +187,11 @@ static CyU3PReturnStatus_t AdiI2CStreamWork()
   * This function performs all the SPI and USB transfers for a single "buffer" of a generic stream.
   * One buffer is considered to be numCapture reads of the register list provided.
  **/
-static CyU3PReturnStatus_t AdiGenericStreamWork()
+ADI_ITCM_CODE static CyU3PReturnStatus_t AdiGenericStreamWork()
 {
 	uint16_t regIndex, captureCount;
+	uint32_t captured;
+	CyBool_t complete;
 	CyU3PReturnStatus_t status;
 
 	/* Track the current position within the MISO (streaming DMA) buffer*/
@@ -196,6 +209,11 @@ static CyU3PReturnStatus_t AdiGenericStreamWork()
 	/* DMA buffer structure for the active buffer for the streaming DMA channel */
 	static CyU3PDmaBuffer_t StreamChannelBuffer;
 
+#ifdef STREAM_JITTER_STATS
+	/* Stall time threshold. Sampling the timer overwrites the threshold register */
+	uint32_t stallTicks = GPIO->lpp_gpio_pin[ADI_TIMER_PIN_INDEX].threshold;
+#endif
+
 	/* If the stream channel buffer has not been set, get a new buffer */
 	if (MISOPtr == 0)
 	{
@@ -239,6 +257,12 @@ static CyU3PReturnStatus_t AdiGenericStreamWork()
 			/* Wait for the complex GPIO timer to reach the stall time */
 			while(!(GPIO->lpp_gpio_pin[ADI_TIMER_PIN_INDEX].status & CY_U3P_LPP_GPIO_INTR));
 
+#ifdef STREAM_JITTER_STATS
+			/* Time past the stall time, then restore the threshold */
+			JitterRecord(&GenericJitter, JitterSampleTimer() - stallTicks);
+			GPIO->lpp_gpio_pin[ADI_TIMER_PIN_INDEX].threshold = stallTicks;
+#endif
+
 			/* transfer words */
 			AdiSpiTransferWord(MOSIPtr, MISOPtr, 2);
 
@@ -293,9 +317,12 @@ static CyU3PReturnStatus_t AdiGenericStreamWork()
 		GPIO->lpp_gpio_pin[ADI_TIMER_PIN_INDEX].status |= CY_U3P_LPP_GPIO_INTR;
 	}
 
-	/* Check to see if we've captured enough buffers or if we were asked to stop data capture early */
-	if ((numBuffersRead >= (StreamThreadState.NumBuffers - 1)) || KillStreamEarly)
+	/* Check to see if we've captured enough buffers, if we were asked to stop data capture early, or if USB is being reset */
+	if ((numBuffersRead >= (StreamThreadState.NumBuffers - 1)) || KillStreamEarly || StreamSuspendRequest)
 	{
+		/* Track the buffers read and stream completion, in case the stream needs to be resumed */
+		captured = numBuffersRead + 1;
+		complete = (numBuffersRead >= (StreamThreadState.NumBuffers - 1));
 		/* Reset values */
 		numBuffersRead = 0;
 		/* Signal getting a new buffer */
@@ -330,6 +357,9 @@ static CyU3PReturnStatus_t AdiGenericStreamWork()
 		CyU3PDebugPrint (4, "Exiting stream thread, %d generic stream buffers read.\r\n", numBuffersRead + 1);
 #endif
 
+		/* Save the stream position (suspends the stream if USB is being reset) */
+		AdiStreamSegmentDone(captured, complete);
+
 		/* Set stream done flag if kill early event was processed (otherwise must be explicitly invoked by FX3 API) */
 		if(KillStreamEarly)
 		{
@@ -360,7 +390,7 @@ static CyU3PReturnStatus_t AdiGenericStreamWork()
   * The operation of this function is very similar to the Burst Stream function. This implementation
   * is slightly more stream lined to allow for the very tight tolerances on the ADcmXL3021 stream modes.
  **/
-static CyU3PReturnStatus_t AdiRealTimeStreamWork()
+ADI_ITCM_CODE static CyU3PReturnStatus_t AdiRealTimeStreamWork()
 {
 	CyU3PReturnStatus_t status;
 	CyBool_t interruptTriggered;
@@ -448,7 +478,7 @@ static CyU3PReturnStatus_t AdiRealTimeStreamWork()
   * burst mode. It can be configured to transfer an arbitrary number of bytes in a single
   * SPI transaction, with optional data ready triggering.
  **/
-static CyU3PReturnStatus_t AdiBurstStreamWork()
+ADI_ITCM_CODE static CyU3PReturnStatus_t AdiBurstStreamWork()
 {
 	CyU3PReturnStatus_t status;
 	CyBool_t interruptTriggered;
@@ -456,6 +486,12 @@ static CyU3PReturnStatus_t AdiBurstStreamWork()
 	/* Static variables persist through function calls, are initialized to 0*/
 	static uint32_t numBuffersRead;
 
+#ifdef STREAM_JITTER_STATS
+	/* Timer value and period of the previous burst */
+	static uint32_t lastBurstTime, lastBurstPeriod;
+	uint32_t burstTime, burstPeriod;
+#endif
+
 #ifdef VERBOSE_MODE
 		CyU3PDebugPrint (4, "Burst stream thread entered.\r\n");
 #endif
@@ -480,6 +516,21 @@ static CyU3PReturnStatus_t AdiBurstStreamWork()
 		}
 	}
 
+#ifdef STREAM_JITTER_STATS
+	/* Change in the burst period from the previous burst (the 10MHz timer free runs during a burst stream) */
+	burstTime = JitterSampleTimer();
+	burstPeriod = burstTime - lastBurstTime;
+	if(numBuffersRead > 1)
+	{
+		if(burstPeriod > lastBurstPeriod)
+			JitterRecord(&BurstJitter, burstPeriod - lastBurstPeriod);
+		else
+			JitterRecord(&BurstJitter, lastBurstPeriod - burstPeriod);
+	}
+	lastBurstTime = burstTime;
+	lastBurstPeriod = burstPeriod;
+#endif
+
 	/* Set the config for DMA mode with RX and TX enabled */
 	SPI->lpp_spi_config |= CY_U3P_LPP_SPI_DMA_MODE;
 
@@ -500,8 +551,8 @@ static CyU3PReturnStatus_t AdiBurstStreamWork()
 		AdiLogError(StreamThread_c, __LINE__, status);
 	}
 
-	/* Check that we haven't captured the desired number of frames or that we were asked to kill the thread early */
-	if((numBuffersRead >= (StreamThreadState.NumBuffers - 1)) || KillStreamEarly)
+	/* Check that we haven't captured the desired number of frames, that we were asked to kill the thread early, or that USB is being reset */
+	if((numBuffersRead >= (StreamThreadState.NumBuffers - 1)) || KillStreamEarly || StreamSuspendRequest)
 	{
 		/* Disable the SPI DMA transfer */
 		status = CyU3PSpiDisableBlockXfer(CyTrue, CyTrue);
@@ -519,6 +570,10 @@ static CyU3PReturnStatus_t AdiBurstStreamWork()
 
 		/* Clear GPIO interrupts */
 		GPIO->lpp_gpio_simple[FX3State.DrPin] |= CY_U3P_LPP_GPIO_INTR;
+
+		/* Save the stream position (suspends the stream if USB is being reset) */
+		AdiStreamSegmentDone(numBuffersRead + 1, numBuffersRead >= (StreamThreadState.NumBuffers - 1));
+
 		/* Reset frame counter */
 		numBuffersRead = 0;
 
@@ -553,12 +608,12 @@ static CyU3PReturnStatus_t AdiBurstStreamWork()
  **/
 static CyU3PReturnStatus_t AdiTransferStreamWork()
 {
-	/* The MOSI data is stored in USBBuffer[14 ...] prior to this function being called */
+	/* The MOSI data is copied to StreamThreadState.RegList (stream arena) prior to this function being called */
 
 	/* Return status code */
 	CyU3PReturnStatus_t status;
 
-	/* Track index within the USBBuffer */
+	/* Track index within the MOSI data */
 	uint16_t MOSIDataCount;
 
 	/* Track current capture count */
@@ -616,10 +671,8 @@ static CyU3PReturnStatus_t AdiTransferStreamWork()
 
 	for(captureCount = 0; captureCount < StreamThreadState.NumCaptures; captureCount++)
 	{
-		/* Set the MOSI pointer to the base address of the USB Buffer*/
-		MOSIData = USBBuffer;
-		/* Increment by 14 so it now points at first MOSI data value */
-		MOSIData += 14;
+		/* Set the MOSI pointer to the first MOSI data value */
+		MOSIData = StreamThreadState.RegList;
 		for(MOSIDataCount = 0; MOSIDataCount < StreamThreadState.BytesPerBuffer; MOSIDataCount += bytesPerSpiTransfer)
 		{
 			/* Wait for the complex GPIO timer to reach the stall time */
@@ -720,4 +773,51 @@ static CyU3PReturnStatus_t AdiTransferStreamWork()
 	return status;
 }
 
+#ifdef STREAM_JITTER_STATS
+/**
+  * @brief Samples the 10MHz timer without changing the timer pin interrupt mode
+  *
+  * @return The timer value
+  *
+  * Unlike AdiReadTimerRegValue, the current pin status is kept, so the stall timer interrupt mode
+  * set up for the generic stream is not lost. The sample overwrites the threshold register.
+ **/
+ADI_ITCM_CODE static inline uint32_t JitterSampleTimer()
+{
+	uint32_t pinStatus = GPIO->lpp_gpio_pin[ADI_TIMER_PIN_INDEX].status & ~(CY_U3P_LPP_GPIO_INTR | CY_U3P_LPP_GPIO_MODE_MASK);
+
+	GPIO->lpp_gpio_pin[ADI_TIMER_PIN_INDEX].status = pinStatus | (CY_U3P_GPIO_MODE_SAMPLE_NOW << CY_U3P_LPP_GPIO_MODE_POS);
+	while (GPIO->lpp_gpio_pin[ADI_TIMER_PIN_INDEX].status & CY_U3P_LPP_GPIO_MODE_MASK);
+	return GPIO->lpp_gpio_pin[ADI_TIMER_PIN_INDEX].threshold;
+}
+
+/**
+  * @brief Adds a sample to a stream jitter histogram
+  *
+  * @param Stats The histogram to update
+  *
+  * @param Ticks The sample, in 10MHz timer ticks
+  *
+  * @return void
+ **/
+ADI_ITCM_CODE static inline void JitterRecord(StreamJitterStats* Stats, uint32_t Ticks)
+{
+	uint32_t bin = 0;
 
+	if(Ticks != 0)
+	{
+		/* Log2 bin, using the ARM926 CLZ instruction */
+		bin = 32 - __builtin_clz(Ticks);
+		if(bin >= ADI_JITTER_BINS)
+			bin = ADI_JITTER_BINS - 1;
+	}
+	Stats->Bins[bin]++;
+
+	if((Stats->Count == 0) || (Ticks < Stats->Min))
+		Stats->Min = Ticks;
+	if(Ticks > Stats->Max)
+		Stats->Max = Ticks;
+	Stats->Sum += Ticks;
+	Stats->Count++;
+}
+#endif
@@ -139,11 +139,14 @@ static CyU3PDmaBufMgr_t glBufferManager = {{0}, 0, 0, 0, 0, 0}; /* Buffer manage
 
 /*
    Debug variables used for doing memory leak and corruption checks around buffers allocated through
-   the CyU3PMemAlloc function.
+   the CyU3PMemAlloc function. The checks are enabled by default so that the heap usage can be read
+   back at runtime (CyU3PMemGetUsage).
  */
-static CyBool_t         glMemEnableChecks = CyFalse;            /* Whether checks are enabled. */
+static CyBool_t         glMemEnableChecks = CyTrue;             /* Whether checks are enabled. */
 static uint32_t         glMemAllocCnt     = 0;                  /* Number of alloc operations performed. */
 static uint32_t         glMemFreeCnt      = 0;                  /* Number of free operations performed. */
+static uint32_t         glMemInUseSize    = 0;                  /* Bytes currently allocated, including headers. */
+static uint32_t         glMemPeakSize     = 0;                  /* Peak value of glMemInUseSize. */
 static MemBlockInfo    *glMemInUseList    = 0;                  /* List of all memory blocks in use. */
 static CyU3PMemCorruptCallback glMemBadCb = 0;                  /* Callback for notification of corrupted memory. */
 
@@ -155,6 +158,8 @@ static CyBool_t         glBufMgrEnableChecks = CyFalse;         /* Whether check
 static uint32_t         glBufAllocCnt        = 0;               /* Number of alloc operations performed. */
 static uint32_t         glBufFreeCnt         = 0;               /* Number of free operations performed. */
 static MemBlockInfo    *glBufInUseList       = 0;               /* List of all memory blocks in use. */
+static uint32_t         glBufInUseSize       = 0;               /* Bytes currently allocated, in cache lines. */
+static uint32_t         glBufPeakSize        = 0;               /* Peak value of glBufInUseSize. */
 static CyU3PMemCorruptCallback glBufBadCb    = 0;               /* Callback for notification of corrupted memory. */
 
 #endif
@@ -339,6 +344,9 @@ CyU3PMemAlloc (
             block_p = (MemBlockInfo *)ret_p;
             block_p->alloc_id        = glMemAllocCnt++;
             block_p->alloc_size      = size;
+            glMemInUseSize          += size;
+            if (glMemInUseSize > glMemPeakSize)
+                glMemPeakSize        = glMemInUseSize;
             block_p->prev_blk        = glMemInUseList;
             block_p->next_blk        = 0;
             block_p->start_sig       = CY_U3P_MEM_START_SIG;
@@ -394,6 +402,7 @@ CyU3PMemFree (
         }
 
         glMemFreeCnt++;
+        glMemInUseSize -= block_p->alloc_size;
 
         /* Update the in-use linked list to drop the freed-up block. */
         if (block_p->next_blk != 0)
@@ -495,10 +504,51 @@ CyU3PMemCorruptionCheck (
 
 #endif
 
+/* Function     : CyU3PMemGetUsage
+ * Description  : Get the current and peak number of bytes allocated from the memory heap.
+ *                The byte counts include the header and footer added to each block.
+ * Parameters   :
+ *                size_p   : Parameter to be filled with the memory heap size.
+ *                inUse_p  : Parameter to be filled with the bytes currently allocated.
+ *                peak_p   : Parameter to be filled with the peak bytes allocated.
+ * Return Value : CY_U3P_SUCCESS, or CY_U3P_ERROR_NOT_SUPPORTED if memory checks are not
+ *                available or disabled. The usage reads as 0 in that case.
+ */
+CyU3PReturnStatus_t
+CyU3PMemGetUsage (
+        uint32_t *size_p,
+        uint32_t *inUse_p,
+        uint32_t *peak_p)
+{
+    uint32_t inUse = 0, peak = 0;
+    CyU3PReturnStatus_t status = CY_U3P_ERROR_NOT_SUPPORTED;
+
+#ifdef CYFXTX_ERRORDETECTION
+    /* The block sizes are only known when the block headers are being added. */
+    if (glMemEnableChecks)
+    {
+        inUse  = glMemInUseSize;
+        peak   = glMemPeakSize;
+        status = CY_U3P_SUCCESS;
+    }
+#endif
+
+    if (size_p != 0)
+        *size_p = CY_U3P_MEM_HEAP_SIZE;
+    if (inUse_p != 0)
+        *inUse_p = inUse;
+    if (peak_p != 0)
+        *peak_p = peak;
+
+    return status;
+}
+
 /* Function     : CyU3PMemSet
  * Description  : memset equivalent function to initialize a memory block.
- *                This function assumes that the memory block may not be DWORD
- *                aligned; and performs a byte-by-byte memset.
+ *                The memory block may not be DWORD aligned. Bytes are set up to the first
+ *                DWORD boundary, then the block is set 32 bytes (eight DWORDs, which the
+ *                compiler can merge into STM instructions) and then one DWORD at a time,
+ *                and the remaining tail bytes are set last.
  *                No checks are performed on the parameters because even a NULL-pointer
  *                is valid on the FX3 device.
  * Parameters   :
@@ -513,22 +563,45 @@ CyU3PMemSet (
         uint8_t  data,
         uint32_t count)
 {
-    /* Loop unrolling for faster operation */
-    while (count >> 3)
+    uint32_t *ptr32;
+    uint32_t  word;
+
+    /* Head: set bytes up to the first DWORD boundary */
+    while ((count > 0) && (((uint32_t)ptr & 0x03) != 0))
+    {
+        *ptr++ = data;
+        count--;
+    }
+
+    /* Body: set aligned DWORDs */
+    ptr32 = (uint32_t *)ptr;
+    word  = data;
+    word |= (word << 8);
+    word |= (word << 16);
+
+    while (count >= 32)
     {
-        ptr[0] = data;
-        ptr[1] = data;
-        ptr[2] = data;
-        ptr[3] = data;
-        ptr[4] = data;
-        ptr[5] = data;
-        ptr[6] = data;
-        ptr[7] = data;
-
-        count -= 8;
-        ptr += 8;
+        ptr32[0] = word;
+        ptr32[1] = word;
+        ptr32[2] = word;
+        ptr32[3] = word;
+        ptr32[4] = word;
+        ptr32[5] = word;
+        ptr32[6] = word;
+        ptr32[7] = word;
+
+        ptr32 += 8;
+        count -= 32;
     }
 
+    while (count >= 4)
+    {
+        *ptr32++ = word;
+        count -= 4;
+    }
+
+    /* Tail: set the remaining bytes */
+    ptr = (uint8_t *)ptr32;
     while (count--)
     {
         *ptr = data;
@@ -538,8 +611,14 @@ CyU3PMemSet (
 
 /* Function     : CyU3PMemCopy
  * Description  : memcpy equivalent function to copy one memory block to another.
- *                This function assumes that the memory block may not be DWORD
- *                aligned; and performs a byte-by-byte copy.
+ *                Overlapping blocks are handled (memmove semantics): the copy runs from the
+ *                end of the block back to the start when the destination is above the source.
+ *                When the source and destination have the same DWORD alignment, bytes are
+ *                copied up to the first DWORD boundary, then the block is copied 32 bytes
+ *                (eight DWORDs, which the compiler can merge into LDM / STM instructions) and
+ *                then one DWORD at a time, and the remaining bytes are copied last. Blocks with
+ *                different alignments are copied byte-by-byte, since the ARM926 does not
+ *                support unaligned DWORD accesses.
  *                No checks are performed on the parameters because even a NULL-pointer
  *                is valid on the FX3 device.
  * Parameters   :
@@ -554,13 +633,66 @@ CyU3PMemCopy (
         uint8_t  *src,
         uint32_t  count)
 {
+    uint32_t *dest32;
+    uint32_t *src32;
+    uint32_t  w0, w1, w2, w3, w4, w5, w6, w7;
+    CyBool_t  aligned = ((((uint32_t)dest ^ (uint32_t)src) & 0x03) == 0);
+
     if (dest > src)
     {
         /* Destination buffer is above source buffer. Copy from end of the buffer back to the start. */
         dest += count;
         src  += count;
 
-        /* Loop unrolling for faster operation */
+        if (aligned)
+        {
+            /* Head: copy bytes down to a DWORD boundary */
+            while ((count > 0) && (((uint32_t)dest & 0x03) != 0))
+            {
+                *--dest = *--src;
+                count--;
+            }
+
+            dest32 = (uint32_t *)dest;
+            src32  = (uint32_t *)src;
+
+            /* Load all eight DWORDs before storing any, in case the blocks overlap */
+            while (count >= 32)
+            {
+                dest32 -= 8;
+                src32  -= 8;
+                count  -= 32;
+
+                w0 = src32[0];
+                w1 = src32[1];
+                w2 = src32[2];
+                w3 = src32[3];
+                w4 = src32[4];
+                w5 = src32[5];
+                w6 = src32[6];
+                w7 = src32[7];
+
+                dest32[0] = w0;
+                dest32[1] = w1;
+                dest32[2] = w2;
+                dest32[3] = w3;
+                dest32[4] = w4;
+                dest32[5] = w5;
+                dest32[6] = w6;
+                dest32[7] = w7;
+            }
+
+            while (count >= 4)
+            {
+                *--dest32 = *--src32;
+                count -= 4;
+            }
+
+            dest = (uint8_t *)dest32;
+            src  = (uint8_t *)src32;
+        }
+
+        /* Tail (or mis-aligned block): copy bytes. Loop unrolling for faster operation */
         while (count >= 8)
         {
             dest  -= 8;
@@ -589,8 +721,55 @@ CyU3PMemCopy (
     else
     {
         /* Destination buffer is below source buffer. Copy from start to end of the buffer. */
+        if (aligned)
+        {
+            /* Head: copy bytes up to a DWORD boundary */
+            while ((count > 0) && (((uint32_t)dest & 0x03) != 0))
+            {
+                *dest++ = *src++;
+                count--;
+            }
+
+            dest32 = (uint32_t *)dest;
+            src32  = (uint32_t *)src;
+
+            /* Load all eight DWORDs before storing any, in case the blocks overlap */
+            while (count >= 32)
+            {
+                w0 = src32[0];
+                w1 = src32[1];
+                w2 = src32[2];
+                w3 = src32[3];
+                w4 = src32[4];
+                w5 = src32[5];
+                w6 = src32[6];
+                w7 = src32[7];
+
+                dest32[0] = w0;
+                dest32[1] = w1;
+                dest32[2] = w2;
+                dest32[3] = w3;
+                dest32[4] = w4;
+                dest32[5] = w5;
+                dest32[6] = w6;
+                dest32[7] = w7;
+
+                dest32 += 8;
+                src32  += 8;
+                count  -= 32;
+            }
 
-        /* Loop unrolling for faster operation */
+            while (count >= 4)
+            {
+                *dest32++ = *src32++;
+                count -= 4;
+            }
+
+            dest = (uint8_t *)dest32;
+            src  = (uint8_t *)src32;
+        }
+
+        /* Tail (or mis-aligned block): copy bytes. Loop unrolling for faster operation */
         while (count >= 8)
         {
             dest[0] = src[0];
@@ -783,6 +962,8 @@ CyU3PDmaBufferDeInit (
     glBufAllocCnt  = 0;
     glBufFreeCnt   = 0;
     glBufInUseList = 0;
+    glBufInUseSize = 0;
+    glBufPeakSize  = 0;
 #endif
 
     /* Free up and destroy the mutex variable. */
@@ -949,6 +1130,14 @@ CyU3PDmaBufferAlloc (
         CyU3PDmaBufMgrSetStatus (start, size - 1, CyTrue);
         ptr = (void *)(glBufferManager.startAddr + (start << 5));
 
+#ifdef CYFXTX_ERRORDETECTION
+        /* Track the buffer heap usage. This only needs the cache line count, so it does not
+           depend on the header based checks being enabled. */
+        glBufInUseSize += (size * FX3_CACHE_LINE_SZ);
+        if (glBufInUseSize > glBufPeakSize)
+            glBufPeakSize = glBufInUseSize;
+#endif
+
 #ifdef CYFXTX_ERRORDETECTION
         if (glBufMgrEnableChecks)
         {
@@ -1067,6 +1256,11 @@ CyU3PDmaBufferFree (
 
         CyU3PDmaBufMgrSetStatus (start, count, CyFalse);
 
+#ifdef CYFXTX_ERRORDETECTION
+        /* The block also owns the cache line left clear after the used bits. */
+        glBufInUseSize -= ((count + 1) * FX3_CACHE_LINE_SZ);
+#endif
+
         /* Start the next buffer search at the top of the heap. This can help reduce fragmentation in cases where
            most of the heap is allocated and then freed as a whole. */
         glBufferManager.searchPos = 0;
@@ -1078,6 +1272,110 @@ CyU3PDmaBufferFree (
     return retVal;
 }
 
+/* Function     : CyU3PBufGetUsage
+ * Description  : Get the current and peak number of bytes allocated from the buffer heap.
+ *                Each block is counted as the cache lines reserved for it, including
+ *                the cache line left free at the end of the block.
+ * Parameters   :
+ *                size_p   : Parameter to be filled with the buffer heap size.
+ *                inUse_p  : Parameter to be filled with the bytes currently allocated.
+ *                peak_p   : Parameter to be filled with the peak bytes allocated.
+ * Return Value : CY_U3P_SUCCESS, or CY_U3P_ERROR_NOT_SUPPORTED if memory checks are not
+ *                available. The usage reads as 0 in that case.
+ */
+CyU3PReturnStatus_t
+CyU3PBufGetUsage (
+        uint32_t *size_p,
+        uint32_t *inUse_p,
+        uint32_t *peak_p)
+{
+    uint32_t inUse = 0, peak = 0;
+    CyU3PReturnStatus_t status = CY_U3P_ERROR_NOT_SUPPORTED;
+
+#ifdef CYFXTX_ERRORDETECTION
+    inUse  = glBufInUseSize;
+    peak   = glBufPeakSize;
+    status = CY_U3P_SUCCESS;
+#endif
+
+    if (size_p != 0)
+        *size_p = CY_U3P_BUFFER_HEAP_SIZE;
+    if (inUse_p != 0)
+        *inUse_p = inUse;
+    if (peak_p != 0)
+        *peak_p = peak;
+
+    return status;
+}
+
+/* Function     : CyU3PDmaBufferGetFreeSpace
+ * Description  : Get the amount of free memory in the buffer heap. This is used by the
+ *                application to size the DMA buffer count for a channel, based on the memory
+ *                which is actually available.
+ *                The allocator keeps one unused cache line after each block, so the largest
+ *                block which can be allocated is one cache line smaller than the longest free
+ *                region.
+ * Parameters   :
+ *                free_p    : Parameter to be filled with the total free memory in bytes.
+ *                largest_p : Parameter to be filled with the size of the largest block which
+ *                            can be allocated, in bytes.
+ * Return Value : CY_U3P_SUCCESS, or CY_U3P_ERROR_FAILURE if the buffer manager lock could not
+ *                be taken or the buffer manager has not been initialized.
+ */
+CyU3PReturnStatus_t
+CyU3PDmaBufferGetFreeSpace (
+        uint32_t *free_p,
+        uint32_t *largest_p)
+{
+    uint32_t wordnum, bitnum;
+    uint32_t count = 0, total = 0, longest = 0;
+
+    if (CyU3PThreadIdentify ())
+    {
+        if (CyU3PMutexGet (&glBufferManager.lock, CY_U3P_BUFFER_ALLOC_TIMEOUT) != CY_U3P_SUCCESS)
+            return CY_U3P_ERROR_FAILURE;
+    }
+    else
+    {
+        if (CyU3PMutexGet (&glBufferManager.lock, CYU3P_NO_WAIT) != CY_U3P_SUCCESS)
+            return CY_U3P_ERROR_FAILURE;
+    }
+
+    if ((glBufferManager.startAddr == 0) || (glBufferManager.regionSize == 0))
+    {
+        CyU3PMutexPut (&glBufferManager.lock);
+        return CY_U3P_ERROR_FAILURE;
+    }
+
+    /* Count the free cache lines, and the longest run of free cache lines. */
+    for (wordnum = 0; wordnum < glBufferManager.statusSize; wordnum++)
+    {
+        for (bitnum = 0; bitnum < 32; bitnum++)
+        {
+            if ((glBufferManager.usedStatus[wordnum] & (1 << bitnum)) == 0)
+            {
+                total++;
+                count++;
+                if (count > longest)
+                    longest = count;
+            }
+            else
+            {
+                count = 0;
+            }
+        }
+    }
+
+    CyU3PMutexPut (&glBufferManager.lock);
+
+    if (free_p != 0)
+        *free_p = total * FX3_CACHE_LINE_SZ;
+    if (largest_p != 0)
+        *largest_p = (longest > 1) ? ((longest - 1) * FX3_CACHE_LINE_SZ) : 0;
+
+    return CY_U3P_SUCCESS;
+}
+
 /* Function    : CyU3PFreeHeaps
  * Description : This function de-initializes both driver and buffer heap allocators.
  *               This is called from the SDK library and is not expected to be called
@@ -88,6 +88,12 @@ uint8_t USBBuffer[4096] __attribute__((aligned(32)));
 /** 12KB Generic bulk buffer. Used for when data is manually sent to or received from the PC via bulk endpoints. */
 uint8_t BulkBuffer[12288] __attribute__((aligned(32)));
 
+/** StreamThread stack, allocated from the memory heap */
+static uint8_t* StreamThreadStack = NULL;
+
+/** AppThread stack, allocated from the memory heap */
+static uint8_t* AppThreadStack = NULL;
+
 /** DMA buffer structure for output buffer */
 CyU3PDmaBuffer_t ManualDMABuffer;
 
@@ -118,17 +124,71 @@ BoardState FX3State;
 /** Signal data stream thread to kill data capture early (True = kill thread signaled, False = allow execution) */
 volatile CyBool_t KillStreamEarly = CyFalse;
 
+/** Signal data stream thread to suspend a resumable stream ahead of a USB reset (True = suspend signaled) */
+volatile CyBool_t StreamSuspendRequest = CyFalse;
+
 /** Struct of data used to synchronize the data streaming / app threads */
 StreamState StreamThreadState;
 
+/*
+ * Fatal error recovery state
+ */
+
+/** Track if an application soft restart has been requested, and not yet started */
+static volatile CyBool_t RecoveryPending = CyFalse;
+
+/** Track if an application soft restart is in progress */
+static volatile CyBool_t RecoveryActive = CyFalse;
+
+/** Number of application soft restarts since boot */
+static uint32_t SoftRestartCount = 0;
+
+/** Error code which triggered the last application soft restart */
+static uint32_t SoftRestartError = 0;
+
+/** Time (ms) when the last application soft restart finished */
+static uint32_t SoftRestartTime = 0;
+
+/** Error code which caused the reset before this boot (0 = none) */
+static uint32_t LastResetReason = 0;
+
+/*
+ * Startup timing checkpoints
+ */
+
+/** 10MHz timer value at each startup checkpoint, for the last application start */
+static uint32_t StartupTicks[STARTUP_CHECKPOINT_COUNT];
+
+/** Bit mask of the startup checkpoints recorded since the last start request */
+static uint32_t StartupRecorded = 0;
+
+/** 10MHz timer value at each boot checkpoint */
+static uint32_t BootTicks[BOOT_CHECKPOINT_COUNT];
+
+/** Bit mask of the boot checkpoints recorded */
+static uint32_t BootRecorded = 0;
+
+/** RTOS time (ms) when the 10MHz timer was started at boot */
+static uint32_t BootTimerStartMs = 0;
+
+/** 10MHz timer value at each startup checkpoint, for the first application start after boot (the plug-in path) */
+static uint32_t BootPathTicks[STARTUP_CHECKPOINT_COUNT];
+
+/** Bit mask of the first application start checkpoints recorded */
+static uint32_t BootPathRecorded = 0;
+
+/** Tracks if startup checkpoints are also recorded as the first application start after boot */
+static CyBool_t BootPathOpen = CyFalse;
+
 /**
   * @brief This is the main entry point function for the iSensor FX3 application firmware.
   *
   * @return A status code indicating the success of the function. Should never return.
   *
   * This firmware image is loaded into RAM over USB by the second-stange iSensor FX3 Bootloader when the Connect() function is called
-  * in the FX3 API. Once the full image has been loaded into SRAM, and the CRC verified, the iSensor FX3 bootloader jumps to this main
-  * function. Main initializes the device, memory, and IO matrix, and then boots the RTOS kernel.
+  * in the FX3 API, or from one of the EEPROM image slots at power on. Once the full image has been loaded into SRAM, and the CRC
+  * verified, the iSensor FX3 bootloader jumps to this main function. Main initializes the device, memory, and IO matrix, and then
+  * boots the RTOS kernel.
  **/
 int main (void)
 {
@@ -136,6 +196,9 @@ int main (void)
     CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
     CyU3PSysClockConfig_t sysclk_cfg;
 
+    /* Check which image slot the bootloader started (before the DMA buffer area is used) */
+    AdiBootSlotInit();
+
     /* Configure system clocks */
     sysclk_cfg.setSysClk400 = CyTrue;
     sysclk_cfg.useStandbyClk = CyFalse;
@@ -235,6 +298,8 @@ CyBool_t AdiControlEndpointHandler (uint32_t setupdat0, uint32_t setupdat1)
     {
         isHandled = CyTrue;
 
+        AdiStartupCheckpoint(CheckpointFirstCommand);
+
 #ifdef VERBOSE_MODE
         CyU3PDebugPrint (4, "Vendor request = 0x%x\r\n", bRequest);
 #endif
@@ -310,7 +375,7 @@ CyBool_t AdiControlEndpointHandler (uint32_t setupdat0, uint32_t setupdat1)
             	CyU3PUsbSendEP0Data(wLength, USBBuffer);
             	break;
 
-            /* Hard-reset the FX3 firmware (return to bootloader mode) */
+            /* Hard-reset the FX3 firmware (return to bootloader mode, or boot the stored image) */
             case ADI_HARD_RESET:
             	CyU3PUsbAckSetup();
             	CyU3PUsbGetEP0Data(wLength, USBBuffer, bytesRead);
@@ -320,6 +385,9 @@ CyBool_t AdiControlEndpointHandler (uint32_t setupdat0, uint32_t setupdat1)
             	AdiAppStop();
             	CyU3PPibDeInit();
             	CyU3PThreadSleep(500);
+            	/* Value of 1 boots the stored image (after an update) instead of the USB bootloader */
+            	if(wValue == 1)
+            		AdiBootSlotRequestBoot();
 				CyU3PDeviceReset(CyFalse);
             	break;
 
@@ -555,15 +623,107 @@ CyBool_t AdiControlEndpointHandler (uint32_t setupdat0, uint32_t setupdat1)
 
 			/* Arbitrary flash read command */
 			case ADI_READ_FLASH:
+				/* Write any rate limited log data from the AppThread. The log count at
+				 * LOG_COUNT_ADDR always matches the entries in flash, but this flush is not
+				 * synchronous with the read, use ADI_DUMP_ERROR_LOG to include pending entries */
+				CyU3PEventSet(&EventHandler, ADI_ERROR_LOG_FLUSH, CYU3P_EVENT_OR);
 				AdiFlashReadHandler((wIndex << 16) | wValue, wLength);
 				break;
 
+			/* Arbitrary length flash read, over ChannelToPC */
+			case ADI_BULK_READ_FLASH:
+				status = AdiFlashBulkReadStart(wLength);
+				break;
+
+			/* Save board configuration to flash */
+			case ADI_SAVE_CONFIG:
+				status = AdiSaveConfig();
+				AdiSendStatus(status, wLength, CyTrue);
+				break;
+
+			/* Restore board configuration (mode in value) */
+			case ADI_RESTORE_CONFIG:
+				status = AdiRestoreConfig(wValue);
+				AdiSendStatus(status, wLength, CyTrue);
+				break;
+
+			/* Write boot script to flash */
+			case ADI_WRITE_BOOT_SCRIPT:
+				status = AdiWriteBootScript(wLength);
+				break;
+
+			/* Boot script status (run script if value is non-zero) */
+			case ADI_BOOT_SCRIPT_STATUS:
+				status = AdiBootScriptStatus(wValue, wLength);
+				break;
+
+			/* Firmware image slot status */
+			case ADI_BOOT_SLOT_STATUS:
+				status = AdiBootSlotStatus(wLength);
+				break;
+
+			/* Program a stored image from the bulk endpoint (target in value) */
+			case ADI_IMAGE_UPDATE_START:
+				status = AdiImageUpdateStart(wValue, wLength);
+				break;
+
+			/* Stored image update status */
+			case ADI_IMAGE_UPDATE_STATUS:
+				status = AdiImageUpdateStatus(wLength);
+				break;
+
+			/* Startup timing checkpoints for the last application start */
+			case ADI_GET_STARTUP_TIMING:
+				status = AdiGetStartupTiming(wLength);
+				break;
+
+			/* Thread stack high water marks and heap peak usage */
+			case ADI_GET_MEMORY_STATUS:
+				status = AdiGetMemoryStatus(wLength);
+				break;
+
+			/* Stream timing jitter histograms (clear after reading if index is 1) */
+			case ADI_GET_STREAM_JITTER:
+				status = AdiStreamJitterStatus(wIndex == 1, wLength);
+				break;
+
+			/* Stream memory arena usage (clear the high water mark if index is 1) */
+			case ADI_STREAM_ARENA_STATUS:
+				status = AdiStreamArenaStatus(wIndex == 1, wLength);
+				break;
+
+			/* Stream DMA buffer depth status (set the max depth using value if index is 1) */
+			case ADI_STREAM_DMA_CONFIG:
+				status = AdiStreamDmaConfig(wIndex == 1, wValue, wLength);
+				break;
+
+			/* Stream resume status (enable stream resume using value if index is 1) */
+			case ADI_STREAM_RESUME_CONFIG:
+				status = AdiStreamResumeConfig(wIndex == 1, wValue, wLength);
+				break;
+
+			/* Fatal error recovery status (set recovery mode to value if index is 1) */
+			case ADI_RECOVERY_CONFIG:
+				status = AdiRecoveryConfig(wIndex == 1, wValue, wLength);
+				break;
+
 			/* Clear flash error log command */
 			case ADI_CLEAR_FLASH_LOG:
-				WriteErrorLogCount(0);
+				AdiClearErrorLog();
 				status = CyU3PUsbGetEP0Data(wLength, USBBuffer, bytesRead);
 				break;
 
+			/* Bulk error log dump. Header is returned over control endpoint, log over ChannelToPC */
+			case ADI_DUMP_ERROR_LOG:
+				status = AdiErrorLogDumpStart(wLength);
+				break;
+
+			/* Set error log rate limit (window ms in value, writes per window in index) */
+			case ADI_SET_ERROR_LOG_RATE:
+				AdiSetErrorLogRateLimit(wValue, wIndex);
+				AdiSendStatus(status, wLength, CyTrue);
+				break;
+
 			/*Set I2C bit rate */
 			case ADI_I2C_SET_BIT_RATE:
 				status = AdiI2CInit(wIndex << 16 | wValue, CyFalse);
@@ -694,22 +854,28 @@ void AdiUSBEventHandler (CyU3PUsbEventType_t evtype, uint16_t evdata)
     switch (evtype)
     {
         case CY_U3P_USB_EVENT_SETCONF:
+        	AdiStartupCheckpoint(CheckpointStartRequest);
         	/* Disable the low power entry to optimize USB throughput */
         	CyU3PUsbLPMDisable();
         	/* Stop the application before re-starting. */
         	if (FX3State.AppActive)
         	{
+        		AdiStreamSuspend();
         		AdiAppStop();
         	}
+        	AdiStartupCheckpoint(CheckpointStopped);
 			/* Start the application */
         	AdiAppStart();
+        	/* Resume a stream interrupted by a USB reset (if enabled) */
+        	AdiStreamResumeCheck();
             break;
 
         case CY_U3P_USB_EVENT_RESET:
         case CY_U3P_USB_EVENT_DISCONNECT:
-        	/* Stop the application */
+        	/* Stop the application, suspending any resumable stream */
         	if (FX3State.AppActive)
         	{
+        		AdiStreamSuspend();
         		AdiAppStop();
         	}
             break;
@@ -741,9 +907,9 @@ CyBool_t AdiLPMRequestHandler(CyU3PUsbLinkPowerMode link_mode)
   * This function is called by the RTOS whenever the GPIO interrupt vector is enabled and a
   * GPIO interrupt is received. Instead of performing any work in this function, to improve
   * system responsiveness, this function sets an RTOS event flag, to be handled by the
-  * application thread.
+  * application thread. This handler runs in interrupt context, and is placed in I-TCM.
  **/
-void AdiGPIOEventHandler(uint8_t gpioId)
+ADI_ITCM_CODE void AdiGPIOEventHandler(uint8_t gpioId)
 {
 	CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
 	CyBool_t gpioValue = CyFalse;
@@ -780,30 +946,179 @@ void AdiGPIOEventHandler(uint8_t gpioId)
 /**
   * @brief This function handles critical errors generated by the ADI application.
   *
-  * @param status The error code which corresponds with the fatal error encountered during startup.
+  * @param status The error code which corresponds with the fatal error encountered.
   *
   * @returns void
   *
-  * This function prints the error message to the debug console, waits five seconds, and performs
-  * a hard reset. Performing the hard reset will clear the SRAM and reboot the FX3 into the second
-  * stage iSensors FX3 bootloader. Could probably do something more intelligent, but at least this
-  * approach will not lock up the FX3 after a failed boot.
+  * The recovery strategy is set by FX3State.Recovery. In the default soft restart mode, the
+  * application is restarted (AdiAppRecover) from the AppThread, and this function returns to
+  * the caller. Callers must return (with the error status, where they have one) straight after
+  * calling this function, and leave the clean up to the restart. A repeat error during the restart, or within RECOVERY_HOLDOFF_MS of
+  * the last restart, falls back to a reset. A restart is also not possible before USB
+  * enumeration, since the application resources have not been created yet.
+  *
+  * Before a reset the error log is flushed and the error code is saved in the journal, so it
+  * can be read by the host using ADI_RECOVERY_CONFIG once the firmware is re-loaded. A reset
+  * will clear the SRAM and reboot the FX3 into the second stage iSensors FX3 bootloader.
  **/
 void AdiAppErrorHandler (CyU3PReturnStatus_t status)
 {
     /* Application failed with the error code status */
 	CyU3PDebugPrint (4, "Application failed with fatal error! Error code: 0x%x\r\n", status);
 
-	for(int i = 5; i > 0; i--)
+	if(FX3State.Recovery == RecoverySoftRestart)
+	{
+		/* A restart has already been requested. Let it clean up this error as well */
+		if(RecoveryPending)
+			return;
+
+		/* Only restart if the last restart was not the cause of this error */
+		if(!RecoveryActive &&
+			(CyU3PUsbGetSpeed() != CY_U3P_NOT_CONNECTED) &&
+			((SoftRestartCount == 0) || ((CyU3PGetTime() - SoftRestartTime) > RECOVERY_HOLDOFF_MS)))
+		{
+			RecoveryPending = CyTrue;
+			SoftRestartError = status;
+			if(CyU3PEventSet(&EventHandler, ADI_APP_RECOVER, CYU3P_EVENT_OR) == CY_U3P_SUCCESS)
+			{
+				CyU3PDebugPrint (4, "Restarting application...\r\n");
+				return;
+			}
+			RecoveryPending = CyFalse;
+		}
+	}
+
+	/* Save any rate limited error log data and the reset reason before resetting */
+	AdiFlushErrorLog();
+	AdiJournalWrite(JOURNAL_KEY_RESET_REASON, status);
+
+	if(FX3State.Recovery == RecoveryDelayedReset)
+	{
+		for(int i = 5; i > 0; i--)
+		{
+			CyU3PDebugPrint (4, "Rebooting in %d seconds...\r\n", i);
+			/* Thread sleep : 1000 ms */
+			CyU3PThreadSleep(1000);
+		}
+	}
+	else
 	{
-		CyU3PDebugPrint (4, "Rebooting in %d seconds...\r\n", i);
-		/* Thread sleep : 1000 ms */
-		CyU3PThreadSleep(1000);
+		/* Allow the debug UART and flash writes to finish */
+		CyU3PDebugPrint (4, "Rebooting...\r\n");
+		CyU3PThreadSleep(RECOVERY_FLUSH_DELAY_MS);
 	}
+
 	 /* Perform hard system reset */
 	CyU3PDeviceReset(CyFalse);
 }
 
+/**
+  * @brief Soft restarts the application after a fatal error. Called from the AppThread.
+  *
+  * @returns void
+  *
+  * The application is stopped, and the peripherals are de-initialized and initialized again
+  * (AdiBoardDeInit / AdiBoardInit) before the application is started, so a fatal error caused
+  * by a wedged SPI, I2C or GPIO block is recovered. AdiAppStop is called even if the application
+  * is not active, since the failing AdiAppStart may have stopped part way through. Any fatal
+  * error reported while the restart is in progress causes a reset.
+ **/
+void AdiAppRecover()
+{
+	RecoveryActive = CyTrue;
+	RecoveryPending = CyFalse;
+	SoftRestartCount++;
+
+	CyU3PDebugPrint (4, "Application soft restart %d after error 0x%x\r\n", SoftRestartCount, SoftRestartError);
+
+	AdiStartupCheckpoint(CheckpointStartRequest);
+	AdiAppStop();
+
+	/* Restart the peripherals from reset */
+	AdiBoardDeInit();
+	AdiBoardInit();
+
+	/* Re-enable the interrupts which a failed stream start may have left disabled */
+	CyU3PVicEnableInt(CY_U3P_VIC_GPIO_CORE_VECTOR);
+	CyU3PVicEnableInt(CY_U3P_VIC_GCTL_PWR_VECTOR);
+
+	AdiStartupCheckpoint(CheckpointStopped);
+	AdiAppStart();
+
+	SoftRestartTime = CyU3PGetTime();
+	RecoveryActive = CyFalse;
+}
+
+/**
+  * @brief Loads the stored recovery mode and the last recovery reset reason. Called once at boot.
+  *
+  * @returns void
+  *
+  * The reset reason is cleared in the journal once read, so it is only reported for the
+  * first boot after the reset.
+ **/
+void AdiRecoveryInit()
+{
+	uint32_t value;
+
+	FX3State.Recovery = RecoverySoftRestart;
+	if(AdiJournalRead(JOURNAL_KEY_RECOVERY_MODE, &value) && (value <= RecoveryDelayedReset))
+		FX3State.Recovery = (RecoveryMode) value;
+
+	LastResetReason = 0;
+	if(AdiJournalRead(JOURNAL_KEY_RESET_REASON, &value) && (value != 0))
+	{
+		LastResetReason = value;
+		AdiJournalWrite(JOURNAL_KEY_RESET_REASON, 0);
+	}
+}
+
+/**
+  * @brief Gets the fatal error recovery status, optionally setting the recovery mode
+  *
+  * @param SetMode Non-zero to set the recovery mode
+  *
+  * @param Mode The new recovery mode (RecoveryMode enum)
+  *
+  * @param RequestLength The number of bytes requested by the host
+  *
+  * @return A status code indicating the success of the function
+  *
+  * The recovery mode is stored in the flash journal, so it persists across resets. The
+  * response is structured as follows:
+  *
+  * Status (0 - 3), Recovery mode (4), Reserved (5 - 7), Soft restart count (8 - 11),
+  * Last soft restart error (12 - 15), Error which caused the last reset (16 - 19)
+ **/
+CyU3PReturnStatus_t AdiRecoveryConfig(uint16_t SetMode, uint16_t Mode, uint16_t RequestLength)
+{
+	CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
+
+	if(SetMode)
+	{
+		if(Mode <= RecoveryDelayedReset)
+		{
+			FX3State.Recovery = (RecoveryMode) Mode;
+			status = AdiJournalWrite(JOURNAL_KEY_RECOVERY_MODE, Mode);
+		}
+		else
+		{
+			status = CY_U3P_ERROR_BAD_ARGUMENT;
+		}
+	}
+
+	USBBuffer[4] = FX3State.Recovery;
+	USBBuffer[5] = 0;
+	USBBuffer[6] = 0;
+	USBBuffer[7] = 0;
+	CyU3PMemCopy(USBBuffer + 8, (uint8_t *)&SoftRestartCount, 4);
+	CyU3PMemCopy(USBBuffer + 12, (uint8_t *)&SoftRestartError, 4);
+	CyU3PMemCopy(USBBuffer + 16, (uint8_t *)&LastResetReason, 4);
+
+	AdiSendStatus(status, RequestLength, CyTrue);
+	return status;
+}
+
 /**
   * @brief This function is called to shut down the application.
   *
@@ -819,24 +1134,15 @@ void AdiAppStop()
 {
 	CyU3PDebugPrint (4, "Application stopping!\r\n");
 
+	/* Save any rate limited error log data while flash is still accessible */
+	AdiFlushErrorLog();
+
 	/* Signal that the app thread has been stopped */
 	FX3State.AppActive = CyFalse;
 
-    /* De-init flash memory */
-    AdiFlashDeInit();
-
-	/* Clean up UART (debug) */
-	CyU3PUartDeInit ();
-
-	/* Clean up GPIO */
-	CyU3PGpioDeInit();
-
-	/* Clean up SPI */
-	CyU3PSpiDeInit();
-
-	/* Clean up event handlers */
-	CyU3PEventDestroy(&EventHandler);
-	CyU3PEventDestroy(&GpioHandler);
+	/* Clear any pending events. The peripherals and event groups stay initialized (AdiBoardInit) */
+	CyU3PEventSet(&EventHandler, 0, CYU3P_EVENT_AND);
+	CyU3PEventSet(&GpioHandler, 0, CYU3P_EVENT_AND);
 
 	/* Flush endpoint memory */
 	CyU3PUsbFlushEp(ADI_STREAMING_ENDPOINT);
@@ -846,6 +1152,7 @@ void AdiAppStop()
 	/* Clean up DMAs */
 	CyU3PDmaChannelDestroy(&ChannelFromPC);
 	CyU3PDmaChannelDestroy(&ChannelToPC);
+	AdiStreamChannelsDestroy();
 
 	/* Disable endpoints */
 	CyU3PEpConfig_t epConfig;
@@ -865,45 +1172,21 @@ void AdiAppStop()
 }
 
 /**
-  * @brief This function sets up the necessary resources to start the ADI application.
+  * @brief This function initializes the FX3 peripherals used by the ADI application. Called once at boot.
   *
   * @returns void
   *
-  * The application startup process configures all GPIO and timers used by the firmware, as
-  * well as the USB endpoints, DMA controller, and SPI hardware. After all configuration is
-  * performed, the AppActive flag is set to true.
+  * The GPIO block, board type detection, power control circuit, GPIO overrides, the 10MHz timer and the
+  * SPI block do not depend on the USB connection speed, so they are set up once, before USB is started,
+  * and kept running across USB resets. AdiAppStart only restores the default board state and sizes the
+  * endpoints and DMA channels for the connection speed. A fatal error soft restart (AdiAppRecover) calls
+  * AdiBoardDeInit and then this function again, to recover a wedged peripheral.
  **/
-void AdiAppStart()
+void AdiBoardInit()
 {
-	CyU3PUSBSpeed_t usbSpeed = CyU3PUsbGetSpeed();
 	CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
 	CyU3PGpioSimpleConfig_t gpioConfig;
 
-    /* Based on the Bus Speed configure the endpoint packet size */
-    switch (usbSpeed)
-    {
-        case CY_U3P_FULL_SPEED:
-        	FX3State.UsbBufferSize = 64;
-            CyU3PDebugPrint (4, "Connected at USB 1.0 speed.\r\n");
-            break;
-
-        case CY_U3P_HIGH_SPEED:
-        	FX3State.UsbBufferSize = 512;
-            CyU3PDebugPrint (4, "Connected at USB 2.0 speed.\r\n");
-            break;
-
-        case  CY_U3P_SUPER_SPEED:
-        	FX3State.UsbBufferSize = 1024;
-            CyU3PDebugPrint (4, "Connected at USB 3.0 speed.\r\n");
-            break;
-
-        default:
-        	/* Invalid USB speed */
-        	AdiLogError(Main_c, __LINE__, status);
-            AdiAppErrorHandler (CY_U3P_ERROR_FAILURE);
-            break;
-    }
-
     /* Configure GPIO for ADI application */
 
 	/* SYS_CLK = 403.2MHz
@@ -924,6 +1207,7 @@ void AdiAppStart()
     {
     	AdiLogError(Main_c, __LINE__, status);
     	AdiAppErrorHandler(status);
+    	return;
     }
 
     /* Get FX3 board type for FX3 state */
@@ -1046,7 +1330,146 @@ void AdiAppStart()
     	AdiLogError(Main_c, __LINE__, status);
     }
 
-	/* Set the GPIO configuration for each GPIO that was just overridden */
+	/* Configure high-speed, high-resolution timer using a complex GPIO. A soft restart resets the
+	 * timer, which ends the boot timing */
+	if(BootRecorded & (1 << BootCheckpointTimer))
+		BootPathOpen = CyFalse;
+	CyU3PGpioComplexConfig_t gpioComplexConfig;
+	CyU3PMemSet ((uint8_t *)&gpioComplexConfig, 0, sizeof (gpioComplexConfig));
+	gpioComplexConfig.outValue = CyFalse;
+	gpioComplexConfig.inputEn = CyFalse;
+	gpioComplexConfig.driveLowEn = CyTrue;
+	gpioComplexConfig.driveHighEn = CyTrue;
+	gpioComplexConfig.pinMode = CY_U3P_GPIO_MODE_STATIC;
+	gpioComplexConfig.intrMode = CY_U3P_GPIO_NO_INTR;
+	gpioComplexConfig.timerMode = CY_U3P_GPIO_TIMER_LOW_FREQ;
+	gpioComplexConfig.timer = 0;
+	gpioComplexConfig.period = 0xFFFFFFFF;
+	gpioComplexConfig.threshold = 0xFFFFFFFF;
+	status = CyU3PGpioSetComplexConfig(ADI_TIMER_PIN, &gpioComplexConfig);
+	/* Timer config failure is critical error, force system reboot */
+    if (status != CY_U3P_SUCCESS)
+    {
+    	AdiLogError(Main_c, __LINE__, status);
+    	AdiAppErrorHandler(status);
+    	return;
+    }
+
+    /* Save bitmask of the timer pin config */
+    FX3State.TimerPinConfig = (GPIO->lpp_gpio_pin[ADI_TIMER_PIN_INDEX].status & ~CY_U3P_LPP_GPIO_INTR);
+
+    /* Boot timing origin (first init only) */
+    AdiBootCheckpoint(BootCheckpointTimer);
+
+    /* Start the SPI module and configure the FX3 as a master.
+     * As with the GPIO configuration, SPI also relies on the io matrix to be correct. */
+    status = CyU3PSpiInit();
+    if (status != CY_U3P_SUCCESS)
+    {
+    	AdiLogError(Main_c, __LINE__, status);
+    	AdiAppErrorHandler(status);
+    	return;
+    }
+
+}
+
+/**
+  * @brief This function stops the FX3 peripherals started by AdiBoardInit. Used by the fatal error recovery.
+  *
+  * @returns void
+  *
+  * The I2C, SPI and GPIO blocks are de-initialized, so the next AdiBoardInit call starts them
+  * from reset. The event groups are kept, since the AppThread and StreamThread wait on them.
+ **/
+void AdiBoardDeInit()
+{
+	/* Clean up I2C (DUT and flash) */
+	CyU3PI2cDeInit();
+
+	/* Clean up SPI */
+	CyU3PSpiDeInit();
+
+	/* Clean up GPIO (including the 10MHz timer) */
+	CyU3PGpioDeInit();
+}
+
+/**
+  * @brief This function creates the global event groups. Called once at boot.
+  *
+  * @returns void
+  *
+  * The event groups are created once, before AdiBoardInit, and are never destroyed. The
+  * threads wait on them for the whole run time of the firmware.
+ **/
+void AdiEventInit()
+{
+	CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
+
+	/* Create the stream/general use event handler */
+	status = CyU3PEventCreate(&EventHandler);
+    if (status != CY_U3P_SUCCESS)
+    {
+    	AdiLogError(Main_c, __LINE__, status);
+    	AdiAppErrorHandler(status);
+    	return;
+    }
+
+	/* Create GPIO event handler */
+	status = CyU3PEventCreate(&GpioHandler);
+    if (status != CY_U3P_SUCCESS)
+    {
+    	AdiLogError(Main_c, __LINE__, status);
+    	AdiAppErrorHandler(status);
+    }
+}
+
+/**
+  * @brief This function sets up the necessary resources to start the ADI application.
+  *
+  * @returns void
+  *
+  * The application startup process restores the default GPIO pin states and board settings, and
+  * configures the USB endpoints and DMA channels for the connection speed. The peripherals themselves
+  * are initialized once at boot, by AdiBoardInit. If a valid configuration block is stored in flash,
+  * it is used in place of the firmware default SPI, DUT, I2C and watchdog settings. After all
+  * configuration is performed, the AppActive flag is set to true. Each step is recorded with
+  * AdiStartupCheckpoint.
+ **/
+void AdiAppStart()
+{
+	CyU3PUSBSpeed_t usbSpeed = CyU3PUsbGetSpeed();
+	CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
+	CyU3PGpioSimpleConfig_t gpioConfig;
+	CyBool_t configLoaded;
+
+    /* Based on the Bus Speed configure the endpoint packet size */
+    switch (usbSpeed)
+    {
+        case CY_U3P_FULL_SPEED:
+        	FX3State.UsbBufferSize = 64;
+            CyU3PDebugPrint (4, "Connected at USB 1.0 speed.\r\n");
+            break;
+
+        case CY_U3P_HIGH_SPEED:
+        	FX3State.UsbBufferSize = 512;
+            CyU3PDebugPrint (4, "Connected at USB 2.0 speed.\r\n");
+            break;
+
+        case  CY_U3P_SUPER_SPEED:
+        	FX3State.UsbBufferSize = 1024;
+            CyU3PDebugPrint (4, "Connected at USB 3.0 speed.\r\n");
+            break;
+
+        default:
+        	/* Invalid USB speed */
+        	AdiLogError(Main_c, __LINE__, status);
+            AdiAppErrorHandler (CY_U3P_ERROR_FAILURE);
+            return;
+    }
+
+    AdiStartupCheckpoint(CheckpointSpeed);
+
+	/* Restore the default configuration for each GPIO overridden by AdiBoardInit */
 	CyU3PMemSet ((uint8_t *)&gpioConfig, 0, sizeof (gpioConfig));
 	gpioConfig.outValue = CyFalse;
 	gpioConfig.inputEn = CyTrue;
@@ -1119,30 +1542,6 @@ void AdiAppStart()
     	AdiLogError(Main_c, __LINE__, status);
     }
 
-	/* Configure high-speed, high-resolution timer using a complex GPIO */
-	CyU3PGpioComplexConfig_t gpioComplexConfig;
-	CyU3PMemSet ((uint8_t *)&gpioComplexConfig, 0, sizeof (gpioComplexConfig));
-	gpioComplexConfig.outValue = CyFalse;
-	gpioComplexConfig.inputEn = CyFalse;
-	gpioComplexConfig.driveLowEn = CyTrue;
-	gpioComplexConfig.driveHighEn = CyTrue;
-	gpioComplexConfig.pinMode = CY_U3P_GPIO_MODE_STATIC;
-	gpioComplexConfig.intrMode = CY_U3P_GPIO_NO_INTR;
-	gpioComplexConfig.timerMode = CY_U3P_GPIO_TIMER_LOW_FREQ;
-	gpioComplexConfig.timer = 0;
-	gpioComplexConfig.period = 0xFFFFFFFF;
-	gpioComplexConfig.threshold = 0xFFFFFFFF;
-	status = CyU3PGpioSetComplexConfig(ADI_TIMER_PIN, &gpioComplexConfig);
-	/* Timer config failure is critical error, force system reboot */
-    if (status != CY_U3P_SUCCESS)
-    {
-    	AdiLogError(Main_c, __LINE__, status);
-    	AdiAppErrorHandler(status);
-    }
-
-    /* Save bitmask of the timer pin config */
-    FX3State.TimerPinConfig = (GPIO->lpp_gpio_pin[ADI_TIMER_PIN_INDEX].status & ~CY_U3P_LPP_GPIO_INTR);
-
     /* Configure the SPI controller */
 
     /* Set the stall time in microseconds */
@@ -1172,43 +1571,29 @@ void AdiAppStart()
     FX3State.SpiConfig.clock      = 2000000;
     FX3State.SpiConfig.wordLen    = 16;
 
-    /* Start the SPI module and configure the FX3 as a master.
-     * As with the GPIO configuration, SPI also relies on the io matrix to be correct. */
-    status = CyU3PSpiInit();
-    if (status != CY_U3P_SUCCESS)
-    {
-    	AdiLogError(Main_c, __LINE__, status);
-    	AdiAppErrorHandler(status);
-    }
+    /* Set the default I2C configuration */
+    FX3State.I2CBitRate = 100000;
+    FX3State.I2CRetryCount = 0;
+
+    /* Override the defaults with the configuration stored in flash, if present */
+    configLoaded = AdiLoadConfig();
 
     status = CyU3PSpiSetConfig (&FX3State.SpiConfig, NULL);
     if (status != CY_U3P_SUCCESS)
     {
     	AdiLogError(Main_c, __LINE__, status);
     	AdiAppErrorHandler(status);
+    	return;
     }
 
     /* Configure I2C */
-    FX3State.I2CBitRate = 100000;
-    AdiI2CInit(100000, CyFalse);
-
-    /* Configure global, user event flags */
+    AdiI2CInit(FX3State.I2CBitRate, CyFalse);
 
-	/* Create the stream/general use event handler */
-	status = CyU3PEventCreate(&EventHandler);
-    if (status != CY_U3P_SUCCESS)
-    {
-    	AdiLogError(Main_c, __LINE__, status);
-    	AdiAppErrorHandler(status);
-    }
+    /* Apply the stored watchdog configuration */
+    if(configLoaded)
+    	AdiConfigureWatchdog();
 
-	/* Create GPIO event handler */
-	status = CyU3PEventCreate(&GpioHandler);
-    if (status != CY_U3P_SUCCESS)
-    {
-    	AdiLogError(Main_c, __LINE__, status);
-    	AdiAppErrorHandler(status);
-    }
+    AdiStartupCheckpoint(CheckpointPeripherals);
 
     /* Configure bulk endpoints */
 
@@ -1228,6 +1613,7 @@ void AdiAppStart()
     {
     	AdiLogError(Main_c, __LINE__, status);
     	AdiAppErrorHandler(status);
+    	return;
     }
 
 	/* Set endpoint config for the PC to FX3 endpoint */
@@ -1236,6 +1622,7 @@ void AdiAppStart()
     {
     	AdiLogError(Main_c, __LINE__, status);
     	AdiAppErrorHandler(status);
+    	return;
     }
 
 	/* Set endpoint config for the FX3 to PC endpoint */
@@ -1244,6 +1631,7 @@ void AdiAppStart()
     {
     	AdiLogError(Main_c, __LINE__, status);
     	AdiAppErrorHandler(status);
+    	return;
     }
 
 	/* Flush endpoint memory */
@@ -1251,6 +1639,8 @@ void AdiAppStart()
 	CyU3PUsbFlushEp(ADI_FROM_PC_ENDPOINT);
 	CyU3PUsbFlushEp(ADI_TO_PC_ENDPOINT);
 
+    AdiStartupCheckpoint(CheckpointEndpoints);
+
 	/* Configure DMAs */
 
     CyU3PDmaChannelConfig_t dmaConfig;
@@ -1273,6 +1663,7 @@ void AdiAppStart()
     {
     	AdiLogError(Main_c, __LINE__, status);
     	AdiAppErrorHandler(status);
+    	return;
     }
 
     /* Configure DMA for ChannelToPC */
@@ -1284,11 +1675,20 @@ void AdiAppStart()
     {
     	AdiLogError(Main_c, __LINE__, status);
     	AdiAppErrorHandler(status);
+    	return;
     }
 
+    AdiStartupCheckpoint(CheckpointDma);
+
     /* Set app active flag */
     FX3State.AppActive = CyTrue;
 
+    /* Run the stored boot script (first start after boot only) */
+    AdiBootScriptAppStart();
+
+    /* Confirm the image slot the firmware was booted from (first start after boot only) */
+    AdiBootSlotAppStart();
+
     /*Print verbose mode message */
 #ifdef VERBOSE_MODE
     CyU3PDebugPrint (4, "Verbose mode enabled. Device status will be logged to the serial output.\r\n");
@@ -1300,6 +1700,254 @@ void AdiAppStart()
 
     /*Print boot message */
     CyU3PDebugPrint (4, "Analog Devices iSensor FX3 Demonstration Platform started successfully!\r\n");
+
+    AdiStartupCheckpoint(CheckpointActive);
+#ifdef VERBOSE_MODE
+    CyU3PDebugPrint (4, "Application start took %d us\r\n", AdiStartupElapsedUs(CheckpointActive));
+#endif
+}
+
+/**
+  * @brief Records a startup timing checkpoint.
+  *
+  * @param Point The checkpoint to record
+  *
+  * @returns void
+  *
+  * Checkpoints are sampled from the 10MHz timer (ADI_TIMER_PIN), which runs from boot. Recording
+  * CheckpointStartRequest clears the other checkpoints. CheckpointFirstCommand is only recorded
+  * for the first vendor command after each start.
+  *
+  * The checkpoints of the first application start after boot are also kept, relative to the boot
+  * timing origin, until the second start request (or a soft restart, which resets the timer).
+ **/
+void AdiStartupCheckpoint(StartupCheckpoint Point)
+{
+	uint32_t ticks = 0;
+
+	if(Point >= STARTUP_CHECKPOINT_COUNT)
+		return;
+
+	if(Point == CheckpointStartRequest)
+	{
+		StartupRecorded = 0;
+		if(BootPathRecorded & (1 << CheckpointStartRequest))
+			BootPathOpen = CyFalse;
+	}
+	else if((Point == CheckpointFirstCommand) && (StartupRecorded & (1 << CheckpointFirstCommand)))
+		return;
+
+	CyU3PGpioComplexSampleNow(ADI_TIMER_PIN, &ticks);
+	StartupTicks[Point] = ticks;
+	StartupRecorded |= (1 << Point);
+
+	if(BootPathOpen)
+	{
+		BootPathTicks[Point] = ticks;
+		BootPathRecorded |= (1 << Point);
+	}
+}
+
+/**
+  * @brief Records a boot timing checkpoint.
+  *
+  * @param Point The checkpoint to record
+  *
+  * @returns void
+  *
+  * Each boot checkpoint is only recorded once per boot. BootCheckpointTimer is the origin for the
+  * boot timing. The RTOS time is saved with it, so the boot timing is reported from the RTOS start,
+  * and starts recording the first application start after boot.
+ **/
+void AdiBootCheckpoint(BootCheckpoint Point)
+{
+	uint32_t ticks = 0;
+
+	if((Point >= BOOT_CHECKPOINT_COUNT) || (BootRecorded & (1 << Point)))
+		return;
+
+	CyU3PGpioComplexSampleNow(ADI_TIMER_PIN, &ticks);
+	BootTicks[Point] = ticks;
+	BootRecorded |= (1 << Point);
+
+	if(Point == BootCheckpointTimer)
+	{
+		BootTimerStartMs = CyU3PGetTime();
+		BootPathOpen = CyTrue;
+	}
+}
+
+/**
+  * @brief Gets the time from the last start request to a startup checkpoint.
+  *
+  * @param Point The checkpoint to get the elapsed time for
+  *
+  * @returns The elapsed time in microseconds, or 0 if the checkpoint has not been recorded
+ **/
+uint32_t AdiStartupElapsedUs(StartupCheckpoint Point)
+{
+	uint32_t ticks;
+
+	if((Point >= STARTUP_CHECKPOINT_COUNT) || !(StartupRecorded & (1 << Point)) || !(StartupRecorded & (1 << CheckpointStartRequest)))
+		return 0;
+
+	ticks = StartupTicks[Point] - StartupTicks[CheckpointStartRequest];
+	return (uint32_t)(((uint64_t)ticks * 1000) / MS_TO_TICKS_MULT);
+}
+
+/**
+  * @brief Converts a 10MHz timer value recorded during boot to the time since the RTOS start.
+  *
+  * @param Ticks The timer value, recorded after the boot timing origin
+  *
+  * @returns The time since the RTOS start, in microseconds
+ **/
+static uint32_t AdiBootElapsedUs(uint32_t Ticks)
+{
+	uint32_t ticks = Ticks - BootTicks[BootCheckpointTimer];
+	return (BootTimerStartMs * 1000) + (uint32_t)(((uint64_t)ticks * 1000) / MS_TO_TICKS_MULT);
+}
+
+/**
+  * @brief Sends the startup timing checkpoints for the last application start to the host.
+  *
+  * @param RequestLength The number of bytes requested by the host
+  *
+  * @return A status code indicating the success of the function
+  *
+  * The response is structured as follows:
+  *
+  * Status (0 - 3), Elapsed time from the start request to each checkpoint, in microseconds, in
+  * StartupCheckpoint order (4 bytes each, starting at byte 4). Checkpoints which have not been
+  * recorded read as 0.
+  *
+  * The boot timing (the plug-in path) follows, as the time in microseconds since the RTOS start:
+  * each BootCheckpoint (4 bytes each, starting at byte 36), then each StartupCheckpoint of the
+  * first application start after boot (4 bytes each, starting at byte 44). 76 bytes in total.
+ **/
+CyU3PReturnStatus_t AdiGetStartupTiming(uint16_t RequestLength)
+{
+	uint32_t elapsedUs;
+	uint32_t offset = 4;
+
+	for(uint32_t point = 0; point < STARTUP_CHECKPOINT_COUNT; point++)
+	{
+		elapsedUs = AdiStartupElapsedUs((StartupCheckpoint) point);
+		CyU3PMemCopy(USBBuffer + offset, (uint8_t *)&elapsedUs, 4);
+		offset += 4;
+	}
+
+	for(uint32_t point = 0; point < BOOT_CHECKPOINT_COUNT; point++)
+	{
+		elapsedUs = 0;
+		if(BootRecorded & (1 << point))
+			elapsedUs = AdiBootElapsedUs(BootTicks[point]);
+		CyU3PMemCopy(USBBuffer + offset, (uint8_t *)&elapsedUs, 4);
+		offset += 4;
+	}
+
+	for(uint32_t point = 0; point < STARTUP_CHECKPOINT_COUNT; point++)
+	{
+		elapsedUs = 0;
+		if(BootPathRecorded & (1 << point))
+			elapsedUs = AdiBootElapsedUs(BootPathTicks[point]);
+		CyU3PMemCopy(USBBuffer + offset, (uint8_t *)&elapsedUs, 4);
+		offset += 4;
+	}
+
+	AdiSendStatus(CY_U3P_SUCCESS, RequestLength, CyTrue);
+	return CY_U3P_SUCCESS;
+}
+
+/**
+  * @brief Fills a thread stack with the stack fill pattern, before the thread is created.
+  *
+  * @param Stack Pointer to the stack base (lowest address). Must be 4-byte aligned
+  *
+  * @param StackSize The stack size, in bytes
+  *
+  * @return void
+ **/
+static void AdiPaintStack(uint8_t* Stack, uint32_t StackSize)
+{
+	uint32_t * word = (uint32_t *) Stack;
+
+	for(uint32_t i = 0; i < (StackSize >> 2); i++)
+	{
+		word[i] = ADI_STACK_FILL;
+	}
+}
+
+/**
+  * @brief Measures the high water mark of a thread stack filled using AdiPaintStack.
+  *
+  * @param Stack Pointer to the stack base (lowest address)
+  *
+  * @param StackSize The stack size, in bytes
+  *
+  * @return The most stack space used by the thread since it was created, in bytes
+  *
+  * The stack grows down, so the stack is scanned up from the base until the first word
+  * which no longer holds the fill pattern. A return value equal to the stack size means
+  * the thread has used the whole stack, and has most likely overflowed it.
+ **/
+uint32_t AdiGetStackUsage(uint8_t* Stack, uint32_t StackSize)
+{
+	uint32_t * word = (uint32_t *) Stack;
+	uint32_t unused = 0;
+
+	if(Stack == NULL)
+		return 0;
+
+	while((unused < (StackSize >> 2)) && (word[unused] == ADI_STACK_FILL))
+	{
+		unused++;
+	}
+
+	return StackSize - (unused << 2);
+}
+
+/**
+  * @brief Sends the thread stack high water marks and the heap usage to the host.
+  *
+  * @param RequestLength The number of bytes requested by the host
+  *
+  * @return CY_U3P_SUCCESS
+  *
+  * The response is structured as follows:
+  *
+  * Status (0 - 3), AppThread stack size (4 - 7), AppThread stack high water mark (8 - 11),
+  * StreamThread stack size (12 - 15), StreamThread stack high water mark (16 - 19),
+  * Memory heap size (20 - 23), Memory heap bytes in use (24 - 27), Memory heap peak bytes in use (28 - 31),
+  * Buffer heap size (32 - 35), Buffer heap bytes in use (36 - 39), Buffer heap peak bytes in use (40 - 43),
+  * Buffer heap free bytes (44 - 47), Buffer heap largest free block (48 - 51)
+  *
+  * The status is CY_U3P_ERROR_NOT_SUPPORTED if the SDK memory checks (cyfxtx.c) are not available. The
+  * heap usage values read as 0 in that case, and the stack values are still valid.
+ **/
+CyU3PReturnStatus_t AdiGetMemoryStatus(uint16_t RequestLength)
+{
+	CyU3PReturnStatus_t status, bufStatus;
+	uint32_t values[12] = {0};
+
+	values[0] = APPTHREAD_STACK;
+	values[1] = AdiGetStackUsage(AppThreadStack, APPTHREAD_STACK);
+	values[2] = STREAMTHREAD_STACK;
+	values[3] = AdiGetStackUsage(StreamThreadStack, STREAMTHREAD_STACK);
+
+	status = CyU3PMemGetUsage(&values[4], &values[5], &values[6]);
+	bufStatus = CyU3PBufGetUsage(&values[7], &values[8], &values[9]);
+	if(status == CY_U3P_SUCCESS)
+		status = bufStatus;
+
+	/* Free space is read from the buffer manager bitmap, and does not need the memory checks */
+	CyU3PDmaBufferGetFreeSpace(&values[10], &values[11]);
+
+	CyU3PMemCopy(USBBuffer + 4, (uint8_t *) values, sizeof(values));
+	AdiSendStatus(status, RequestLength, CyTrue);
+
+	/* The memory check status is reported in the response, so the request is never stalled */
+	return CY_U3P_SUCCESS;
 }
 
 /**
@@ -1392,8 +2040,24 @@ void CyFxApplicationDefine (void)
     void *ptr = NULL;
     uint32_t retThrdCreate = CY_U3P_SUCCESS;
 
+    /* Create the error log mutex before any thread can log an error */
+    if (AdiErrorLogInit() != CY_U3P_SUCCESS)
+    {
+    	/* Mutex creation failed. Fatal error. Cannot continue. */
+    	while(1);
+    }
+
     /* Create application (main) thread */
     ptr = CyU3PMemAlloc (APPTHREAD_STACK);
+    if (ptr == NULL)
+    {
+    	/* Stack allocation failed. Fatal error. Cannot continue. */
+    	while(1);
+    }
+
+    /* Fill the stack so the high water mark can be measured */
+    AppThreadStack = (uint8_t *) ptr;
+    AdiPaintStack(AppThreadStack, APPTHREAD_STACK);
 
     /* Create the thread for the application */
     retThrdCreate = CyU3PThreadCreate (&AppThread, /* Thread structure. */
@@ -1419,6 +2083,15 @@ void CyFxApplicationDefine (void)
 
     /* Create the thread for streaming data */
     ptr = CyU3PMemAlloc (STREAMTHREAD_STACK);
+    if (ptr == NULL)
+    {
+    	/* Stack allocation failed. Fatal error. Cannot continue. */
+    	while(1);
+    }
+
+    /* Fill the stack so the high water mark can be measured */
+    StreamThreadStack = (uint8_t *) ptr;
+    AdiPaintStack(StreamThreadStack, STREAMTHREAD_STACK);
 
     /* Create the streaming thread */
     retThrdCreate = CyU3PThreadCreate (&StreamThread, 	/* Thread structure. */
@@ -25,6 +25,13 @@
  */
 //#define VERBOSE_MODE									(0)
 
+/*
+ * This macro enables the stream timing jitter histograms (ADI_GET_STREAM_JITTER) during compile time.
+ * It samples the 10MHz timer for every SPI word in the generic stream, so it adds time to each word.
+ * Ensure that it is commented out for release versions.
+ */
+//#define STREAM_JITTER_STATS							(0)
+
 /* Include all needed Cypress libraries */
 #include "cyu3types.h"
 #include "cyu3usbconst.h"
@@ -44,6 +51,19 @@
 #include "stdlib.h"
 #include "sys/unistd.h"
 
+/*
+ * Places a timing critical function in the ARM926 I-TCM, using the section which the SDK
+ * linker script (fx3.ld) maps to I-TCM. Code in I-TCM runs at core speed with no I-cache
+ * misses, which removes the jitter seen when a stream loop is evicted from the I-cache.
+ * The 16KB I-TCM is shared with the SDK interrupt handlers, so only the stream inner loops
+ * and the interrupt handlers which they depend on should be placed here.
+ *
+ * I-TCM (0x100) is out of branch range of SYSMEM (0x40003000), so long_call is used for
+ * calls into these functions. Apply the macro to both the prototype and the definition.
+ * Calls from I-TCM back out to SYSMEM (SDK APIs) go through linker generated veneers.
+ */
+#define ADI_ITCM_CODE									__attribute__((section("CYU3P_ITCM_SECTION"), long_call))
+
 /* Include all Analog Devices produced project header files */
 #include "AppThread.h"
 #include "PinFunctions.h"
@@ -54,6 +74,10 @@
 #include "ErrorLog.h"
 #include "I2cFunctions.h"
 #include "HelperFunctions.h"
+#include "ConfigStore.h"
+#include "Journal.h"
+#include "BootScript.h"
+#include "BootSlot.h"
 
 /* Lower level register access includes */
 #include "gpio_regs.h"
@@ -143,6 +167,75 @@ typedef struct FX3PinMap
 	uint16_t FX3_PIN_GPIO4;
 }FX3PinMap;
 
+/** Minimum time (ms) between application soft restarts. A repeat error inside this window causes a reset */
+#define RECOVERY_HOLDOFF_MS						5000
+
+/** Delay (ms) before a recovery reset, to allow the debug UART and flash writes to finish */
+#define RECOVERY_FLUSH_DELAY_MS					50
+
+/** Fill pattern written to the AppThread and StreamThread stacks before they are started (stack high water mark) */
+#define ADI_STACK_FILL							(0xEFEFEFEF)
+
+/** Number of startup timing checkpoints */
+#define STARTUP_CHECKPOINT_COUNT				8
+
+/** @brief Application startup timing checkpoints, recorded by AdiStartupCheckpoint */
+typedef enum StartupCheckpoint
+{
+	/** 0 Application start requested (USB SET_CONFIGURATION, or a soft restart) */
+	CheckpointStartRequest = 0,
+
+	/** 1 Previous application instance stopped */
+	CheckpointStopped,
+
+	/** 2 USB speed checked (start of AdiAppStart) */
+	CheckpointSpeed,
+
+	/** 3 GPIO, board settings, SPI, I2C and watchdog configured */
+	CheckpointPeripherals,
+
+	/** 4 Bulk endpoints configured */
+	CheckpointEndpoints,
+
+	/** 5 DMA channels created */
+	CheckpointDma,
+
+	/** 6 Application active (end of AdiAppStart) */
+	CheckpointActive,
+
+	/** 7 First vendor command received after the start */
+	CheckpointFirstCommand
+
+}StartupCheckpoint;
+
+/** Number of boot timing checkpoints */
+#define BOOT_CHECKPOINT_COUNT					2
+
+/** @brief Boot timing checkpoints, before the first application start. Recorded once per boot by AdiBootCheckpoint */
+typedef enum BootCheckpoint
+{
+	/** 0 10MHz timer started (AdiBoardInit). Origin of the 10MHz timer boot timing */
+	BootCheckpointTimer = 0,
+
+	/** 1 USB pins connected (end of AdiAppInit) */
+	BootCheckpointConnect
+
+}BootCheckpoint;
+
+/** @brief Recovery strategy used by AdiAppErrorHandler for fatal application errors */
+typedef enum RecoveryMode
+{
+	/** 0 Soft restart of the application and peripherals (AdiAppRecover), then reset if the error repeats */
+	RecoverySoftRestart = 0,
+
+	/** 1 Reset the FX3 immediately (after flushing the error log) */
+	RecoveryReset,
+
+	/** 2 Legacy behavior. Wait five seconds, then reset the FX3 */
+	RecoveryDelayedReset
+
+}RecoveryMode;
+
 /** @brief Struct to store the current board state (SPI config, USB speed, etc) */
 typedef struct BoardState
 {
@@ -200,6 +293,9 @@ typedef struct BoardState
 	/** I2C retry count after slave device sends NAK */
 	uint16_t I2CRetryCount;
 
+	/** Fatal error recovery strategy */
+	RecoveryMode Recovery;
+
 }BoardState;
 
 /** @brief Struct to store the current data stream state information */
@@ -334,6 +430,24 @@ typedef struct StreamState
 /** Set GPIO resistor pull up or pull down */
 #define ADI_SET_PIN_RESISTOR					(0xD2)
 
+/** Get the stream resume status, optionally enabling stream resume after a USB reset */
+#define ADI_STREAM_RESUME_CONFIG				(0xD3)
+
+/** Get the startup timing checkpoints for the last application start */
+#define ADI_GET_STARTUP_TIMING					(0xD4)
+
+/** Get the stream memory arena usage, optionally clearing the high water mark */
+#define ADI_STREAM_ARENA_STATUS					(0xD5)
+
+/** Get the stream DMA buffer depth status, optionally setting the max DMA buffer depth */
+#define ADI_STREAM_DMA_CONFIG					(0xD6)
+
+/** Get the thread stack high water marks and the heap and buffer heap peak usage */
+#define ADI_GET_MEMORY_STATUS					(0xD7)
+
+/** Get the generic and burst stream timing jitter histograms (STREAM_JITTER_STATS builds only) */
+#define ADI_GET_STREAM_JITTER					(0xD8)
+
 /** Read a word at a specified address and return the data over the control endpoint */
 #define ADI_READ_BYTES							(0xF0)
 
@@ -346,6 +460,39 @@ typedef struct StreamState
 /** Read flash memory */
 #define ADI_READ_FLASH							(0xF3)
 
+/** Set the error log flash write rate limit */
+#define ADI_SET_ERROR_LOG_RATE					(0xF4)
+
+/** Stream the valid portion of the flash error log over the bulk endpoint */
+#define ADI_DUMP_ERROR_LOG						(0xF5)
+
+/** Read an arbitrary length block of flash over the bulk endpoint */
+#define ADI_BULK_READ_FLASH						(0xF6)
+
+/** Save the current board configuration to flash */
+#define ADI_SAVE_CONFIG							(0xF7)
+
+/** Restore the stored board configuration, or clear it (defaults on next boot) */
+#define ADI_RESTORE_CONFIG						(0xF8)
+
+/** Write (or clear) the flash stored DUT boot script */
+#define ADI_WRITE_BOOT_SCRIPT					(0xF9)
+
+/** Get the boot script status, optionally running the stored script */
+#define ADI_BOOT_SCRIPT_STATUS					(0xFA)
+
+/** Get the A/B firmware image slot status */
+#define ADI_BOOT_SLOT_STATUS					(0xFB)
+
+/** Program a stored image (slot in value) from the bulk endpoint */
+#define ADI_IMAGE_UPDATE_START					(0xFC)
+
+/** Get the stored image update status */
+#define ADI_IMAGE_UPDATE_STATUS					(0xFD)
+
+/** Get the fatal error recovery status, optionally setting the recovery mode */
+#define ADI_RECOVERY_CONFIG						(0xFE)
+
 /** Used to transfer bytes without any intervention/protocol management */
 #define ADI_TRANSFER_BYTES						(0xCA)
 
@@ -431,17 +578,34 @@ extern const uint8_t CyFxUSBProductDscr[];
 extern uint8_t CyFxUSBSerialNumDesc[];
 
 /* Initialization and configuration functions. */
+void AdiEventInit();
+void AdiBoardInit();
+void AdiBoardDeInit();
 void AdiAppStart();
 void AdiAppStop();
+void AdiStartupCheckpoint(StartupCheckpoint Point);
+void AdiBootCheckpoint(BootCheckpoint Point);
+uint32_t AdiStartupElapsedUs(StartupCheckpoint Point);
+CyU3PReturnStatus_t AdiGetStartupTiming(uint16_t RequestLength);
+uint32_t AdiGetStackUsage(uint8_t* Stack, uint32_t StackSize);
+CyU3PReturnStatus_t AdiGetMemoryStatus(uint16_t RequestLength);
 void AdiAppErrorHandler (CyU3PReturnStatus_t status);
+void AdiAppRecover();
+void AdiRecoveryInit();
+CyU3PReturnStatus_t AdiRecoveryConfig(uint16_t SetMode, uint16_t Mode, uint16_t RequestLength);
 FX3BoardType AdiGetFX3BoardType();
 
+/* Memory manager functions (cyfxtx.c) */
+CyU3PReturnStatus_t CyU3PDmaBufferGetFreeSpace(uint32_t *free_p, uint32_t *largest_p);
+CyU3PReturnStatus_t CyU3PMemGetUsage(uint32_t *size_p, uint32_t *inUse_p, uint32_t *peak_p);
+CyU3PReturnStatus_t CyU3PBufGetUsage(uint32_t *size_p, uint32_t *inUse_p, uint32_t *peak_p);
+
 /* Event Handlers */
 CyBool_t AdiControlEndpointHandler(uint32_t setupdat0, uint32_t setupdat1);
 void AdiBulkEndpointHandler(CyU3PUsbEpEvtType evType,CyU3PUSBSpeed_t usbSpeed, uint8_t epNum);
 void AdiUSBEventHandler(CyU3PUsbEventType_t evtype, uint16_t evdata);
 CyBool_t AdiLPMRequestHandler(CyU3PUsbLinkPowerMode link_mode);
-void AdiGPIOEventHandler(uint8_t gpioId);
+ADI_ITCM_CODE void AdiGPIOEventHandler(uint8_t gpioId);
 
 #include <cyu3externcend.h>
 
@@ -0,0 +1,160 @@
+/*
+ * boot_image.c
+ *
+ *  Created on: Oct 17, 2020
+ *      Author: A. Nolan
+ *
+ *  Image section decoding and verification for the bulk image download path.
+ */
+
+#include "cyfx3device.h"
+#include "cyfx3utils.h"
+#include "main.h"
+
+/* CRC32 lookup table, built on first use */
+static uint32_t glCrcTable[256];
+static uint8_t  glCrcTableValid = 0;
+
+/* Reads an LZ4 length extension (a run of bytes, terminated by a byte which is not 255).
+   Returns -1 if the extension runs past the end of the source data. */
+static int
+myLz4ReadLength (
+        const uint8_t **src_pp,
+        const uint8_t *srcEnd_p,
+        uint32_t *len_p
+        )
+{
+    uint8_t b;
+
+    do
+    {
+        if (*src_pp >= srcEnd_p)
+        {
+            return -1;
+        }
+        b = *(*src_pp)++;
+        *len_p += b;
+    } while (b == 255);
+
+    return 0;
+}
+
+/* Decompresses a single LZ4 block (standard LZ4 block format, no frame header).
+
+   Every sequence is bounds checked against both the source and the destination, so a corrupt
+   or truncated section can never write outside of [dst_p, dst_p + dstLen).
+
+   Return Value:
+    Number of bytes written to dst_p
+   -1 - Source data is not a valid LZ4 block, or does not fit in the destination
+*/
+int
+myLz4Decompress (
+        const uint8_t *src_p,
+        uint32_t srcLen,
+        uint8_t *dst_p,
+        uint32_t dstLen
+        )
+{
+    const uint8_t *srcEnd_p = src_p + srcLen;
+    uint8_t *out_p = dst_p;
+    uint8_t *outEnd_p = dst_p + dstLen;
+    const uint8_t *match_p;
+    uint32_t len;
+    uint32_t offset;
+    uint8_t token;
+
+    while (src_p < srcEnd_p)
+    {
+        token = *src_p++;
+
+        /* Literal run */
+        len = token >> 4;
+        if ((len == 15) && (myLz4ReadLength (&src_p, srcEnd_p, &len) < 0))
+        {
+            return -1;
+        }
+        if ((len > (uint32_t)(srcEnd_p - src_p)) || (len > (uint32_t)(outEnd_p - out_p)))
+        {
+            return -1;
+        }
+        CyFx3BootMemCopy (out_p, (uint8_t *)src_p, len);
+        src_p += len;
+        out_p += len;
+
+        /* The last sequence of a block only carries literals */
+        if (src_p == srcEnd_p)
+        {
+            break;
+        }
+
+        /* Match copy */
+        if ((srcEnd_p - src_p) < 2)
+        {
+            return -1;
+        }
+        offset = src_p[0] | (src_p[1] << 8);
+        src_p += 2;
+        if ((offset == 0) || (offset > (uint32_t)(out_p - dst_p)))
+        {
+            return -1;
+        }
+
+        len = token & 0xF;
+        if ((len == 15) && (myLz4ReadLength (&src_p, srcEnd_p, &len) < 0))
+        {
+            return -1;
+        }
+        len += 4;
+        if (len > (uint32_t)(outEnd_p - out_p))
+        {
+            return -1;
+        }
+
+        /* Matches may overlap the output (offset < len), so copy forwards a byte at a time */
+        match_p = out_p - offset;
+        while (len--)
+        {
+            *out_p++ = *match_p++;
+        }
+    }
+
+    return (int)(out_p - dst_p);
+}
+
+/* Calculates a CRC32 (IEEE 802.3, reflected, polynomial 0xEDB88320) over a block of memory. This matches
+   the CRC32 used by the FX3 application firmware, and most host CRC32 implementations.
+
+   Pass crc = 0 to start a new calculation, or a previous result to continue it. The table is built the
+   first time the function is called, rather than stored in the bootloader image.
+*/
+uint32_t
+myCrc32 (
+        uint32_t crc,
+        const uint8_t *buf_p,
+        uint32_t len
+        )
+{
+    uint32_t i, bit, val;
+
+    if (!glCrcTableValid)
+    {
+        for (i = 0; i < 256; i++)
+        {
+            val = i;
+            for (bit = 0; bit < 8; bit++)
+            {
+                val = (val & 1) ? ((val >> 1) ^ 0xEDB88320) : (val >> 1);
+            }
+            glCrcTable[i] = val;
+        }
+        glCrcTableValid = 1;
+    }
+
+    crc = ~crc;
+    while (len--)
+    {
+        crc = glCrcTable[(crc ^ *buf_p++) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
@@ -0,0 +1,84 @@
+/*
+ * boot_slot.c
+ *
+ *  Created on: Oct 17, 2020
+ *      Author: A. Nolan
+ *
+ *  Stored firmware image slot selection. These functions only look at the slot headers and the reset cause,
+ *  and do no I/O, so the selection can be built and tested on a host (tools/test/test_slot.c).
+ */
+
+#include "cyfx3device.h"
+#include "cyfx3utils.h"
+#include "main.h"
+
+/* Function to validate an image slot header, as read from the EEPROM.
+
+   Return Value:
+    0 - Header is valid
+   -1 - No valid image in the slot
+*/
+int
+myCheckSlotHeader (
+        const BootSlotHeader_t *header_p
+        )
+{
+    if ((header_p->magic != BOOT_SLOT_MAGIC) ||
+            (header_p->headerCrc != myCrc32 (0, (const uint8_t *)header_p, 16)) ||
+            (header_p->length < SECTION_HEADER_SIZE) || (header_p->length > BOOT_SLOT_SIZE))
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
+/* Function to select the image slots to try, in order.
+
+   A software reset (the host resetting the board into the bootloader) selects no slot, so the USB bootloader
+   starts, unless the application left a boot request. Otherwise the valid slots are tried newest first (the
+   sequence compare handles wrap). An unconfirmed slot which has used up its BOOT_SLOT_MAX_TRIES boot attempts
+   (or was rejected) is skipped, so the bootloader falls back to the other slot.
+
+   Return Value:
+    Number of slots to try, with the slot numbers in order_p (BOOT_SLOT_COUNT entries)
+*/
+uint32_t
+mySelectBootSlots (
+        const BootSlotHeader_t *header_p,
+        const int *valid_p,
+        uint32_t resetCause,
+        CyBool_t bootRequest,
+        uint32_t *order_p
+        )
+{
+    uint32_t first = 0;
+    uint32_t count = 0;
+    uint32_t i, slot;
+
+    if ((resetCause & GCTL_CONTROL_SW_RESET) && (!bootRequest))
+    {
+        return 0;
+    }
+
+    if (valid_p[0] && valid_p[1] && ((int32_t)(header_p[0].sequence - header_p[1].sequence) < 0))
+    {
+        first = 1;
+    }
+
+    for (i = 0; i < BOOT_SLOT_COUNT; i++)
+    {
+        slot = (first + i) % BOOT_SLOT_COUNT;
+        if (!valid_p[slot])
+        {
+            continue;
+        }
+        if ((header_p[slot].confirmed != BOOT_SLOT_CONFIRMED) && (header_p[slot].bootCount >= BOOT_SLOT_MAX_TRIES))
+        {
+            continue;
+        }
+        order_p[count++] = slot;
+    }
+
+    return count;
+}
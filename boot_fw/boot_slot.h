@@ -0,0 +1,94 @@
+/*
+ * boot_slot.h
+ *
+ *  Created on: Oct 17, 2020
+ *      Author: A. Nolan
+ *
+ *  Stored firmware image slot layout and bootloader handoff record. Shared by the bootloader (boot_fw) and
+ *  the application firmware (FX3_Firmware/BootSlot.h), so both agree on the EEPROM layout and the RAM
+ *  addresses for every build configuration. Include after the FX3 type definitions (uint32_t).
+ */
+
+#ifndef BOOT_SLOT_H_
+#define BOOT_SLOT_H_
+
+/*
+ * Note: Address of 4 KB DMA scratch buffer used for USB data transfers. This is located outside of the
+ * 32 KB region allocated for the boot firmware code and data, and is expected to overlap the DMA buffer
+ * region used by the full FX3 firmware image.
+ *
+ * Turn on the CYMEM_256K pre-processor definition to build this binary for the CYUSB3011/CYUSB3012 devices
+ * that only have 256 KB of System RAM. The application firmware must be built with the same setting.
+ */
+#ifdef CYMEM_256K
+#define USB_DMA_BUF_ADDRESS     (0x40037000)
+#else
+#define USB_DMA_BUF_ADDRESS     (0x40077000)
+#endif
+
+/*
+ * Stored firmware image slots (I2C EEPROM)
+ *
+ * The EEPROM holds two firmware image slots (A and B) after the 32 KB bootloader image. Each slot has a
+ * header in its own EEPROM page, so the boot count and confirmation fields can be updated without touching
+ * the image.
+ */
+/* EEPROM address of the slot A header. The slot B header is in the following page */
+#define BOOT_SLOT_HEADER_ADDR       (0x8000)
+
+/* EEPROM page size (and spacing of the slot headers) */
+#define BOOT_SLOT_PAGE_SIZE         (0x40)
+
+/* EEPROM address of the slot A image. The slot B image immediately follows slot A */
+#define BOOT_SLOT_IMAGE_ADDR        (0x9000)
+
+/* Max image size for each slot */
+#define BOOT_SLOT_SIZE              (0x15000)
+
+/* Number of image slots */
+#define BOOT_SLOT_COUNT             (2)
+
+/* Slot header magic number ("ADIF") */
+#define BOOT_SLOT_MAGIC             (0x46494441)
+
+/* Value of the confirmed field once the application has confirmed the slot ("ADOK") */
+#define BOOT_SLOT_CONFIRMED         (0x4B4F4441)
+
+/* Number of times an unconfirmed slot is booted before the bootloader falls back to the other slot */
+#define BOOT_SLOT_MAX_TRIES         (3)
+
+/* Boot count written to a slot which failed to load. The slot is not tried again */
+#define BOOT_SLOT_REJECTED          (0xFFFFFFFF)
+
+/* Handoff record passed to the application firmware, at the end of the staging area. Tells the application
+   which slot it was booted from, so it can confirm the slot */
+#define BOOT_HANDOFF_ADDRESS        (USB_DMA_BUF_ADDRESS - 0x10)
+
+/* Handoff record magic number ("ADIH") */
+#define BOOT_HANDOFF_MAGIC          (0x48494441)
+
+/* Handoff record magic number written by the application to boot a stored image after a software reset ("ADIR") */
+#define BOOT_REQUEST_MAGIC          (0x52494441)
+
+/* Image slot header. Bytes 0 - 15 are covered by the header CRC. The boot count and confirmed fields
+   are updated in place by the bootloader and the application */
+typedef struct
+{
+    uint32_t magic;             /* BOOT_SLOT_MAGIC (bytes 0 - 3) */
+    uint32_t sequence;          /* Image sequence number, the highest valid sequence is booted first (bytes 4 - 7) */
+    uint32_t length;            /* Image length, in bytes (bytes 8 - 11) */
+    uint32_t imageCrc;          /* CRC32 of the image (bytes 12 - 15) */
+    uint32_t headerCrc;         /* CRC32 of bytes 0 - 15 (bytes 16 - 19) */
+    uint32_t bootCount;         /* Number of unconfirmed boot attempts (bytes 20 - 23) */
+    uint32_t confirmed;         /* BOOT_SLOT_CONFIRMED once the application confirms the image (bytes 24 - 27) */
+} BootSlotHeader_t;
+
+/* Handoff record, written to BOOT_HANDOFF_ADDRESS before jumping to a stored image */
+typedef struct
+{
+    uint32_t magic;             /* BOOT_HANDOFF_MAGIC */
+    uint32_t slot;              /* Slot the image was booted from */
+    uint32_t check;             /* ~(magic ^ slot) */
+} BootHandoff_t;
+
+#endif /* BOOT_SLOT_H_ */
@@ -0,0 +1,381 @@
+/*
+ * i2c_boot.c
+ *
+ *  Created on: Oct 17, 2020
+ *      Author: A. Nolan
+ *
+ *  A/B firmware image slot selection, and booting a stored image from the I2C EEPROM.
+ */
+
+#include "cyfx3device.h"
+#include "cyfx3utils.h"
+#include "cyfx3gpio.h"
+#include "cyfx3i2c.h"
+#include "main.h"
+
+/* Global control register (reset cause bits in main.h) */
+#define GCTL_CONTROL                (*(volatile uint32_t *)(0xE0050000))
+
+/* EEPROM access settings */
+#define EEPROM_BIT_RATE             (1000000)
+#define EEPROM_RETRY_COUNT          (10)
+#define EEPROM_ACK_POLL_RETRIES     (1000)
+#define EEPROM_READ_CHUNK           (0x1000)
+
+/* Builds the EEPROM device address for a byte address. Byte address bits 16 - 17 select the 64 KB block */
+static uint8_t
+myEepromDevAddr (
+        uint32_t address
+        )
+{
+    return (uint8_t)(0xA0 | ((address >> 15) & 0x06));
+}
+
+/* Reads a block of data from the EEPROM. Reads are split at the 64 KB device block boundaries.
+
+   Return Value:
+    0 - Success
+   -1 - I2C transfer failed
+*/
+static int
+myEepromRead (
+        uint32_t address,
+        uint8_t *buf_p,
+        uint32_t len
+        )
+{
+    CyFx3BootI2cPreamble_t preamble;
+    uint32_t chunk;
+
+    while (len != 0)
+    {
+        chunk = 0x10000 - (address & 0xFFFF);
+        if (chunk > EEPROM_READ_CHUNK)
+        {
+            chunk = EEPROM_READ_CHUNK;
+        }
+        if (chunk > len)
+        {
+            chunk = len;
+        }
+
+        preamble.length    = 4;
+        preamble.buffer[0] = myEepromDevAddr (address);
+        preamble.buffer[1] = (uint8_t)(address >> 8);
+        preamble.buffer[2] = (uint8_t)(address & 0xFF);
+        preamble.buffer[3] = preamble.buffer[0] | 0x01;
+        preamble.ctrlMask  = 1 << 2;
+
+        if (CyFx3BootI2cReceiveBytes (&preamble, buf_p, chunk, EEPROM_RETRY_COUNT) != CY_FX3_BOOT_SUCCESS)
+        {
+            return -1;
+        }
+
+        address += chunk;
+        buf_p   += chunk;
+        len     -= chunk;
+    }
+
+    return 0;
+}
+
+/* Writes a 32-bit word to the EEPROM (within a single page), and waits for the write cycle to complete */
+static int
+myEepromWriteWord (
+        uint32_t address,
+        uint32_t value
+        )
+{
+    CyFx3BootI2cPreamble_t preamble;
+
+    preamble.length    = 3;
+    preamble.buffer[0] = myEepromDevAddr (address);
+    preamble.buffer[1] = (uint8_t)(address >> 8);
+    preamble.buffer[2] = (uint8_t)(address & 0xFF);
+    preamble.ctrlMask  = 0;
+
+    if (CyFx3BootI2cTransmitBytes (&preamble, (uint8_t *)&value, 4, EEPROM_RETRY_COUNT) != CY_FX3_BOOT_SUCCESS)
+    {
+        return -1;
+    }
+
+    /* ACK poll the device address until the write cycle is done */
+    preamble.length = 1;
+    if (CyFx3BootI2cWaitForAck (&preamble, EEPROM_ACK_POLL_RETRIES) != CY_FX3_BOOT_SUCCESS)
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
+/* Reads data from the EEPROM image, and adds it to the running image CRC */
+static int
+myEepromReadImage (
+        uint32_t address,
+        uint8_t *buf_p,
+        uint32_t len,
+        uint32_t *crc_p
+        )
+{
+    if (myEepromRead (address, buf_p, len) < 0)
+    {
+        return -1;
+    }
+    *crc_p = myCrc32 (*crc_p, buf_p, len);
+    return 0;
+}
+
+/* Reads and validates a slot header.
+
+   Return Value:
+    0 - Header is valid
+   -1 - No valid image in the slot
+*/
+static int
+myReadSlotHeader (
+        uint32_t slot,
+        BootSlotHeader_t *header_p
+        )
+{
+    if (myEepromRead (BOOT_SLOT_HEADER_ADDR + (slot * BOOT_SLOT_PAGE_SIZE), (uint8_t *)header_p,
+                sizeof (BootSlotHeader_t)) < 0)
+    {
+        return -1;
+    }
+
+    return myCheckSlotHeader (header_p);
+}
+
+/* Loads the image stored in a slot into RAM.
+
+   The image is a sequence of sections, in the same form as the bulk download: a 16 byte header (load address,
+   stored length, loaded length, CRC32 of the loaded data), followed by the stored data, padded to a multiple
+   of 4 bytes. A section with a stored length different from the loaded length is LZ4 compressed. A section
+   with a loaded length of 0 ends the image, and holds the program entry point. The CRC32 of the whole image
+   is checked against the slot header before the entry point is returned.
+
+   Return Value:
+    0 - Image loaded, entry point returned in entry_p
+   -1 - Image could not be read, or is not valid
+*/
+static int
+myLoadSlotImage (
+        uint32_t slot,
+        BootSlotHeader_t *header_p,
+        uint32_t *entry_p
+        )
+{
+    uint32_t base = BOOT_SLOT_IMAGE_ADDR + (slot * BOOT_SLOT_SIZE);
+    uint32_t offset = 0;
+    uint32_t imageCrc = 0;
+    uint32_t section[4];
+    uint32_t address, storedLen, len, padLen, chunk, sectionCrc;
+    uint8_t *dst_p;
+    uint8_t pad[4];
+    CyBool_t itcm;
+
+    while ((offset + SECTION_HEADER_SIZE) <= header_p->length)
+    {
+        if (myEepromReadImage (base + offset, (uint8_t *)section, SECTION_HEADER_SIZE, &imageCrc) < 0)
+        {
+            return -1;
+        }
+        offset += SECTION_HEADER_SIZE;
+
+        address   = section[0];
+        storedLen = section[1];
+        len       = section[2];
+
+        /* Entry point record ends the image */
+        if (len == 0)
+        {
+            if ((offset != header_p->length) || (imageCrc != header_p->imageCrc))
+            {
+                return -1;
+            }
+            *entry_p = address;
+            return 0;
+        }
+
+        padLen = ((storedLen + 3) & ~3) - storedLen;
+        if ((myCheckAddress (address, len) != 0) || (storedLen == 0) ||
+                ((storedLen + padLen) > (header_p->length - offset)))
+        {
+            return -1;
+        }
+
+        itcm = ((address + len) <= CY_FX3_BOOT_ITCM_END);
+        sectionCrc = 0;
+
+        if (storedLen != len)
+        {
+            /* Compressed section: read into the staging area, then decompress into place */
+            if ((storedLen > USB_STAGING_SIZE) ||
+                    (itcm && ((((storedLen + 3) & ~3) + len) > USB_STAGING_SIZE)) ||
+                    ((address < USB_DMA_BUF_ADDRESS) && ((address + len) > USB_STAGING_ADDRESS)))
+            {
+                return -1;
+            }
+
+            if (myEepromReadImage (base + offset, (uint8_t *)USB_STAGING_ADDRESS, storedLen, &imageCrc) < 0)
+            {
+                return -1;
+            }
+
+            dst_p = itcm ? (uint8_t *)(USB_STAGING_ADDRESS + ((storedLen + 3) & ~3)) : (uint8_t *)address;
+            if (myLz4Decompress ((uint8_t *)USB_STAGING_ADDRESS, storedLen, dst_p, len) != (int)len)
+            {
+                return -1;
+            }
+            sectionCrc = myCrc32 (0, dst_p, len);
+
+            if (itcm)
+            {
+                myCopyToItcm (address, dst_p, len);
+            }
+        }
+        else if (itcm)
+        {
+            /* Raw ITCM section: read through the staging area, without writing the interrupt table */
+            for (chunk = 0; chunk < len; chunk += EEPROM_READ_CHUNK)
+            {
+                storedLen = ((len - chunk) > EEPROM_READ_CHUNK) ? EEPROM_READ_CHUNK : (len - chunk);
+                if (myEepromReadImage (base + offset + chunk, (uint8_t *)USB_STAGING_ADDRESS, storedLen, &imageCrc) < 0)
+                {
+                    return -1;
+                }
+                sectionCrc = myCrc32 (sectionCrc, (uint8_t *)USB_STAGING_ADDRESS, storedLen);
+                myCopyToItcm (address + chunk, (uint8_t *)USB_STAGING_ADDRESS, storedLen);
+            }
+            storedLen = len;
+        }
+        else
+        {
+            /* Raw SYSMEM section: read directly into place */
+            if (myEepromReadImage (base + offset, (uint8_t *)address, len, &imageCrc) < 0)
+            {
+                return -1;
+            }
+            sectionCrc = myCrc32 (0, (uint8_t *)address, len);
+        }
+
+        if (sectionCrc != section[3])
+        {
+            return -1;
+        }
+        offset += storedLen;
+
+        if (padLen != 0)
+        {
+            if (myEepromReadImage (base + offset, pad, padLen, &imageCrc) < 0)
+            {
+                return -1;
+            }
+            offset += padLen;
+        }
+    }
+
+    /* Ran off the end of the image without an entry point */
+    return -1;
+}
+
+/* Function to boot a stored firmware image from the EEPROM image slots.
+
+   Stored images are only booted after a power on or watchdog reset. A software reset (the host resetting the
+   board into the bootloader) returns to the USB bootloader, so the host can still load an image over USB,
+   unless the application left a BOOT_REQUEST_MAGIC handoff record (reset after an image update). The slot order
+   is chosen by mySelectBootSlots (boot_slot.c). A slot which the application has not yet confirmed is only booted
+   BOOT_SLOT_MAX_TRIES times, with the boot count stored in the slot header before each attempt. Once the tries
+   are used up, or if the image fails to load, the bootloader falls back to the other slot. If no slot can be
+   booted this function returns, and the USB bootloader is started.
+*/
+void
+myEepromBoot (
+        void
+        )
+{
+    CyFx3BootI2cConfig_t i2cConfig;
+    BootSlotHeader_t header[BOOT_SLOT_COUNT];
+    int valid[BOOT_SLOT_COUNT];
+    BootHandoff_t *handoff_p = (BootHandoff_t *)BOOT_HANDOFF_ADDRESS;
+    uint32_t resetCause = GCTL_CONTROL;
+    uint32_t order[BOOT_SLOT_COUNT];
+    uint32_t entry, slot, count, i;
+
+    CyBool_t bootRequest = ((handoff_p->magic == BOOT_REQUEST_MAGIC) &&
+            (handoff_p->check == ~(BOOT_REQUEST_MAGIC ^ handoff_p->slot)));
+
+    /* Clear the reset cause, so the next reset is reported correctly */
+    GCTL_CONTROL = resetCause & ~(GCTL_CONTROL_POR | GCTL_CONTROL_SW_RESET | GCTL_CONTROL_WDT_RESET);
+
+    /* No handoff record unless a stored image is booted */
+    handoff_p->magic = 0;
+
+    /* A software reset starts the USB bootloader, unless the application asked for the stored image. Checked
+       here as well as in mySelectBootSlots, so the EEPROM is not touched */
+    if ((resetCause & GCTL_CONTROL_SW_RESET) && (!bootRequest))
+    {
+        return;
+    }
+
+    if (CyFx3BootI2cInit () != CY_FX3_BOOT_SUCCESS)
+    {
+        return;
+    }
+
+    i2cConfig.busTimeout = 0xFFFFFFFF;
+    i2cConfig.dmaTimeout = 0xFFFF;
+    i2cConfig.isDma      = CyFalse;
+    i2cConfig.bitRate    = EEPROM_BIT_RATE;
+    if (CyFx3BootI2cSetConfig (&i2cConfig) != CY_FX3_BOOT_SUCCESS)
+    {
+        CyFx3BootI2cDeInit ();
+        return;
+    }
+
+    for (slot = 0; slot < BOOT_SLOT_COUNT; slot++)
+    {
+        valid[slot] = (myReadSlotHeader (slot, &header[slot]) == 0);
+    }
+
+    count = mySelectBootSlots (header, valid, resetCause, bootRequest, order);
+    for (i = 0; i < count; i++)
+    {
+        slot = order[i];
+
+        if (header[slot].confirmed != BOOT_SLOT_CONFIRMED)
+        {
+            /* Count the attempt before starting the image, so a hang is counted too */
+            if (myEepromWriteWord (BOOT_SLOT_HEADER_ADDR + (slot * BOOT_SLOT_PAGE_SIZE) + 20,
+                        header[slot].bootCount + 1) < 0)
+            {
+                continue;
+            }
+        }
+
+        if (myLoadSlotImage (slot, &header[slot], &entry) < 0)
+        {
+            /* Do not try an unconfirmed image which failed to load again */
+            if (header[slot].confirmed != BOOT_SLOT_CONFIRMED)
+            {
+                myEepromWriteWord (BOOT_SLOT_HEADER_ADDR + (slot * BOOT_SLOT_PAGE_SIZE) + 20, BOOT_SLOT_REJECTED);
+            }
+            continue;
+        }
+
+        CyFx3BootI2cDeInit ();
+
+        /* Tell the application which slot it was booted from */
+        handoff_p->magic = BOOT_HANDOFF_MAGIC;
+        handoff_p->slot  = slot;
+        handoff_p->check = ~(BOOT_HANDOFF_MAGIC ^ slot);
+
+        /* Change GPIO state while switching control to main firmware. */
+        CyFx3BootGpioSetValue (APP_SCLK_GPIO, CyTrue);
+
+        CyFx3BootJumpToProgramEntry (entry);
+    }
+
+    CyFx3BootI2cDeInit ();
+}
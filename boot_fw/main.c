@@ -33,6 +33,11 @@ extern void
 myUsbBoot (
         void);
 
+/* Receives image sections queued for download over the bulk endpoint */
+extern void
+myUsbBulkService (
+        void);
+
 /****************************************************************************
  * main:
  ****************************************************************************/
@@ -49,7 +54,7 @@ main (
 
     ioCfg.isDQ32Bit = CyFalse;
     ioCfg.useUart   = CyFalse;
-    ioCfg.useI2C    = CyFalse;
+    ioCfg.useI2C    = CyTrue;
     ioCfg.useI2S    = CyFalse;
     ioCfg.useSpi    = CyFalse;
     ioCfg.gpioSimpleEn[0] = 0;
@@ -81,6 +86,9 @@ main (
     if (status != CY_FX3_BOOT_SUCCESS)
         return status;
 
+    /* Boot a stored firmware image from the EEPROM slots. Returns if there is no image to boot */
+    myEepromBoot ();
+
     /* Enable this for booting off the USB */
     myUsbBoot ();
 
@@ -91,6 +99,9 @@ main (
          */
         CyFx3BootUsbHandleEvents ();
 
+        /* Receive any image section queued by the ADI_BULK_LOAD_SECTION command */
+        myUsbBulkService ();
+
         /* Handle blinking the LED */
 
         switch(mode)
@@ -17,9 +17,64 @@ extern uint16_t mode;
 /* Define SCK GPIO */
 #define	APP_SCLK_GPIO			(53)
 
+/* Stored image slot layout, handoff record and the scratch buffer address (shared with the application) */
+#include "boot_slot.h"
+
+/* Size of an image section record header (address, stored length, length, CRC) */
+#define SECTION_HEADER_SIZE     (16)
+
+/* Reset cause bits in the global control register (GCTL_CONTROL) */
+#define GCTL_CONTROL_POR        (1u << 0)
+#define GCTL_CONTROL_SW_RESET   (1u << 1)
+#define GCTL_CONTROL_WDT_RESET  (1u << 2)
+
+/*
+ * Note: Staging area for compressed image sections. This is the DMA buffer area of the full FX3 firmware
+ * image, which is not part of the downloaded image, and ends at the 4 KB scratch buffer.
+ */
+#ifdef CYMEM_256K
+#define USB_STAGING_ADDRESS     (0x40030000)
+#else
+#define USB_STAGING_ADDRESS     (0x40040000)
+#endif
+#define USB_STAGING_SIZE        (USB_DMA_BUF_ADDRESS - USB_STAGING_ADDRESS)
+
 /*
  * Bootloader Vendor Commands
  */
+/* Load an image section over the bulk OUT endpoint (EP1). Address in wValue/wIndex. The data stage holds the
+   transfer length (4 bytes), optionally followed by the loaded section length (LZ4 compressed if different from
+   the transfer length) and the CRC32 of the loaded section (4 bytes each) */
+#define ADI_BULK_LOAD_SECTION	(0xA1)
+
+/* Read the bulk image load status (4 bytes BOOT_STATUS code, 4 bytes failing section address) */
+#define ADI_BULK_LOAD_STATUS	(0xA2)
+
+/* Arm the image CRC check for the control endpoint (0xA0) download. The data stage holds the CRC32 of the image
+   data and the number of bytes, as written with 0xA0 (4 bytes each). The image is only started if they match */
+#define ADI_SET_IMAGE_CRC		(0xA3)
+
+/*
+ * Bulk image load status codes
+ */
+/* All sections loaded (and verified) successfully */
+#define BOOT_STATUS_SUCCESS				(0)
+
+/* A section is currently being received */
+#define BOOT_STATUS_PENDING				(1)
+
+/* A bulk transfer failed or timed out */
+#define BOOT_STATUS_XFER_FAILED			(2)
+
+/* A compressed section could not be decompressed */
+#define BOOT_STATUS_DECOMPRESS_FAILED	(3)
+
+/* A section CRC did not match the loaded data */
+#define BOOT_STATUS_CRC_MISMATCH		(4)
+
+/* A section had an invalid address or length */
+#define BOOT_STATUS_BAD_SECTION			(5)
+
 /* Hard-reset the FX3 firmware (return to bootloader mode) */
 #define ADI_HARD_RESET			(0xB1)
 
@@ -35,4 +90,57 @@ extern uint16_t mode;
 /* Turn on APP_LED_GPIO blinking */
 #define ADI_LED_BLINKING_ON		(0xEF)
 
+/* Decompress an LZ4 block (boot_image.c) */
+extern int
+myLz4Decompress (
+        const uint8_t *src_p,
+        uint32_t srcLen,
+        uint8_t *dst_p,
+        uint32_t dstLen);
+
+/* Calculate a CRC32 (boot_image.c) */
+extern uint32_t
+myCrc32 (
+        uint32_t crc,
+        const uint8_t *buf_p,
+        uint32_t len);
+
+/* Validate an image section address (usb_boot.c) */
+extern int
+myCheckAddress (
+        uint32_t address,
+        uint32_t len);
+
+/* Copy image data into ITCM, skipping the interrupt table (usb_boot.c) */
+extern void
+myCopyToItcm (
+        uint32_t address,
+        uint8_t *src_p,
+        uint32_t len);
+
+/* Validate an image slot header (boot_slot.c) */
+extern int
+myCheckSlotHeader (
+        const BootSlotHeader_t *header_p);
+
+/* Select the image slots to try, in order (boot_slot.c) */
+extern uint32_t
+mySelectBootSlots (
+        const BootSlotHeader_t *header_p,
+        const int *valid_p,
+        uint32_t resetCause,
+        CyBool_t bootRequest,
+        uint32_t *order_p);
+
+/* Boot a stored image from the EEPROM slots, if there is one to boot (i2c_boot.c) */
+extern void
+myEepromBoot (
+        void);
+
+/* Record an image load failure (usb_boot.c) */
+extern void
+myLatchBootError (
+        uint32_t status,
+        uint32_t address);
+
 #endif /* MAIN_H_ */
@@ -26,20 +26,6 @@
 #include "cyfx3gpio.h"
 #include "main.h"
 
-/*
- * Note: Address of 4 KB DMA scratch buffer used for USB data transfers. This is located outside of the
- * 32 KB region allocated for the boot firmware code and data, and is expected to overlap the DMA buffer
- * region used by the full FX3 firmware image.
- *
- * Turn on the CYMEM_256K pre-processor definition to build this binary for the CYUSB3011/CYUSB3012 devices
- * that only have 256 KB of System RAM.
- */
-#ifdef CYMEM_256K
-#define USB_DMA_BUF_ADDRESS     (0x40037000)
-#else
-#define USB_DMA_BUF_ADDRESS     (0x40077000)
-#endif
-
 typedef enum
 {
     eStall = 0,     /* Send STALL */
@@ -80,6 +66,37 @@ uint16_t gDevStatus __attribute__ ((aligned (4))) = 0;
 #define gpUSBData                   (uint8_t*)(USB_DMA_BUF_ADDRESS)
 #define USB_DATA_BUF_SIZE           (1024*4)
 
+/* Bulk OUT endpoint used for image section downloads. */
+#define USB_BULK_OUT_EP             (0x01)
+
+/* Max size of a single bulk DMA transfer. This is a multiple of the packet size at all speeds, so
+   every transfer except the last one of a section ends on a packet boundary. */
+#define USB_BULK_XFER_MAX           (0x8000)
+
+/* Timeout for each bulk DMA transfer. */
+#define USB_BULK_XFER_TIMEOUT       (5000)
+
+/* Image section queued by the ADI_BULK_LOAD_SECTION command, received over the bulk endpoint
+   from the main loop. */
+uint32_t glBulkAddress = 0;
+uint32_t glBulkLength = 0;
+uint32_t glBulkCompLength = 0;  /* Compressed length of the section, 0 for an uncompressed section. */
+uint32_t glBulkCrc = 0;         /* Expected CRC32 of the (decompressed) section data. */
+uint8_t  glBulkHasCrc = 0;      /* Whether the section carries a CRC. */
+volatile uint8_t glBulkPending = 0;
+
+/* Image CRC armed by the ADI_SET_IMAGE_CRC command, checked against the data written with the 0xA0 command
+   before jumping to the program entry point. */
+uint8_t  glLegacyCrcArmed = 0;
+uint32_t glLegacyCrcExpected = 0;
+uint32_t glLegacyLenExpected = 0;
+uint32_t glLegacyCrc = 0;       /* Running CRC32 of the data written with 0xA0, in the order it was sent. */
+uint32_t glLegacyLen = 0;       /* Number of bytes written with 0xA0. */
+
+/* First image load failure (BOOT_STATUS code) since the last report, and the failing section address. */
+uint32_t glBootStatus = BOOT_STATUS_SUCCESS;
+uint32_t glBootErrorAddress = 0;
+
 CyU3PUsbDescrPtrs   *gpUsbDescPtr; /* Pointer to the USB Descriptors */
 CyFx3BootUsbEp0Pkt_t gEP0;
 
@@ -274,6 +291,36 @@ myGetDescriptor (
         return eStall;
 }
 
+/* Function to enable or disable the bulk OUT endpoint used for image downloads */
+void
+myConfigureBulkEp (
+        CyBool_t enable
+        )
+{
+    CyFx3BootUsbEpConfig_t epCfg;
+
+    switch (CyFx3BootUsbGetSpeed ())
+    {
+        case CY_FX3_BOOT_SUPER_SPEED:
+            epCfg.pcktSize = 1024;
+            break;
+        case CY_FX3_BOOT_HIGH_SPEED:
+            epCfg.pcktSize = 512;
+            break;
+        default:
+            epCfg.pcktSize = 64;
+            break;
+    }
+
+    epCfg.enable   = enable;
+    epCfg.epType   = CY_FX3_BOOT_USB_EP_BULK;
+    epCfg.burstLen = 1;
+    epCfg.streams  = 0;
+    epCfg.isoPkts  = 0;
+
+    CyFx3BootUsbSetEpConfig (USB_BULK_OUT_EP, &epCfg);
+}
+
 /* Function to handle the SET_CONFIG Standard request */
 int
 mySetConfig (
@@ -284,6 +331,8 @@ mySetConfig (
     {
         glUsbState = gEP0.bVal0;
         gConfig = gEP0.bVal0;
+        glBulkPending = 0;
+        myConfigureBulkEp ((CyBool_t)gConfig);
         return eStatus;
     }
 
@@ -482,6 +531,222 @@ myCheckAddress (
     return -1;
 }
 
+/* Function to hand control over to the downloaded firmware. Does not return. */
+void
+myJumpToProgram (
+        uint32_t address
+        )
+{
+    /* Mask the USB Interrupts and Disconnect the USB Phy. */
+    CyFx3BootUsbConnect (CyFalse, CyTrue);
+
+    /* Change GPIO state while switching control to main firmware. */
+    CyFx3BootGpioSetValue (APP_SCLK_GPIO, CyTrue);
+
+    /* Transfer to Program Entry */
+    CyFx3BootJumpToProgramEntry (address);
+}
+
+/* Function to copy a received block of data into ITCM, without writing to the interrupt table. */
+void
+myCopyToItcm (
+        uint32_t address,
+        uint8_t *src_p,
+        uint32_t len
+        )
+{
+    if (address < 0xFF)
+    {
+        if ((address + len) <= 0xFF)
+        {
+            return;
+        }
+        src_p += 0xFF - address;
+        len   -= 0xFF - address;
+        address = 0xFF;
+    }
+    CyFx3BootMemCopy ((uint8_t *)address, src_p, len);
+}
+
+/* Function to receive an LZ4 compressed image section over the bulk OUT endpoint.
+
+   The compressed section is received into the staging area in USB_BULK_XFER_MAX transfers, then
+   decompressed into place. ITCM destinations are decompressed into the staging area after the compressed
+   data, and then copied into ITCM. The CRC is calculated over the decompressed data.
+
+   Return Value:
+    BOOT_STATUS_SUCCESS, or the BOOT_STATUS code of the failure
+*/
+int
+myUsbBulkCompressedSection (
+        uint32_t *crc_p
+        )
+{
+    int status = CY_FX3_BOOT_SUCCESS;
+    uint32_t offset = 0;
+    uint32_t chunk;
+    uint8_t *dst_p = (uint8_t *)glBulkAddress;
+    CyBool_t itcm = ((glBulkAddress + glBulkLength) <= CY_FX3_BOOT_ITCM_END);
+
+    while ((offset < glBulkCompLength) && (status == CY_FX3_BOOT_SUCCESS))
+    {
+        chunk = glBulkCompLength - offset;
+        if (chunk > USB_BULK_XFER_MAX)
+        {
+            chunk = USB_BULK_XFER_MAX;
+        }
+        status = CyFx3BootUsbDmaXferData (USB_BULK_OUT_EP, USB_STAGING_ADDRESS + offset, chunk, USB_BULK_XFER_TIMEOUT);
+        offset += chunk;
+    }
+
+    if (status != CY_FX3_BOOT_SUCCESS)
+    {
+        return BOOT_STATUS_XFER_FAILED;
+    }
+
+    if (itcm)
+    {
+        dst_p = (uint8_t *)(USB_STAGING_ADDRESS + ((glBulkCompLength + 3) & ~3));
+    }
+
+    if (myLz4Decompress ((uint8_t *)USB_STAGING_ADDRESS, glBulkCompLength, dst_p, glBulkLength) != (int)glBulkLength)
+    {
+        return BOOT_STATUS_DECOMPRESS_FAILED;
+    }
+
+    *crc_p = myCrc32 (0, dst_p, glBulkLength);
+
+    if (itcm)
+    {
+        myCopyToItcm (glBulkAddress, dst_p, glBulkLength);
+    }
+
+    return BOOT_STATUS_SUCCESS;
+}
+
+/* Function to receive an uncompressed image section over the bulk OUT endpoint.
+
+   SYSMEM destinations which meet the DMA alignment requirements are received directly in place, in
+   USB_BULK_XFER_MAX transfers, so the data is never copied by the CPU. Other destinations (ITCM, or
+   unaligned SYSMEM) are received through the scratch buffer and copied into place. The CRC is calculated
+   over each received chunk, before it is copied.
+
+   Return Value:
+    BOOT_STATUS_SUCCESS, or the BOOT_STATUS code of the failure
+*/
+int
+myUsbBulkRawSection (
+        uint32_t *crc_p
+        )
+{
+    int status;
+    uint32_t address   = glBulkAddress;
+    uint32_t remaining = glBulkLength;
+    uint32_t chunk;
+    uint32_t crc = 0;
+    CyBool_t direct = ((address >= CY_FX3_BOOT_SYSMEM_BASE1) && ((address & 0xF) == 0));
+
+    while (remaining != 0)
+    {
+        if (direct)
+        {
+            chunk = (remaining > USB_BULK_XFER_MAX) ? USB_BULK_XFER_MAX : remaining;
+            status = CyFx3BootUsbDmaXferData (USB_BULK_OUT_EP, address, chunk, USB_BULK_XFER_TIMEOUT);
+            if (status == CY_FX3_BOOT_SUCCESS)
+            {
+                crc = myCrc32 (crc, (uint8_t *)address, chunk);
+            }
+        }
+        else
+        {
+            chunk = (remaining > USB_DATA_BUF_SIZE) ? USB_DATA_BUF_SIZE : remaining;
+            status = CyFx3BootUsbDmaXferData (USB_BULK_OUT_EP, (uint32_t)gpUSBData, chunk, USB_BULK_XFER_TIMEOUT);
+            if (status == CY_FX3_BOOT_SUCCESS)
+            {
+                crc = myCrc32 (crc, gpUSBData, chunk);
+                if ((address + chunk) <= CY_FX3_BOOT_ITCM_END)
+                {
+                    myCopyToItcm (address, gpUSBData, chunk);
+                }
+                else
+                {
+                    CyFx3BootMemCopy ((uint8_t *)address, gpUSBData, chunk);
+                }
+            }
+        }
+
+        if (status != CY_FX3_BOOT_SUCCESS)
+        {
+            return BOOT_STATUS_XFER_FAILED;
+        }
+
+        address   += chunk;
+        remaining -= chunk;
+    }
+
+    *crc_p = crc;
+    return BOOT_STATUS_SUCCESS;
+}
+
+/* Function to receive the image section queued by the ADI_BULK_LOAD_SECTION command over the bulk
+   OUT endpoint. This is called from the main loop, so the control transfer which queued the section
+   has completed before the host starts sending the section data.
+
+   If the section carries a CRC, it is checked against the loaded data. On any failure the bulk endpoint
+   is stalled, and the failure is latched in glBootStatus, so the image is not started. The host reads the
+   failure with the ADI_BULK_LOAD_STATUS command.
+*/
+void
+myUsbBulkService (
+        void
+        )
+{
+    int status;
+    uint32_t crc = 0;
+
+    if (!glBulkPending)
+    {
+        return;
+    }
+
+    if (glBulkCompLength != 0)
+    {
+        status = myUsbBulkCompressedSection (&crc);
+    }
+    else
+    {
+        status = myUsbBulkRawSection (&crc);
+    }
+
+    if ((status == BOOT_STATUS_SUCCESS) && (glBulkHasCrc) && (crc != glBulkCrc))
+    {
+        status = BOOT_STATUS_CRC_MISMATCH;
+    }
+
+    if (status != BOOT_STATUS_SUCCESS)
+    {
+        CyFx3BootUsbStall (USB_BULK_OUT_EP, CyTrue, CyFalse);
+        myLatchBootError (status, glBulkAddress);
+    }
+
+    glBulkPending = 0;
+}
+
+/* Function to record the first image load failure. The image is not started until the failure
+   has been reported to the host. */
+void
+myLatchBootError (
+        uint32_t status,
+        uint32_t address
+        )
+{
+    if (glBootStatus == BOOT_STATUS_SUCCESS)
+    {
+        glBootStatus = status;
+        glBootErrorAddress = address;
+    }
+}
+
 /* Function to handle the vendor commands. */
 void 
 myVendorCmdHandler (
@@ -492,6 +757,9 @@ myVendorCmdHandler (
     int status;
     uint32_t address  = ((gEP0.bIdx1 << 24) | (gEP0.bIdx0 << 16) | (gEP0.bVal1 << 8) | (gEP0.bVal0));
     uint16_t len  = gEP0.wLen;
+    uint32_t len32;
+    uint32_t compLen;
+    uint32_t stagingLen;
     uint16_t bReq = gEP0.bReq;
     uint16_t dir  = gEP0.bmReqType & USB_SETUP_DIR;
 
@@ -526,14 +794,23 @@ myVendorCmdHandler (
         status = myCheckAddress (address, len);
         if (len == 0)
         {	
-            /* Mask the USB Interrupts and Disconnect the USB Phy. */
-            CyFx3BootUsbConnect (CyFalse, CyTrue);
-
-            /* Change GPIO state while switching control to main firmware. */
-            CyFx3BootGpioSetValue (APP_SCLK_GPIO, CyTrue);
-
-            /* Transfer to Program Entry */    
-            CyFx3BootJumpToProgramEntry (address);
+            /* With an image CRC armed, the image is only started if every byte written with 0xA0 arrived
+               and matches the CRC. A failure is latched for ADI_BULK_LOAD_STATUS, and the jump is refused. */
+            if (glLegacyCrcArmed)
+            {
+                if ((glLegacyCrc != glLegacyCrcExpected) || (glLegacyLen != glLegacyLenExpected))
+                {
+                    myLatchBootError (BOOT_STATUS_CRC_MISMATCH, address);
+                }
+                glLegacyCrcArmed = 0;
+                if (glBootStatus != BOOT_STATUS_SUCCESS)
+                {
+                    glBootStatus = BOOT_STATUS_SUCCESS;
+                    CyFx3BootUsbStall (0, CyTrue, CyFalse);
+                    return;
+                }
+            }
+            myJumpToProgram (address);
             return;
         }
 
@@ -574,20 +851,160 @@ myVendorCmdHandler (
             {
                 /* USB DMA Transfer failed. Stall the Endpoint. */
                 CyFx3BootUsbStall (0, CyTrue, CyFalse);
+                if (glLegacyCrcArmed)
+                {
+                    myLatchBootError (BOOT_STATUS_XFER_FAILED, address);
+                }
                 return;
             }
 
+            if (glLegacyCrcArmed)
+            {
+                glLegacyCrc = myCrc32 (glLegacyCrc, gEP0.pData, gEP0.wLen);
+                glLegacyLen += gEP0.wLen;
+            }
+
             /* Validate ITCM Memory */
             if ((address + gEP0.wLen) <= CY_FX3_BOOT_ITCM_END)
             {
                 /* Avoid writing to the interrupt table. */
-                if (address < 0xFF) {
-                    gEP0.pData += 0xFF-address;
-                    gEP0.wLen -= 0xFF-address;
-                    address = 0xFF;
-                }
-                CyFx3BootMemCopy((uint8_t *)address, gEP0.pData, gEP0.wLen); 
+                myCopyToItcm (address, gEP0.pData, gEP0.wLen);
+            }
+        }
+        return;
+    }
+
+    /* Vendor command 0xA1 handling - queue an image section for download over the bulk endpoint */
+    if (bReq == ADI_BULK_LOAD_SECTION)
+    {
+        if ((dir) || ((len != 4) && (len != 8) && (len != 12)) || (gConfig == 0) || (glBulkPending))
+        {
+            CyFx3BootUsbStall (0, CyTrue, CyFalse);
+            return;
+        }
+
+        CyFx3BootUsbAckSetup ();
+        status = CyFx3BootUsbDmaXferData (0x00, (uint32_t)gEP0.pData, gEP0.wLen, CY_FX3_BOOT_WAIT_FOREVER);
+        if (status != CY_FX3_BOOT_SUCCESS)
+        {
+            /* USB DMA Transfer failed. Stall the Endpoint. */
+            CyFx3BootUsbStall (0, CyTrue, CyFalse);
+            return;
+        }
+
+        /* Length of the section data sent over the bulk endpoint, little endian. This is optionally followed by
+           the section length once loaded (a different length marks an LZ4 compressed section), and the CRC32 of
+           the loaded section. */
+        len32 = ((gEP0.pData[3] << 24) | (gEP0.pData[2] << 16) | (gEP0.pData[1] << 8) | (gEP0.pData[0]));
+        compLen = 0;
+        if (len >= 8)
+        {
+            compLen = len32;
+            len32 = ((gEP0.pData[7] << 24) | (gEP0.pData[6] << 16) | (gEP0.pData[5] << 8) | (gEP0.pData[4]));
+            if (compLen == len32)
+            {
+                compLen = 0;
+            }
+        }
+        glBulkHasCrc = (len == 12);
+        glBulkCrc = ((gEP0.pData[11] << 24) | (gEP0.pData[10] << 16) | (gEP0.pData[9] << 8) | (gEP0.pData[8]));
+
+        /* A zero length section marks the end of the image, and carries the program entry point. The image
+           is not started if any section failed to load: the failure is cleared, so the host can retry. */
+        if (len32 == 0)
+        {
+            if (glBootStatus != BOOT_STATUS_SUCCESS)
+            {
+                glBootStatus = BOOT_STATUS_SUCCESS;
+                CyFx3BootUsbStall (0, CyTrue, CyFalse);
+                return;
+            }
+            myJumpToProgram (address);
+            return;
+        }
+
+        /* Reject the section data on the bulk endpoint if the destination is not valid. A compressed section
+           must fit in the staging area (along with the decompressed data, for ITCM), and must not be
+           decompressed over the staging area. */
+        status = myCheckAddress (address, len32);
+        if ((status == 0) && (compLen != 0))
+        {
+            stagingLen = compLen;
+            if ((address + len32) <= CY_FX3_BOOT_ITCM_END)
+            {
+                stagingLen = ((compLen + 3) & ~3) + len32;
             }
+            if ((compLen == 0) || (compLen > USB_STAGING_SIZE) || (stagingLen > USB_STAGING_SIZE) ||
+                    ((address < USB_DMA_BUF_ADDRESS) && ((address + len32) > USB_STAGING_ADDRESS)))
+            {
+                status = -1;
+            }
+        }
+        if (status < 0)
+        {
+            CyFx3BootUsbStall (USB_BULK_OUT_EP, CyTrue, CyFalse);
+            myLatchBootError (BOOT_STATUS_BAD_SECTION, address);
+            return;
+        }
+
+        glBulkAddress = address;
+        glBulkLength  = len32;
+        glBulkCompLength = compLen;
+        glBulkPending = 1;
+        return;
+    }
+
+    /* Vendor command 0xA3 handling - arm the image CRC check for the 0xA0 download */
+    if (bReq == ADI_SET_IMAGE_CRC)
+    {
+        if ((dir) || (len != 8))
+        {
+            CyFx3BootUsbStall (0, CyTrue, CyFalse);
+            return;
+        }
+
+        CyFx3BootUsbAckSetup ();
+        status = CyFx3BootUsbDmaXferData (0x00, (uint32_t)gEP0.pData, gEP0.wLen, CY_FX3_BOOT_WAIT_FOREVER);
+        if (status != CY_FX3_BOOT_SUCCESS)
+        {
+            CyFx3BootUsbStall (0, CyTrue, CyFalse);
+            return;
+        }
+
+        /* CRC32 of the image data, then the number of bytes, little endian. The running CRC restarts, so this
+           is sent before the first 0xA0 write of the image. */
+        glLegacyCrcExpected = ((gEP0.pData[3] << 24) | (gEP0.pData[2] << 16) | (gEP0.pData[1] << 8) | (gEP0.pData[0]));
+        glLegacyLenExpected = ((gEP0.pData[7] << 24) | (gEP0.pData[6] << 16) | (gEP0.pData[5] << 8) | (gEP0.pData[4]));
+        glLegacyCrc = 0;
+        glLegacyLen = 0;
+        glLegacyCrcArmed = 1;
+        return;
+    }
+
+    /* Vendor command 0xA2 handling - report the image load status */
+    if (bReq == ADI_BULK_LOAD_STATUS)
+    {
+        if ((!dir) || (len < 8))
+        {
+            CyFx3BootUsbStall (0, CyTrue, CyFalse);
+            return;
+        }
+
+        status = (glBulkPending) ? BOOT_STATUS_PENDING : glBootStatus;
+        gEP0.pData[0] = (uint8_t)(status & 0xFF);
+        gEP0.pData[1] = (uint8_t)((status >> 8) & 0xFF);
+        gEP0.pData[2] = (uint8_t)((status >> 16) & 0xFF);
+        gEP0.pData[3] = (uint8_t)((status >> 24) & 0xFF);
+        gEP0.pData[4] = (uint8_t)(glBootErrorAddress & 0xFF);
+        gEP0.pData[5] = (uint8_t)((glBootErrorAddress >> 8) & 0xFF);
+        gEP0.pData[6] = (uint8_t)((glBootErrorAddress >> 16) & 0xFF);
+        gEP0.pData[7] = (uint8_t)((glBootErrorAddress >> 24) & 0xFF);
+
+        CyFx3BootUsbAckSetup ();
+        status = CyFx3BootUsbDmaXferData (0x80, (uint32_t)gEP0.pData, 8, 1000);
+        if (status != CY_FX3_BOOT_SUCCESS)
+        {
+            CyFx3BootUsbStall (0, CyTrue, CyFalse);
         }
         return;
     }
@@ -751,6 +1168,9 @@ myUsbEventCallback (
         gUsbDevStatus        = 0;
         glUsbState           = 0;
         glInCompliance       = 0;
+        glBulkPending        = 0;
+        glLegacyCrcArmed     = 0;
+        glBootStatus         = BOOT_STATUS_SUCCESS;
     }
 
     if ((event == CY_FX3_BOOT_USB_CONNECT) ||
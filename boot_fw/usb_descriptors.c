@@ -56,7 +56,7 @@ unsigned char gbCfgDesc[] =
 {
     0x09,                           /* Descriptor Size */
     0x02,                           /* Configuration Descriptor Type */
-    0x12,0x00,                      /* Length of this descriptor and all sub descriptors */
+    0x19,0x00,                      /* Length of this descriptor and all sub descriptors */
     0x01,                           /* Number of interfaces */
     0x01,                           /* Configuration number */
     0x00,                           /* COnfiguration string index */
@@ -68,11 +68,19 @@ unsigned char gbCfgDesc[] =
     0x04,                           /* Interface Descriptor type */
     0x00,                           /* Interface number */
     0x00,                           /* Alternate setting number */
-    0x00,                           /* Number of end points */
+    0x01,                           /* Number of end points */
     0xFF,                           /* Interface class */
     0x00,                           /* Interface sub class */
     0x00,                           /* Interface protocol code */
     0x00,                           /* Interface descriptor string index */
+
+    /* Endpoint Descriptor for bulk image download */
+    0x07,                           /* Descriptor size */
+    0x05,                           /* Endpoint Descriptor Type */
+    0x01,                           /* Endpoint address and description : EP1 OUT */
+    0x02,                           /* Bulk endpoint type */
+    0x00,0x02,                      /* Max packet size = 512 bytes */
+    0x00,                           /* Servicing interval for data transfers : 0 for bulk */
 };
 
 unsigned char gbLangIDDesc[] =
@@ -173,7 +181,7 @@ unsigned char gbSsConfigDesc[] =
     /* Configuration Descriptor Type */
     0x09,                           /* Descriptor Size */
     0x02,                           /* Configuration Descriptor Type */
-    0x12,0x00,                      /* Length of this descriptor and all sub descriptors */
+    0x1F,0x00,                      /* Length of this descriptor and all sub descriptors */
     0x01,                           /* Number of interfaces */
     0x01,                           /* Configuration number */
     0x00,                           /* Configuration string index */
@@ -185,11 +193,26 @@ unsigned char gbSsConfigDesc[] =
     0x04,                           /* Interface Descriptor type */
     0x00,                           /* Interface number */
     0x00,                           /* Alternate setting number */
-    0x00,                           /* Number of end points */
+    0x01,                           /* Number of end points */
     0xFF,                           /* Interface class */
     0x00,                           /* Interface sub class */
     0x00,                           /* Interface protocol code */
     0x00,                           /* Interface descriptor string index */
+
+    /* Endpoint Descriptor for bulk image download */
+    0x07,                           /* Descriptor size */
+    0x05,                           /* Endpoint Descriptor Type */
+    0x01,                           /* Endpoint address and description : EP1 OUT */
+    0x02,                           /* Bulk endpoint type */
+    0x00,0x04,                      /* Max packet size = 1024 bytes */
+    0x00,                           /* Servicing interval for data transfers : 0 for bulk */
+
+    /* Super Speed Endpoint Companion Descriptor for bulk image download */
+    0x06,                           /* Descriptor size */
+    0x30,                           /* SS Endpoint Companion Descriptor Type */
+    0x00,                           /* Max no. of packets in a burst : 1 */
+    0x00,                           /* Max streams for bulk EP = 0 (No streams) */
+    0x00,0x00                       /* Service interval for the EP : 0 for bulk */
 };
 
 /* Standard Device Descriptor for USB 3.0 */
@@ -217,7 +240,7 @@ unsigned char gbFsConfigDesc[] =
     /* Configuration Descriptor Type */
     0x09,                           /* Descriptor Size */
     0x02,                           /* Configuration Descriptor Type */
-    0x12,0x00,                      /* Length of this descriptor and all sub descriptors */
+    0x19,0x00,                      /* Length of this descriptor and all sub descriptors */
     0x01,                           /* Number of interfaces */
     0x01,                           /* Configuration number */
     0x00,                           /* COnfiguration string index */
@@ -229,10 +252,18 @@ unsigned char gbFsConfigDesc[] =
     0x04,       					/* Interface Descriptor type */
     0x00,                           /* Interface number */
     0x00,                           /* Alternate setting number */
-    0x00,                           /* Number of end points */
+    0x01,                           /* Number of end points */
     0xFF,                           /* Interface class */
     0x00,                           /* Interface sub class */
     0x00,                           /* Interface protocol code */
     0x00,                           /* Interface descriptor string index */
+
+    /* Endpoint Descriptor for bulk image download */
+    0x07,                           /* Descriptor size */
+    0x05,                           /* Endpoint Descriptor Type */
+    0x01,                           /* Endpoint address and description : EP1 OUT */
+    0x02,                           /* Bulk endpoint type */
+    0x40,0x00,                      /* Max packet size = 64 bytes */
+    0x00,                           /* Servicing interval for data transfers : 0 for bulk */
 };
 
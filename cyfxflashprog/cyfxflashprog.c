@@ -51,6 +51,23 @@ CyU3PDmaChannel glI2cTxHandle;   /* I2C Tx channel handle */
 CyU3PDmaChannel glI2cRxHandle;   /* I2C Rx channel handle */
 CyU3PDmaChannel glSpiTxHandle;   /* SPI Tx channel handle */
 CyU3PDmaChannel glSpiRxHandle;   /* SPI Rx channel handle */
+CyU3PDmaChannel glBulkRxHandle;  /* USB bulk OUT to CPU channel handle for EEPROM programming data */
+CyBool_t glBulkChannelActive = CyFalse;
+
+CyU3PEvent glFlashProgEvent;     /* Event group used to start background programming operations */
+
+/* State of the bulk EEPROM programming operation. */
+volatile CyBool_t glBulkProgBusy = CyFalse;
+uint32_t glBulkProgAddress   = 0;
+uint32_t glBulkProgRemaining = 0;
+uint32_t glBulkProgSkipped   = 0;
+uint16_t glBulkProgFlags     = 0;
+CyU3PReturnStatus_t glBulkProgStatus = CY_U3P_SUCCESS;
+
+/* Partially consumed buffer from the bulk programming channel. */
+CyU3PDmaBuffer_t glBulkBuf;
+uint32_t glBulkBufOffset = 0;
+CyBool_t glBulkBufValid  = CyFalse;
 
 /* Initialize the debug module with UART. */
 CyU3PReturnStatus_t
@@ -161,7 +178,30 @@ CyFxFlashProgI2cInit (uint16_t pageLen)
     return status;
 }
 
-/* I2C read / write for programmer application. */
+/* Wait for the I2C EEPROM to complete its internal write cycle. The EEPROM does not
+ * ACK its device address until the write cycle is done, so polling for the ACK lets
+ * the next page go out as soon as the part is ready, instead of after a fixed delay. */
+void
+CyFxFlashProgI2cWaitForAck (
+        uint8_t devAddr)
+{
+    CyU3PI2cPreamble_t preamble;
+    CyU3PReturnStatus_t status;
+
+    preamble.length    = 1;
+    preamble.buffer[0] = devAddr;
+    preamble.ctrlMask  = 0x0000;
+
+    status = CyU3PI2cWaitForAck (&preamble, CY_FX_I2C_ACK_POLL_RETRIES);
+    if (status != CY_U3P_SUCCESS)
+    {
+        /* Fall back to the worst case write cycle time. */
+        CyU3PThreadSleep (10);
+    }
+}
+
+/* I2C read / write for programmer application. Writes are split on EEPROM page
+ * boundaries, so the start address does not need to be page aligned. */
 CyU3PReturnStatus_t
 CyFxFlashProgI2cTransfer (
         uint16_t  byteAddress,
@@ -172,7 +212,7 @@ CyFxFlashProgI2cTransfer (
 {
     CyU3PDmaBuffer_t buf_p;
     CyU3PI2cPreamble_t preamble;
-    uint16_t pageCount = (byteCount / glI2cPageSize);
+    uint16_t chunk;
     CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
 
     if (byteCount == 0)
@@ -180,22 +220,19 @@ CyFxFlashProgI2cTransfer (
         return CY_U3P_SUCCESS;
     }
 
-    if ((byteCount % glI2cPageSize) != 0)
-    {
-        pageCount ++;
-    }
-
-    CyU3PDebugPrint (2, "I2C access - dev: 0x%x, address: 0x%x, size: 0x%x, pages: 0x%x.\r\n",
-            devAddr, byteAddress, byteCount, pageCount);
+    CyU3PDebugPrint (2, "I2C access - dev: 0x%x, address: 0x%x, size: 0x%x.\r\n",
+            devAddr, byteAddress, byteCount);
 
     /* Update the buffer address and status. */
     buf_p.buffer = buffer;
     buf_p.status = 0;
 
-    while (pageCount != 0)
+    while (byteCount != 0)
     {
         if (isRead)
         {
+            chunk = (byteCount > glI2cPageSize) ? glI2cPageSize : byteCount;
+
             /* Update the preamble information. */
             preamble.length    = 4;
             preamble.buffer[0] = devAddr;
@@ -205,9 +242,9 @@ CyFxFlashProgI2cTransfer (
             preamble.ctrlMask  = 0x0004;
 
             buf_p.size = glI2cPageSize;
-            buf_p.count = glI2cPageSize;
+            buf_p.count = chunk;
 
-            status = CyU3PI2cSendCommand (&preamble, glI2cPageSize, isRead);
+            status = CyU3PI2cSendCommand (&preamble, chunk, isRead);
             if (status != CY_U3P_SUCCESS)
             {
                 return status;
@@ -226,6 +263,13 @@ CyFxFlashProgI2cTransfer (
         }
         else /* Write */
         {
+            /* Do not cross an EEPROM page boundary. */
+            chunk = glI2cPageSize - (byteAddress % glI2cPageSize);
+            if (chunk > byteCount)
+            {
+                chunk = byteCount;
+            }
+
             /* Update the preamble information. */
             preamble.length    = 3;
             preamble.buffer[0] = devAddr;
@@ -234,7 +278,7 @@ CyFxFlashProgI2cTransfer (
             preamble.ctrlMask  = 0x0000;
 
             buf_p.size = glI2cPageSize;
-            buf_p.count = glI2cPageSize;
+            buf_p.count = chunk;
 
             status = CyU3PDmaChannelSetupSendBuffer (&glI2cTxHandle,
                     &buf_p);
@@ -242,7 +286,7 @@ CyFxFlashProgI2cTransfer (
             {
                 return status;
             }
-            status = CyU3PI2cSendCommand (&preamble, glI2cPageSize, isRead);
+            status = CyU3PI2cSendCommand (&preamble, chunk, isRead);
             if (status != CY_U3P_SUCCESS)
             {
                 return status;
@@ -253,15 +297,15 @@ CyFxFlashProgI2cTransfer (
             {
                 return status;
             }
+
+            /* Wait for the page write cycle to complete. */
+            CyFxFlashProgI2cWaitForAck (devAddr);
         }
 
         /* Update the parameters */
-        byteAddress  += glI2cPageSize;
-        buf_p.buffer += glI2cPageSize;
-        pageCount --;
-
-        /* Need a delay between write operations. */
-        CyU3PThreadSleep (10);
+        byteAddress  += chunk;
+        buf_p.buffer += chunk;
+        byteCount    -= chunk;
     }
 
     return CY_U3P_SUCCESS;
@@ -347,7 +391,9 @@ CyFxFlashProgSpiInit (uint16_t pageLen)
     return status;
 }
 
-/* Wait for the status response from the SPI flash. */
+/* Wait for the SPI flash to finish any program or erase operation (WIP bit clear).
+ * This only polls the status register: the write enable latch is set separately,
+ * right before the operations which need it. */
 CyU3PReturnStatus_t
 CyFxFlashProgSpiWaitForStatus (
         void)
@@ -358,17 +404,6 @@ CyFxFlashProgSpiWaitForStatus (
     /* Wait for status response from SPI flash device. */
     do
     {
-        buf[0] = 0x06;  /* Write enable command. */
-
-        CyU3PSpiSetSsnLine (CyFalse);
-        status = CyU3PSpiTransferWords (buf, 1, 0, 0);
-        CyU3PSpiSetSsnLine (CyTrue);
-        if (status != CY_U3P_SUCCESS)
-        {
-            CyU3PDebugPrint (2, "SPI WR_ENABLE command failed\n\r");
-            return status;
-        }
-
         buf[0] = 0x05;  /* Read status command */
 
         CyU3PSpiSetSsnLine (CyFalse);
@@ -388,11 +423,126 @@ CyFxFlashProgSpiWaitForStatus (
             return status;
         }
 
-    } while ((rd_buf[0] & 1)|| (!(rd_buf[0] & 0x2)));
+    } while (rd_buf[0] & 1);
 
     return CY_U3P_SUCCESS;
 }
 
+/* Set the write enable latch of the SPI flash. This is needed before each page
+ * program or sector erase operation. */
+CyU3PReturnStatus_t
+CyFxFlashProgSpiWriteEnable (
+        void)
+{
+    uint8_t buf[1];
+    CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
+
+    buf[0] = 0x06;  /* Write enable command. */
+
+    CyU3PSpiSetSsnLine (CyFalse);
+    status = CyU3PSpiTransferWords (buf, 1, 0, 0);
+    CyU3PSpiSetSsnLine (CyTrue);
+    if (status != CY_U3P_SUCCESS)
+    {
+        CyU3PDebugPrint (2, "SPI WR_ENABLE command failed\n\r");
+    }
+
+    return status;
+}
+
+/* Read from the SPI flash using a single fast read (0x0B) command. The whole read
+ * is done with one chip select assertion, in DMA transfers of up to
+ * CY_FX_SPI_READ_CHUNK bytes.
+ *
+ * If compare is NULL, the data is read into buffer. Otherwise buffer is used as a
+ * CY_FX_SPI_READ_CHUNK byte scratch area: each chunk is compared against compare,
+ * and *mismatch is set if any byte differs. */
+CyU3PReturnStatus_t
+CyFxFlashProgSpiFastRead (
+        uint32_t  byteAddress,
+        uint32_t  byteCount,
+        uint8_t  *buffer,
+        uint8_t  *compare,
+        CyBool_t *mismatch)
+{
+    CyU3PDmaBuffer_t buf_p;
+    uint8_t location[5];
+    uint32_t chunk, i;
+    CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
+
+    if (byteCount == 0)
+    {
+        return CY_U3P_SUCCESS;
+    }
+
+    location[0] = 0x0B; /* Fast read command. */
+    location[1] = (byteAddress >> 16) & 0xFF;       /* MS byte */
+    location[2] = (byteAddress >> 8) & 0xFF;
+    location[3] = byteAddress & 0xFF;               /* LS byte */
+    location[4] = 0x00; /* Dummy byte. */
+
+    status = CyFxFlashProgSpiWaitForStatus ();
+    if (status != CY_U3P_SUCCESS)
+    {
+        return status;
+    }
+
+    CyU3PSpiSetSsnLine (CyFalse);
+    status = CyU3PSpiTransferWords (location, 5, 0, 0);
+    if (status != CY_U3P_SUCCESS)
+    {
+        CyU3PDebugPrint (2, "SPI FAST_READ command failed\r\n");
+        CyU3PSpiSetSsnLine (CyTrue);
+        return status;
+    }
+
+    CyU3PSpiSetBlockXfer (0, byteCount);
+
+    buf_p.buffer = buffer;
+    buf_p.status = 0;
+
+    while (byteCount != 0)
+    {
+        chunk = (byteCount > CY_FX_SPI_READ_CHUNK) ? CY_FX_SPI_READ_CHUNK : byteCount;
+        buf_p.size  = (chunk + 0x0F) & ~0x0F;
+        buf_p.count = chunk;
+
+        status = CyU3PDmaChannelSetupRecvBuffer (&glSpiRxHandle, &buf_p);
+        if (status != CY_U3P_SUCCESS)
+        {
+            break;
+        }
+        status = CyU3PDmaChannelWaitForCompletion (&glSpiRxHandle,
+                CY_FX_FLASH_PROG_TIMEOUT);
+        if (status != CY_U3P_SUCCESS)
+        {
+            break;
+        }
+
+        if (compare != NULL)
+        {
+            for (i = 0; (i < chunk) && (!(*mismatch)); i++)
+            {
+                if (buffer[i] != compare[i])
+                {
+                    *mismatch = CyTrue;
+                }
+            }
+            compare += chunk;
+        }
+        else
+        {
+            buf_p.buffer += chunk;
+        }
+        byteCount -= chunk;
+    }
+
+    CyU3PSpiSetSsnLine (CyTrue);
+    CyU3PSpiDisableBlockXfer (CyFalse, CyTrue);
+
+    return status;
+}
+
 /* SPI read / write for programmer application. */
 CyU3PReturnStatus_t
 CyFxFlashProgSpiTransfer (
@@ -423,101 +573,65 @@ CyFxFlashProgSpiTransfer (
     CyU3PDebugPrint (2, "SPI access - addr: 0x%x, size: 0x%x, pages: 0x%x.\r\n",
             byteAddress, byteCount, pageCount);
 
+    /* Reads are done with one continuous fast read, rather than page by page. */
+    if (isRead)
+    {
+        return CyFxFlashProgSpiFastRead (byteAddress, pageCount * glSpiPageSize, buffer, NULL, NULL);
+    }
+
     while (pageCount != 0)
     {
         location[1] = (byteAddress >> 16) & 0xFF;       /* MS byte */
         location[2] = (byteAddress >> 8) & 0xFF;
         location[3] = byteAddress & 0xFF;               /* LS byte */
 
-        if (isRead)
-        {
-            location[0] = 0x03; /* Read command. */
+        location[0] = 0x02; /* Write command */
 
-            buf_p.size  = glSpiPageSize;
-            buf_p.count = glSpiPageSize;
+        buf_p.size  = glSpiPageSize;
+        buf_p.count = glSpiPageSize;
 
-            status = CyFxFlashProgSpiWaitForStatus ();
-            if (status != CY_U3P_SUCCESS)
-            {
-                return status;
-            }
+        status = CyFxFlashProgSpiWaitForStatus ();
+        if (status != CY_U3P_SUCCESS)
+            return status;
 
-            CyU3PSpiSetSsnLine (CyFalse);
-            status = CyU3PSpiTransferWords (location, 4, 0, 0);
-            if (status != CY_U3P_SUCCESS)
-            {
-                CyU3PDebugPrint (2, "SPI READ command failed\r\n");
-                CyU3PSpiSetSsnLine (CyTrue);
-                return status;
-            }
+        status = CyFxFlashProgSpiWriteEnable ();
+        if (status != CY_U3P_SUCCESS)
+            return status;
 
-            CyU3PSpiSetBlockXfer (0, glSpiPageSize);
+        CyU3PSpiSetSsnLine (CyFalse);
+        status = CyU3PSpiTransferWords (location, 4, 0, 0);
+        if (status != CY_U3P_SUCCESS)
+        {
+            CyU3PDebugPrint (2, "SPI WRITE command failed\r\n");
+            CyU3PSpiSetSsnLine (CyTrue);
+            return status;
+        }
 
-            status = CyU3PDmaChannelSetupRecvBuffer (&glSpiRxHandle,
-                    &buf_p);
-            if (status != CY_U3P_SUCCESS)
-            {
-                CyU3PSpiSetSsnLine (CyTrue);
-                return status;
-            }
-            status = CyU3PDmaChannelWaitForCompletion (&glSpiRxHandle,
-                    CY_FX_FLASH_PROG_TIMEOUT);
-            if (status != CY_U3P_SUCCESS)
-            {
-                CyU3PSpiSetSsnLine (CyTrue);
-                return status;
-            }
+        CyU3PSpiSetBlockXfer (glSpiPageSize, 0);
 
+        status = CyU3PDmaChannelSetupSendBuffer (&glSpiTxHandle,
+                &buf_p);
+        if (status != CY_U3P_SUCCESS)
+        {
             CyU3PSpiSetSsnLine (CyTrue);
-            CyU3PSpiDisableBlockXfer (CyFalse, CyTrue);
+            return status;
         }
-        else /* Write */
+        status = CyU3PDmaChannelWaitForCompletion(&glSpiTxHandle,
+                CY_FX_FLASH_PROG_TIMEOUT);
+        if (status != CY_U3P_SUCCESS)
         {
-            location[0] = 0x02; /* Write command */
-
-            buf_p.size  = glSpiPageSize;
-            buf_p.count = glSpiPageSize;
-
-            status = CyFxFlashProgSpiWaitForStatus ();
-            if (status != CY_U3P_SUCCESS)
-                return status;
-
-            CyU3PSpiSetSsnLine (CyFalse);
-            status = CyU3PSpiTransferWords (location, 4, 0, 0);
-            if (status != CY_U3P_SUCCESS)
-            {
-                CyU3PDebugPrint (2, "SPI WRITE command failed\r\n");
-                CyU3PSpiSetSsnLine (CyTrue);
-                return status;
-            }
-
-            CyU3PSpiSetBlockXfer (glSpiPageSize, 0);
-
-            status = CyU3PDmaChannelSetupSendBuffer (&glSpiTxHandle,
-                    &buf_p);
-            if (status != CY_U3P_SUCCESS)
-            {
-                CyU3PSpiSetSsnLine (CyTrue);
-                return status;
-            }
-            status = CyU3PDmaChannelWaitForCompletion(&glSpiTxHandle,
-                    CY_FX_FLASH_PROG_TIMEOUT);
-            if (status != CY_U3P_SUCCESS)
-            {
-                CyU3PSpiSetSsnLine (CyTrue);
-                return status;
-            }
-
             CyU3PSpiSetSsnLine (CyTrue);
-            CyU3PSpiDisableBlockXfer (CyTrue, CyFalse);
+            return status;
         }
 
-        /* Update the parameters */
+        CyU3PSpiSetSsnLine (CyTrue);
+        CyU3PSpiDisableBlockXfer (CyTrue, CyFalse);
+
+        /* Update the parameters. The next page waits for this page program to
+         * complete by polling the status register. */
         byteAddress  += glSpiPageSize;
         buf_p.buffer += glSpiPageSize;
         pageCount --;
-
-        CyU3PThreadSleep (10);
     }
     return CY_U3P_SUCCESS;
 }
@@ -538,16 +652,13 @@ CyFxFlashProgEraseSector (
         return CY_U3P_ERROR_BAD_ARGUMENT;
     }
 
-    location[0] = 0x06;  /* Write enable. */
-
-    CyU3PSpiSetSsnLine (CyFalse);
-    status = CyU3PSpiTransferWords (location, 1, 0, 0);
-    CyU3PSpiSetSsnLine (CyTrue);
-    if (status != CY_U3P_SUCCESS)
-        return status;
-
     if (isErase)
     {
+        /* Only the erase needs the write enable latch set. */
+        status = CyFxFlashProgSpiWriteEnable ();
+        if (status != CY_U3P_SUCCESS)
+            return status;
+
         location[0] = 0xD8; /* Sector erase. */
         temp        = sector * 0x10000;
         location[1] = (temp >> 16) & 0xFF;
@@ -578,6 +689,328 @@ CyFxFlashProgEraseSector (
     return status;
 }
 
+/* Drop any data left in the bulk programming channel at the end of an operation, and
+ * re-arm the channel for the next one. Without this, data the host sent past the end of
+ * a failed (or over length) operation would be programmed by the next operation. */
+static void
+CyFxFlashProgBulkReset (
+        void)
+{
+    CyU3PReturnStatus_t status;
+
+    glBulkBufValid = CyFalse;
+    if (!glBulkChannelActive)
+    {
+        return;
+    }
+
+    CyU3PDmaChannelReset (&glBulkRxHandle);
+    CyU3PUsbFlushEp (CY_FX_EP_PROG_DATA);
+    status = CyU3PDmaChannelSetXfer (&glBulkRxHandle, 0);
+    if (status != CY_U3P_SUCCESS)
+    {
+        CyU3PDebugPrint (2, "Bulk channel restart failed, error code: %d\r\n", status);
+    }
+}
+
+/* Program the I2C EEPROM with the data received on the bulk OUT endpoint. This runs
+ * in the application thread. The bulk channel has several buffers, so the host keeps
+ * sending (and the FX3 keeps receiving) the next chunks while the current chunk is
+ * being written to the EEPROM. Each chunk is written straight from the USB DMA buffer. */
+void
+CyFxFlashProgBulkWrite (
+        void)
+{
+    CyU3PDmaBuffer_t buf;
+    uint32_t len, offset, chunk;
+    uint8_t  i2cAddr;
+    CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
+
+    CyU3PDebugPrint (2, "Bulk EEPROM write - address: 0x%x, size: 0x%x.\r\n",
+            glBulkProgAddress, glBulkProgRemaining);
+
+    while ((glBulkProgRemaining != 0) && (status == CY_U3P_SUCCESS))
+    {
+        status = CyU3PDmaChannelGetBuffer (&glBulkRxHandle, &buf, CY_FX_FLASH_PROG_TIMEOUT);
+        if (status != CY_U3P_SUCCESS)
+        {
+            break;
+        }
+
+        /* Ignore any data past the requested length. */
+        len = (buf.count > glBulkProgRemaining) ? glBulkProgRemaining : buf.count;
+        if (len == 0)
+        {
+            /* Zero length packet before all of the data was received. */
+            status = CY_U3P_ERROR_FAILURE;
+        }
+
+        offset = 0;
+        while ((offset < len) && (status == CY_U3P_SUCCESS))
+        {
+            /* A single I2C transfer has to stay within one 64KB device address. */
+            chunk = len - offset;
+            if (chunk > (0x10000 - (glBulkProgAddress & 0xFFFF)))
+            {
+                chunk = 0x10000 - (glBulkProgAddress & 0xFFFF);
+            }
+
+            i2cAddr = 0xA0 | (((glBulkProgAddress >> 16) & 0x0007) << 1);
+            status = CyFxFlashProgI2cTransfer ((uint16_t)(glBulkProgAddress & 0xFFFF), i2cAddr,
+                    (uint16_t)chunk, buf.buffer + offset, CyFalse);
+
+            offset              += chunk;
+            glBulkProgAddress   += chunk;
+            glBulkProgRemaining -= chunk;
+        }
+
+        CyU3PDmaChannelDiscardBuffer (&glBulkRxHandle);
+    }
+
+    if (status != CY_U3P_SUCCESS)
+    {
+        CyU3PDebugPrint (2, "Bulk EEPROM write failed, error code: %d\r\n", status);
+    }
+
+    CyFxFlashProgBulkReset ();
+
+    glBulkProgStatus = status;
+    glBulkProgBusy   = CyFalse;
+}
+
+/* Copy the next byteCount bytes received on the bulk programming endpoint into
+ * buffer. A received DMA buffer which is only partly used is kept for the next call,
+ * so the host does not need to align its transfers to the DMA buffer size. */
+CyU3PReturnStatus_t
+CyFxFlashProgBulkRecv (
+        uint8_t  *buffer,
+        uint32_t  byteCount)
+{
+    uint32_t chunk;
+    CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
+
+    while (byteCount != 0)
+    {
+        if (!glBulkBufValid)
+        {
+            status = CyU3PDmaChannelGetBuffer (&glBulkRxHandle, &glBulkBuf, CY_FX_FLASH_PROG_TIMEOUT);
+            if (status != CY_U3P_SUCCESS)
+            {
+                return status;
+            }
+            if (glBulkBuf.count == 0)
+            {
+                /* Zero length packet before all of the data was received. */
+                CyU3PDmaChannelDiscardBuffer (&glBulkRxHandle);
+                return CY_U3P_ERROR_FAILURE;
+            }
+            glBulkBufOffset = 0;
+            glBulkBufValid  = CyTrue;
+        }
+
+        chunk = glBulkBuf.count - glBulkBufOffset;
+        if (chunk > byteCount)
+        {
+            chunk = byteCount;
+        }
+        CyU3PMemCopy (buffer, glBulkBuf.buffer + glBulkBufOffset, chunk);
+        buffer          += chunk;
+        byteCount       -= chunk;
+        glBulkBufOffset += chunk;
+
+        if (glBulkBufOffset == glBulkBuf.count)
+        {
+            CyU3PDmaChannelDiscardBuffer (&glBulkRxHandle);
+            glBulkBufValid = CyFalse;
+        }
+    }
+
+    return status;
+}
+
+/* Program the SPI flash with the data received on the bulk OUT endpoint, one sector
+ * at a time. This runs in the application thread.
+ *
+ * With CY_FX_SPI_BULK_VERIFY_SKIP set, each sector is read back with one continuous
+ * fast read and compared against the incoming data first. Sectors which already hold
+ * the data are neither erased nor programmed, so re-programming an image with small
+ * changes only rewrites the sectors which changed. Pages which are all 0xFF are not
+ * programmed, since the sector erase already leaves them blank. */
+void
+CyFxFlashProgSpiBulkWrite (
+        void)
+{
+    uint8_t *sectorBuf = NULL;
+    uint8_t *readBuf = NULL;
+    uint32_t sectorLen, page, i;
+    CyBool_t mismatch;
+    CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
+
+    CyU3PDebugPrint (2, "Bulk SPI write - address: 0x%x, size: 0x%x, flags: 0x%x.\r\n",
+            glBulkProgAddress, glBulkProgRemaining, glBulkProgFlags);
+
+    sectorBuf = (uint8_t *)CyU3PDmaBufferAlloc (CY_FX_SPI_SECTOR_SIZE);
+    readBuf   = (uint8_t *)CyU3PDmaBufferAlloc (CY_FX_SPI_READ_CHUNK);
+    if ((sectorBuf == NULL) || (readBuf == NULL))
+    {
+        status = CY_U3P_ERROR_MEMORY_ERROR;
+    }
+
+    while ((glBulkProgRemaining != 0) && (status == CY_U3P_SUCCESS))
+    {
+        sectorLen = (glBulkProgRemaining > CY_FX_SPI_SECTOR_SIZE) ? CY_FX_SPI_SECTOR_SIZE : glBulkProgRemaining;
+
+        /* Collect the sector from USB. Pad a partial last sector with the erased value. */
+        CyU3PMemSet (sectorBuf + sectorLen, 0xFF, CY_FX_SPI_SECTOR_SIZE - sectorLen);
+        status = CyFxFlashProgBulkRecv (sectorBuf, sectorLen);
+        if (status != CY_U3P_SUCCESS)
+        {
+            break;
+        }
+
+        mismatch = CyTrue;
+        if (glBulkProgFlags & CY_FX_SPI_BULK_VERIFY_SKIP)
+        {
+            mismatch = CyFalse;
+            status = CyFxFlashProgSpiFastRead (glBulkProgAddress, sectorLen, readBuf, sectorBuf, &mismatch);
+            if (status != CY_U3P_SUCCESS)
+            {
+                break;
+            }
+        }
+
+        if (mismatch)
+        {
+            status = CyFxFlashProgEraseSector (CyTrue, (uint8_t)(glBulkProgAddress / CY_FX_SPI_SECTOR_SIZE), NULL);
+            if (status != CY_U3P_SUCCESS)
+            {
+                break;
+            }
+
+            for (page = 0; (page < sectorLen) && (status == CY_U3P_SUCCESS); page += glSpiPageSize)
+            {
+                for (i = 0; i < glSpiPageSize; i++)
+                {
+                    if (sectorBuf[page + i] != 0xFF)
+                        break;
+                }
+                if (i != glSpiPageSize)
+                {
+                    status = CyFxFlashProgSpiTransfer ((uint16_t)((glBulkProgAddress + page) / glSpiPageSize),
+                            glSpiPageSize, sectorBuf + page, CyFalse);
+                }
+            }
+
+            /* Leave the flash idle before the next sector is compared. */
+            if (status == CY_U3P_SUCCESS)
+            {
+                status = CyFxFlashProgSpiWaitForStatus ();
+            }
+        }
+        else
+        {
+            glBulkProgSkipped++;
+        }
+
+        glBulkProgAddress   += sectorLen;
+        glBulkProgRemaining -= sectorLen;
+    }
+
+    if (status != CY_U3P_SUCCESS)
+    {
+        CyU3PDebugPrint (2, "Bulk SPI write failed, error code: %d\r\n", status);
+    }
+    else
+    {
+        CyU3PDebugPrint (2, "Bulk SPI write done, %d sectors skipped\r\n", glBulkProgSkipped);
+    }
+
+    /* Drop any data left over in a partly used DMA buffer, or still queued in the channel. */
+    CyFxFlashProgBulkReset ();
+
+    if (sectorBuf != NULL)
+        CyU3PDmaBufferFree (sectorBuf);
+    if (readBuf != NULL)
+        CyU3PDmaBufferFree (readBuf);
+
+    glBulkProgStatus = status;
+    glBulkProgBusy   = CyFalse;
+}
+
+/* Create the bulk OUT endpoint and DMA channel used for EEPROM programming data. */
+CyU3PReturnStatus_t
+CyFxFlashProgBulkStart (
+        void)
+{
+    CyU3PEpConfig_t epCfg;
+    CyU3PDmaChannelConfig_t dmaConfig;
+    CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
+
+    CyU3PMemSet ((uint8_t *)&epCfg, 0, sizeof (epCfg));
+    epCfg.enable   = CyTrue;
+    epCfg.epType   = CY_U3P_USB_EP_BULK;
+    epCfg.burstLen = 1;
+    epCfg.streams  = 0;
+    switch (CyU3PUsbGetSpeed ())
+    {
+        case CY_U3P_SUPER_SPEED:
+            epCfg.pcktSize = 1024;
+            break;
+        case CY_U3P_HIGH_SPEED:
+            epCfg.pcktSize = 512;
+            break;
+        default:
+            epCfg.pcktSize = 64;
+            break;
+    }
+
+    status = CyU3PSetEpConfig (CY_FX_EP_PROG_DATA, &epCfg);
+    if (status != CY_U3P_SUCCESS)
+    {
+        return status;
+    }
+
+    CyU3PMemSet ((uint8_t *)&dmaConfig, 0, sizeof (dmaConfig));
+    dmaConfig.size           = CY_FX_BULK_PROG_BUF_SIZE;
+    dmaConfig.count          = CY_FX_BULK_PROG_BUF_COUNT;
+    dmaConfig.prodSckId      = CY_FX_EP_PROG_DATA_SOCKET;
+    dmaConfig.consSckId      = CY_U3P_CPU_SOCKET_CONS;
+    dmaConfig.dmaMode        = CY_U3P_DMA_MODE_BYTE;
+    dmaConfig.notification   = 0;
+    dmaConfig.cb             = NULL;
+
+    status = CyU3PDmaChannelCreate (&glBulkRxHandle, CY_U3P_DMA_TYPE_MANUAL_IN, &dmaConfig);
+    if (status != CY_U3P_SUCCESS)
+    {
+        return status;
+    }
+    glBulkChannelActive = CyTrue;
+
+    /* Receive continuously, so the endpoint is ready before the host starts sending. */
+    return CyU3PDmaChannelSetXfer (&glBulkRxHandle, 0);
+}
+
+/* Tear down the bulk programming endpoint and DMA channel. */
+void
+CyFxFlashProgBulkStop (
+        void)
+{
+    CyU3PEpConfig_t epCfg;
+
+    if (glBulkChannelActive)
+    {
+        CyU3PDmaChannelDestroy (&glBulkRxHandle);
+        glBulkChannelActive = CyFalse;
+        glBulkBufValid = CyFalse;
+    }
+
+    CyU3PUsbFlushEp (CY_FX_EP_PROG_DATA);
+
+    CyU3PMemSet ((uint8_t *)&epCfg, 0, sizeof (epCfg));
+    epCfg.enable = CyFalse;
+    CyU3PSetEpConfig (CY_FX_EP_PROG_DATA, &epCfg);
+}
+
 CyBool_t
 CyFxUSBSetupCB (
         uint32_t setupdat0,
@@ -592,6 +1025,7 @@ CyFxUSBSetupCB (
     uint8_t  bRequest, bReqType;
     uint8_t  bType, bTarget;
     uint16_t wValue, wIndex, wLength;
+    uint32_t addr32, len32;
     CyBool_t isHandled = CyFalse;
     CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
 
@@ -641,6 +1075,11 @@ CyFxUSBSetupCB (
             case CY_FX_RQT_I2C_EEPROM_WRITE:
                 i2cAddr = 0xA0 | ((wValue & 0x0007) << 1);
                 status  = CyU3PUsbGetEP0Data(wLength, glEp0Buffer, NULL);
+                if ((status == CY_U3P_SUCCESS) && (glBulkProgBusy))
+                {
+                    /* The I2C channels are in use by a bulk programming operation. */
+                    status = CY_U3P_ERROR_INVALID_SEQUENCE;
+                }
                 if (status == CY_U3P_SUCCESS)
                 {
                     CyFxFlashProgI2cTransfer (wIndex, i2cAddr, wLength,
@@ -649,6 +1088,11 @@ CyFxUSBSetupCB (
                 break;
 
             case CY_FX_RQT_I2C_EEPROM_READ:
+                if (glBulkProgBusy)
+                {
+                    status = CY_U3P_ERROR_INVALID_SEQUENCE;
+                    break;
+                }
                 i2cAddr = 0xA0 | ((wValue & 0x0007) << 1);
                 CyU3PMemSet (glEp0Buffer, 0, sizeof (glEp0Buffer));
                 status = CyFxFlashProgI2cTransfer (wIndex, i2cAddr, wLength,
@@ -659,6 +1103,60 @@ CyFxUSBSetupCB (
                 }
                 break;
 
+            case CY_FX_RQT_I2C_EEPROM_BULK_WRITE:
+                status = CyU3PUsbGetEP0Data (8, glEp0Buffer, NULL);
+                if (status == CY_U3P_SUCCESS)
+                {
+                    addr32 = glEp0Buffer[0] | (glEp0Buffer[1] << 8) | (glEp0Buffer[2] << 16) | (glEp0Buffer[3] << 24);
+                    len32  = glEp0Buffer[4] | (glEp0Buffer[5] << 8) | (glEp0Buffer[6] << 16) | (glEp0Buffer[7] << 24);
+                    if ((wLength != 8) || (glBulkProgBusy) || (!glBulkChannelActive) || (len32 == 0) ||
+                            (addr32 >= CY_FX_I2C_EEPROM_SIZE) || (len32 > (CY_FX_I2C_EEPROM_SIZE - addr32)))
+                    {
+                        status = CY_U3P_ERROR_BAD_ARGUMENT;
+                        break;
+                    }
+
+                    glBulkProgAddress   = addr32;
+                    glBulkProgRemaining = len32;
+                    glBulkProgSkipped   = 0;
+                    glBulkProgStatus    = CY_U3P_SUCCESS;
+                    glBulkProgBusy      = CyTrue;
+                    CyU3PEventSet (&glFlashProgEvent, CY_FX_FLASH_PROG_EVT_BULK_WRITE, CYU3P_EVENT_OR);
+                }
+                break;
+
+            case CY_FX_RQT_SPI_FLASH_BULK_WRITE:
+                status = CyU3PUsbGetEP0Data (8, glEp0Buffer, NULL);
+                if (status == CY_U3P_SUCCESS)
+                {
+                    addr32 = glEp0Buffer[0] | (glEp0Buffer[1] << 8) | (glEp0Buffer[2] << 16) | (glEp0Buffer[3] << 24);
+                    len32  = glEp0Buffer[4] | (glEp0Buffer[5] << 8) | (glEp0Buffer[6] << 16) | (glEp0Buffer[7] << 24);
+                    if ((wLength != 8) || (glBulkProgBusy) || (!glBulkChannelActive) || (len32 == 0) ||
+                            ((addr32 % CY_FX_SPI_SECTOR_SIZE) != 0) || (addr32 >= CY_FX_SPI_FLASH_SIZE) ||
+                            (len32 > (CY_FX_SPI_FLASH_SIZE - addr32)))
+                    {
+                        status = CY_U3P_ERROR_BAD_ARGUMENT;
+                        break;
+                    }
+
+                    glBulkProgAddress   = addr32;
+                    glBulkProgRemaining = len32;
+                    glBulkProgFlags     = wValue;
+                    glBulkProgSkipped   = 0;
+                    glBulkProgStatus    = CY_U3P_SUCCESS;
+                    glBulkProgBusy      = CyTrue;
+                    CyU3PEventSet (&glFlashProgEvent, CY_FX_FLASH_PROG_EVT_SPI_BULK_WRITE, CYU3P_EVENT_OR);
+                }
+                break;
+
+            case CY_FX_RQT_BULK_PROG_STATUS:
+                ((uint32_t *)glEp0Buffer)[0] = glBulkProgStatus;
+                ((uint32_t *)glEp0Buffer)[1] = glBulkProgBusy;
+                ((uint32_t *)glEp0Buffer)[2] = glBulkProgRemaining;
+                ((uint32_t *)glEp0Buffer)[3] = glBulkProgSkipped;
+                status = CyU3PUsbSendEP0Data ((wLength > 16) ? 16 : wLength, glEp0Buffer);
+                break;
+
             case CY_FX_RQT_SYS_MEM_READ:
                 addr = (uint32_t *)((wIndex << 16) | wValue);
                 offset = 0;
@@ -681,6 +1179,11 @@ CyFxUSBSetupCB (
 
             case CY_FX_RQT_SPI_FLASH_WRITE:
                 status = CyU3PUsbGetEP0Data (wLength, glEp0Buffer, NULL);
+                if ((status == CY_U3P_SUCCESS) && (glBulkProgBusy))
+                {
+                    /* The SPI channels are in use by a bulk programming operation. */
+                    status = CY_U3P_ERROR_INVALID_SEQUENCE;
+                }
                 if (status == CY_U3P_SUCCESS)
                 {
                     status = CyFxFlashProgSpiTransfer (wIndex, wLength,
@@ -689,6 +1192,11 @@ CyFxUSBSetupCB (
                 break;
 
             case CY_FX_RQT_SPI_FLASH_READ:
+                if (glBulkProgBusy)
+                {
+                    status = CY_U3P_ERROR_INVALID_SEQUENCE;
+                    break;
+                }
                 CyU3PMemSet (glEp0Buffer, 0, sizeof (glEp0Buffer));
                 status = CyFxFlashProgSpiTransfer (wIndex, wLength,
                         glEp0Buffer, CyTrue);
@@ -699,6 +1207,11 @@ CyFxUSBSetupCB (
                 break;
 
             case CY_FX_RQT_SPI_FLASH_ERASE_POLL:
+                if (glBulkProgBusy)
+                {
+                    status = CY_U3P_ERROR_INVALID_SEQUENCE;
+                    break;
+                }
                 status = CyFxFlashProgEraseSector ((wValue) ? CyTrue : CyFalse,
                         (wIndex & 0xFF), glEp0Buffer);
                 if (status == CY_U3P_SUCCESS)
@@ -759,12 +1272,24 @@ CyFxUSBEventCB (
     switch (evtype)
     {
         case CY_U3P_USB_EVENT_SETCONF:
+            if (glIsApplnActive)
+            {
+                CyFxFlashProgBulkStop ();
+            }
             glIsApplnActive = CyTrue;
             CyU3PUsbLPMDisable();
+            if (CyFxFlashProgBulkStart () != CY_U3P_SUCCESS)
+            {
+                CyU3PDebugPrint (2, "Bulk programming endpoint setup failed\r\n");
+            }
             break;
 
         case CY_U3P_USB_EVENT_RESET:
         case CY_U3P_USB_EVENT_DISCONNECT:
+            if (glIsApplnActive)
+            {
+                CyFxFlashProgBulkStop ();
+            }
             glIsApplnActive = CyFalse;
             /* Reset the I2C and SPI DMA channels. */
             CyU3PDmaChannelReset (&glI2cTxHandle);
@@ -800,6 +1325,13 @@ CyFxFlashProgInit (
 {
     CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
 
+    /* Event used to hand bulk programming operations to the application thread. */
+    status = CyU3PEventCreate (&glFlashProgEvent);
+    if (status != CY_U3P_SUCCESS)
+    {
+        return status;
+    }
+
     /* Initialize the I2C interface for the EEPROM of page size 64 bytes. */
     status = CyFxFlashProgI2cInit (0x40);
     if (status != CY_U3P_SUCCESS)
@@ -914,13 +1446,15 @@ CyFxFlashProgInit (
  * Entry function for the application thread. This function performs
  * the initialization of the Debug, I2C, SPI and USB modules and then
  * executes in a loop printing out heartbeat messages through the UART.
- * All of the flash programming functionality is implemented in callbacks.
+ * Bulk programming operations are run from this loop; all of the other
+ * flash programming functionality is implemented in callbacks.
  */
 void
 AppThread_Entry (
         uint32_t input)
 {
     uint8_t count = 0;
+    uint32_t eventFlag;
     CyU3PReturnStatus_t status = CY_U3P_SUCCESS;
 
     /* Initialize the debug interface. */
@@ -939,10 +1473,25 @@ AppThread_Entry (
 
     for (;;)
     {
+        status = CyU3PEventGet (&glFlashProgEvent,
+                CY_FX_FLASH_PROG_EVT_BULK_WRITE | CY_FX_FLASH_PROG_EVT_SPI_BULK_WRITE,
+                CYU3P_EVENT_OR_CLEAR, &eventFlag, 1000);
+        if (status == CY_U3P_SUCCESS)
+        {
+            if (eventFlag & CY_FX_FLASH_PROG_EVT_BULK_WRITE)
+            {
+                CyFxFlashProgBulkWrite ();
+            }
+            if (eventFlag & CY_FX_FLASH_PROG_EVT_SPI_BULK_WRITE)
+            {
+                CyFxFlashProgSpiBulkWrite ();
+            }
+            continue;
+        }
+
         CyU3PDebugPrint (4, "%x: Device initialized. Firmware ID: %x %x %x %x %x %x %x %x\r\n",
                 count++, glFirmwareID[3], glFirmwareID[2], glFirmwareID[1], glFirmwareID[0],
                 glFirmwareID[7], glFirmwareID[6], glFirmwareID[5], glFirmwareID[4]);
-        CyU3PThreadSleep (1000);
     }
 
 handle_error:
@@ -35,6 +35,38 @@
 /* Give a timeout value of 5s for any flash programming. */
 #define CY_FX_FLASH_PROG_TIMEOUT                (5000)
 
+/* Number of ACK polls to wait for an I2C EEPROM write cycle to complete. The poll
+ * is one device address byte (~100 us at 100 KHz), so this covers well over the
+ * 5 ms maximum write cycle time. If the EEPROM never ACKs, a fixed 10 ms delay
+ * is used instead. */
+#define CY_FX_I2C_ACK_POLL_RETRIES              (1000)
+
+/* Total addressable I2C EEPROM space (8 device addresses of 64KB each). */
+#define CY_FX_I2C_EEPROM_SIZE                   (0x80000)
+
+/* Bulk OUT endpoint and socket used for EEPROM programming data. */
+#define CY_FX_EP_PROG_DATA                      (0x01)
+#define CY_FX_EP_PROG_DATA_SOCKET               (CY_U3P_UIB_SOCKET_PROD_1)
+
+/* Size and number of the DMA buffers for the bulk programming channel. While the
+ * firmware writes one buffer to the EEPROM, USB keeps receiving into the others. */
+#define CY_FX_BULK_PROG_BUF_SIZE                (4096)
+#define CY_FX_BULK_PROG_BUF_COUNT               (4)
+
+/* Event flags used to start bulk programming operations. */
+#define CY_FX_FLASH_PROG_EVT_BULK_WRITE         (1 << 0)
+#define CY_FX_FLASH_PROG_EVT_SPI_BULK_WRITE     (1 << 1)
+
+/* SPI flash sector (erase block) size, and the addressable flash size (24-bit addressing). */
+#define CY_FX_SPI_SECTOR_SIZE                   (0x10000)
+#define CY_FX_SPI_FLASH_SIZE                    (0x1000000)
+
+/* Max size of a single DMA transfer during a continuous SPI flash read. */
+#define CY_FX_SPI_READ_CHUNK                    (0x1000)
+
+/* Flag for CY_FX_RQT_SPI_FLASH_BULK_WRITE: skip sectors which already hold the data. */
+#define CY_FX_SPI_BULK_VERIFY_SKIP              (1 << 0)
+
 
 /* USB vendor requests supported by the application. */
 
@@ -54,6 +86,19 @@
  * request. The maximum allowed request length is 4KB. */
 #define CY_FX_RQT_I2C_EEPROM_READ               (0xBB)
 
+/* USB vendor request to program the I2C EEPROM with data sent on the bulk OUT
+ * endpoint (CY_FX_EP_PROG_DATA). The 8 byte data stage holds the linear EEPROM
+ * start address (bit 16 and up select the device address) and the number of bytes
+ * to program, both 32-bit little endian. The programming runs in the background;
+ * use CY_FX_RQT_BULK_PROG_STATUS to check for completion. */
+#define CY_FX_RQT_I2C_EEPROM_BULK_WRITE         (0xBC)
+
+/* USB vendor request to read the status of the last bulk programming operation
+ * (I2C EEPROM or SPI flash). Returns up to 16 bytes: the status code, a busy flag,
+ * the number of bytes remaining, and the number of SPI flash sectors skipped
+ * because they already held the data, each 32-bit little endian. */
+#define CY_FX_RQT_BULK_PROG_STATUS              (0xBD)
+
 /* USB vendor request to read data from SYS_MEM starting at 32-bit aligned given
  * address. The MS 16-bit of start address is provided in the index field and the
  * LS 16-bit is provided in the value field of the request. */
@@ -69,6 +114,15 @@
  * field of the request. The maximum allowed request length is 4KB. */
 #define CY_FX_RQT_SPI_FLASH_READ                (0xC3)
 
+/* USB vendor request to program the SPI flash with data sent on the bulk OUT
+ * endpoint (CY_FX_EP_PROG_DATA). The 8 byte data stage holds the sector aligned
+ * flash start address and the number of bytes to program, both 32-bit little endian.
+ * The value field holds flags. With CY_FX_SPI_BULK_VERIFY_SKIP set, each sector is
+ * first read back with one continuous fast read and compared with the incoming data,
+ * and is only erased and programmed if it differs. The programming runs in the
+ * background; use CY_FX_RQT_BULK_PROG_STATUS to check for completion. */
+#define CY_FX_RQT_SPI_FLASH_BULK_WRITE          (0xC5)
+
 /* USB vendor request to erase a sector on SPI flash connected. The flash sector
  * size is fixed to 64KB. The sector address is provided in the index field of
  * the request. The erase is carried out if the value field is non-zero. If this 
@@ -0,0 +1,477 @@
+/*
+ * fx3_image.c
+ *
+ *  Created on: Oct 17, 2020
+ *      Author: A. Nolan
+ *
+ *  Host side FX3 firmware image handling. The packed image checks match the bootloader (boot_fw/usb_boot.c
+ *  and boot_fw/i2c_boot.c), and the unpack path uses the bootloader LZ4 decoder and CRC32 directly, so an
+ *  image which unpacks here loads on the FX3.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cyfx3device.h"
+#include "main.h"
+#include "lz4_compress.h"
+#include "fx3_image.h"
+
+/* Cypress boot image header: 'C', 'Y', image control byte, image type */
+#define FX3_IMAGE_TYPE_NORMAL       (0xB0)
+
+/* Reads a little endian 32-bit word */
+static uint32_t
+myGet32 (
+        const uint8_t *p
+        )
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/* Writes a little endian 32-bit word */
+static void
+myPut32 (
+        uint8_t *p,
+        uint32_t val
+        )
+{
+    p[0] = (uint8_t)val;
+    p[1] = (uint8_t)(val >> 8);
+    p[2] = (uint8_t)(val >> 16);
+    p[3] = (uint8_t)(val >> 24);
+}
+
+/* Same check as myCheckAddress in the bootloader (usb_boot.c): word aligned, and entirely in ITCM or SYSMEM */
+static int
+myCheckSectionAddress (
+        uint32_t address,
+        uint32_t len
+        )
+{
+    uint64_t end = (uint64_t)address + len;
+
+    if (address & 3)
+    {
+        return -1;
+    }
+    if ((address >= CY_FX3_BOOT_SYSMEM_BASE1) && (end <= CY_FX3_BOOT_SYSMEM_END))
+    {
+        return 0;
+    }
+    if (end <= CY_FX3_BOOT_ITCM_END)
+    {
+        return 0;
+    }
+    return -1;
+}
+
+/* Checks a compressed section fits the bootloader staging area, the same way as the ADI_BULK_LOAD_SECTION
+   handler. ITCM sections are decompressed into the staging area after the compressed data */
+static int
+myCheckStaging (
+        uint32_t address,
+        uint32_t storedLen,
+        uint32_t len
+        )
+{
+    uint32_t stagingLen = storedLen;
+
+    if ((address + len) <= CY_FX3_BOOT_ITCM_END)
+    {
+        stagingLen = ((storedLen + 3) & ~3) + len;
+    }
+    if ((storedLen > USB_STAGING_SIZE) || (stagingLen > USB_STAGING_SIZE) ||
+            ((address < USB_DMA_BUF_ADDRESS) && ((address + len) > USB_STAGING_ADDRESS)))
+    {
+        return -1;
+    }
+    return 0;
+}
+
+int
+fx3ReadFile (
+        const char *path_p,
+        uint8_t **buf_pp,
+        uint32_t *len_p
+        )
+{
+    FILE *file_p = fopen (path_p, "rb");
+    long len;
+
+    *buf_pp = NULL;
+    if (file_p == NULL)
+    {
+        return -1;
+    }
+
+    if ((fseek (file_p, 0, SEEK_END) != 0) || ((len = ftell (file_p)) < 0) || (fseek (file_p, 0, SEEK_SET) != 0))
+    {
+        fclose (file_p);
+        return -1;
+    }
+
+    /* Always allocate at least one byte, so an empty file still returns a buffer */
+    *buf_pp = (uint8_t *)malloc ((size_t)len + 1);
+    if ((*buf_pp == NULL) || (fread (*buf_pp, 1, (size_t)len, file_p) != (size_t)len))
+    {
+        free (*buf_pp);
+        *buf_pp = NULL;
+        fclose (file_p);
+        return -1;
+    }
+
+    fclose (file_p);
+    *len_p = (uint32_t)len;
+    return 0;
+}
+
+int
+fx3WriteFile (
+        const char *path_p,
+        const uint8_t *buf_p,
+        uint32_t len
+        )
+{
+    FILE *file_p = fopen (path_p, "wb");
+    int status = 0;
+
+    if (file_p == NULL)
+    {
+        return -1;
+    }
+    if (fwrite (buf_p, 1, len, file_p) != len)
+    {
+        status = -1;
+    }
+    if (fclose (file_p) != 0)
+    {
+        status = -1;
+    }
+    return status;
+}
+
+int
+fx3ImageParse (
+        const uint8_t *buf_p,
+        uint32_t len,
+        Fx3Image_t *image_p
+        )
+{
+    uint32_t offset = 4;
+    uint32_t checksum = 0;
+    uint32_t words, address, i;
+
+    memset (image_p, 0, sizeof (Fx3Image_t));
+
+    /* Executable image (image control bit 0 clear) of the normal FX3 image type */
+    if ((len < 4) || (buf_p[0] != 'C') || (buf_p[1] != 'Y') || (buf_p[2] & 0x01) ||
+            (buf_p[3] != FX3_IMAGE_TYPE_NORMAL))
+    {
+        return FX3_IMAGE_ERR_FORMAT;
+    }
+
+    for (;;)
+    {
+        if ((len - offset) < 8)
+        {
+            return FX3_IMAGE_ERR_FORMAT;
+        }
+        words   = myGet32 (&buf_p[offset]);
+        address = myGet32 (&buf_p[offset + 4]);
+        offset += 8;
+
+        /* A zero length section holds the entry point, and is followed by the checksum */
+        if (words == 0)
+        {
+            break;
+        }
+
+        if ((words > ((len - offset) / 4)) || (image_p->sectionCount >= FX3_IMAGE_MAX_SECTIONS))
+        {
+            return FX3_IMAGE_ERR_FORMAT;
+        }
+        if (myCheckSectionAddress (address, words * 4) != 0)
+        {
+            return FX3_IMAGE_ERR_ADDRESS;
+        }
+
+        image_p->sections[image_p->sectionCount].address = address;
+        image_p->sections[image_p->sectionCount].length  = words * 4;
+        image_p->sections[image_p->sectionCount].data_p  = &buf_p[offset];
+        image_p->sectionCount++;
+
+        for (i = 0; i < words; i++)
+        {
+            checksum += myGet32 (&buf_p[offset]);
+            offset += 4;
+        }
+    }
+
+    if ((len - offset) < 4)
+    {
+        return FX3_IMAGE_ERR_FORMAT;
+    }
+
+    image_p->entry       = address;
+    image_p->checksum    = myGet32 (&buf_p[offset]);
+    image_p->imageLength = offset + 4;
+
+    if (image_p->checksum != checksum)
+    {
+        return FX3_IMAGE_ERR_CHECKSUM;
+    }
+
+    return FX3_IMAGE_OK;
+}
+
+void
+fx3ImageDataCrc (
+        const Fx3Image_t *image_p,
+        uint32_t *crc_p,
+        uint32_t *len_p
+        )
+{
+    uint32_t i;
+
+    *crc_p = 0;
+    *len_p = 0;
+    for (i = 0; i < image_p->sectionCount; i++)
+    {
+        *crc_p = myCrc32 (*crc_p, image_p->sections[i].data_p, image_p->sections[i].length);
+        *len_p += image_p->sections[i].length;
+    }
+}
+
+void
+fx3ImageSign (
+        const Fx3Image_t *image_p,
+        uint8_t *sig_p
+        )
+{
+    uint32_t crc, len;
+
+    fx3ImageDataCrc (image_p, &crc, &len);
+    myPut32 (&sig_p[0], FX3_SIGNATURE_MAGIC);
+    myPut32 (&sig_p[4], crc);
+    myPut32 (&sig_p[8], len);
+    myPut32 (&sig_p[12], ~crc);
+}
+
+int
+fx3ImageCheckSignature (
+        const Fx3Image_t *image_p,
+        const uint8_t *buf_p,
+        uint32_t len,
+        uint32_t *crc_p,
+        uint32_t *len_p
+        )
+{
+    const uint8_t *sig_p = &buf_p[image_p->imageLength];
+    uint32_t crc, dataLen;
+
+    if (((len - image_p->imageLength) != FX3_SIGNATURE_SIZE) || (myGet32 (&sig_p[0]) != FX3_SIGNATURE_MAGIC) ||
+            (myGet32 (&sig_p[12]) != ~myGet32 (&sig_p[4])))
+    {
+        return FX3_IMAGE_ERR_FORMAT;
+    }
+
+    *crc_p = myGet32 (&sig_p[4]);
+    *len_p = myGet32 (&sig_p[8]);
+
+    fx3ImageDataCrc (image_p, &crc, &dataLen);
+    if ((crc != *crc_p) || (dataLen != *len_p))
+    {
+        return FX3_IMAGE_ERR_CRC;
+    }
+
+    return FX3_IMAGE_OK;
+}
+
+/* Appends one packed section. The section is stored LZ4 compressed when that is smaller and the compressed
+   section fits the bootloader staging area, otherwise it is stored raw. Returns the new output offset, or
+   FX3_IMAGE_ERR_SPACE */
+static int
+myPackSection (
+        uint32_t address,
+        const uint8_t *data_p,
+        uint32_t len,
+        int compress,
+        uint8_t *out_p,
+        uint32_t outLen,
+        uint32_t offset
+        )
+{
+    uint8_t *comp_p = NULL;
+    const uint8_t *stored_p = data_p;
+    uint32_t storedLen = len;
+    uint32_t padLen;
+    int compLen;
+
+    if (compress)
+    {
+        comp_p = (uint8_t *)malloc (LZ4_COMPRESS_BOUND (len));
+        if (comp_p == NULL)
+        {
+            return FX3_IMAGE_ERR_SPACE;
+        }
+
+        compLen = lz4Compress (data_p, len, comp_p, LZ4_COMPRESS_BOUND (len));
+        if ((compLen > 0) && ((uint32_t)compLen < len) && (myCheckStaging (address, (uint32_t)compLen, len) == 0))
+        {
+            stored_p  = comp_p;
+            storedLen = (uint32_t)compLen;
+        }
+    }
+
+    padLen = ((storedLen + 3) & ~3) - storedLen;
+    if ((outLen - offset) < (FX3_SECTION_HEADER_SIZE + storedLen + padLen))
+    {
+        free (comp_p);
+        return FX3_IMAGE_ERR_SPACE;
+    }
+
+    myPut32 (&out_p[offset], address);
+    myPut32 (&out_p[offset + 4], storedLen);
+    myPut32 (&out_p[offset + 8], len);
+    myPut32 (&out_p[offset + 12], myCrc32 (0, data_p, len));
+    offset += FX3_SECTION_HEADER_SIZE;
+
+    memcpy (&out_p[offset], stored_p, storedLen);
+    memset (&out_p[offset + storedLen], 0, padLen);
+    offset += storedLen + padLen;
+
+    free (comp_p);
+    return (int)offset;
+}
+
+int
+fx3ImagePack (
+        const Fx3Image_t *image_p,
+        const Fx3PackOptions_t *options_p,
+        uint8_t *out_p,
+        uint32_t outLen
+        )
+{
+    uint32_t chunkSize = options_p->chunkSize & ~3;
+    uint32_t offset = 0;
+    uint32_t i, pos, len;
+    int status;
+
+    if (chunkSize == 0)
+    {
+        chunkSize = FX3_PACK_CHUNK_SIZE;
+    }
+
+    for (i = 0; i < image_p->sectionCount; i++)
+    {
+        for (pos = 0; pos < image_p->sections[i].length; pos += len)
+        {
+            len = image_p->sections[i].length - pos;
+            if (len > chunkSize)
+            {
+                len = chunkSize;
+            }
+
+            status = myPackSection (image_p->sections[i].address + pos, image_p->sections[i].data_p + pos, len,
+                    options_p->compress, out_p, outLen, offset);
+            if (status < 0)
+            {
+                return status;
+            }
+            offset = (uint32_t)status;
+        }
+    }
+
+    /* Entry point record ends the image */
+    if ((outLen - offset) < FX3_SECTION_HEADER_SIZE)
+    {
+        return FX3_IMAGE_ERR_SPACE;
+    }
+    myPut32 (&out_p[offset], image_p->entry);
+    myPut32 (&out_p[offset + 4], 0);
+    myPut32 (&out_p[offset + 8], 0);
+    myPut32 (&out_p[offset + 12], 0);
+    offset += FX3_SECTION_HEADER_SIZE;
+
+    return (int)offset;
+}
+
+int
+fx3ImageUnpack (
+        const uint8_t *packed_p,
+        uint32_t packedLen,
+        void (*section_cb)(uint32_t address, const uint8_t *data_p, uint32_t len, void *ctx_p),
+        void *ctx_p,
+        uint32_t *entry_p
+        )
+{
+    uint32_t offset = 0;
+    uint32_t address, storedLen, len, crc, padLen;
+    uint8_t *buf_p;
+    const uint8_t *data_p;
+
+    while ((packedLen - offset) >= FX3_SECTION_HEADER_SIZE)
+    {
+        address   = myGet32 (&packed_p[offset]);
+        storedLen = myGet32 (&packed_p[offset + 4]);
+        len       = myGet32 (&packed_p[offset + 8]);
+        crc       = myGet32 (&packed_p[offset + 12]);
+        offset   += FX3_SECTION_HEADER_SIZE;
+
+        if (len == 0)
+        {
+            if (offset != packedLen)
+            {
+                return FX3_IMAGE_ERR_FORMAT;
+            }
+            *entry_p = address;
+            return FX3_IMAGE_OK;
+        }
+
+        padLen = ((storedLen + 3) & ~3) - storedLen;
+        if ((myCheckSectionAddress (address, len) != 0) || (storedLen == 0) ||
+                ((uint64_t)storedLen + padLen > (packedLen - offset)))
+        {
+            return FX3_IMAGE_ERR_FORMAT;
+        }
+        if ((storedLen != len) && (myCheckStaging (address, storedLen, len) != 0))
+        {
+            return FX3_IMAGE_ERR_ADDRESS;
+        }
+
+        buf_p  = NULL;
+        data_p = &packed_p[offset];
+        if (storedLen != len)
+        {
+            buf_p = (uint8_t *)malloc (len);
+            if (buf_p == NULL)
+            {
+                return FX3_IMAGE_ERR_SPACE;
+            }
+            if (myLz4Decompress (data_p, storedLen, buf_p, len) != (int)len)
+            {
+                free (buf_p);
+                return FX3_IMAGE_ERR_FORMAT;
+            }
+            data_p = buf_p;
+        }
+
+        if (myCrc32 (0, data_p, len) != crc)
+        {
+            free (buf_p);
+            return FX3_IMAGE_ERR_CRC;
+        }
+
+        if (section_cb != NULL)
+        {
+            section_cb (address, data_p, len, ctx_p);
+        }
+
+        free (buf_p);
+        offset += storedLen + padLen;
+    }
+
+    /* Ran off the end of the image without an entry point */
+    return FX3_IMAGE_ERR_FORMAT;
+}
@@ -0,0 +1,137 @@
+/*
+ * fx3_image.h
+ *
+ *  Created on: Oct 17, 2020
+ *      Author: A. Nolan
+ *
+ *  Host side FX3 firmware image handling: parsing the Cypress boot image (.img) format, and packing an
+ *  image into the section format read by the bootloader (bulk download and stored image slots).
+ */
+
+#ifndef FX3_IMAGE_H_
+#define FX3_IMAGE_H_
+
+#include <stdint.h>
+
+/* Max number of sections in a Cypress boot image */
+#define FX3_IMAGE_MAX_SECTIONS      (64)
+
+/* Size of a packed section header (load address, stored length, loaded length, CRC32 of the loaded data) */
+#define FX3_SECTION_HEADER_SIZE     (16)
+
+/* Default max loaded length of a packed section. Larger image sections are split, so each compressed part
+   (plus the decompressed data, for ITCM) fits the bootloader staging area */
+#ifdef CYMEM_256K
+#define FX3_PACK_CHUNK_SIZE         (0x3000)
+#else
+#define FX3_PACK_CHUNK_SIZE         (0x8000)
+#endif
+
+/* Signature trailer magic number ("ADIS"). The trailer is appended to a Cypress boot image, after the
+   checksum, and is ignored by the Cypress image loaders */
+#define FX3_SIGNATURE_MAGIC         (0x53494441)
+
+/* Size of the signature trailer (magic, image CRC32, image data length, ~CRC32) */
+#define FX3_SIGNATURE_SIZE          (16)
+
+/* Error codes */
+#define FX3_IMAGE_OK                (0)
+#define FX3_IMAGE_ERR_FORMAT        (-1)    /* Not a Cypress boot image, or a truncated image */
+#define FX3_IMAGE_ERR_CHECKSUM      (-2)    /* Image checksum does not match the section data */
+#define FX3_IMAGE_ERR_ADDRESS       (-3)    /* Section address is not loadable by the bootloader */
+#define FX3_IMAGE_ERR_SPACE         (-4)    /* Output buffer is too small */
+#define FX3_IMAGE_ERR_CRC           (-5)    /* Section or image CRC32 does not match */
+
+/* Image section, pointing into the image file data */
+typedef struct
+{
+    uint32_t address;           /* Load address */
+    uint32_t length;            /* Length, in bytes */
+    const uint8_t *data_p;      /* Section data */
+} Fx3Section_t;
+
+/* Parsed Cypress boot image */
+typedef struct
+{
+    uint32_t sectionCount;      /* Number of sections */
+    Fx3Section_t sections[FX3_IMAGE_MAX_SECTIONS];
+    uint32_t entry;             /* Program entry point */
+    uint32_t checksum;          /* Image checksum (sum of the section data words) */
+    uint32_t imageLength;       /* Length of the image, up to and including the checksum */
+} Fx3Image_t;
+
+/* Packing options */
+typedef struct
+{
+    uint32_t chunkSize;         /* Max loaded length of each packed section */
+    int compress;               /* LZ4 compress sections which get smaller */
+} Fx3PackOptions_t;
+
+/* Reads a whole file. The buffer is allocated with malloc. Returns 0 on success */
+int
+fx3ReadFile (
+        const char *path_p,
+        uint8_t **buf_pp,
+        uint32_t *len_p);
+
+/* Writes a whole file. Returns 0 on success */
+int
+fx3WriteFile (
+        const char *path_p,
+        const uint8_t *buf_p,
+        uint32_t len);
+
+/* Parses a Cypress boot image, and checks its checksum. Returns an FX3_IMAGE error code */
+int
+fx3ImageParse (
+        const uint8_t *buf_p,
+        uint32_t len,
+        Fx3Image_t *image_p);
+
+/* Calculates the CRC32 and length of the image data as written to the bootloader with the 0xA0 command
+   (the section data, in file order). These are the values sent with ADI_SET_IMAGE_CRC */
+void
+fx3ImageDataCrc (
+        const Fx3Image_t *image_p,
+        uint32_t *crc_p,
+        uint32_t *len_p);
+
+/* Writes the signature trailer for a parsed image to sig_p (FX3_SIGNATURE_SIZE bytes) */
+void
+fx3ImageSign (
+        const Fx3Image_t *image_p,
+        uint8_t *sig_p);
+
+/* Checks the signature trailer of a signed image file (parsed into image_p). Returns FX3_IMAGE_OK if the
+   image is signed and the signature matches, FX3_IMAGE_ERR_FORMAT if there is no signature trailer, or
+   FX3_IMAGE_ERR_CRC if the image data does not match the signature. The signed CRC and length are returned
+   in crc_p and len_p */
+int
+fx3ImageCheckSignature (
+        const Fx3Image_t *image_p,
+        const uint8_t *buf_p,
+        uint32_t len,
+        uint32_t *crc_p,
+        uint32_t *len_p);
+
+/* Packs a parsed image into the bootloader section format. Returns the packed length, or an FX3_IMAGE
+   error code */
+int
+fx3ImagePack (
+        const Fx3Image_t *image_p,
+        const Fx3PackOptions_t *options_p,
+        uint8_t *out_p,
+        uint32_t outLen);
+
+/* Walks a packed image the same way the bootloader loads a stored slot: each section is decompressed with
+   the bootloader LZ4 decoder and its CRC32 checked. The loaded sections are passed to the callback (if not
+   NULL). Returns an FX3_IMAGE error code, and the entry point in entry_p */
+int
+fx3ImageUnpack (
+        const uint8_t *packed_p,
+        uint32_t packedLen,
+        void (*section_cb)(uint32_t address, const uint8_t *data_p, uint32_t len, void *ctx_p),
+        void *ctx_p,
+        uint32_t *entry_p);
+
+#endif /* FX3_IMAGE_H_ */
@@ -0,0 +1,146 @@
+/*
+ * fx3pack.c
+ *
+ *  Created on: Oct 17, 2020
+ *      Author: A. Nolan
+ *
+ *  Packs an FX3 firmware image (.img, as built by elf2img) into the bootloader section format, with LZ4
+ *  compressed sections. The packed image can be programmed into a stored image slot (ADI_IMAGE_UPDATE_START)
+ *  or sent section by section over the bulk download (ADI_BULK_LOAD_SECTION). The packed image is checked by
+ *  unpacking it with the bootloader decoder before it is written.
+ *
+ *  Usage: fx3pack [-r] [-c chunk_size] input.img output.bin
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cyfx3device.h"
+#include "main.h"
+#include "fx3_image.h"
+
+static void
+myUsage (
+        void
+        )
+{
+    fprintf (stderr, "Usage: fx3pack [-r] [-c chunk_size] input.img output.bin\n");
+    fprintf (stderr, "  -r             store all sections raw (no LZ4 compression)\n");
+    fprintf (stderr, "  -c chunk_size  max loaded length of each packed section (default 0x%X)\n", FX3_PACK_CHUNK_SIZE);
+}
+
+int
+main (
+        int argc,
+        char **argv
+        )
+{
+    Fx3PackOptions_t options;
+    Fx3Image_t image;
+    uint8_t *img_p = NULL;
+    uint8_t *out_p = NULL;
+    uint32_t imgLen, outLen, entry, i;
+    int argn = 1;
+    int status;
+
+    options.chunkSize = FX3_PACK_CHUNK_SIZE;
+    options.compress  = 1;
+
+    while ((argn < argc) && (argv[argn][0] == '-'))
+    {
+        if (strcmp (argv[argn], "-r") == 0)
+        {
+            options.compress = 0;
+        }
+        else if ((strcmp (argv[argn], "-c") == 0) && ((argn + 1) < argc))
+        {
+            options.chunkSize = (uint32_t)strtoul (argv[++argn], NULL, 0);
+            if ((options.chunkSize < 4) || (options.chunkSize > USB_STAGING_SIZE))
+            {
+                fprintf (stderr, "fx3pack: chunk size must be between 4 and 0x%X\n", USB_STAGING_SIZE);
+                return 1;
+            }
+        }
+        else
+        {
+            myUsage ();
+            return 1;
+        }
+        argn++;
+    }
+
+    if ((argc - argn) != 2)
+    {
+        myUsage ();
+        return 1;
+    }
+
+    if (fx3ReadFile (argv[argn], &img_p, &imgLen) != 0)
+    {
+        fprintf (stderr, "fx3pack: cannot read %s\n", argv[argn]);
+        return 1;
+    }
+
+    status = fx3ImageParse (img_p, imgLen, &image);
+    if (status != FX3_IMAGE_OK)
+    {
+        fprintf (stderr, "fx3pack: %s is not a valid FX3 image (error %d)\n", argv[argn], status);
+        free (img_p);
+        return 1;
+    }
+
+    /* Worst case is every section stored raw: one section header per chunk, plus the entry record */
+    outLen = imgLen + ((imgLen / options.chunkSize) + image.sectionCount + 1) * FX3_SECTION_HEADER_SIZE;
+    out_p = (uint8_t *)malloc (outLen);
+    if (out_p == NULL)
+    {
+        free (img_p);
+        return 1;
+    }
+
+    status = fx3ImagePack (&image, &options, out_p, outLen);
+    if (status < 0)
+    {
+        fprintf (stderr, "fx3pack: packing failed (error %d)\n", status);
+        free (out_p);
+        free (img_p);
+        return 1;
+    }
+    outLen = (uint32_t)status;
+
+    status = fx3ImageUnpack (out_p, outLen, NULL, NULL, &entry);
+    if ((status != FX3_IMAGE_OK) || (entry != image.entry))
+    {
+        fprintf (stderr, "fx3pack: packed image does not verify (error %d)\n", status);
+        free (out_p);
+        free (img_p);
+        return 1;
+    }
+
+    for (i = 0; i < image.sectionCount; i++)
+    {
+        printf ("section 0x%08X %6u bytes\n", image.sections[i].address, image.sections[i].length);
+    }
+    printf ("entry   0x%08X\n", image.entry);
+    printf ("packed  %u bytes (image %u bytes), CRC32 0x%08X\n", outLen, imgLen, myCrc32 (0, out_p, outLen));
+
+    /* The packed image must fit a stored image slot */
+    if (outLen > BOOT_SLOT_SIZE)
+    {
+        fprintf (stderr, "fx3pack: packed image is larger than a stored image slot (%u bytes)\n", BOOT_SLOT_SIZE);
+        free (out_p);
+        free (img_p);
+        return 1;
+    }
+
+    status = fx3WriteFile (argv[argn + 1], out_p, outLen);
+    free (out_p);
+    free (img_p);
+    if (status != 0)
+    {
+        fprintf (stderr, "fx3pack: cannot write %s\n", argv[argn + 1]);
+        return 1;
+    }
+
+    return 0;
+}
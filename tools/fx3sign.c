@@ -0,0 +1,109 @@
+/*
+ * fx3sign.c
+ *
+ *  Created on: Oct 17, 2020
+ *      Author: A. Nolan
+ *
+ *  Signs an FX3 firmware image (.img) for the bootloader control endpoint (0xA0) download. The CRC32 and
+ *  length of the image data are appended to the image as a signature trailer, which the host sends with
+ *  ADI_SET_IMAGE_CRC (0xA3) before the download. The bootloader refuses to start an image which does not
+ *  match. Signing an already signed image replaces its signature.
+ *
+ *  Usage: fx3sign input.img output.img
+ *         fx3sign -c signed.img
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "fx3_image.h"
+
+static void
+myUsage (
+        void
+        )
+{
+    fprintf (stderr, "Usage: fx3sign input.img output.img   sign an image\n");
+    fprintf (stderr, "       fx3sign -c signed.img          check the signature of a signed image\n");
+}
+
+int
+main (
+        int argc,
+        char **argv
+        )
+{
+    Fx3Image_t image;
+    uint8_t *img_p = NULL;
+    uint8_t *out_p;
+    uint32_t imgLen, crc, len;
+    int check = 0;
+    int argn = 1;
+    int status;
+
+    if ((argc == 3) && (strcmp (argv[1], "-c") == 0))
+    {
+        check = 1;
+        argn = 2;
+    }
+    else if ((argc != 3) || (argv[1][0] == '-'))
+    {
+        myUsage ();
+        return 1;
+    }
+
+    if (fx3ReadFile (argv[argn], &img_p, &imgLen) != 0)
+    {
+        fprintf (stderr, "fx3sign: cannot read %s\n", argv[argn]);
+        return 1;
+    }
+
+    status = fx3ImageParse (img_p, imgLen, &image);
+    if (status != FX3_IMAGE_OK)
+    {
+        fprintf (stderr, "fx3sign: %s is not a valid FX3 image (error %d)\n", argv[argn], status);
+        free (img_p);
+        return 1;
+    }
+
+    if (check)
+    {
+        status = fx3ImageCheckSignature (&image, img_p, imgLen, &crc, &len);
+        free (img_p);
+        if (status == FX3_IMAGE_ERR_FORMAT)
+        {
+            fprintf (stderr, "fx3sign: %s is not signed\n", argv[argn]);
+            return 1;
+        }
+        if (status != FX3_IMAGE_OK)
+        {
+            fprintf (stderr, "fx3sign: %s does not match its signature\n", argv[argn]);
+            return 1;
+        }
+        printf ("signature OK: CRC32 0x%08X, %u bytes\n", crc, len);
+        return 0;
+    }
+
+    /* Copy the image up to its checksum (dropping any old signature), then append the signature */
+    out_p = (uint8_t *)malloc (image.imageLength + FX3_SIGNATURE_SIZE);
+    if (out_p == NULL)
+    {
+        free (img_p);
+        return 1;
+    }
+    memcpy (out_p, img_p, image.imageLength);
+    fx3ImageSign (&image, &out_p[image.imageLength]);
+    fx3ImageDataCrc (&image, &crc, &len);
+
+    status = fx3WriteFile (argv[argn + 1], out_p, image.imageLength + FX3_SIGNATURE_SIZE);
+    free (out_p);
+    free (img_p);
+    if (status != 0)
+    {
+        fprintf (stderr, "fx3sign: cannot write %s\n", argv[argn + 1]);
+        return 1;
+    }
+
+    printf ("signed: CRC32 0x%08X, %u bytes\n", crc, len);
+    return 0;
+}
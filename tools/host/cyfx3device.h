@@ -0,0 +1,41 @@
+/*
+ * cyfx3device.h
+ *
+ *  Created on: Oct 17, 2020
+ *      Author: A. Nolan
+ *
+ *  Host build stand-in for the FX3 boot SDK header of the same name. Holds only the types, memory map
+ *  constants and functions used by the bootloader sources which are built into the host tools and tests
+ *  (boot_fw/boot_image.c and boot_fw/boot_slot.c). The values match the FX3 boot SDK.
+ */
+
+#ifndef CYFX3DEVICE_H_
+#define CYFX3DEVICE_H_
+
+#include <stdint.h>
+#include <string.h>
+
+typedef int CyBool_t;
+#define CyTrue                      (1)
+#define CyFalse                     (0)
+
+/* Memory map */
+#define CY_FX3_BOOT_ITCM_BASE       (0x00000000)
+#define CY_FX3_BOOT_ITCM_END        (0x00004000)
+#define CY_FX3_BOOT_SYSMEM_BASE1    (0x40000000)
+#ifdef CYMEM_256K
+#define CY_FX3_BOOT_SYSMEM_END      (0x40040000)
+#else
+#define CY_FX3_BOOT_SYSMEM_END      (0x40080000)
+#endif
+
+static inline void
+CyFx3BootMemCopy (
+        uint8_t *dest,
+        uint8_t *src,
+        uint32_t count)
+{
+    memmove (dest, src, count);
+}
+
+#endif /* CYFX3DEVICE_H_ */
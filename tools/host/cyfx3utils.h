@@ -0,0 +1,16 @@
+/*
+ * cyfx3utils.h
+ *
+ *  Created on: Oct 17, 2020
+ *      Author: A. Nolan
+ *
+ *  Host build stand-in for the FX3 boot SDK header of the same name. Everything used by the host built
+ *  bootloader sources is in cyfx3device.h.
+ */
+
+#ifndef CYFX3UTILS_H_
+#define CYFX3UTILS_H_
+
+#include "cyfx3device.h"
+
+#endif /* CYFX3UTILS_H_ */
@@ -0,0 +1,21 @@
+/*
+ * cyu3types.h
+ *
+ *  Created on: Oct 17, 2020
+ *      Author: A. Nolan
+ *
+ *  Host build stand-in for the FX3 SDK header of the same name. Holds only the types used by the
+ *  application memory functions (CyU3PMemSet and CyU3PMemCopy in FX3_Firmware/cyfxtx.c), which the host
+ *  tests build from the application source.
+ */
+
+#ifndef CYU3TYPES_H_
+#define CYU3TYPES_H_
+
+#include <stdint.h>
+
+typedef int CyBool_t;
+#define CyTrue                      (1)
+#define CyFalse                     (0)
+
+#endif /* CYU3TYPES_H_ */
@@ -0,0 +1,168 @@
+/*
+ * lz4_compress.c
+ *
+ *  Created on: Oct 17, 2020
+ *      Author: A. Nolan
+ *
+ *  Host side LZ4 block compressor. A greedy single entry hash table match finder, which is fast and gives a
+ *  ratio close to the reference LZ4 fast mode on firmware images. The output follows the LZ4 block format
+ *  end of block rules (the last 5 bytes are literals, and no match starts in the last 12 bytes), so it can
+ *  be read by any LZ4 block decoder.
+ */
+
+#include <string.h>
+#include "lz4_compress.h"
+
+/* Min match length, and the end of block limits from the LZ4 block format */
+#define LZ4_MIN_MATCH           (4)
+#define LZ4_LAST_LITERALS       (5)
+#define LZ4_MATCH_FIND_LIMIT    (12)
+
+/* Max match offset */
+#define LZ4_MAX_OFFSET          (65535)
+
+/* Match finder hash table size (log2) */
+#define LZ4_HASH_LOG            (16)
+
+/* Reads 4 bytes, in any alignment */
+static uint32_t
+myRead32 (
+        const uint8_t *p
+        )
+{
+    uint32_t val;
+
+    memcpy (&val, p, 4);
+    return val;
+}
+
+/* Hashes the 4 bytes at p */
+static uint32_t
+myHash (
+        const uint8_t *p
+        )
+{
+    return (myRead32 (p) * 2654435761u) >> (32 - LZ4_HASH_LOG);
+}
+
+/* Writes an LZ4 length extension (the part of a length above 15) */
+static uint8_t *
+myWriteLength (
+        uint8_t *op,
+        uint32_t len
+        )
+{
+    while (len >= 255)
+    {
+        *op++ = 255;
+        len -= 255;
+    }
+    *op++ = (uint8_t)len;
+    return op;
+}
+
+/* Writes one sequence (literal run, then an optional match). Returns NULL if the output is too small */
+static uint8_t *
+myWriteSequence (
+        uint8_t *op,
+        uint8_t *opEnd,
+        const uint8_t *lit_p,
+        uint32_t litLen,
+        uint32_t offset,
+        uint32_t matchLen
+        )
+{
+    uint8_t *token_p = op++;
+    uint32_t matchCode = 0;
+
+    /* Token, length extensions and offset take at most this many bytes beyond the literals */
+    if ((uint32_t)(opEnd - op) < (litLen + (litLen / 255) + (matchLen / 255) + 8))
+    {
+        return NULL;
+    }
+
+    *token_p = (uint8_t)(((litLen >= 15) ? 15 : litLen) << 4);
+    if (litLen >= 15)
+    {
+        op = myWriteLength (op, litLen - 15);
+    }
+    memcpy (op, lit_p, litLen);
+    op += litLen;
+
+    if (matchLen != 0)
+    {
+        *op++ = (uint8_t)(offset & 0xFF);
+        *op++ = (uint8_t)(offset >> 8);
+        matchCode = matchLen - LZ4_MIN_MATCH;
+        *token_p |= (uint8_t)((matchCode >= 15) ? 15 : matchCode);
+        if (matchCode >= 15)
+        {
+            op = myWriteLength (op, matchCode - 15);
+        }
+    }
+
+    return op;
+}
+
+int
+lz4Compress (
+        const uint8_t *src_p,
+        uint32_t srcLen,
+        uint8_t *dst_p,
+        uint32_t dstLen
+        )
+{
+    static const uint8_t *hashTable[1 << LZ4_HASH_LOG];
+    const uint8_t *ip = src_p;
+    const uint8_t *anchor = src_p;
+    const uint8_t *srcEnd = src_p + srcLen;
+    const uint8_t *matchLimit = srcEnd - LZ4_LAST_LITERALS;
+    const uint8_t *ref;
+    uint8_t *op = dst_p;
+    uint8_t *opEnd = dst_p + dstLen;
+    uint32_t h, matchLen;
+
+    memset ((void *)hashTable, 0, sizeof (hashTable));
+
+    /* Blocks too short to hold a match are stored as a single literal run */
+    if (srcLen >= LZ4_MATCH_FIND_LIMIT)
+    {
+        while (ip < (srcEnd - LZ4_MATCH_FIND_LIMIT))
+        {
+            h = myHash (ip);
+            ref = hashTable[h];
+            hashTable[h] = ip;
+
+            if ((ref == NULL) || ((uint32_t)(ip - ref) > LZ4_MAX_OFFSET) || (myRead32 (ref) != myRead32 (ip)))
+            {
+                ip++;
+                continue;
+            }
+
+            /* Extend the match, stopping short of the last literals */
+            matchLen = LZ4_MIN_MATCH;
+            while (((ip + matchLen) < matchLimit) && (ref[matchLen] == ip[matchLen]))
+            {
+                matchLen++;
+            }
+
+            op = myWriteSequence (op, opEnd, anchor, (uint32_t)(ip - anchor), (uint32_t)(ip - ref), matchLen);
+            if (op == NULL)
+            {
+                return -1;
+            }
+
+            ip += matchLen;
+            anchor = ip;
+        }
+    }
+
+    /* Last literals */
+    op = myWriteSequence (op, opEnd, anchor, (uint32_t)(srcEnd - anchor), 0, 0);
+    if (op == NULL)
+    {
+        return -1;
+    }
+
+    return (int)(op - dst_p);
+}
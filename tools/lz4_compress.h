@@ -0,0 +1,33 @@
+/*
+ * lz4_compress.h
+ *
+ *  Created on: Oct 17, 2020
+ *      Author: A. Nolan
+ *
+ *  Host side LZ4 block compressor, used to pack firmware image sections for the bootloader.
+ */
+
+#ifndef LZ4_COMPRESS_H_
+#define LZ4_COMPRESS_H_
+
+#include <stdint.h>
+
+/* Worst case size of an LZ4 block for srcLen bytes of input (incompressible data) */
+#define LZ4_COMPRESS_BOUND(srcLen)  ((srcLen) + ((srcLen) / 255) + 16)
+
+/* Compresses a block of data into a single LZ4 block (standard LZ4 block format, no frame header). The
+   output can be decompressed by myLz4Decompress in the bootloader (boot_fw/boot_image.c), or any LZ4
+   block decoder.
+
+   Return Value:
+    Number of bytes written to dst_p
+   -1 - dstLen is too small for the compressed block
+*/
+int
+lz4Compress (
+        const uint8_t *src_p,
+        uint32_t srcLen,
+        uint8_t *dst_p,
+        uint32_t dstLen);
+
+#endif /* LZ4_COMPRESS_H_ */
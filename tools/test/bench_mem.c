@@ -0,0 +1,171 @@
+/*
+ * bench_mem.c
+ *
+ *  Created on: Oct 17, 2020
+ *      Author: A. Nolan
+ *
+ *  Benchmark for the application CyU3PMemSet and CyU3PMemCopy (FX3_Firmware/cyfxtx.c) against the byte loops
+ *  they replaced (8x unrolled byte copy and set). Built without vectorization and without the compiler
+ *  turning loops into library calls, so the host compares the same kind of code the ARM926 runs. Absolute
+ *  numbers are host numbers; the ratio between the word and byte versions is the useful figure.
+ */
+
+#include <stdio.h>
+#include <time.h>
+#include "cyu3mem.h"
+
+/* Bytes processed per measurement */
+#define BENCH_TOTAL_BYTES   (64u * 1024u * 1024u)
+
+static uint8_t glSrc[16384 + 64] __attribute__ ((aligned (32)));
+static uint8_t glDest[16384 + 64] __attribute__ ((aligned (32)));
+
+/* Previous CyU3PMemSet: bytes, 8x unrolled */
+static void __attribute__ ((noinline))
+myByteSet (
+        uint8_t *ptr,
+        uint8_t  data,
+        uint32_t count)
+{
+    while (count >> 3)
+    {
+        ptr[0] = data;
+        ptr[1] = data;
+        ptr[2] = data;
+        ptr[3] = data;
+        ptr[4] = data;
+        ptr[5] = data;
+        ptr[6] = data;
+        ptr[7] = data;
+
+        count -= 8;
+        ptr += 8;
+    }
+
+    while (count--)
+    {
+        *ptr = data;
+        ptr++;
+    }
+}
+
+/* Previous CyU3PMemCopy (forward direction): bytes, 8x unrolled */
+static void __attribute__ ((noinline))
+myByteCopy (
+        uint8_t  *dest,
+        uint8_t  *src,
+        uint32_t  count)
+{
+    while (count >= 8)
+    {
+        dest[0] = src[0];
+        dest[1] = src[1];
+        dest[2] = src[2];
+        dest[3] = src[3];
+        dest[4] = src[4];
+        dest[5] = src[5];
+        dest[6] = src[6];
+        dest[7] = src[7];
+
+        dest  += 8;
+        src   += 8;
+        count -= 8;
+    }
+
+    while (count > 0)
+    {
+        *dest = *src;
+
+        dest++;
+        src++;
+        count--;
+    }
+}
+
+static double
+myNow (
+        void
+        )
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec * 1e9) + ts.tv_nsec;
+}
+
+/* Times one copy function. Returns ns per KB */
+static double
+myTimeCopy (
+        void (*copy)(uint8_t *, uint8_t *, uint32_t),
+        uint32_t size,
+        uint32_t destOffset,
+        uint32_t srcOffset
+        )
+{
+    uint32_t iterations = BENCH_TOTAL_BYTES / size;
+    uint32_t i;
+    double start = myNow ();
+
+    for (i = 0; i < iterations; i++)
+    {
+        copy (&glDest[destOffset], &glSrc[srcOffset], size);
+    }
+    return (myNow () - start) / ((double)iterations * size / 1024.0);
+}
+
+/* Times one set function. Returns ns per KB */
+static double
+myTimeSet (
+        void (*set)(uint8_t *, uint8_t, uint32_t),
+        uint32_t size,
+        uint32_t destOffset
+        )
+{
+    uint32_t iterations = BENCH_TOTAL_BYTES / size;
+    uint32_t i;
+    double start = myNow ();
+
+    for (i = 0; i < iterations; i++)
+    {
+        set (&glDest[destOffset], (uint8_t)i, size);
+    }
+    return (myNow () - start) / ((double)iterations * size / 1024.0);
+}
+
+int
+main (
+        void
+        )
+{
+    /* Register list sizes, a control transfer buffer, and the 12 KB BulkBuffer */
+    static const uint32_t sizes[] = { 64, 256, 1024, 4096, 12288 };
+    uint32_t i;
+    double byteNs, wordNs;
+
+    printf ("%-28s %8s %12s %12s %8s\n", "case", "bytes", "byte ns/KB", "word ns/KB", "speedup");
+
+    for (i = 0; i < (sizeof (sizes) / sizeof (sizes[0])); i++)
+    {
+        byteNs = myTimeSet (myByteSet, sizes[i], 0);
+        wordNs = myTimeSet (CyU3PMemSet, sizes[i], 0);
+        printf ("%-28s %8u %12.1f %12.1f %7.2fx\n", "MemSet aligned", sizes[i], byteNs, wordNs, byteNs / wordNs);
+
+        byteNs = myTimeSet (myByteSet, sizes[i], 1);
+        wordNs = myTimeSet (CyU3PMemSet, sizes[i], 1);
+        printf ("%-28s %8u %12.1f %12.1f %7.2fx\n", "MemSet unaligned", sizes[i], byteNs, wordNs, byteNs / wordNs);
+
+        byteNs = myTimeCopy (myByteCopy, sizes[i], 0, 0);
+        wordNs = myTimeCopy (CyU3PMemCopy, sizes[i], 0, 0);
+        printf ("%-28s %8u %12.1f %12.1f %7.2fx\n", "MemCopy aligned", sizes[i], byteNs, wordNs, byteNs / wordNs);
+
+        byteNs = myTimeCopy (myByteCopy, sizes[i], 3, 3);
+        wordNs = myTimeCopy (CyU3PMemCopy, sizes[i], 3, 3);
+        printf ("%-28s %8u %12.1f %12.1f %7.2fx\n", "MemCopy same misalignment", sizes[i], byteNs, wordNs, byteNs / wordNs);
+
+        byteNs = myTimeCopy (myByteCopy, sizes[i], 1, 0);
+        wordNs = myTimeCopy (CyU3PMemCopy, sizes[i], 1, 0);
+        printf ("%-28s %8u %12.1f %12.1f %7.2fx\n", "MemCopy mixed alignment", sizes[i], byteNs, wordNs, byteNs / wordNs);
+    }
+
+    return 0;
+}
@@ -0,0 +1,29 @@
+/*
+ * cyu3mem.h
+ *
+ *  Created on: Oct 17, 2020
+ *      Author: A. Nolan
+ *
+ *  Prototypes for the application memory functions, which the host tests build from FX3_Firmware/cyfxtx.c.
+ *  The function bodies are extracted from cyfxtx.c by the tools Makefile, so the tests and the benchmark
+ *  run the firmware code.
+ */
+
+#ifndef CYU3MEM_H_
+#define CYU3MEM_H_
+
+#include "cyu3types.h"
+
+void
+CyU3PMemSet (
+        uint8_t *ptr,
+        uint8_t  data,
+        uint32_t count);
+
+void
+CyU3PMemCopy (
+        uint8_t  *dest,
+        uint8_t  *src,
+        uint32_t  count);
+
+#endif /* CYU3MEM_H_ */
@@ -0,0 +1,33 @@
+/*
+ * test_check.h
+ *
+ *  Created on: Oct 17, 2020
+ *      Author: A. Nolan
+ *
+ *  Minimal check macros for the host tests. A failed check prints its location and is counted, and
+ *  TEST_RESULT() returns a non-zero exit code from main if any check failed.
+ */
+
+#ifndef TEST_CHECK_H_
+#define TEST_CHECK_H_
+
+#include <stdio.h>
+
+static int testChecks = 0;
+static int testFailures = 0;
+
+#define CHECK(cond) \
+    do \
+    { \
+        testChecks++; \
+        if (!(cond)) \
+        { \
+            testFailures++; \
+            printf ("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+        } \
+    } while (0)
+
+#define TEST_RESULT() \
+    (printf ("%d checks, %d failed\n", testChecks, testFailures), (testFailures != 0))
+
+#endif /* TEST_CHECK_H_ */
@@ -0,0 +1,191 @@
+/*
+ * test_lz4.c
+ *
+ *  Created on: Oct 17, 2020
+ *      Author: A. Nolan
+ *
+ *  Round trip tests for the host LZ4 compressor against the bootloader decoder (boot_fw/boot_image.c), and
+ *  checks that the decoder rejects corrupt or truncated blocks without writing outside its destination.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "cyfx3device.h"
+#include "main.h"
+#include "lz4_compress.h"
+#include "test_check.h"
+#include "test_util.h"
+
+/* Guard bytes around the decoder destination */
+#define GUARD_SIZE      (64)
+#define GUARD_BYTE      (0xA5)
+
+/* Fills a buffer with firmware-like data: a small set of repeating 32-bit words, with some noise */
+static void
+myFillCodeLike (
+        uint8_t *buf_p,
+        uint32_t len
+        )
+{
+    static const uint32_t words[] = { 0xE92D4010, 0xE8BD8010, 0xE59F3000, 0xE3A00000, 0xEB000000, 0xE1A00004 };
+    uint32_t i, w;
+
+    for (i = 0; i < len; i += 4)
+    {
+        w = words[myRand () % 6];
+        if ((myRand () % 4) == 0)
+        {
+            w ^= myRand () & 0xFFF;
+        }
+        memcpy (&buf_p[i], &w, ((len - i) < 4) ? (len - i) : 4);
+    }
+}
+
+/* Compresses and decompresses a buffer, and checks the data and the destination guard bytes. Returns the
+   compressed length */
+static int
+myRoundTrip (
+        const uint8_t *src_p,
+        uint32_t len
+        )
+{
+    uint8_t *comp_p = (uint8_t *)malloc (LZ4_COMPRESS_BOUND (len));
+    uint8_t *out_p = (uint8_t *)malloc (len + (2 * GUARD_SIZE));
+    int compLen, i;
+
+    compLen = lz4Compress (src_p, len, comp_p, LZ4_COMPRESS_BOUND (len));
+    CHECK (compLen > 0);
+    CHECK ((uint32_t)compLen <= LZ4_COMPRESS_BOUND (len));
+
+    memset (out_p, GUARD_BYTE, len + (2 * GUARD_SIZE));
+    CHECK (myLz4Decompress (comp_p, (uint32_t)compLen, out_p + GUARD_SIZE, len) == (int)len);
+    CHECK (memcmp (out_p + GUARD_SIZE, src_p, len) == 0);
+    for (i = 0; i < GUARD_SIZE; i++)
+    {
+        CHECK (out_p[i] == GUARD_BYTE);
+        CHECK (out_p[GUARD_SIZE + len + i] == GUARD_BYTE);
+    }
+
+    free (out_p);
+    free (comp_p);
+    return compLen;
+}
+
+static void
+testRoundTrip (
+        void
+        )
+{
+    static const uint32_t lengths[] = { 1, 4, 5, 11, 12, 13, 15, 16, 17, 64, 255, 270, 4096, 65536, 65537, 200000 };
+    uint8_t *buf_p = (uint8_t *)malloc (200000);
+    uint32_t i, j, len;
+    int compLen;
+
+    for (i = 0; i < (sizeof (lengths) / sizeof (lengths[0])); i++)
+    {
+        len = lengths[i];
+
+        /* All zeros: long matches, and long match length extensions */
+        memset (buf_p, 0, len);
+        compLen = myRoundTrip (buf_p, len);
+        if (len >= 4096)
+        {
+            CHECK ((uint32_t)compLen < (len / 100));
+        }
+
+        /* Random: no matches, and long literal length extensions */
+        for (j = 0; j < len; j++)
+        {
+            buf_p[j] = (uint8_t)myRand ();
+        }
+        myRoundTrip (buf_p, len);
+
+        /* Firmware-like data */
+        myFillCodeLike (buf_p, len);
+        compLen = myRoundTrip (buf_p, len);
+        if (len >= 4096)
+        {
+            CHECK ((uint32_t)compLen < ((len * 3) / 4));
+        }
+    }
+
+    /* Matches at the max offset, and just past it */
+    for (j = 0; j < 200000; j++)
+    {
+        buf_p[j] = (uint8_t)myRand ();
+    }
+    memcpy (&buf_p[65535 + 100], &buf_p[100], 64);
+    memcpy (&buf_p[65536 + 1000], &buf_p[1000], 64);
+    myRoundTrip (buf_p, 70000);
+
+    free (buf_p);
+}
+
+static void
+testOutputTooSmall (
+        void
+        )
+{
+    uint8_t src[256];
+    uint8_t dst[64];
+    uint32_t i;
+
+    for (i = 0; i < sizeof (src); i++)
+    {
+        src[i] = (uint8_t)myRand ();
+    }
+    CHECK (lz4Compress (src, sizeof (src), dst, sizeof (dst)) == -1);
+}
+
+static void
+testDecoderRejects (
+        void
+        )
+{
+    uint8_t src[4096];
+    uint8_t comp[LZ4_COMPRESS_BOUND (4096)];
+    uint8_t out[4096 + GUARD_SIZE];
+    int compLen, cut, i;
+
+    /* Offset pointing before the start of the output */
+    static const uint8_t badOffset[] = { 0x14, 'A', 0x10, 0x00, 0x50, 'A', 'B', 'C', 'D', 'E' };
+
+    /* Literal run longer than the source */
+    static const uint8_t badLiteral[] = { 0xF0, 0x40, 'A' };
+
+    /* Zero offset */
+    static const uint8_t zeroOffset[] = { 0x14, 'A', 0x00, 0x00, 0x50, 'A', 'B', 'C', 'D', 'E' };
+
+    CHECK (myLz4Decompress (badOffset, sizeof (badOffset), out, sizeof (out)) == -1);
+    CHECK (myLz4Decompress (badLiteral, sizeof (badLiteral), out, sizeof (out)) == -1);
+    CHECK (myLz4Decompress (zeroOffset, sizeof (zeroOffset), out, sizeof (out)) == -1);
+
+    myFillCodeLike (src, sizeof (src));
+    compLen = lz4Compress (src, sizeof (src), comp, sizeof (comp));
+    CHECK (compLen > 0);
+
+    /* Destination one byte too small must fail without writing past it */
+    memset (out, GUARD_BYTE, sizeof (out));
+    CHECK (myLz4Decompress (comp, (uint32_t)compLen, out, sizeof (src) - 1) == -1);
+    for (i = sizeof (src) - 1; i < (int)sizeof (out); i++)
+    {
+        CHECK (out[i] == GUARD_BYTE);
+    }
+
+    /* Truncated blocks never decode to the full length */
+    for (cut = 1; cut < compLen; cut += 7)
+    {
+        CHECK (myLz4Decompress (comp, (uint32_t)(compLen - cut), out, sizeof (src)) != (int)sizeof (src));
+    }
+}
+
+int
+main (
+        void
+        )
+{
+    testRoundTrip ();
+    testOutputTooSmall ();
+    testDecoderRejects ();
+    return TEST_RESULT ();
+}
@@ -0,0 +1,187 @@
+/*
+ * test_mem.c
+ *
+ *  Created on: Oct 17, 2020
+ *      Author: A. Nolan
+ *
+ *  Tests for the application CyU3PMemSet and CyU3PMemCopy (FX3_Firmware/cyfxtx.c). Every combination of
+ *  source and destination alignment, a range of lengths around the DWORD and 32 byte block sizes, and
+ *  overlapping copies in both directions are checked against a byte-at-a-time reference, with guard bytes
+ *  around the destination.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "cyu3mem.h"
+#include "test_check.h"
+
+#define TEST_RAND_SEED  (3)
+#include "test_util.h"
+
+#define BUF_SIZE        (1024)
+#define GUARD_BYTE      (0x5A)
+
+/* Lengths to test: every length up to 80 (head, body and tail combinations), and some larger blocks */
+static const uint32_t glLongLengths[] = { 95, 96, 97, 127, 128, 129, 255, 256, 257, 511, 513 };
+
+static void
+myFillRandom (
+        uint8_t *buf_p,
+        uint32_t len
+        )
+{
+    uint32_t i;
+
+    for (i = 0; i < len; i++)
+    {
+        buf_p[i] = (uint8_t)myRand ();
+    }
+}
+
+/* Reference copy, with memmove semantics */
+static void
+myRefCopy (
+        uint8_t *dest,
+        const uint8_t *src,
+        uint32_t count
+        )
+{
+    uint32_t i;
+
+    if (dest > src)
+    {
+        for (i = count; i > 0; i--)
+        {
+            dest[i - 1] = src[i - 1];
+        }
+    }
+    else
+    {
+        for (i = 0; i < count; i++)
+        {
+            dest[i] = src[i];
+        }
+    }
+}
+
+static uint32_t
+myTestLength (
+        uint32_t index
+        )
+{
+    if (index <= 80)
+    {
+        return index;
+    }
+    return glLongLengths[index - 81];
+}
+
+#define TEST_LENGTH_COUNT   (81 + (sizeof (glLongLengths) / sizeof (glLongLengths[0])))
+
+static void
+testMemSet (
+        void
+        )
+{
+    static uint8_t buf[BUF_SIZE] __attribute__ ((aligned (8)));
+    static uint8_t ref[BUF_SIZE] __attribute__ ((aligned (8)));
+    uint32_t align, n, len;
+    uint8_t value;
+
+    for (align = 0; align < 8; align++)
+    {
+        for (n = 0; n < TEST_LENGTH_COUNT; n++)
+        {
+            len = myTestLength (n);
+            value = (uint8_t)myRand ();
+
+            memset (buf, GUARD_BYTE, sizeof (buf));
+            memset (ref, GUARD_BYTE, sizeof (ref));
+            CyU3PMemSet (&buf[16 + align], value, len);
+            memset (&ref[16 + align], value, len);
+            CHECK (memcmp (buf, ref, sizeof (buf)) == 0);
+        }
+    }
+
+    /* Values with the top bit set, and zero, fill every byte of the DWORD */
+    CyU3PMemSet (&buf[1], 0xFF, 64);
+    CHECK ((buf[1] == 0xFF) && (buf[32] == 0xFF) && (buf[64] == 0xFF) && (buf[65] != 0xFF));
+    CyU3PMemSet (&buf[1], 0x00, 64);
+    CHECK ((buf[1] == 0x00) && (buf[32] == 0x00) && (buf[64] == 0x00));
+}
+
+static void
+testMemCopy (
+        void
+        )
+{
+    static uint8_t src[BUF_SIZE] __attribute__ ((aligned (8)));
+    static uint8_t buf[BUF_SIZE] __attribute__ ((aligned (8)));
+    static uint8_t ref[BUF_SIZE] __attribute__ ((aligned (8)));
+    uint32_t srcAlign, destAlign, n, len;
+
+    myFillRandom (src, sizeof (src));
+
+    /* Separate blocks, every alignment combination */
+    for (srcAlign = 0; srcAlign < 8; srcAlign++)
+    {
+        for (destAlign = 0; destAlign < 8; destAlign++)
+        {
+            for (n = 0; n < TEST_LENGTH_COUNT; n++)
+            {
+                len = myTestLength (n);
+
+                memset (buf, GUARD_BYTE, sizeof (buf));
+                memset (ref, GUARD_BYTE, sizeof (ref));
+                CyU3PMemCopy (&buf[16 + destAlign], &src[srcAlign], len);
+                myRefCopy (&ref[16 + destAlign], &src[srcAlign], len);
+                CHECK (memcmp (buf, ref, sizeof (buf)) == 0);
+            }
+        }
+    }
+}
+
+static void
+testMemCopyOverlap (
+        void
+        )
+{
+    static uint8_t buf[BUF_SIZE] __attribute__ ((aligned (8)));
+    static uint8_t ref[BUF_SIZE] __attribute__ ((aligned (8)));
+    uint32_t srcOffset, n, len;
+    int32_t shift;
+
+    /* Overlapping blocks in one buffer: destination below and above the source, by up to 72 bytes (more than
+       one 32 byte block), at every source alignment */
+    for (srcOffset = 96; srcOffset < 104; srcOffset++)
+    {
+        for (shift = -72; shift <= 72; shift++)
+        {
+            for (n = 0; n < TEST_LENGTH_COUNT; n++)
+            {
+                len = myTestLength (n);
+                if ((srcOffset + shift + len + 16) > BUF_SIZE)
+                {
+                    continue;
+                }
+
+                myFillRandom (buf, sizeof (buf));
+                memcpy (ref, buf, sizeof (buf));
+                CyU3PMemCopy (&buf[srcOffset + shift], &buf[srcOffset], len);
+                myRefCopy (&ref[srcOffset + shift], &ref[srcOffset], len);
+                CHECK (memcmp (buf, ref, sizeof (buf)) == 0);
+            }
+        }
+    }
+}
+
+int
+main (
+        void
+        )
+{
+    testMemSet ();
+    testMemCopy ();
+    testMemCopyOverlap ();
+    return TEST_RESULT ();
+}
@@ -0,0 +1,360 @@
+/*
+ * test_pack.c
+ *
+ *  Created on: Oct 17, 2020
+ *      Author: A. Nolan
+ *
+ *  Tests for the FX3 image parser and packer. Packed images are unpacked with the bootloader decoder into a
+ *  model of the FX3 memory map, and compared with the original image sections.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "cyfx3device.h"
+#include "main.h"
+#include "fx3_image.h"
+#include "test_check.h"
+
+#define TEST_RAND_SEED  (7)
+#include "test_util.h"
+
+/* Model of the FX3 ITCM and SYSMEM, filled in by the unpack callback */
+static uint8_t glItcm[CY_FX3_BOOT_ITCM_END];
+static uint8_t glSysmem[CY_FX3_BOOT_SYSMEM_END - CY_FX3_BOOT_SYSMEM_BASE1];
+static uint32_t glUnpackSections;
+
+static uint8_t *
+myMemory (
+        uint32_t address
+        )
+{
+    if (address >= CY_FX3_BOOT_SYSMEM_BASE1)
+    {
+        return &glSysmem[address - CY_FX3_BOOT_SYSMEM_BASE1];
+    }
+    return &glItcm[address];
+}
+
+static void
+myUnpackSection (
+        uint32_t address,
+        const uint8_t *data_p,
+        uint32_t len,
+        void *ctx_p
+        )
+{
+    (void)ctx_p;
+    memcpy (myMemory (address), data_p, len);
+    glUnpackSections++;
+}
+
+/* Generates a section data word. Firmware-like data is built from a set of code snippets (random words,
+   repeated through the image) with some of the words changed, like the branch targets and literal pool
+   offsets in real code */
+static uint32_t
+myDataWord (
+        int compressible
+        )
+{
+    static uint32_t snippets[32][16];
+    static int snippetsValid = 0;
+    static uint32_t snippet = 0, pos = 16;
+    uint32_t i, j, w;
+
+    if (!compressible)
+    {
+        return (myRand () << 16) ^ myRand ();
+    }
+
+    if (!snippetsValid)
+    {
+        for (i = 0; i < 32; i++)
+        {
+            for (j = 0; j < 16; j++)
+            {
+                snippets[i][j] = (myRand () << 16) ^ myRand ();
+            }
+        }
+        snippetsValid = 1;
+    }
+
+    if (pos >= 16)
+    {
+        snippet = myRand () % 32;
+        pos = myRand () % 8;
+    }
+    w = snippets[snippet][pos++];
+    if ((myRand () % 8) == 0)
+    {
+        w ^= myRand () & 0xFFF;
+    }
+    return w;
+}
+
+/* Builds a Cypress boot image from a list of sections (address and length pairs). The section data is
+   firmware-like when compressible is set, otherwise random. Returns the image length */
+static uint32_t
+myBuildImage (
+        uint8_t *img_p,
+        const uint32_t *sections_p,
+        uint32_t count,
+        uint32_t entry,
+        int compressible
+        )
+{
+    uint32_t offset = 4;
+    uint32_t checksum = 0;
+    uint32_t i, j, w;
+
+    img_p[0] = 'C';
+    img_p[1] = 'Y';
+    img_p[2] = 0x1C;
+    img_p[3] = 0xB0;
+
+    for (i = 0; i < count; i++)
+    {
+        myPut32 (&img_p[offset], sections_p[(2 * i) + 1] / 4);
+        myPut32 (&img_p[offset + 4], sections_p[2 * i]);
+        offset += 8;
+        for (j = 0; j < (sections_p[(2 * i) + 1] / 4); j++)
+        {
+            w = myDataWord (compressible);
+            myPut32 (&img_p[offset], w);
+            checksum += w;
+            offset += 4;
+        }
+    }
+
+    myPut32 (&img_p[offset], 0);
+    myPut32 (&img_p[offset + 4], entry);
+    myPut32 (&img_p[offset + 8], checksum);
+    return offset + 12;
+}
+
+/* Packs an image, unpacks it into the memory model and checks every section. Returns the packed length */
+static int
+myPackAndCheck (
+        const uint8_t *img_p,
+        uint32_t imgLen,
+        const Fx3PackOptions_t *options_p,
+        uint8_t *out_p,
+        uint32_t outLen
+        )
+{
+    Fx3Image_t image;
+    uint32_t entry = 0;
+    uint32_t i;
+    int packedLen;
+
+    CHECK (fx3ImageParse (img_p, imgLen, &image) == FX3_IMAGE_OK);
+    CHECK (image.imageLength == imgLen);
+
+    packedLen = fx3ImagePack (&image, options_p, out_p, outLen);
+    CHECK (packedLen > 0);
+    if (packedLen <= 0)
+    {
+        return packedLen;
+    }
+
+    memset (glItcm, 0, sizeof (glItcm));
+    memset (glSysmem, 0, sizeof (glSysmem));
+    glUnpackSections = 0;
+    CHECK (fx3ImageUnpack (out_p, (uint32_t)packedLen, myUnpackSection, NULL, &entry) == FX3_IMAGE_OK);
+    CHECK (entry == image.entry);
+
+    for (i = 0; i < image.sectionCount; i++)
+    {
+        CHECK (memcmp (myMemory (image.sections[i].address), image.sections[i].data_p, image.sections[i].length) == 0);
+    }
+
+    return packedLen;
+}
+
+static void
+testParse (
+        void
+        )
+{
+    static const uint32_t sections[] = { 0x40003000, 256, 0x00000100, 64 };
+    uint8_t img[1024];
+    uint8_t bad[1024];
+    Fx3Image_t image;
+    uint32_t len = myBuildImage (img, sections, 2, 0x40003000, 1);
+
+    CHECK (fx3ImageParse (img, len, &image) == FX3_IMAGE_OK);
+    CHECK (image.sectionCount == 2);
+    CHECK (image.sections[0].address == 0x40003000);
+    CHECK (image.sections[0].length == 256);
+    CHECK (image.sections[1].address == 0x100);
+    CHECK (image.sections[1].length == 64);
+    CHECK (image.entry == 0x40003000);
+
+    /* Bad signature, data image and wrong image type */
+    memcpy (bad, img, len);
+    bad[0] = 'X';
+    CHECK (fx3ImageParse (bad, len, &image) == FX3_IMAGE_ERR_FORMAT);
+    memcpy (bad, img, len);
+    bad[2] |= 0x01;
+    CHECK (fx3ImageParse (bad, len, &image) == FX3_IMAGE_ERR_FORMAT);
+    memcpy (bad, img, len);
+    bad[3] = 0xB2;
+    CHECK (fx3ImageParse (bad, len, &image) == FX3_IMAGE_ERR_FORMAT);
+
+    /* Truncated image, and a section running past the end of the file */
+    CHECK (fx3ImageParse (img, len - 4, &image) == FX3_IMAGE_ERR_FORMAT);
+    CHECK (fx3ImageParse (img, 100, &image) == FX3_IMAGE_ERR_FORMAT);
+
+    /* Corrupt section data */
+    memcpy (bad, img, len);
+    bad[20] ^= 0x01;
+    CHECK (fx3ImageParse (bad, len, &image) == FX3_IMAGE_ERR_CHECKSUM);
+
+    /* Section outside of ITCM and SYSMEM, and an unaligned section */
+    memcpy (bad, img, len);
+    myPut32 (&bad[8], 0x10000000);
+    CHECK (fx3ImageParse (bad, len, &image) == FX3_IMAGE_ERR_ADDRESS);
+    memcpy (bad, img, len);
+    myPut32 (&bad[8], 0x40003002);
+    CHECK (fx3ImageParse (bad, len, &image) == FX3_IMAGE_ERR_ADDRESS);
+}
+
+static void
+testPackApplication (
+        void
+        )
+{
+    /* Layout of the application image: vectors in ITCM, then code and data in SYSMEM */
+    static const uint32_t sections[] = { 0x00000100, 0x2000, 0x40003000, 140 * 1024, 0x40030000, 8 * 1024 };
+    uint32_t imgLen = 4 + (3 * 8) + 0x2000 + (140 * 1024) + (8 * 1024) + 12;
+    uint8_t *img_p = (uint8_t *)malloc (imgLen);
+    uint32_t outLen = imgLen + 4096;
+    uint8_t *out_p = (uint8_t *)malloc (outLen);
+    Fx3PackOptions_t options;
+    int packedLen, rawLen;
+
+    CHECK (myBuildImage (img_p, sections, 3, 0x40003000, 1) == imgLen);
+
+    /* Compressed: fits a stored image slot */
+    options.chunkSize = FX3_PACK_CHUNK_SIZE;
+    options.compress  = 1;
+    packedLen = myPackAndCheck (img_p, imgLen, &options, out_p, outLen);
+    printf ("application image %u bytes, packed %d bytes\n", imgLen, packedLen);
+    CHECK ((packedLen > 0) && ((uint32_t)packedLen <= BOOT_SLOT_SIZE));
+
+    /* Raw: larger than the image data, and does not fit */
+    options.compress = 0;
+    rawLen = myPackAndCheck (img_p, imgLen, &options, out_p, outLen);
+    CHECK (rawLen > packedLen);
+    CHECK ((uint32_t)rawLen > BOOT_SLOT_SIZE);
+
+    /* Small chunks split the sections, every part still loads */
+    options.chunkSize = 0x1000;
+    options.compress  = 1;
+    CHECK (myPackAndCheck (img_p, imgLen, &options, out_p, outLen) > 0);
+    CHECK (glUnpackSections == (2 + 35 + 2));
+
+    /* Output too small */
+    CHECK (fx3ImagePack (&(Fx3Image_t){ 0 }, &options, out_p, 8) == FX3_IMAGE_ERR_SPACE);
+
+    free (out_p);
+    free (img_p);
+}
+
+static void
+testIncompressible (
+        void
+        )
+{
+    static const uint32_t sections[] = { 0x00000100, 0x1000, 0x40003000, 0x4000 };
+    uint32_t imgLen = 4 + (2 * 8) + 0x5000 + 12;
+    uint8_t *img_p = (uint8_t *)malloc (imgLen);
+    uint8_t *out_p = (uint8_t *)malloc (imgLen + 4096);
+    Fx3PackOptions_t options = { FX3_PACK_CHUNK_SIZE, 1 };
+    uint32_t offset = 0;
+    int packedLen;
+
+    myBuildImage (img_p, sections, 2, 0x40003000, 0);
+
+    /* Random data is stored raw (stored length equal to the loaded length) */
+    packedLen = myPackAndCheck (img_p, imgLen, &options, out_p, imgLen + 4096);
+    CHECK (packedLen == (int)(0x5000 + ((1 + ((0x4000 + FX3_PACK_CHUNK_SIZE - 1) / FX3_PACK_CHUNK_SIZE) + 1) *
+                    FX3_SECTION_HEADER_SIZE)));
+    while ((packedLen > 0) && (offset < (uint32_t)packedLen))
+    {
+        uint32_t stored, len;
+        memcpy (&stored, &out_p[offset + 4], 4);
+        memcpy (&len, &out_p[offset + 8], 4);
+        CHECK (stored == len);
+        offset += FX3_SECTION_HEADER_SIZE + stored;
+    }
+
+    free (out_p);
+    free (img_p);
+}
+
+static void
+testUnpackRejects (
+        void
+        )
+{
+    static const uint32_t sections[] = { 0x00000100, 0x1000, 0x40003000, 0x4000 };
+    uint32_t imgLen = 4 + (2 * 8) + 0x5000 + 12;
+    uint8_t *img_p = (uint8_t *)malloc (imgLen);
+    uint8_t *out_p = (uint8_t *)malloc (imgLen + 4096);
+    uint8_t *bad_p = (uint8_t *)malloc (imgLen + 4096);
+    Fx3PackOptions_t options = { FX3_PACK_CHUNK_SIZE, 1 };
+    Fx3Image_t image;
+    uint32_t entry, storedLen;
+    int packedLen;
+
+    myBuildImage (img_p, sections, 2, 0x40003000, 1);
+    CHECK (fx3ImageParse (img_p, imgLen, &image) == FX3_IMAGE_OK);
+    packedLen = fx3ImagePack (&image, &options, out_p, imgLen + 4096);
+    CHECK (packedLen > 0);
+
+    /* The first section is compressed */
+    memcpy (&storedLen, &out_p[4], 4);
+    CHECK (storedLen < 0x1000);
+
+    /* Missing entry record */
+    CHECK (fx3ImageUnpack (out_p, (uint32_t)packedLen - FX3_SECTION_HEADER_SIZE, NULL, NULL, &entry) == FX3_IMAGE_ERR_FORMAT);
+
+    /* Trailing data after the entry record */
+    CHECK (fx3ImageUnpack (out_p, (uint32_t)packedLen + 4, NULL, NULL, &entry) == FX3_IMAGE_ERR_FORMAT);
+
+    /* Corrupt section CRC */
+    memcpy (bad_p, out_p, (uint32_t)packedLen);
+    bad_p[12] ^= 0x01;
+    CHECK (fx3ImageUnpack (bad_p, (uint32_t)packedLen, NULL, NULL, &entry) == FX3_IMAGE_ERR_CRC);
+
+    /* Corrupt compressed data: fails to decompress, or fails the CRC */
+    memcpy (bad_p, out_p, (uint32_t)packedLen);
+    bad_p[FX3_SECTION_HEADER_SIZE + 40] ^= 0x55;
+    CHECK (fx3ImageUnpack (bad_p, (uint32_t)packedLen, NULL, NULL, &entry) != FX3_IMAGE_OK);
+
+    /* Decompressed section overlapping the bootloader staging area */
+    memcpy (bad_p, out_p, (uint32_t)packedLen);
+    myPut32 (&bad_p[0], USB_STAGING_ADDRESS - 0x100);
+    CHECK (fx3ImageUnpack (bad_p, (uint32_t)packedLen, NULL, NULL, &entry) == FX3_IMAGE_ERR_ADDRESS);
+
+    /* Section address outside of ITCM and SYSMEM */
+    memcpy (bad_p, out_p, (uint32_t)packedLen);
+    myPut32 (&bad_p[0], 0x10000000);
+    CHECK (fx3ImageUnpack (bad_p, (uint32_t)packedLen, NULL, NULL, &entry) == FX3_IMAGE_ERR_FORMAT);
+
+    free (bad_p);
+    free (out_p);
+    free (img_p);
+}
+
+int
+main (
+        void
+        )
+{
+    testParse ();
+    testPackApplication ();
+    testIncompressible ();
+    testUnpackRejects ();
+    return TEST_RESULT ();
+}
@@ -0,0 +1,154 @@
+/*
+ * test_sign.c
+ *
+ *  Created on: Oct 17, 2020
+ *      Author: A. Nolan
+ *
+ *  Tests for the image signature used by the bootloader control endpoint (0xA0) download. The signed CRC
+ *  must match the running CRC the bootloader calculates over the 0xA0 writes, which the host sends in chunks
+ *  of up to 4 KB per section.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "cyfx3device.h"
+#include "main.h"
+#include "fx3_image.h"
+#include "test_check.h"
+
+#define TEST_RAND_SEED  (11)
+#include "test_util.h"
+
+/* Max data stage of a 0xA0 write (USB_DATA_BUF_SIZE in the bootloader) */
+#define LEGACY_WRITE_MAX    (4096)
+
+/* Builds a Cypress boot image with random section data. Returns the image length */
+static uint32_t
+myBuildImage (
+        uint8_t *img_p,
+        const uint32_t *sections_p,
+        uint32_t count,
+        uint32_t entry
+        )
+{
+    uint32_t offset = 4;
+    uint32_t checksum = 0;
+    uint32_t i, j, w;
+
+    img_p[0] = 'C';
+    img_p[1] = 'Y';
+    img_p[2] = 0x1C;
+    img_p[3] = 0xB0;
+
+    for (i = 0; i < count; i++)
+    {
+        myPut32 (&img_p[offset], sections_p[(2 * i) + 1] / 4);
+        myPut32 (&img_p[offset + 4], sections_p[2 * i]);
+        offset += 8;
+        for (j = 0; j < (sections_p[(2 * i) + 1] / 4); j++)
+        {
+            w = (myRand () << 16) ^ myRand ();
+            myPut32 (&img_p[offset], w);
+            checksum += w;
+            offset += 4;
+        }
+    }
+
+    myPut32 (&img_p[offset], 0);
+    myPut32 (&img_p[offset + 4], entry);
+    myPut32 (&img_p[offset + 8], checksum);
+    return offset + 12;
+}
+
+/* Running CRC over the image data, written the way the host writes it with 0xA0: each section in chunks of
+   up to LEGACY_WRITE_MAX bytes */
+static void
+myLegacyDownloadCrc (
+        const Fx3Image_t *image_p,
+        uint32_t *crc_p,
+        uint32_t *len_p
+        )
+{
+    uint32_t i, pos, chunk;
+
+    *crc_p = 0;
+    *len_p = 0;
+    for (i = 0; i < image_p->sectionCount; i++)
+    {
+        for (pos = 0; pos < image_p->sections[i].length; pos += chunk)
+        {
+            chunk = image_p->sections[i].length - pos;
+            if (chunk > LEGACY_WRITE_MAX)
+            {
+                chunk = LEGACY_WRITE_MAX;
+            }
+            *crc_p = myCrc32 (*crc_p, image_p->sections[i].data_p + pos, chunk);
+            *len_p += chunk;
+        }
+    }
+}
+
+static void
+testSignature (
+        void
+        )
+{
+    static const uint32_t sections[] = { 0x00000100, 0x1804, 0x40003000, 0x9008, 0x40030000, 0x40 };
+    uint32_t imgLen = 4 + (3 * 8) + 0x1804 + 0x9008 + 0x40 + 12;
+    uint8_t *img_p = (uint8_t *)malloc (imgLen + FX3_SIGNATURE_SIZE);
+    Fx3Image_t image;
+    uint32_t crc, len, legacyCrc, legacyLen, sigCrc, sigLen, i;
+    uint8_t sig[FX3_SIGNATURE_SIZE];
+
+    CHECK (myBuildImage (img_p, sections, 3, 0x40003000) == imgLen);
+    CHECK (fx3ImageParse (img_p, imgLen, &image) == FX3_IMAGE_OK);
+
+    /* Signed CRC and length match the bootloader running CRC over the 0xA0 writes */
+    fx3ImageDataCrc (&image, &crc, &len);
+    myLegacyDownloadCrc (&image, &legacyCrc, &legacyLen);
+    CHECK (len == (0x1804 + 0x9008 + 0x40));
+    CHECK (crc == legacyCrc);
+    CHECK (len == legacyLen);
+
+    /* Known value: CRC32 of "123456789" */
+    CHECK (myCrc32 (0, (const uint8_t *)"123456789", 9) == 0xCBF43926);
+
+    /* Unsigned image */
+    CHECK (fx3ImageCheckSignature (&image, img_p, imgLen, &sigCrc, &sigLen) == FX3_IMAGE_ERR_FORMAT);
+
+    /* Signed image: the trailer follows the checksum, and the image still parses */
+    fx3ImageSign (&image, &img_p[imgLen]);
+    CHECK (fx3ImageParse (img_p, imgLen + FX3_SIGNATURE_SIZE, &image) == FX3_IMAGE_OK);
+    CHECK (image.imageLength == imgLen);
+    CHECK (fx3ImageCheckSignature (&image, img_p, imgLen + FX3_SIGNATURE_SIZE, &sigCrc, &sigLen) == FX3_IMAGE_OK);
+    CHECK (sigCrc == crc);
+    CHECK (sigLen == len);
+
+    /* Corrupt trailer */
+    memcpy (sig, &img_p[imgLen], FX3_SIGNATURE_SIZE);
+    for (i = 0; i < FX3_SIGNATURE_SIZE; i++)
+    {
+        img_p[imgLen + i] ^= 0x10;
+        CHECK (fx3ImageCheckSignature (&image, img_p, imgLen + FX3_SIGNATURE_SIZE, &sigCrc, &sigLen) != FX3_IMAGE_OK);
+        img_p[imgLen + i] ^= 0x10;
+    }
+
+    /* Image data changed after signing (with the Cypress checksum fixed up, so only the signature catches
+       it): two words swapped within a section */
+    memcpy (sig, &img_p[40], 4);
+    memcpy (&img_p[40], &img_p[44], 4);
+    memcpy (&img_p[44], sig, 4);
+    CHECK (fx3ImageParse (img_p, imgLen + FX3_SIGNATURE_SIZE, &image) == FX3_IMAGE_OK);
+    CHECK (fx3ImageCheckSignature (&image, img_p, imgLen + FX3_SIGNATURE_SIZE, &sigCrc, &sigLen) == FX3_IMAGE_ERR_CRC);
+
+    free (img_p);
+}
+
+int
+main (
+        void
+        )
+{
+    testSignature ();
+    return TEST_RESULT ();
+}
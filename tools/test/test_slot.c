@@ -0,0 +1,276 @@
+/*
+ * test_slot.c
+ *
+ *  Created on: Oct 17, 2020
+ *      Author: A. Nolan
+ *
+ *  Host simulation of the bootloader stored image slot selection (boot_fw/boot_slot.c). The EEPROM slot
+ *  headers are modelled in memory, and each simulated boot follows myEepromBoot (boot_fw/i2c_boot.c): select
+ *  the slots, count the attempt for an unconfirmed slot, reject a slot which fails to load, and boot the
+ *  first slot which loads.
+ */
+
+#include <string.h>
+#include "cyfx3device.h"
+#include "main.h"
+#include "test_check.h"
+
+/* Simulated board: slot headers in the EEPROM, and whether each stored image loads and confirms itself */
+typedef struct
+{
+    BootSlotHeader_t header[BOOT_SLOT_COUNT];
+    int loads[BOOT_SLOT_COUNT];
+    int confirms[BOOT_SLOT_COUNT];
+} SimBoard_t;
+
+/* Writes a valid slot header, as the application does after programming an image */
+static void
+mySimProgram (
+        SimBoard_t *board_p,
+        uint32_t slot,
+        uint32_t sequence,
+        int loads,
+        int confirms
+        )
+{
+    BootSlotHeader_t *header_p = &board_p->header[slot];
+
+    header_p->magic     = BOOT_SLOT_MAGIC;
+    header_p->sequence  = sequence;
+    header_p->length    = 0x10000;
+    header_p->imageCrc  = 0x12345678;
+    header_p->headerCrc = myCrc32 (0, (uint8_t *)header_p, 16);
+    header_p->bootCount = 0;
+    header_p->confirmed = 0;
+    board_p->loads[slot]    = loads;
+    board_p->confirms[slot] = confirms;
+}
+
+/* Simulates one reset. Returns the slot booted, or -1 if the USB bootloader starts */
+static int
+mySimBoot (
+        SimBoard_t *board_p,
+        uint32_t resetCause,
+        CyBool_t bootRequest
+        )
+{
+    int valid[BOOT_SLOT_COUNT];
+    uint32_t order[BOOT_SLOT_COUNT];
+    uint32_t count, slot, i;
+
+    for (slot = 0; slot < BOOT_SLOT_COUNT; slot++)
+    {
+        valid[slot] = (myCheckSlotHeader (&board_p->header[slot]) == 0);
+    }
+
+    count = mySelectBootSlots (board_p->header, valid, resetCause, bootRequest, order);
+    CHECK (count <= BOOT_SLOT_COUNT);
+    for (i = 0; i < count; i++)
+    {
+        slot = order[i];
+        CHECK (valid[slot]);
+
+        if (board_p->header[slot].confirmed != BOOT_SLOT_CONFIRMED)
+        {
+            board_p->header[slot].bootCount++;
+        }
+
+        if (!board_p->loads[slot])
+        {
+            if (board_p->header[slot].confirmed != BOOT_SLOT_CONFIRMED)
+            {
+                board_p->header[slot].bootCount = BOOT_SLOT_REJECTED;
+            }
+            continue;
+        }
+
+        /* The application confirms the slot once it starts */
+        if (board_p->confirms[slot])
+        {
+            board_p->header[slot].confirmed = BOOT_SLOT_CONFIRMED;
+        }
+        return (int)slot;
+    }
+
+    return -1;
+}
+
+static void
+testCheckHeader (
+        void
+        )
+{
+    SimBoard_t board;
+    BootSlotHeader_t header;
+
+    memset (&board, 0, sizeof (board));
+    mySimProgram (&board, 0, 1, 1, 1);
+    CHECK (myCheckSlotHeader (&board.header[0]) == 0);
+
+    /* Erased EEPROM */
+    memset (&header, 0xFF, sizeof (header));
+    CHECK (myCheckSlotHeader (&header) != 0);
+
+    /* Bad magic */
+    header = board.header[0];
+    header.magic ^= 1;
+    CHECK (myCheckSlotHeader (&header) != 0);
+
+    /* Header CRC covers the sequence, length and image CRC */
+    header = board.header[0];
+    header.sequence++;
+    CHECK (myCheckSlotHeader (&header) != 0);
+    header = board.header[0];
+    header.imageCrc ^= 0x80000000;
+    CHECK (myCheckSlotHeader (&header) != 0);
+
+    /* But not the boot count and confirmed fields, which are updated in place */
+    header = board.header[0];
+    header.bootCount = 2;
+    header.confirmed = BOOT_SLOT_CONFIRMED;
+    CHECK (myCheckSlotHeader (&header) == 0);
+
+    /* Length limits */
+    header = board.header[0];
+    header.length = SECTION_HEADER_SIZE - 1;
+    header.headerCrc = myCrc32 (0, (uint8_t *)&header, 16);
+    CHECK (myCheckSlotHeader (&header) != 0);
+    header.length = SECTION_HEADER_SIZE;
+    header.headerCrc = myCrc32 (0, (uint8_t *)&header, 16);
+    CHECK (myCheckSlotHeader (&header) == 0);
+    header.length = BOOT_SLOT_SIZE;
+    header.headerCrc = myCrc32 (0, (uint8_t *)&header, 16);
+    CHECK (myCheckSlotHeader (&header) == 0);
+    header.length = BOOT_SLOT_SIZE + 1;
+    header.headerCrc = myCrc32 (0, (uint8_t *)&header, 16);
+    CHECK (myCheckSlotHeader (&header) != 0);
+}
+
+static void
+testResetCause (
+        void
+        )
+{
+    SimBoard_t board;
+
+    memset (&board, 0, sizeof (board));
+    mySimProgram (&board, 0, 1, 1, 1);
+
+    /* A software reset starts the USB bootloader, unless the application asked for the stored image */
+    CHECK (mySimBoot (&board, GCTL_CONTROL_SW_RESET, CyFalse) == -1);
+    CHECK (board.header[0].bootCount == 0);
+    CHECK (mySimBoot (&board, GCTL_CONTROL_SW_RESET, CyTrue) == 0);
+
+    /* Power on and watchdog resets boot the stored image */
+    CHECK (mySimBoot (&board, GCTL_CONTROL_POR, CyFalse) == 0);
+    CHECK (mySimBoot (&board, GCTL_CONTROL_WDT_RESET, CyFalse) == 0);
+    CHECK (mySimBoot (&board, 0, CyFalse) == 0);
+
+    /* No valid slot */
+    memset (&board, 0xFF, sizeof (board.header));
+    CHECK (mySimBoot (&board, GCTL_CONTROL_POR, CyFalse) == -1);
+}
+
+static void
+testUpdate (
+        void
+        )
+{
+    SimBoard_t board;
+
+    memset (&board, 0, sizeof (board));
+
+    /* First image in slot A */
+    mySimProgram (&board, 0, 1, 1, 1);
+    CHECK (mySimBoot (&board, GCTL_CONTROL_POR, CyFalse) == 0);
+    CHECK (board.header[0].confirmed == BOOT_SLOT_CONFIRMED);
+    CHECK (board.header[0].bootCount == 1);
+
+    /* Good update to slot B: newest image is booted and confirmed, and stays booted */
+    mySimProgram (&board, 1, 2, 1, 1);
+    CHECK (mySimBoot (&board, GCTL_CONTROL_SW_RESET, CyTrue) == 1);
+    CHECK (board.header[1].confirmed == BOOT_SLOT_CONFIRMED);
+    CHECK (mySimBoot (&board, GCTL_CONTROL_POR, CyFalse) == 1);
+    CHECK (mySimBoot (&board, GCTL_CONTROL_WDT_RESET, CyFalse) == 1);
+    CHECK (board.header[1].bootCount == 1);
+
+    /* Update to slot A which starts but never confirms (hangs before USB enumerates): booted
+       BOOT_SLOT_MAX_TRIES times, then falls back to slot B */
+    mySimProgram (&board, 0, 3, 1, 0);
+    CHECK (mySimBoot (&board, GCTL_CONTROL_SW_RESET, CyTrue) == 0);
+    CHECK (mySimBoot (&board, GCTL_CONTROL_WDT_RESET, CyFalse) == 0);
+    CHECK (mySimBoot (&board, GCTL_CONTROL_WDT_RESET, CyFalse) == 0);
+    CHECK (board.header[0].bootCount == BOOT_SLOT_MAX_TRIES);
+    CHECK (mySimBoot (&board, GCTL_CONTROL_WDT_RESET, CyFalse) == 1);
+    CHECK (mySimBoot (&board, GCTL_CONTROL_POR, CyFalse) == 1);
+    CHECK (board.header[0].bootCount == BOOT_SLOT_MAX_TRIES);
+
+    /* Update to slot A which fails to load (CRC error): rejected at once, falls back to slot B in the same boot */
+    mySimProgram (&board, 0, 4, 0, 1);
+    CHECK (mySimBoot (&board, GCTL_CONTROL_SW_RESET, CyTrue) == 1);
+    CHECK (board.header[0].bootCount == BOOT_SLOT_REJECTED);
+    CHECK (mySimBoot (&board, GCTL_CONTROL_POR, CyFalse) == 1);
+    CHECK (board.header[0].bootCount == BOOT_SLOT_REJECTED);
+
+    /* Confirmed slot which fails to load is not rejected, but the other slot is booted */
+    mySimProgram (&board, 0, 5, 1, 1);
+    CHECK (mySimBoot (&board, GCTL_CONTROL_POR, CyFalse) == 0);
+    board.loads[0] = 0;
+    CHECK (mySimBoot (&board, GCTL_CONTROL_POR, CyFalse) == 1);
+    CHECK (board.header[0].bootCount == 1);
+    board.loads[0] = 1;
+    CHECK (mySimBoot (&board, GCTL_CONTROL_POR, CyFalse) == 0);
+
+    /* Both slots failing: USB bootloader */
+    board.loads[0] = 0;
+    board.loads[1] = 0;
+    CHECK (mySimBoot (&board, GCTL_CONTROL_POR, CyFalse) == -1);
+}
+
+static void
+testSequence (
+        void
+        )
+{
+    BootSlotHeader_t header[BOOT_SLOT_COUNT];
+    int valid[BOOT_SLOT_COUNT] = { 1, 1 };
+    uint32_t order[BOOT_SLOT_COUNT];
+
+    memset (header, 0, sizeof (header));
+    header[0].confirmed = BOOT_SLOT_CONFIRMED;
+    header[1].confirmed = BOOT_SLOT_CONFIRMED;
+
+    /* Newest first */
+    header[0].sequence = 7;
+    header[1].sequence = 8;
+    CHECK (mySelectBootSlots (header, valid, GCTL_CONTROL_POR, CyFalse, order) == 2);
+    CHECK ((order[0] == 1) && (order[1] == 0));
+    header[0].sequence = 9;
+    CHECK (mySelectBootSlots (header, valid, GCTL_CONTROL_POR, CyFalse, order) == 2);
+    CHECK ((order[0] == 0) && (order[1] == 1));
+
+    /* Sequence wrap: 0 is newer than 0xFFFFFFFF */
+    header[0].sequence = 0xFFFFFFFF;
+    header[1].sequence = 0;
+    CHECK (mySelectBootSlots (header, valid, GCTL_CONTROL_POR, CyFalse, order) == 2);
+    CHECK ((order[0] == 1) && (order[1] == 0));
+
+    /* An invalid slot is never selected, whatever its sequence */
+    valid[1] = 0;
+    CHECK (mySelectBootSlots (header, valid, GCTL_CONTROL_POR, CyFalse, order) == 1);
+    CHECK (order[0] == 0);
+    valid[0] = 0;
+    CHECK (mySelectBootSlots (header, valid, GCTL_CONTROL_POR, CyFalse, order) == 0);
+}
+
+int
+main (
+        void
+        )
+{
+    testCheckHeader ();
+    testResetCause ();
+    testUpdate ();
+    testSequence ();
+    return TEST_RESULT ();
+}
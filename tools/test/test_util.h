@@ -0,0 +1,42 @@
+/*
+ * test_util.h
+ *
+ *  Created on: Oct 17, 2020
+ *      Author: A. Nolan
+ *
+ *  Shared helpers for the host tests: a small deterministic random number generator and a little endian
+ *  word store. Define TEST_RAND_SEED before including this file to give a test its own random sequence.
+ */
+
+#ifndef TEST_UTIL_H_
+#define TEST_UTIL_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#ifndef TEST_RAND_SEED
+#define TEST_RAND_SEED  (1)
+#endif
+
+static uint32_t glRandState = TEST_RAND_SEED;
+
+static uint32_t
+myRand (
+        void
+        )
+{
+    glRandState = (glRandState * 1103515245u) + 12345u;
+    return glRandState >> 8;
+}
+
+/* Inline, so tests which do not build images do not warn about an unused function */
+static inline void
+myPut32 (
+        uint8_t *p,
+        uint32_t val
+        )
+{
+    memcpy (p, &val, 4);
+}
+
+#endif /* TEST_UTIL_H_ */